@@ -0,0 +1,438 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Sto.hh"
+
+namespace bench {
+
+// File of evicted rows in fixed-size slots, mapped into memory. Space is
+// reserved up front and the file is sparse, so only written pages take
+// disk. Rows are never rewritten in place: an evicted row gets a fresh slot
+// every time, and the table frees the slot of a row that was fetched or
+// overwritten once no reader can still be copying it. Appends reuse freed
+// slots before growing the file.
+class cold_file {
+public:
+    cold_file(const std::string& path, size_t capacity, size_t record_size)
+        : path_(path), capacity_(capacity), record_size_(record_size),
+          slot_size_((record_size + 7) & ~size_t(7)),
+          tail_(0), nfree_(0), dirty_lo_(~size_t(0)), dirty_hi_(0) {
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        always_assert(fd_ >= 0, "opening cold file");
+        always_assert(ftruncate(fd_, capacity) == 0, "sizing cold file");
+        void* p = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        always_assert(p != MAP_FAILED, "mapping cold file");
+        base_ = reinterpret_cast<char*>(p);
+    }
+    cold_file(const cold_file&) = delete;
+    cold_file& operator=(const cold_file&) = delete;
+
+    ~cold_file() {
+        munmap(base_, capacity_);
+        close(fd_);
+        unlink(path_.c_str());
+    }
+
+    // Writes a record from `data` to a free slot. Call from one thread at a
+    // time.
+    uint64_t append(const void* data) {
+        uint64_t off;
+        {
+            std::lock_guard<std::mutex> guard(free_lock_);
+            if (!free_.empty()) {
+                off = free_.back();
+                free_.pop_back();
+                nfree_.store(free_.size(), std::memory_order_relaxed);
+            } else {
+                off = tail_.load(std::memory_order_relaxed);
+                always_assert(off + slot_size_ <= capacity_, "cold file full");
+                tail_.store(off + slot_size_, std::memory_order_relaxed);
+            }
+        }
+        memcpy(base_ + off, data, record_size_);
+        dirty_lo_ = std::min(dirty_lo_, size_t(off));
+        dirty_hi_ = std::max(dirty_hi_, size_t(off + slot_size_));
+        return off;
+    }
+
+    void read(uint64_t off, void* data, size_t len) const {
+        memcpy(data, base_ + off, len);
+    }
+
+    // The slot at `off` may be reused
+    void free_slot(uint64_t off) {
+        std::lock_guard<std::mutex> guard(free_lock_);
+        free_.push_back(off);
+        nfree_.store(free_.size(), std::memory_order_relaxed);
+    }
+
+    // Write back the slots appended since the last call and drop their
+    // pages from the page cache; later reads fault them back in from the
+    // file. Call from the appending thread.
+    void release() {
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t lo = dirty_lo_ & ~(page - 1), hi = std::min((dirty_hi_ + page - 1) & ~(page - 1), capacity_);
+        if (lo >= hi)
+            return;
+        msync(base_ + lo, hi - lo, MS_SYNC);
+        posix_fadvise(fd_, lo, hi - lo, POSIX_FADV_DONTNEED);
+        madvise(base_ + lo, hi - lo, MADV_DONTNEED);
+        dirty_lo_ = ~size_t(0);
+        dirty_hi_ = 0;
+    }
+
+    // Bytes of rows held, and of slots ever used
+    size_t bytes() const {
+        return tail_.load(std::memory_order_relaxed) - nfree_.load(std::memory_order_relaxed) * slot_size_;
+    }
+    size_t file_bytes() const {
+        return tail_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::string path_;
+    size_t capacity_;
+    size_t record_size_;
+    size_t slot_size_;
+    int fd_;
+    char* base_;
+    std::atomic<size_t> tail_;
+    std::atomic<size_t> nfree_;
+    std::mutex free_lock_;
+    std::vector<uint64_t> free_;
+    size_t dirty_lo_;   // appending thread only
+    size_t dirty_hi_;
+};
+
+// Anti-caching table: a fixed key set whose rows can be evicted to a
+// cold_file and are fetched back when a transaction touches them.
+//
+// Each entry's row word holds either a pointer to the in-memory row or a
+// stub, (file offset << 1) | 1. Rows are immutable once published: commits
+// install a new row and RCU-free the old one, so evicting, fetching and
+// installing only ever swap the row word, and never touch the version.
+// Eviction swaps a pointer for a stub, and a fetch swaps that exact stub
+// back for a row read from it; a fetch that loses to a commit is dropped.
+// Whoever replaces a stub frees its file slot through RCU, so a racing
+// fetch never reads a reused slot.
+//
+// Accesses are sampled into per-entry reference bits, and a single evictor
+// thread runs CLOCK over the entries whenever more than `max_hot` rows are
+// in memory. On touching a stub, a transaction either reads the row itself
+// (fetch_policy::block) or hands it to the prefetcher thread and aborts
+// (fetch_policy::abort_and_prefetch), so a retry usually finds it in memory
+// without the transaction having waited on I/O.
+template <typename K, typename V, typename Version = TNonopaqueVersion>
+class anticache_table : public TObject {
+public:
+    typedef K key_type;
+    typedef V value_type;
+    typedef Version version_type;
+    typedef std::tuple<bool, bool, const V*> sel_return_type;
+    static_assert(std::is_trivially_copyable<V>::value, "Evicted rows are copied byte for byte.");
+
+    enum class fetch_policy : int { block = 0, abort_and_prefetch };
+
+    static constexpr unsigned sample_period = 8;    // track 1 access in N
+
+    anticache_table(const std::string& cold_path, size_t cold_capacity,
+                    fetch_policy policy = fetch_policy::block)
+        : file_(std::make_shared<cold_file>(cold_path, cold_capacity, sizeof(V))), policy_(policy), hot_(0),
+          max_hot_(~size_t(0)), hand_(0), run_(false) {}
+
+    ~anticache_table() override {
+        stop();
+        for (auto e : entries_) {
+            uintptr_t w = e->row.load(std::memory_order_relaxed);
+            if (!is_stub(w))
+                delete reinterpret_cast<V*>(w);
+            delete e;
+        }
+    }
+
+    // Loading: the key set is fixed once transactions start
+    void nontrans_put(const K& key, const V& value) {
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            entry* e = new entry(key);
+            map_.emplace(key, e);
+            entries_.push_back(e);
+            it = map_.find(key);
+        }
+        uintptr_t old = it->second->row.exchange(reinterpret_cast<uintptr_t>(new V(value)));
+        if (is_stub(old)) {
+            ++hot_;
+            if (old != 1)
+                file_->free_slot(old >> 1);
+        } else
+            delete reinterpret_cast<V*>(old);
+    }
+
+    sel_return_type select_row(const K& key) {
+        auto it = map_.find(key);
+        if (it == map_.end())
+            return sel_return_type(true, false, nullptr);
+        entry* e = it->second;
+        auto item = Sto::item(this, e);
+        if (item.has_write())
+            return sel_return_type(true, true, &item.template write_value<V>());
+        if (!item.observe(e->version))
+            return sel_return_type(false, false, nullptr);
+        sample(e);
+        const V* row = resident_row(e);
+        if (!row)
+            return sel_return_type(false, false, nullptr);
+        return sel_return_type(true, true, row);
+    }
+
+    // Blind update of an existing key
+    bool update_row(const K& key, const V& value) {
+        auto it = map_.find(key);
+        if (it == map_.end())
+            return false;
+        sample(it->second);
+        Sto::item(this, it->second).add_write(value);
+        return true;
+    }
+
+    bool lock(TransItem& item, Transaction& txn) override {
+        return txn.try_lock(item, item.key<entry*>()->version);
+    }
+    bool check(TransItem& item, Transaction& txn) override {
+        return item.key<entry*>()->version.cp_check_version(txn, item);
+    }
+    void install(TransItem& item, Transaction& txn) override {
+        entry* e = item.key<entry*>();
+        uintptr_t old = e->row.exchange(reinterpret_cast<uintptr_t>(new V(item.template write_value<V>())),
+                                        std::memory_order_acq_rel);
+        if (is_stub(old)) {
+            hot_.fetch_add(1, std::memory_order_relaxed);
+            retire_slot(old);
+        } else
+            Transaction::rcu_delete(reinterpret_cast<V*>(old));
+        txn.set_version_unlock(e->version, item);
+    }
+    void unlock(TransItem& item) override {
+        item.key<entry*>()->version.cp_unlock(item);
+    }
+
+    // Evict until at most `max_hot` rows are in memory, in the background
+    void start(size_t max_hot, int evictor_thread_id, int prefetcher_thread_id) {
+        max_hot_ = max_hot;
+        run_ = true;
+        evictor_ = std::thread([this, evictor_thread_id] {
+            TThread::set_id(evictor_thread_id);
+            while (run_.load(std::memory_order_relaxed)) {
+                size_t n = evict(max_hot_);
+                Transaction::quiesce();
+                if (!n)
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+        prefetcher_ = std::thread([this, prefetcher_thread_id] {
+            TThread::set_id(prefetcher_thread_id);
+            std::unique_lock<std::mutex> guard(queue_lock_);
+            while (run_.load(std::memory_order_relaxed)) {
+                if (queue_.empty()) {
+                    queue_cv_.wait(guard);
+                    continue;
+                }
+                entry* e = queue_.front();
+                queue_.pop_front();
+                guard.unlock();
+                {
+                    // keeps RCU from freeing the slot it reads from
+                    TransactionGuard txn;
+                    fetch(e);
+                }
+                Transaction::quiesce();
+                e->queued.store(false, std::memory_order_release);
+                guard.lock();
+            }
+        });
+    }
+
+    void stop() {
+        if (!run_.exchange(false))
+            return;
+        {
+            std::lock_guard<std::mutex> guard(queue_lock_);
+            queue_cv_.notify_all();
+        }
+        evictor_.join();
+        prefetcher_.join();
+    }
+
+    // One CLOCK pass toward `max_hot` resident rows. Returns the number
+    // of rows evicted. Call from one thread at a time.
+    size_t evict(size_t max_hot) {
+        size_t n = entries_.size(), evicted = 0;
+        if (!n || hot_.load(std::memory_order_relaxed) <= max_hot)
+            return 0;
+        // The transaction scope lets RCU free the evicted rows
+        TransactionGuard guard;
+        for (size_t i = 0; i != 2 * n && hot_.load(std::memory_order_relaxed) > max_hot; ++i) {
+            entry* e = entries_[hand_];
+            hand_ = (hand_ + 1) % n;
+            uintptr_t w = e->row.load(std::memory_order_acquire);
+            if (is_stub(w) || e->referenced.exchange(false, std::memory_order_relaxed))
+                continue;
+            uint64_t off = file_->append(reinterpret_cast<V*>(w));
+            if (e->row.compare_exchange_strong(w, (off << 1) | 1, std::memory_order_acq_rel)) {
+                Transaction::rcu_delete(reinterpret_cast<V*>(w));
+                hot_.fetch_sub(1, std::memory_order_relaxed);
+                ++evicted;
+            } else {
+                // no stub points at it yet
+                file_->free_slot(off);
+            }
+        }
+        nevictions_.fetch_add(evicted, std::memory_order_relaxed);
+        file_->release();
+        return evicted;
+    }
+
+    size_t size() const {
+        return entries_.size();
+    }
+    size_t resident_rows() const {
+        return hot_.load(std::memory_order_relaxed);
+    }
+    size_t evictions() const {
+        return nevictions_.load(std::memory_order_relaxed);
+    }
+    size_t fetches() const {
+        return nfetches_.load(std::memory_order_relaxed);
+    }
+    size_t cold_misses() const {
+        return nmisses_.load(std::memory_order_relaxed);
+    }
+    // Bytes of evicted rows, and of the cold file's slots ever used
+    size_t cold_bytes() const {
+        return file_->bytes();
+    }
+    size_t cold_file_bytes() const {
+        return file_->file_bytes();
+    }
+
+    void print_stats(std::ostream& w) const {
+        w << "Anti-caching: " << resident_rows() << "/" << size() << " rows resident, "
+          << cold_misses() << " cold accesses, " << fetches() << " fetches, "
+          << evictions() << " evictions, " << file_->bytes() << " cold bytes in a "
+          << file_->file_bytes() << "-byte file" << std::endl;
+    }
+
+private:
+    struct entry {
+        K key;
+        version_type version;
+        std::atomic<uintptr_t> row;
+        std::atomic<bool> referenced;
+        std::atomic<bool> queued;
+
+        explicit entry(const K& k)
+            : key(k), version(Sto::initialized_tid()), row(1),
+              referenced(false), queued(false) {}
+    };
+
+    static bool is_stub(uintptr_t w) {
+        return w & 1;
+    }
+
+    struct retired_slot {
+        std::shared_ptr<cold_file> file;
+        uint64_t off;
+    };
+
+    // Frees the slot of a stub that was just replaced, once no fetch can
+    // still be reading it
+    void retire_slot(uintptr_t stub) {
+        Transaction::rcu_call(free_retired_slot, new retired_slot{file_, stub >> 1});
+    }
+    static void free_retired_slot(void* x) {
+        auto r = static_cast<retired_slot*>(x);
+        r->file->free_slot(r->off);
+        delete r;
+    }
+
+    void sample(entry* e) {
+        static __thread unsigned n;
+        if (++n % sample_period == 0 && !e->referenced.load(std::memory_order_relaxed))
+            e->referenced.store(true, std::memory_order_relaxed);
+    }
+
+    // The row, or nullptr if the transaction must abort for a fetch
+    const V* resident_row(entry* e) {
+        uintptr_t w = e->row.load(std::memory_order_acquire);
+        if (!is_stub(w))
+            return reinterpret_cast<const V*>(w);
+        nmisses_.fetch_add(1, std::memory_order_relaxed);
+        // a cold row is worth keeping for a while
+        e->referenced.store(true, std::memory_order_relaxed);
+        // without a prefetcher running, every fetch blocks
+        if (policy_ == fetch_policy::block || !run_.load(std::memory_order_relaxed))
+            return fetch(e);
+        if (!e->queued.exchange(true, std::memory_order_acq_rel)) {
+            std::lock_guard<std::mutex> guard(queue_lock_);
+            queue_.push_back(e);
+            queue_cv_.notify_one();
+        }
+        return nullptr;
+    }
+
+    const V* fetch(entry* e) {
+        uintptr_t w = e->row.load(std::memory_order_acquire);
+        if (!is_stub(w))
+            return reinterpret_cast<const V*>(w);
+        V* row = new V;
+        file_->read(w >> 1, row, sizeof(V));
+        if (e->row.compare_exchange_strong(w, reinterpret_cast<uintptr_t>(row), std::memory_order_acq_rel)) {
+            retire_slot(w);
+            hot_.fetch_add(1, std::memory_order_relaxed);
+            nfetches_.fetch_add(1, std::memory_order_relaxed);
+            return row;
+        }
+        // evicted again or overwritten meanwhile; w now holds the newer word
+        delete row;
+        return is_stub(w) ? fetch(e) : reinterpret_cast<const V*>(w);
+    }
+
+    // shared with pending retire_slot callbacks, which may outlive the table
+    std::shared_ptr<cold_file> file_;
+    fetch_policy policy_;
+    std::unordered_map<K, entry*> map_;
+    std::vector<entry*> entries_;
+
+    std::atomic<size_t> hot_;
+    size_t max_hot_;
+    size_t hand_;
+    std::atomic<size_t> nevictions_ = {0};
+    std::atomic<size_t> nfetches_ = {0};
+    std::atomic<size_t> nmisses_ = {0};
+
+    std::atomic<bool> run_;
+    std::thread evictor_;
+    std::thread prefetcher_;
+    std::mutex queue_lock_;
+    std::condition_variable queue_cv_;
+    std::deque<entry*> queue_;
+};
+
+}; // namespace bench
@@ -0,0 +1,619 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <immintrin.h>
+
+#include "Sto.hh"
+
+namespace bench {
+
+// Receives a table's committed row images; see ordered_index::set_mirror()
+template <typename K, typename V>
+class table_mirror {
+public:
+    virtual ~table_mirror() = default;
+    // `row` is the whole row of `key` as of a commit in `epoch`
+    virtual void append(const K& key, const V& row, uint64_t epoch) = 0;
+    virtual void remove(const K& key, uint64_t epoch) = 0;
+};
+
+// A read-optimized, PAX-style copy of selected int64 columns of a table.
+//
+// Every committed insert or update appends the row's new image to the tail
+// chunk, column by column, and ends the key's previous image; deletes end
+// it too. An image is stamped with its transaction's commit epoch (see
+// Transaction::commit_epoch()), so a scan at epoch S sees exactly the
+// images committed by epoch S that no commit by epoch S replaced: a
+// consistent snapshot, which never blocks writers. snapshot() is the newest
+// S no running transaction can still commit into, and moves with the epoch
+// advancer (--gc in the benchmarks).
+//
+// Chunks keep per-column min/max zone maps, so range filters skip whole
+// chunks, and filter and aggregate kernels use AVX2 when the CPU has it.
+//
+// reclaim() frees chunks whose images ended before any snapshot still in
+// use, and first moves the live images out of mostly replaced chunks; a
+// moved image ends its old copy at an epoch no running scan can see, so
+// each scan still counts it once. Scans must pin() their snapshot while
+// reclaim() can run, and run in a transaction, since freed chunks go
+// through RCU. Rows of split tables that commit different cells
+// concurrently can expose one commit's cells at the other's epoch.
+template <typename K, typename V>
+class column_mirror : public table_mirror<K, V> {
+public:
+    typedef std::function<int64_t(const K&, const V&)> extractor_type;
+
+    static constexpr size_t chunk_rows = 1024;
+    static constexpr size_t max_chunks = size_t(1) << 18;
+    static constexpr int max_filters = 4;
+    // chunks reclaim() examines each time a chunk fills
+    static constexpr size_t reclaim_step = 4;
+    static_assert(std::is_trivially_copyable<K>::value && alignof(K) <= alignof(int64_t),
+                  "keys are stored in chunks");
+
+    struct column {
+        std::string name;
+        extractor_type extract;
+    };
+
+    // Rows with column `col` in [lo, hi]
+    struct range {
+        int col;
+        int64_t lo;
+        int64_t hi;
+    };
+
+    struct aggregate {
+        uint64_t count = 0;
+        int64_t sum = 0;
+        int64_t min = std::numeric_limits<int64_t>::max();
+        int64_t max = std::numeric_limits<int64_t>::min();
+
+        void add(int64_t x) {
+            ++count;
+            sum += x;
+            min = std::min(min, x);
+            max = std::max(max, x);
+        }
+        void merge(const aggregate& a) {
+            count += a.count;
+            sum += a.sum;
+            min = std::min(min, a.min);
+            max = std::max(max, a.max);
+        }
+    };
+
+    explicit column_mirror(std::vector<column> columns)
+        : columns_(std::move(columns)), chunks_(new std::atomic<chunk*>[max_chunks]()),
+          nchunks_(1), tail_(0), hand_(0), bound_(0), pins_(),
+          next_(0), chunks_scanned_(0), chunks_skipped_(0), moved_(0), reclaimed_(0) {
+        chunks_[0].store(chunk::make(ncolumns()), std::memory_order_relaxed);
+    }
+    ~column_mirror() override {
+        for (size_t i = 0; i != nchunks_.load(std::memory_order_relaxed); ++i)
+            if (chunk* c = chunks_[i].load(std::memory_order_relaxed))
+                chunk::free(c);
+    }
+    column_mirror(const column_mirror&) = delete;
+    column_mirror& operator=(const column_mirror&) = delete;
+
+    int ncolumns() const {
+        return int(columns_.size());
+    }
+    int column_index(const std::string& name) const {
+        for (int i = 0; i != ncolumns(); ++i)
+            if (columns_[i].name == name)
+                return i;
+        return -1;
+    }
+    // Images appended so far, including replaced ones
+    uint64_t images() const {
+        return next_.load(std::memory_order_acquire);
+    }
+    uint64_t chunks_scanned() const {
+        return chunks_scanned_.load(std::memory_order_relaxed);
+    }
+    uint64_t chunks_skipped() const {
+        return chunks_skipped_.load(std::memory_order_relaxed);
+    }
+    uint64_t images_moved() const {
+        return moved_.load(std::memory_order_relaxed);
+    }
+    uint64_t chunks_reclaimed() const {
+        return reclaimed_.load(std::memory_order_relaxed);
+    }
+    size_t chunks_in_use() {
+        std::lock_guard<std::mutex> guard(alloc_lock_);
+        return nchunks_.load(std::memory_order_relaxed) - free_chunks_.size();
+    }
+
+    static uint64_t snapshot() {
+        return oldest_commit_epoch() - 1;
+    }
+
+    // Pins a snapshot for this thread's scans: reclaim() keeps the images
+    // visible at it until unpin()
+    uint64_t pin() {
+        auto& p = pins_[TThread::id()];
+        uint64_t s;
+        do {
+            s = snapshot();
+            p.store(s + 1);
+            // a reclaim() that missed the pin used a bound no newer than s
+        } while (s < bound_.load());
+        return s;
+    }
+    void unpin() {
+        pins_[TThread::id()].store(0, std::memory_order_release);
+    }
+
+    // Use the AVX2 kernels if the CPU has them; for testing
+    static void set_vectorized(bool on) {
+        vectorized() = on && cpu_has_avx2();
+    }
+
+    void append(const K& key, const V& row, uint64_t epoch) override {
+        bool opened = false;
+        {
+            auto& sh = shard_of(key);
+            std::lock_guard<std::mutex> guard(sh.lock);
+            uint64_t slot = write_image(key, epoch, [&] (int col) {
+                return columns_[col].extract(key, row);
+            }, opened);
+
+            auto it = sh.last.find(key);
+            if (it != sh.last.end()) {
+                end_image(it->second, epoch);
+                it->second = slot;
+            } else
+                sh.last.emplace(key, slot);
+        }
+        // reclaim() takes shard locks
+        if (opened)
+            reclaim(reclaim_step);
+    }
+
+    void remove(const K& key, uint64_t epoch) override {
+        auto& sh = shard_of(key);
+        std::lock_guard<std::mutex> guard(sh.lock);
+        auto it = sh.last.find(key);
+        if (it != sh.last.end()) {
+            end_image(it->second, epoch);
+            sh.last.erase(it);
+        }
+    }
+
+    // Aggregates column `col` over the rows visible at `snapshot` that pass
+    // every filter
+    aggregate scan(uint64_t snapshot, int col, std::initializer_list<range> filters = {}) {
+        aggregate a;
+        for_each_chunk(filters, [&] (const chunk* c, size_t n, const range* f, int nf) {
+            if (vectorized())
+                scan_chunk_avx2(c, n, snapshot, f, nf, col, a);
+            else
+                scan_chunk(c, n, snapshot, f, nf, col, a);
+        });
+        return a;
+    }
+
+    // Aggregates column `col` per value of column `group_col`, which must
+    // be in [0, groups.size())
+    void group_scan(uint64_t snapshot, int group_col, int col, std::vector<aggregate>& groups,
+                    std::initializer_list<range> filters = {}) {
+        uint64_t bits[chunk_rows / 64];
+        for_each_chunk(filters, [&] (const chunk* c, size_t n, const range* f, int nf) {
+            if (vectorized())
+                filter_chunk_avx2(c, n, snapshot, f, nf, bits);
+            else
+                filter_chunk(c, n, snapshot, f, nf, bits);
+            const int64_t* g = c->values(group_col);
+            const int64_t* x = c->values(col);
+            for (size_t w = 0; w != (n + 63) / 64; ++w)
+                for (uint64_t m = bits[w]; m; m &= m - 1) {
+                    size_t i = w * 64 + __builtin_ctzll(m);
+                    assert(g[i] >= 0 && size_t(g[i]) < groups.size());
+                    groups[g[i]].add(x[i]);
+                }
+        });
+    }
+
+    // Examines up to `nexamine` chunks: frees those whose images all ended
+    // before every snapshot in use, and moves the live images out of chunks
+    // that are at least half replaced so a later pass can free them.
+    // Returns the number of chunks freed. Concurrent calls return 0.
+    size_t reclaim(size_t nexamine = max_chunks) {
+        std::unique_lock<std::mutex> guard(reclaim_lock_, std::try_to_lock);
+        if (!guard.owns_lock())
+            return 0;
+        uint64_t bound = pinned_bound();
+        size_t n = nchunks_.load(std::memory_order_acquire), freed = 0;
+        for (size_t k = 0; k != std::min(nexamine, n); ++k) {
+            size_t ci = hand_;
+            hand_ = hand_ + 1 < n ? hand_ + 1 : 0;
+            chunk* c = chunks_[ci].load(std::memory_order_acquire);
+            if (!c || ci == tail_.load(std::memory_order_acquire)
+                || c->used.load(std::memory_order_acquire) < chunk_rows)
+                continue;
+            size_t nlive = 0;
+            bool written = true, expired = true;
+            for (size_t i = 0; i != chunk_rows && written; ++i) {
+                written = __atomic_load_n(&c->begin[i], __ATOMIC_ACQUIRE) != 0;
+                int64_t e = __atomic_load_n(&c->end[i], __ATOMIC_ACQUIRE);
+                if (e == live)
+                    ++nlive;
+                else if (uint64_t(e) > bound)
+                    expired = false;
+            }
+            if (!written)
+                continue;
+            if (!nlive && expired) {
+                retire_chunk(ci, c);
+                ++freed;
+            } else if (nlive && nlive <= chunk_rows / 2)
+                move_live(ci, c);
+        }
+        reclaimed_.fetch_add(freed, std::memory_order_relaxed);
+        return freed;
+    }
+
+    void print_stats(std::ostream& out, const std::string& name) {
+        out << name << " mirror: " << images() << " images, " << chunks_in_use()
+            << " chunks in use, " << chunks_reclaimed() << " reclaimed, " << images_moved()
+            << " images moved, " << chunks_scanned() << " chunks scanned, " << chunks_skipped()
+            << " skipped by zone maps" << std::endl;
+    }
+
+private:
+    static constexpr int64_t live = std::numeric_limits<int64_t>::max();
+
+    // begin[i] is image i's epoch plus one, or 0 while it is being written;
+    // end[i] is the epoch that replaced it, or `live`. Then one array of
+    // chunk_rows values per column, each column's zone map, and the images'
+    // keys.
+    struct alignas(32) chunk {
+        int64_t begin[chunk_rows];
+        int64_t end[chunk_rows];
+        int ncols;
+        std::atomic<uint32_t> used;   // slots handed out; overshoots when full
+
+        int64_t* values(int col) {
+            return reinterpret_cast<int64_t*>(this + 1) + col * chunk_rows;
+        }
+        const int64_t* values(int col) const {
+            return const_cast<chunk*>(this)->values(col);
+        }
+        int64_t* zone(int col) {
+            return values(ncols) + 2 * col;
+        }
+        const int64_t* zone(int col) const {
+            return const_cast<chunk*>(this)->zone(col);
+        }
+        K* keys() {
+            return reinterpret_cast<K*>(zone(ncols));
+        }
+        size_t rows() const {
+            return std::min<size_t>(used.load(std::memory_order_acquire), chunk_rows);
+        }
+
+        void widen(int col, int64_t x) {
+            int64_t* z = zone(col);
+            int64_t v = __atomic_load_n(&z[0], __ATOMIC_RELAXED);
+            while (x < v && !__atomic_compare_exchange_n(&z[0], &v, x, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                /* retry */;
+            v = __atomic_load_n(&z[1], __ATOMIC_RELAXED);
+            while (x > v && !__atomic_compare_exchange_n(&z[1], &v, x, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                /* retry */;
+        }
+
+        static size_t bytes(int ncols) {
+            return sizeof(chunk) + sizeof(int64_t) * (ncols * chunk_rows + 2 * ncols) + sizeof(K) * chunk_rows;
+        }
+        static chunk* make(int ncols) {
+            size_t sz = bytes(ncols);
+            void* p = HugeArena::allocate(sz, 32);
+            memset(p, 0, sz);
+            chunk* c = new (p) chunk;
+            c->ncols = ncols;
+            c->used.store(0, std::memory_order_relaxed);
+            for (int col = 0; col != ncols; ++col) {
+                c->zone(col)[0] = std::numeric_limits<int64_t>::max();
+                c->zone(col)[1] = std::numeric_limits<int64_t>::min();
+            }
+            return c;
+        }
+        static void free(chunk* c) {
+            HugeArena::deallocate(c, bytes(c->ncols), 32);
+        }
+        static void free_cb(void* p) {
+            free(static_cast<chunk*>(p));
+        }
+    };
+    static_assert(sizeof(chunk) % 32 == 0, "column arrays are AVX2 aligned");
+
+    struct key_hash {
+        size_t operator()(const K& k) const {
+            auto p = reinterpret_cast<const unsigned char*>(&k);
+            uint64_t h = 14695981039346656037ULL;
+            for (size_t i = 0; i != sizeof(K); ++i)
+                h = (h ^ p[i]) * 1099511628211ULL;
+            return h;
+        }
+    };
+
+    static constexpr int nshards = 64;
+    struct shard {
+        std::mutex lock;
+        std::unordered_map<K, uint64_t, key_hash> last;
+    };
+
+    std::vector<column> columns_;
+    std::unique_ptr<std::atomic<chunk*>[]> chunks_;
+    std::atomic<size_t> nchunks_;       // chunk indexes ever used
+    std::atomic<size_t> tail_;          // chunk being appended to
+    std::mutex alloc_lock_;
+    std::vector<size_t> free_chunks_;   // alloc_lock_
+    std::mutex reclaim_lock_;
+    size_t hand_;                       // reclaim_lock_
+    std::atomic<uint64_t> bound_;       // last bound reclaim() started from
+    std::atomic<uint64_t> pins_[MAX_THREADS];   // pinned snapshot plus one
+    std::atomic<uint64_t> next_;
+    shard shards_[nshards];
+    std::atomic<uint64_t> chunks_scanned_;
+    std::atomic<uint64_t> chunks_skipped_;
+    std::atomic<uint64_t> moved_;
+    std::atomic<uint64_t> reclaimed_;
+
+    static bool cpu_has_avx2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+    static bool& vectorized() {
+        static bool on = cpu_has_avx2();
+        return on;
+    }
+
+    shard& shard_of(const K& key) {
+        return shards_[key_hash()(key) % nshards];
+    }
+
+    // No running or future transaction commits at an earlier epoch
+    static uint64_t oldest_commit_epoch() {
+        return Transaction::global_epochs.read_epoch.load();
+    }
+
+    // Writes an image of `key` with column values value(col) to a fresh
+    // slot, and returns the slot. Sets `opened` if it started a chunk.
+    template <typename F>
+    uint64_t write_image(const K& key, uint64_t epoch, F value, bool& opened) {
+        uint64_t slot = allocate_slot(opened);
+        chunk* c = chunks_[slot / chunk_rows].load(std::memory_order_acquire);
+        size_t i = slot % chunk_rows;
+        c->keys()[i] = key;
+        for (int col = 0; col != ncolumns(); ++col) {
+            int64_t x = value(col);
+            c->values(col)[i] = x;
+            c->widen(col, x);
+        }
+        c->end[i] = live;
+        __atomic_store_n(&c->begin[i], int64_t(epoch) + 1, __ATOMIC_RELEASE);
+        next_.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    uint64_t allocate_slot(bool& opened) {
+        while (true) {
+            size_t ci = tail_.load(std::memory_order_acquire);
+            chunk* c = chunks_[ci].load(std::memory_order_acquire);
+            uint32_t i = c->used.fetch_add(1, std::memory_order_relaxed);
+            if (i < chunk_rows)
+                return ci * chunk_rows + i;
+            opened |= open_chunk(ci);
+        }
+    }
+
+    // Replaces the full tail chunk `full` with a fresh one
+    bool open_chunk(size_t full) {
+        std::lock_guard<std::mutex> guard(alloc_lock_);
+        if (tail_.load(std::memory_order_relaxed) != full)
+            return false;
+        size_t ci = nchunks_.load(std::memory_order_relaxed);
+        if (!free_chunks_.empty()) {
+            ci = free_chunks_.back();
+            free_chunks_.pop_back();
+        } else {
+            always_assert(ci < max_chunks, "column mirror full");
+            nchunks_.store(ci + 1, std::memory_order_release);
+        }
+        chunks_[ci].store(chunk::make(ncolumns()), std::memory_order_release);
+        tail_.store(ci, std::memory_order_release);
+        return true;
+    }
+
+    // The oldest snapshot a pinned or future scan can use. Publishes the
+    // unpinned bound first; see pin().
+    uint64_t pinned_bound() {
+        uint64_t b = snapshot();
+        bound_.store(b);
+        for (auto& p : pins_) {
+            uint64_t s = p.load();
+            if (s && s - 1 < b)
+                b = s - 1;
+        }
+        return b;
+    }
+
+    // Copies chunk `ci`'s live images to the tail. The copy begins, and the
+    // original ends, at an epoch no running scan or commit is below, and
+    // the copy is written first, so no scan counts the image twice.
+    void move_live(size_t ci, chunk* c) {
+        for (size_t i = 0; i != chunk_rows; ++i) {
+            if (__atomic_load_n(&c->end[i], __ATOMIC_ACQUIRE) != live)
+                continue;
+            K key = c->keys()[i];
+            uint64_t slot = ci * chunk_rows + i;
+            auto& sh = shard_of(key);
+            std::lock_guard<std::mutex> guard(sh.lock);
+            auto it = sh.last.find(key);
+            if (it == sh.last.end() || it->second != slot)
+                continue;
+            uint64_t epoch = std::max(oldest_commit_epoch(), uint64_t(c->begin[i] - 1));
+            bool opened = false;
+            it->second = write_image(key, epoch, [&] (int col) {
+                return c->values(col)[i];
+            }, opened);
+            end_image(slot, epoch);
+            moved_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void retire_chunk(size_t ci, chunk* c) {
+        chunks_[ci].store(nullptr, std::memory_order_release);
+        // scans may still be reading it
+        Transaction::rcu_call(chunk::free_cb, c);
+        std::lock_guard<std::mutex> guard(alloc_lock_);
+        free_chunks_.push_back(ci);
+    }
+
+    void end_image(uint64_t slot, uint64_t epoch) {
+        chunk* c = chunks_[slot / chunk_rows].load(std::memory_order_acquire);
+        __atomic_store_n(&c->end[slot % chunk_rows], int64_t(epoch), __ATOMIC_RELEASE);
+    }
+
+    // Calls f(chunk, rows, filters, nfilters) for each chunk the filters'
+    // zone maps don't rule out. Filters a zone map fully covers are dropped.
+    template <typename F>
+    void for_each_chunk(std::initializer_list<range> filters, F f) {
+        always_assert(filters.size() <= max_filters, "too many scan filters");
+        size_t n = nchunks_.load(std::memory_order_acquire);
+        for (size_t ci = 0; ci != n; ++ci) {
+            const chunk* c = chunks_[ci].load(std::memory_order_acquire);
+            if (!c)
+                continue;
+            range need[max_filters];
+            int nneed = 0;
+            bool skip = false;
+            for (auto& r : filters) {
+                const int64_t* z = c->zone(r.col);
+                if (r.hi < z[0] || r.lo > z[1]) {
+                    skip = true;
+                    break;
+                }
+                if (r.lo > z[0] || r.hi < z[1])
+                    need[nneed++] = r;
+            }
+            if (skip) {
+                chunks_skipped_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            chunks_scanned_.fetch_add(1, std::memory_order_relaxed);
+            f(c, c->rows(), need, nneed);
+        }
+    }
+
+    static bool visible(const chunk* c, size_t i, uint64_t snapshot, const range* f, int nf) {
+        int64_t b = __atomic_load_n(&c->begin[i], __ATOMIC_ACQUIRE);
+        int64_t e = __atomic_load_n(&c->end[i], __ATOMIC_RELAXED);
+        bool ok = b > 0 && b <= int64_t(snapshot) + 1 && e > int64_t(snapshot);
+        for (int k = 0; k != nf; ++k) {
+            int64_t x = c->values(f[k].col)[i];
+            ok &= x >= f[k].lo && x <= f[k].hi;
+        }
+        return ok;
+    }
+
+    static void scan_chunk(const chunk* c, size_t n, uint64_t snapshot, const range* f, int nf,
+                           int col, aggregate& a) {
+        const int64_t* x = c->values(col);
+        for (size_t i = 0; i != n; ++i)
+            if (visible(c, i, snapshot, f, nf))
+                a.add(x[i]);
+    }
+
+    static void filter_chunk(const chunk* c, size_t n, uint64_t snapshot, const range* f, int nf,
+                             uint64_t* bits) {
+        memset(bits, 0, sizeof(uint64_t) * chunk_rows / 64);
+        for (size_t i = 0; i != n; ++i)
+            if (visible(c, i, snapshot, f, nf))
+                bits[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    // Lanes of rows i..i+3 that are visible and pass the filters
+    __attribute__((target("avx2")))
+    static __m256i mask4_avx2(const chunk* c, size_t i, __m256i s, __m256i s1,
+                              const range* f, int nf) {
+        __m256i b = _mm256_load_si256(reinterpret_cast<const __m256i*>(&c->begin[i]));
+        __m256i e = _mm256_load_si256(reinterpret_cast<const __m256i*>(&c->end[i]));
+        __m256i m = _mm256_andnot_si256(_mm256_cmpgt_epi64(b, s1),
+                                        _mm256_cmpgt_epi64(b, _mm256_setzero_si256()));
+        m = _mm256_and_si256(m, _mm256_cmpgt_epi64(e, s));
+        for (int k = 0; k != nf; ++k) {
+            __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(&c->values(f[k].col)[i]));
+            __m256i out = _mm256_or_si256(_mm256_cmpgt_epi64(_mm256_set1_epi64x(f[k].lo), x),
+                                          _mm256_cmpgt_epi64(x, _mm256_set1_epi64x(f[k].hi)));
+            m = _mm256_andnot_si256(out, m);
+        }
+        return m;
+    }
+
+    __attribute__((target("avx2")))
+    static void scan_chunk_avx2(const chunk* c, size_t n, uint64_t snapshot, const range* f, int nf,
+                                int col, aggregate& a) {
+        const int64_t* x = c->values(col);
+        __m256i s = _mm256_set1_epi64x(int64_t(snapshot));
+        __m256i s1 = _mm256_set1_epi64x(int64_t(snapshot) + 1);
+        __m256i sum = _mm256_setzero_si256(), count = _mm256_setzero_si256();
+        __m256i mn = _mm256_set1_epi64x(a.min), mx = _mm256_set1_epi64x(a.max);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i m = mask4_avx2(c, i, s, s1, f, nf);
+            __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(&x[i]));
+            sum = _mm256_add_epi64(sum, _mm256_and_si256(m, v));
+            count = _mm256_sub_epi64(count, m);
+            mn = _mm256_blendv_epi8(mn, v, _mm256_and_si256(m, _mm256_cmpgt_epi64(mn, v)));
+            mx = _mm256_blendv_epi8(mx, v, _mm256_and_si256(m, _mm256_cmpgt_epi64(v, mx)));
+        }
+        alignas(32) int64_t lanes[4][4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), sum);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), count);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[2]), mn);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[3]), mx);
+        for (int l = 0; l != 4; ++l) {
+            a.sum += lanes[0][l];
+            a.count += lanes[1][l];
+            a.min = std::min(a.min, lanes[2][l]);
+            a.max = std::max(a.max, lanes[3][l]);
+        }
+        for (; i != n; ++i)
+            if (visible(c, i, snapshot, f, nf))
+                a.add(x[i]);
+    }
+
+    __attribute__((target("avx2")))
+    static void filter_chunk_avx2(const chunk* c, size_t n, uint64_t snapshot, const range* f, int nf,
+                                  uint64_t* bits) {
+        memset(bits, 0, sizeof(uint64_t) * chunk_rows / 64);
+        __m256i s = _mm256_set1_epi64x(int64_t(snapshot));
+        __m256i s1 = _mm256_set1_epi64x(int64_t(snapshot) + 1);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i m = mask4_avx2(c, i, s, s1, f, nf);
+            uint64_t m4 = _mm256_movemask_pd(_mm256_castsi256_pd(m));
+            bits[i / 64] |= m4 << (i % 64);
+        }
+        for (; i != n; ++i)
+            if (visible(c, i, snapshot, f, nf))
+                bits[i / 64] |= uint64_t(1) << (i % 64);
+    }
+};
+
+} // namespace bench
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "compiler.hh"
+
+namespace bench {
+
+// Deterministic batched execution for transactions whose read and write sets
+// are declared up front, after Calvin.
+//
+// Transactions are collected into epochs. A single sequencing pass walks the
+// epoch in order and queues every access behind the earlier conflicting
+// accesses to the same key: a write waits for the key's previous writer and
+// every reader since, a read waits for the previous writer only. Execution is
+// then parallel: workers claim transactions in sequence order and run each one
+// once its predecessors have finished. Because every conflict is ordered ahead
+// of time, transactions never abort and need no validation; the body of a
+// transaction may access its declared keys nontransactionally.
+//
+// Claiming in sequence order keeps execution deadlock free: the earliest
+// unfinished transaction depends only on finished ones.
+template <typename K, typename Hash = std::hash<K>>
+class deterministic_engine {
+public:
+    typedef uint32_t txn_id;
+
+    // Start sequencing an epoch of `ntxns` transactions. Must not overlap
+    // with execute().
+    void begin_epoch(size_t ntxns) {
+        if (txns_.size() < ntxns)
+            txns_ = std::vector<txn_state>(ntxns);
+        for (size_t i = 0; i != ntxns; ++i) {
+            txns_[i].waits.store(0, std::memory_order_relaxed);
+            txns_[i].successors.clear();
+        }
+        ntxns_ = ntxns;
+        keys_.clear();
+    }
+
+    // Declare that transaction `t` of the current epoch accesses `key`.
+    // Transactions must be declared in sequence order, each transaction's
+    // accesses contiguously.
+    void declare(txn_id t, const K& key, bool is_write) {
+        key_state& ks = keys_[key];
+        if (is_write) {
+            if (ks.readers.empty())
+                depend(t, ks.writer);
+            for (auto r : ks.readers)
+                depend(t, r);
+            ks.writer = t;
+            ks.readers.clear();
+        } else {
+            depend(t, ks.writer);
+            ks.readers.push_back(t);
+        }
+    }
+
+    // Finish sequencing; the epoch may now be executed
+    void end_epoch() {
+        next_.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // Run transactions of the current epoch until none are left to claim.
+    // Called concurrently by every worker; fn(t) executes transaction t.
+    // Returns the number of transactions run by the calling thread.
+    template <typename F>
+    size_t execute(F&& fn) {
+        size_t n = 0;
+        while (true) {
+            size_t t = next_.fetch_add(1, std::memory_order_relaxed);
+            if (t >= ntxns_)
+                break;
+            txn_state& ts = txns_[t];
+            while (ts.waits.load(std::memory_order_acquire) != 0)
+                relax_fence();
+            fn(txn_id(t));
+            for (auto s : ts.successors)
+                txns_[s].waits.fetch_sub(1, std::memory_order_release);
+            ++n;
+        }
+        return n;
+    }
+
+    size_t epoch_size() const {
+        return ntxns_;
+    }
+
+private:
+    static constexpr txn_id no_txn = txn_id(-1);
+
+    struct txn_state {
+        std::atomic<uint32_t> waits;
+        std::vector<txn_id> successors;
+
+        txn_state() : waits(0), successors() {}
+        txn_state(const txn_state&) = delete;
+        txn_state(txn_state&&) = delete;
+    };
+
+    struct key_state {
+        txn_id writer = no_txn;
+        std::vector<txn_id> readers;
+    };
+
+    void depend(txn_id t, txn_id pred) {
+        if (pred == no_txn || pred == t)
+            return;
+        auto& succ = txns_[pred].successors;
+        // t's accesses are declared together, so a repeated edge is last
+        if (!succ.empty() && succ.back() == t)
+            return;
+        succ.push_back(t);
+        txns_[t].waits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::vector<txn_state> txns_;
+    size_t ntxns_ = 0;
+    std::unordered_map<K, key_state, Hash> keys_;
+    std::atomic<size_t> next_{0};
+};
+
+}; // namespace bench
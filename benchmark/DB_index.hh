@@ -13,6 +13,7 @@
 #include "masstree_scan.hh"
 #include "string.hh"
 
+#include <memory>
 #include <vector>
 #include "DB_structs.hh"
 #include "VersionSelector.hh"
@@ -20,13 +21,15 @@
 
 #include "TBox.hh"
 #include "TMvBox.hh"
+#include "DB_split_layout.hh"
+#include "DB_columnar.hh"
 
 namespace bench {
 
 class version_adapter {
 public:
-    template <bool Adaptive>
-    static bool select_for_update(TransProxy& item, TLockVersion<Adaptive>& vers) {
+    template <bool Adaptive, bool ReaderBias>
+    static bool select_for_update(TransProxy& item, TLockVersion<Adaptive, ReaderBias>& vers) {
         return item.acquire_write(vers);
     }
     static bool select_for_update(TransProxy& item, TVersion& vers) {
@@ -53,9 +56,16 @@ public:
         item.acquire_write(vers);
         return true;
     }
+    template <bool Opaque, bool Extend>
+    static bool select_for_update(TransProxy& item, TicTocCompressedVersion<Opaque, Extend>& vers) {
+        if (!item.observe(vers))
+            return false;
+        item.acquire_write(vers);
+        return true;
+    }
 
-    template <bool Adaptive, typename T>
-    static bool select_for_overwrite(TransProxy& item, TLockVersion<Adaptive>& vers, const T& val) {
+    template <bool Adaptive, bool ReaderBias, typename T>
+    static bool select_for_overwrite(TransProxy& item, TLockVersion<Adaptive, ReaderBias>& vers, const T& val) {
         return item.acquire_write(vers, val);
     }
     template <typename T>
@@ -78,6 +88,10 @@ public:
     static bool select_for_overwrite(TransProxy& item, TicTocVersion<Opaque, Extend>& vers, const T& val) {
         return item.acquire_write(vers, val);
     }
+    template <bool Opaque, bool Extend, typename T>
+    static bool select_for_overwrite(TransProxy& item, TicTocCompressedVersion<Opaque, Extend>& vers, const T& val) {
+        return item.acquire_write(vers, val);
+    }
 };
 
 template <typename DBParams>
@@ -88,9 +102,10 @@ struct get_occ_version {
 template <typename DBParams>
 struct get_version {
     typedef typename std::conditional<DBParams::MVCC, TNonopaqueVersion,
-            typename std::conditional<DBParams::TicToc, TicTocVersion<>,
-            typename std::conditional<DBParams::Adaptive, TLockVersion<true /* adaptive */>,
-            typename std::conditional<DBParams::TwoPhaseLock, TLockVersion<false>,
+            typename std::conditional<DBParams::TicToc,
+                typename std::conditional<DBParams::TicTocCompressed, TicTocCompressedVersion<>, TicTocVersion<>>::type,
+            typename std::conditional<DBParams::Adaptive, TLockVersion<true /* adaptive */, DBParams::ReaderBias>,
+            typename std::conditional<DBParams::TwoPhaseLock, TLockVersion<false, DBParams::ReaderBias>,
             typename std::conditional<DBParams::Swiss, TSwissVersion<DBParams::Opaque>,
             typename get_occ_version<DBParams>::type>::type>::type>::type>::type>::type type;
 };
@@ -228,6 +243,43 @@ public:
         return cell_accesses;
     }
 
+    // column_to_cell_accesses() for tables with an adaptive_split_layout:
+    // the container's cells are the layout's atoms
+    template <typename T, typename Layout>
+    static std::array<access_t, T::num_versions>
+    adaptive_column_to_cell_accesses(Layout& layout, std::initializer_list<column_access_t> accesses) {
+        typename Layout::mask_type read = 0, write = 0;
+        for (auto it = accesses.begin(); it != accesses.end(); ++it) {
+            auto atom = typename Layout::mask_type(1) << T::map(it->col_id);
+            if (static_cast<uint8_t>(it->access) & static_cast<uint8_t>(access_t::read))
+                read |= atom;
+            if (static_cast<uint8_t>(it->access) & static_cast<uint8_t>(access_t::write))
+                write |= atom;
+        }
+        auto read_cells = layout.leaders(read), write_cells = layout.leaders(write);
+        layout.sample(read, write);
+
+        std::array<access_t, T::num_versions> cell_accesses;
+        for (size_t i = 0; i < T::num_versions; ++i) {
+            cell_accesses[i] = static_cast<access_t>(
+                    (((read_cells >> i) & 1) * static_cast<uint8_t>(access_t::read))
+                    | (((write_cells >> i) & 1) * static_cast<uint8_t>(access_t::write)));
+        }
+        return cell_accesses;
+    }
+
+    // Installs cell `cell` of `new_row`: the cell itself, or with an adaptive
+    // layout, every atom in its group
+    template <typename T, typename Layout>
+    static void install_cells(T& row_container, int cell, const value_type* new_row, const Layout* layout) {
+        if (!layout) {
+            row_container.install_cell(cell, new_row);
+            return;
+        }
+        for (auto m = layout->install_mask(cell); m; m &= m - 1)
+            row_container.install_cell(__builtin_ctz(m), new_row);
+    }
+
     template <typename T>
     constexpr static std::array<access_t, T::num_splits>
     mvcc_column_to_cell_accesses(std::initializer_list<column_access_t> accesses) {
@@ -660,7 +712,7 @@ public:
         return (item.flags() & row_cell_bit) != 0;
     }
 
-    struct MvInternalElement {
+    struct MvInternalElement : public HugeArenaObject {
         typedef typename SplitParams<value_type>::layout_type split_layout_type;
         using object0_type = std::tuple_element_t<0, split_layout_type>;
 
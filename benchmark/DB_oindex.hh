@@ -20,6 +20,8 @@ public:
     static constexpr TransItem::flags_type delete_bit = TransItem::user0_bit << 1u;
     static constexpr TransItem::flags_type row_update_bit = TransItem::user0_bit << 2u;
     static constexpr TransItem::flags_type row_cell_bit = TransItem::user0_bit << 3u;
+    // installed by this commit, for mirror_
+    static constexpr TransItem::flags_type installed_bit = TransItem::user0_bit << 4u;
     static constexpr uintptr_t internode_bit = 1;
     // TicToc node version bit
     static constexpr uintptr_t ttnv_bit = 1 << 1u;
@@ -31,7 +33,7 @@ public:
 
     static constexpr bool index_read_my_write = DBParams::RdMyWr;
 
-    struct internal_elem {
+    struct internal_elem : public HugeArenaObject {
         key_type key;
         value_container_type row_container;
         bool deleted;
@@ -77,6 +79,7 @@ public:
     template <typename T>
     static constexpr auto extract_item_list
         = split_version_helpers<ordered_index<K, V, DBParams>>::template extract_item_list<T>;
+    typedef adaptive_split_layout<value_container_type::num_versions> split_layout_type;
 
     typedef std::tuple<bool, bool, uintptr_t, const value_type*> sel_return_type;
     typedef std::tuple<bool, bool>                               ins_return_type;
@@ -98,6 +101,35 @@ public:
             ti = threadinfo::make(threadinfo::TI_MAIN, -1);
         table_.initialize(*ti);
         key_gen_ = 0;
+        policy_site_ = -1;
+    }
+
+    void set_policy_site(int site) {
+        policy_site_ = site;
+    }
+
+    // Regroup the row version cells at runtime, see DB_split_layout.hh
+    void enable_adaptive_split() {
+        if (value_container_type::num_versions > 1)
+            split_layout_ = std::make_shared<split_layout_type>();
+    }
+    const split_layout_type* adaptive_split() const {
+        return split_layout_.get();
+    }
+
+    // Out-of-line bytes of this table's compact_string columns; load
+    // under a string_arena::scope on it, and update them through it
+    string_arena& strings() {
+        return *strings_;
+    }
+
+    // Mirror committed rows into `m`, e.g. a column_mirror for analytic
+    // scans; set before loading
+    void set_mirror(std::shared_ptr<table_mirror<K, V>> m) {
+        mirror_ = std::move(m);
+    }
+    table_mirror<K, V>* mirror() const {
+        return mirror_.get();
     }
 
     static void thread_init() {
@@ -201,7 +233,7 @@ public:
 
         // Translate from column accesses to cell accesses
         // all buffered writes are only stored in the wdata_ of the row item (to avoid redundant copies)
-        auto cell_accesses = column_to_cell_accesses<value_container_type>(accesses);
+        auto cell_accesses = cell_accesses_of(accesses);
 
         std::array<TransItem*, value_container_type::num_versions> cell_items {};
         bool any_has_write;
@@ -225,7 +257,7 @@ public:
             }
         }
 
-        ok = access_all(cell_accesses, cell_items, e->row_container);
+        ok = access_all(cell_accesses, cell_items, e->row_container, policy_site_);
         if (!ok)
             goto abort;
 
@@ -251,6 +283,25 @@ public:
         row_item.add_commute(comm);
     }
 
+    // Opt-in repair of this transaction's read of column `col` in row `rid`
+    // (see TransProxy::add_repair). Fragments run at commit, may read the
+    // row's current contents with nontrans_row(), and redo their writes by
+    // rewriting the row they passed to update_row().
+    void add_repair(uintptr_t rid, NamedColumn col, Transaction::repair_fn fn, void* arg) {
+        static_assert(!value_is_small, "small rows are copied into the write at update_row()");
+        auto e = reinterpret_cast<internal_elem*>(rid);
+        typename split_layout_type::mask_type cells = 1u << value_container_type::map(static_cast<int>(col));
+        if (split_layout_)
+            cells = split_layout_->leaders(cells);
+        for (; cells; cells &= cells - 1) {
+            int cell = __builtin_ctz(cells);
+            Sto::item(this, item_key_t(e, cell)).add_repair(e->row_container.version_at(cell), fn, arg);
+        }
+    }
+    const value_type& nontrans_row(uintptr_t rid) const {
+        return reinterpret_cast<const internal_elem*>(rid)->row_container.row;
+    }
+
     // insert assumes common case where the row doesn't exist in the table
     // if a row already exists, then use select (FOR UPDATE) instead
     ins_return_type
@@ -405,7 +456,7 @@ public:
             return ((!phantom_protection) || scan_track_node_version(node, version));
         };
 
-        auto cell_accesses = column_to_cell_accesses<value_container_type>(accesses);
+        auto cell_accesses = cell_accesses_of(accesses);
 
         auto value_callback = [&] (const lcdf::Str& key, internal_elem *e, bool& ret, bool& count) {
             TransProxy row_item = index_read_my_write ? Sto::item(this, item_key_t::row_item_key(e))
@@ -430,7 +481,7 @@ public:
                 }
             }
 
-            bool ok = access_all(cell_accesses, cell_items, e->row_container);
+            bool ok = access_all(cell_accesses, cell_items, e->row_container, policy_site_);
             if (!ok)
                 return false;
             //bool ok = item.observe(e->version);
@@ -549,6 +600,8 @@ public:
             lp.value() = e;
             lp.finish(1, *ti);
         }
+        if (mirror_)
+            mirror_->append(k, v, 0);
     }
 
     // TObject interface methods
@@ -562,10 +615,20 @@ public:
         }
         auto key = item.key<item_key_t>();
         auto e = key.internal_elem_ptr();
+        bool locked;
         if (key.is_row_item())
-            return txn.try_lock(item, e->version());
+            locked = txn.try_lock(item, e->version());
         else
-            return txn.try_lock(item, e->row_container.version_at(key.cell_num()));
+            locked = txn.try_lock(item, e->row_container.version_at(key.cell_num()));
+        if constexpr (DBParams::Commute) {
+            if (locked && !commute_escrow_check(item, txn, key, e)) {
+                TXP_INCREMENT(txp_commute_escrow_aborts);
+                // not yet marked as needing unlock by the commit protocol
+                unlock(item);
+                return false;
+            }
+        }
+        return locked;
     }
 
     bool check(TransItem& item, Transaction& txn) override {
@@ -609,6 +672,8 @@ public:
             if (has_delete(item)) {
                 assert(e->valid() && !e->deleted);
                 e->deleted = true;
+                if (mirror_)
+                    mirror_->remove(e->key, txn.commit_epoch());
                 txn.set_version(e->version());
                 return;
             }
@@ -639,10 +704,12 @@ public:
                         // install only the difference part
                         // not sure if works when there are more than 1 minor version fields
                         // should still work
-                        e->row_container.install_cell(0, vptr);
+                        split_version_helpers<ordered_index<K, V, DBParams>>::install_cells(e->row_container, 0, vptr, split_layout_.get());
                     }
                 }
             }
+            if (mirror_)
+                mirror_installed(item, txn, e);
             txn.set_version_unlock(e->version(), item);
         } else {
             // skip installation if row-level update is present
@@ -659,9 +726,11 @@ public:
                     else
                         vptr = row_item.template raw_write_value<value_type *>();
 
-                    e->row_container.install_cell(key.cell_num(), vptr);
+                    split_version_helpers<ordered_index<K, V, DBParams>>::install_cells(e->row_container, key.cell_num(), vptr, split_layout_.get());
                 }
             }
+            if (mirror_)
+                mirror_installed(item, txn, e);
 
             txn.set_version_unlock(e->row_container.version_at(key.cell_num()), item);
         }
@@ -774,14 +843,66 @@ protected:
 private:
     table_type table_;
     uint64_t key_gen_;
+    // CCPolicy access site of this table, or -1
+    int policy_site_;
+
+    // Set by enable_adaptive_split()
+    std::shared_ptr<split_layout_type> split_layout_;
+    std::shared_ptr<string_arena> strings_ = std::make_shared<string_arena>();
+    // Set by set_mirror()
+    std::shared_ptr<table_mirror<K, V>> mirror_;
+
+    // Marks `item` installed and, once every written item of row `e` is,
+    // appends the row's image to mirror_: one image per row per commit,
+    // however many cells the commit wrote.
+    void mirror_installed(TransItem& item, Transaction& txn, internal_elem* e) {
+        item.add_flags(installed_bit);
+        for (int cell = 0; cell != value_container_type::num_versions; ++cell) {
+            auto other = txn.check_item(this, item_key_t(e, cell));
+            if (other && other->item().has_write() && !(other->item().flags() & installed_bit))
+                return;
+        }
+        mirror_->append(e->key, e->row_container.row, txn.commit_epoch());
+    }
+
+    std::array<access_t, value_container_type::num_versions>
+    cell_accesses_of(std::initializer_list<column_access_t> accesses) {
+        if (split_layout_) {
+            return split_version_helpers<ordered_index<K, V, DBParams>>::template adaptive_column_to_cell_accesses<value_container_type>(
+                    *split_layout_, accesses);
+        }
+        return column_to_cell_accesses<value_container_type>(accesses);
+    }
+
+    // Escrow-style bounds check for commutative updates. Runs on the item
+    // through which install() will apply the commutator, once its version
+    // is locked, so the row value inspected cannot change before install.
+    bool commute_escrow_check(TransItem& item, Transaction& txn, const item_key_t& key, internal_elem* e) {
+        if (key.is_row_item()) {
+            if (!item.has_commute() || has_insert(item) || has_delete(item)
+                || !(has_row_update(item) || has_row_cell(item))) {
+                return true;
+            }
+            return commutators::escrow_check(item.write_value<comm_type>(), e->row_container.row);
+        } else {
+            // update_row() registered the row item carrying the commutator;
+            // look it up without adding to the tset, which is being iterated
+            auto row_item = txn.check_item(this, item_key_t::row_item_key(e));
+            if (!row_item || !row_item->has_commute() || has_row_update(row_item->item())) {
+                return true;
+            }
+            return commutators::escrow_check(row_item->template write_value<comm_type>(), e->row_container.row);
+        }
+    }
 
     static bool
     access_all(std::array<access_t, value_container_type::num_versions>& cell_accesses, std::array<TransItem*,
-               value_container_type::num_versions>& cell_items, value_container_type& row_container) {
+               value_container_type::num_versions>& cell_items, value_container_type& row_container, int site) {
         for (size_t idx = 0; idx < cell_accesses.size(); ++idx) {
             auto& access = cell_accesses[idx];
             auto proxy = TransProxy(*Sto::transaction(), *cell_items[idx]);
             if (static_cast<uint8_t>(access) & static_cast<uint8_t>(access_t::read)) {
+                CCPolicy::apply<version_type>(proxy.item(), site);
                 if (!proxy.observe(row_container.version_at(idx)))
                     return false;
             }
@@ -1008,6 +1129,17 @@ public:
         key_gen_ = 0;
     }
 
+    // MVCC reads never lock, so there is no policy to apply
+    void set_policy_site(int) {}
+    void enable_adaptive_split() {}
+
+    // Out-of-line bytes of this table's compact_string columns; load
+    // under a string_arena::scope on it. Replaced bytes are reclaimed only
+    // once the old versions that share them have been collected.
+    string_arena& strings() {
+        return *strings_;
+    }
+
     static void thread_init() {
         if (ti == nullptr)
             ti = threadinfo::make(threadinfo::TI_PROCESS, TThread::id());
@@ -1451,6 +1583,7 @@ public:
 //private:
     table_type table_;
     uint64_t key_gen_;
+    std::shared_ptr<string_arena> strings_ = std::make_shared<string_arena>(true, MvGarbage::call_after_collect);
 
     //static bool
     //access_all(std::array<access_t, internal_elem::num_versions>&, std::array<TransItem*, internal_elem::num_versions>&, internal_elem*) {
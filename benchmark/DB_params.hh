@@ -3,6 +3,10 @@
 #include <iostream>
 #include <cstring>
 
+#ifndef TICTOC_COMPRESSED
+#define TICTOC_COMPRESSED 0
+#endif
+
 namespace db_params {
 
 // Benchmark parameters
@@ -37,9 +41,11 @@ public:
     static constexpr bool RdMyWr = false;
     static constexpr bool TwoPhaseLock = false;
     static constexpr bool Adaptive = false;
+    static constexpr bool ReaderBias = false;
     static constexpr bool Opaque = false;
     static constexpr bool Swiss = false;
     static constexpr bool TicToc = false;
+    static constexpr bool TicTocCompressed = false;
     static constexpr bool MVCC = false;
     static constexpr bool NodeTrack = false;
     static constexpr bool Commute = false;
@@ -67,12 +73,22 @@ public:
     static constexpr bool TwoPhaseLock = true;
 };
 
+class db_2pl_rbias_params : public db_2pl_params {
+public:
+    static constexpr bool ReaderBias = true;
+};
+
 class db_adaptive_params : public db_default_params {
 public:
     static constexpr db_params_id Id = db_params_id::Adaptive;
     static constexpr bool Adaptive = true;
 };
 
+class db_adaptive_rbias_params : public db_adaptive_params {
+public:
+    static constexpr bool ReaderBias = true;
+};
+
 class db_swiss_params : public db_default_params {
 public:
     static constexpr db_params_id Id = db_params_id::Swiss;
@@ -83,6 +99,8 @@ class db_tictoc_params : public db_default_params {
 public:
     static constexpr db_params_id Id = db_params_id::TicToc;
     static constexpr bool TicToc = true;
+    // Single-word (wts, delta) timestamps, see TicTocCompressedTid
+    static constexpr bool TicTocCompressed = TICTOC_COMPRESSED;
 };
 
 class db_tictoc_commute_params : public db_tictoc_params {
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <string>
+
 #include "SystemProfiler.hh"
 #include "Transaction.hh"
 #include "DB_params.hh"
@@ -58,5 +62,69 @@ private:
     uint64_t end_tsc_;
 };
 
+// Per-thread transaction latency histogram, in TSC ticks with power-of-two
+// buckets. Merge the threads' histograms before printing.
+class latency_histogram {
+public:
+    static constexpr int nbuckets = 64;
+
+    latency_histogram() : buckets_(), count_(0), sum_(0), max_(0), late_(0) {}
+
+    void record(uint64_t ticks, bool missed_deadline = false) {
+        ++buckets_[ticks ? 64 - __builtin_clzll(ticks) - 1 : 0];
+        ++count_;
+        sum_ += ticks;
+        max_ = std::max(max_, ticks);
+        late_ += missed_deadline;
+    }
+
+    void merge(const latency_histogram& other) {
+        for (int i = 0; i != nbuckets; ++i)
+            buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+        late_ += other.late_;
+    }
+
+    uint64_t count() const {
+        return count_;
+    }
+
+    // Upper bound of the bucket holding the p-th percentile
+    uint64_t percentile(double p) const {
+        uint64_t target = (uint64_t) (p / 100.0 * count_), seen = 0;
+        for (int i = 0; i != nbuckets; ++i) {
+            seen += buckets_[i];
+            if (seen > target)
+                return std::min(max_, (uint64_t(2) << i) - 1);
+        }
+        return max_;
+    }
+
+    void print(const std::string& name) const {
+        auto us = [] (uint64_t ticks) {
+            return db_profiler::ticks_to_secs(ticks) * 1e6;
+        };
+        std::cout << name << ": " << count_ << " txns";
+        if (count_) {
+            std::cout << ", mean " << us(sum_ / count_) << " us"
+                      << ", p50 " << us(percentile(50)) << " us"
+                      << ", p99 " << us(percentile(99)) << " us"
+                      << ", max " << us(max_) << " us";
+            if (late_)
+                std::cout << ", " << late_ << " missed deadlines";
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    std::array<uint64_t, nbuckets> buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+    uint64_t late_;
+};
+
 }; // namespace bench
 
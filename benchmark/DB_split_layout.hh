@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "compiler.hh"
+#include "Sto.hh"
+
+namespace bench {
+
+// Runtime vertical partitioning of a table's version cells.
+//
+// The codegen'd version selector fixes the finest cells a row can be split
+// into; call them atoms. An adaptive layout groups atoms into the cells that
+// transactions actually observe and lock: a group is protected by the
+// version of its lowest atom, the group's leader. Tables start with the
+// codegen'd split, one group per atom. Accesses are sampled as (read atoms,
+// written atoms) masks into small per-thread weighted histograms that decay
+// by half at every evaluation, so the advisor follows the recent workload
+// at a bounded cost. When splitting a group would cut the read/write
+// co-access on it by enough, or merging two groups that are accessed
+// together would add little, the table migrates to the new layout:
+//
+//   phase 2k:   layout k
+//   phase 2k+1: layout k -> k+1; accesses use the leaders of both layouts
+//
+// A transaction pins the phase of its first access to the table until it
+// commits or aborts, and the phase only advances once no transaction is
+// pinned to the previous one, so at most two adjacent phases are ever live.
+// Rows are stored whole, so migration moves no data. Under phase 2k+1 a
+// write locks the leaders of every atom it writes in both layouts, and
+// installs each group of layout k+1 it holds; a leader of layout k that a
+// merge demoted installs nothing, but its version still changes, so readers
+// of layout k see the write.
+template <size_t NumCells>
+class adaptive_split_layout : public TObject {
+public:
+    typedef uint32_t mask_type;
+    static_assert(NumCells <= 32, "Too many cells for an adaptive layout.");
+
+    static constexpr unsigned sample_period = 16;   // sample 1 access in N
+    static constexpr unsigned nslots = 16;          // distinct samples kept per thread
+    static constexpr unsigned min_weight = 64;      // decayed samples needed to regroup
+    static constexpr unsigned tick_period = 4096;   // accesses between advance attempts
+
+    // Starts with `groups`, disjoint atom masks covering every atom, or
+    // with one group per atom if `groups` is empty
+    explicit adaptive_split_layout(std::initializer_list<mask_type> groups = {})
+        : phase_(0), window_(0), advancing_(false), nmigrations_(0), min_gain_(0.25) {
+        layout& l = layouts_[0];
+        l.group.fill(0);
+        if (groups.size() == 0) {
+            for (size_t i = 0; i != NumCells; ++i) {
+                l.leader[i] = i;
+                l.group[i] = mask_type(1) << i;
+            }
+        } else {
+            mask_type seen = 0;
+            for (auto g : groups) {
+                always_assert(g && !(g & seen), "adaptive layout groups overlap");
+                seen |= g;
+                int lead = __builtin_ctz(g);
+                l.group[lead] = g;
+                for (mask_type m = g; m; m &= m - 1)
+                    l.leader[__builtin_ctz(m)] = lead;
+            }
+            always_assert(seen == all_cells, "adaptive layout groups miss atoms");
+        }
+        layouts_[1] = layouts_[0];
+    }
+
+    // Split a group when that cuts its co-access by at least this fraction;
+    // merge two groups when keeping them apart saves at most half of that
+    void set_min_gain(double gain) {
+        min_gain_ = gain;
+    }
+
+    unsigned phase() const {
+        return phase_.load(std::memory_order_acquire);
+    }
+    unsigned migrations() const {
+        return nmigrations_;
+    }
+
+    // Cells the current transaction must access to touch the atoms in
+    // `atoms`. Pins the transaction's phase on first use.
+    mask_type leaders(mask_type atoms) {
+        unsigned p = pin();
+        mask_type m = layout_of(p).leaders(atoms);
+        if (p & 1)
+            m |= layout_of(p + 1).leaders(atoms);
+        return m;
+    }
+
+    // Atoms to install from the current transaction's row for cell `leader`
+    mask_type install_mask(int leader) const {
+        unsigned p = threads_[TThread::id()].pin.load(std::memory_order_relaxed);
+        assert(p != 0);
+        // under phase 2k+1 (pin 2k+2), the groups of layout k+1
+        return layout_of(p & ~1u).group[leader];
+    }
+
+    // Record an access for the advisor, and now and then try to advance
+    void sample(mask_type read, mask_type write) {
+        thread_state& ts = threads_[TThread::id()];
+        ++ts.accesses;
+        // sampled at random, so periodic access patterns can't alias
+        ts.seed = ts.seed * 1103515245 + 12345;
+        if ((ts.seed >> 16) % sample_period == 0)
+            ts.add({read, write}, window_.load(std::memory_order_relaxed));
+        if (ts.accesses % tick_period == 0)
+            advance();
+    }
+
+    // Move to the next phase if allowed: finish a migration, or start one
+    // if the samples call for a regrouping. Returns true if the phase changed.
+    bool advance() {
+        if (advancing_.exchange(true, std::memory_order_acquire))
+            return false;
+        bool changed = false;
+        unsigned p = phase_.load(std::memory_order_seq_cst);
+        if (quiescent(p)) {
+            if (p & 1) {
+                changed = true;
+            } else {
+                layout next = layout_of(p);
+                auto hist = collect();
+                // samples taken before this evaluation count half from now on
+                window_.fetch_add(1, std::memory_order_relaxed);
+                unsigned n = 0;
+                for (auto& h : hist)
+                    n += h.second;
+                if (n >= min_weight && regroup(next, hist)) {
+                    layouts_[(p / 2 + 1) % 2] = next;
+                    ++nmigrations_;
+                    changed = true;
+                }
+            }
+            if (changed)
+                phase_.store(p + 1, std::memory_order_seq_cst);
+        }
+        advancing_.store(false, std::memory_order_release);
+        return changed;
+    }
+
+    // Groups of the current layout, e.g. "{0}{1,2}"
+    std::string describe() const {
+        const layout& l = layout_of(phase() + 1);
+        std::string s;
+        for (size_t c = 0; c != NumCells; ++c) {
+            if (!l.group[c])
+                continue;
+            s += '{';
+            for (size_t a = c; a != NumCells; ++a)
+                if (l.group[c] & (mask_type(1) << a))
+                    s += (s.back() == '{' ? "" : ",") + std::to_string(a);
+            s += '}';
+        }
+        return s;
+    }
+
+    // The layout's TransItem only marks the transaction's pin. It is neither
+    // read nor written, so a read-only transaction stays read-only; its
+    // unlock() unpins when the transaction ends.
+    bool lock(TransItem&, Transaction&) override {
+        return true;
+    }
+    bool check(TransItem&, Transaction&) override {
+        return true;
+    }
+    void install(TransItem&, Transaction&) override {
+    }
+    void unlock(TransItem&) override {
+        threads_[TThread::id()].pin.store(0, std::memory_order_release);
+    }
+
+private:
+    static constexpr mask_type all_cells = NumCells == 32 ? ~mask_type(0)
+                                                          : (mask_type(1) << NumCells) - 1;
+
+    struct layout {
+        std::array<uint8_t, NumCells> leader;   // by atom
+        std::array<mask_type, NumCells> group;  // by leader; 0 for non-leaders
+
+        mask_type leaders(mask_type atoms) const {
+            mask_type m = 0;
+            for (; atoms; atoms &= atoms - 1)
+                m |= mask_type(1) << leader[__builtin_ctz(atoms)];
+            return m;
+        }
+    };
+
+    typedef std::pair<mask_type, mask_type> access_sample;
+
+    // Distinct samples with their weights, as of window `window`; each
+    // later window halves the weights
+    struct thread_state {
+        std::atomic<unsigned> pin;  // pinned phase + 1, or 0
+        unsigned accesses;
+        unsigned seed;
+        unsigned window;
+        unsigned nhist;
+        std::array<std::pair<access_sample, unsigned>, nslots> hist;
+
+        thread_state() : pin(0), accesses(0), seed(1), window(0), nhist(0), hist() {}
+
+        static unsigned decayed(unsigned weight, unsigned age) {
+            return age >= 32 ? 0 : weight >> age;
+        }
+
+        void add(access_sample s, unsigned w) {
+            if (window != w) {
+                unsigned n = 0;
+                for (unsigned i = 0; i != nhist; ++i)
+                    if (unsigned x = decayed(hist[i].second, w - window))
+                        hist[n++] = {hist[i].first, x};
+                nhist = n;
+                window = w;
+            }
+            unsigned lightest = 0;
+            for (unsigned i = 0; i != nhist; ++i) {
+                if (hist[i].first == s) {
+                    ++hist[i].second;
+                    return;
+                }
+                if (hist[i].second < hist[lightest].second)
+                    lightest = i;
+            }
+            // a full table replaces its lightest sample
+            hist[nhist < nslots ? nhist++ : lightest] = {s, 1};
+        }
+    } __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    // Layout k lives in slot k % 2; phase p uses layout p / 2 (and, when
+    // migrating, p / 2 + 1)
+    const layout& layout_of(unsigned p) const {
+        return layouts_[(p / 2) % 2];
+    }
+
+    unsigned pin() {
+        thread_state& ts = threads_[TThread::id()];
+        unsigned p = ts.pin.load(std::memory_order_relaxed);
+        if (p)
+            return p - 1;
+        do {
+            p = phase_.load(std::memory_order_seq_cst);
+            ts.pin.store(p + 1, std::memory_order_seq_cst);
+        } while (phase_.load(std::memory_order_seq_cst) != p);
+        // unlock() unpins when the transaction ends
+        Sto::item(this, 0).item().add_needs_unlock();
+        return p;
+    }
+
+    // No live transaction is pinned to phase p - 1
+    bool quiescent(unsigned p) const {
+        if (p == 0)
+            return true;
+        for (auto& ts : threads_)
+            if (ts.pin.load(std::memory_order_seq_cst) == p)
+                return false;
+        return true;
+    }
+
+    // Distinct samples of all threads with their decayed weights. Other
+    // threads' histograms are read racily; a stale entry only skews advice.
+    std::vector<std::pair<access_sample, unsigned>> collect() const {
+        unsigned w = window_.load(std::memory_order_relaxed);
+        std::vector<std::pair<access_sample, unsigned>> hist;
+        for (auto& ts : threads_) {
+            unsigned n = std::min(ts.nhist, nslots), age = w - ts.window;
+            for (unsigned i = 0; i != n; ++i) {
+                unsigned x = thread_state::decayed(ts.hist[i].second, age);
+                if (!x)
+                    continue;
+                auto it = std::find_if(hist.begin(), hist.end(), [&] (const auto& h) {
+                    return h.first == ts.hist[i].first;
+                });
+                if (it == hist.end())
+                    hist.push_back({ts.hist[i].first, x});
+                else
+                    it->second += x;
+            }
+        }
+        return hist;
+    }
+
+    // Read/write co-access on the atoms in `m`: pairs of sampled accesses
+    // where one reads and the other writes the cell that would hold them
+    static double coaccess(const std::vector<std::pair<access_sample, unsigned>>& hist, mask_type m) {
+        double r = 0, w = 0;
+        for (auto& h : hist) {
+            if (h.first.first & m)
+                r += h.second;
+            if (h.first.second & m)
+                w += h.second;
+        }
+        return r * w;
+    }
+
+    bool regroup(layout& l, const std::vector<std::pair<access_sample, unsigned>>& hist) const {
+        bool changed = false;
+        auto groups = l.group;
+        for (auto g : groups)
+            if (g)
+                changed |= split_group(l, hist, g);
+        while (merge_groups(l, hist))
+            changed = true;
+        return changed;
+    }
+
+    // Sampled accesses that touch both `a` and `b`
+    static unsigned joint_accesses(const std::vector<std::pair<access_sample, unsigned>>& hist, mask_type a, mask_type b) {
+        unsigned n = 0;
+        for (auto& h : hist) {
+            mask_type m = h.first.first | h.first.second;
+            if ((m & a) && (m & b))
+                n += h.second;
+        }
+        return n;
+    }
+
+    // Merge the pair of groups most often accessed together, if keeping
+    // them apart cuts at most half of min_gain_ of the merged group's
+    // co-access; the hysteresis keeps split_group from undoing the merge
+    bool merge_groups(layout& l, const std::vector<std::pair<access_sample, unsigned>>& hist) const {
+        mask_type best_a = 0, best_b = 0;
+        unsigned best_joint = 0;
+        for (size_t i = 0; i != NumCells; ++i) {
+            mask_type a = l.group[i];
+            if (!a)
+                continue;
+            for (size_t j = i + 1; j != NumCells; ++j) {
+                mask_type b = l.group[j];
+                if (!b)
+                    continue;
+                unsigned joint = joint_accesses(hist, a, b);
+                if (joint <= best_joint)
+                    continue;
+                double cost = coaccess(hist, a | b);
+                if (cost - coaccess(hist, a) - coaccess(hist, b) <= cost * min_gain_ / 2) {
+                    best_a = a;
+                    best_b = b;
+                    best_joint = joint;
+                }
+            }
+        }
+        if (!best_a)
+            return false;
+        // best_a holds the lower leader, which leads the merged group
+        int lead = __builtin_ctz(best_a);
+        l.group[lead] = best_a | best_b;
+        l.group[__builtin_ctz(best_b)] = 0;
+        for (mask_type m = best_b; m; m &= m - 1)
+            l.leader[__builtin_ctz(m)] = lead;
+        return true;
+    }
+
+    // Split `g` in two where that pays, then try the halves
+    bool split_group(layout& l, const std::vector<std::pair<access_sample, unsigned>>& hist, mask_type g) const {
+        if (!(g & (g - 1)))
+            return false;
+        double cost = coaccess(hist, g);
+        if (cost == 0)
+            return false;
+        mask_type low = g & -g, best = 0;
+        double best_cost = cost * (1 - min_gain_);
+        auto consider = [&] (mask_type x) {
+            double c = coaccess(hist, x) + coaccess(hist, g & ~x);
+            if (c < best_cost) {
+                best = x;
+                best_cost = c;
+            }
+        };
+        if (__builtin_popcount(g) <= 10) {
+            // every split keeping the leader on the low side
+            mask_type rest = g & ~low;
+            for (mask_type x = (rest - 1) & rest; ; x = (x - 1) & rest) {
+                consider(low | x);
+                if (!x)
+                    break;
+            }
+        } else {
+            for (mask_type m = g & ~low; m; m &= m - 1)
+                consider(g & ~(m & -m));
+        }
+        if (!best)
+            return false;
+        mask_type other = g & ~best;
+        int lead = __builtin_ctz(best), olead = __builtin_ctz(other);
+        l.group[lead] = best;
+        l.group[olead] = other;
+        for (mask_type m = other; m; m &= m - 1)
+            l.leader[__builtin_ctz(m)] = olead;
+        split_group(l, hist, best);
+        split_group(l, hist, other);
+        return true;
+    }
+
+    std::atomic<unsigned> phase_;
+    std::atomic<unsigned> window_;  // evaluations so far, for sample decay
+    std::atomic<bool> advancing_;
+    unsigned nmigrations_;
+    double min_gain_;
+    layout layouts_[2];
+    thread_state threads_[MAX_THREADS];
+};
+
+}; // namespace bench
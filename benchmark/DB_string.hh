@@ -0,0 +1,617 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "compiler.hh"
+#include "Sto.hh"
+
+namespace bench {
+
+// Storage for out-of-line string bytes, owned by a table. Each thread
+// carves blocks from its own chunks. Strings stored here are immutable, so
+// row copies can share them.
+//
+// A reclaiming arena recycles the bytes of replaced values through
+// per-thread free lists, one per power-of-two size class. compact_string
+// reports a replacement made inside a transaction (see assign()): if the
+// transaction commits, the old bytes are retired, and reused once every
+// transaction that could have read them has finished; if it aborts, the
+// new bytes are reused at once. A commutator replacing a value while the
+// row installs retires the old bytes right away. Retired bytes are freed
+// an RCU period after the commit, unless the arena was given a `retire`
+// hook: tables that keep old versions pass one that waits until the
+// versions that may share the bytes are collected (see
+// MvGarbage::call_after_collect). Arenas made with reclaim = false only
+// grow.
+class string_arena : public TObject {
+public:
+    static constexpr size_t chunk_size = 64 << 10;
+    // 16 bytes to 64 KiB, enough for any compact_string
+    static constexpr int num_classes = 13;
+
+    typedef void (*retire_hook)(TRcuSet::callback_type, void*);
+
+    explicit string_arena(bool reclaim = true, retire_hook retire = nullptr)
+        : reclaim_(reclaim), retire_(retire) {
+    }
+    string_arena(const string_arena&) = delete;
+    string_arena& operator=(const string_arena&) = delete;
+
+    ~string_arena() override {
+        for (auto& ts : threads_)
+            for (auto c : ts.chunks)
+                free(c);
+    }
+
+    bool reclaims() const {
+        return reclaim_;
+    }
+    // Has a retire hook, so old versions may share its bytes
+    bool versioned() const {
+        return retire_ != nullptr;
+    }
+
+    // Copies `len` bytes of `s` plus a terminating NUL
+    const char* store(const char* s, size_t len) {
+        char* p = allocate(len);
+        memcpy(p, s, len);
+        p[len] = '\0';
+        return p;
+    }
+
+    // Room for `len` bytes plus a terminating NUL
+    char* allocate(size_t len) {
+        thread_state& ts = threads_[TThread::id()];
+        size_t need = len + 1;
+        ts.used += need;
+        if (!reclaim_)
+            return carve(ts, need);
+        int c = size_class(need);
+        if (char* p = ts.free_lists[c]) {
+            memcpy(&ts.free_lists[c], p, sizeof(char*));
+            return p;
+        }
+        return carve(ts, size_t(16) << c);
+    }
+
+    // A value stored at `old` (nullptr if inline) was replaced by one
+    // stored at `fresh` (likewise); see the class comment
+    void replaced(const char* old, size_t old_len, const char* fresh, size_t fresh_len) {
+        if (!reclaim_ || !Sto::in_progress() || (!old && !fresh))
+            return;
+        if (TThread::txn->committing()) {
+            if (old)
+                retire(new retired{this, TThread::id(), {{const_cast<char*>(old), old_len}}});
+            return;
+        }
+        thread_state& ts = threads_[TThread::id()];
+        if (old)
+            ts.retiring.emplace_back(const_cast<char*>(old), old_len);
+        if (fresh)
+            ts.fresh.emplace_back(const_cast<char*>(fresh), fresh_len);
+        Sto::item(this, 0).add_write();
+    }
+
+    // Bytes of live string data, NULs included
+    size_t bytes_used() const {
+        size_t n = 0;
+        for (auto& ts : threads_)
+            n += ts.used;
+        return n;
+    }
+    // Bytes obtained from malloc
+    size_t bytes_allocated() const {
+        size_t n = 0;
+        for (auto& ts : threads_)
+            n += ts.allocated;
+        return n;
+    }
+
+    // The arena that implicit compact_string conversions store into on
+    // this thread. Loaders point it at the table being loaded with a scope.
+    static string_arena*& current() {
+        static string_arena global;
+        static __thread string_arena* cur = nullptr;
+        if (!cur)
+            cur = &global;
+        return cur;
+    }
+
+    class scope {
+    public:
+        explicit scope(string_arena& a) : prev_(current()) {
+            current() = &a;
+        }
+        ~scope() {
+            current() = prev_;
+        }
+    private:
+        string_arena* prev_;
+    };
+
+    bool lock(TransItem&, Transaction&) override {
+        return true;
+    }
+    bool check(TransItem&, Transaction&) override {
+        return true;
+    }
+    void install(TransItem&, Transaction&) override {
+    }
+    void unlock(TransItem&) override {
+    }
+    void cleanup(TransItem&, bool committed) override {
+        thread_state& ts = threads_[TThread::id()];
+        if (committed && !ts.retiring.empty()) {
+            auto r = new retired{this, TThread::id(), {}};
+            r->strings.swap(ts.retiring);
+            retire(r);
+        } else if (!committed) {
+            for (auto& s : ts.fresh)
+                release(ts, s.first, s.second);
+        }
+        ts.retiring.clear();
+        ts.fresh.clear();
+    }
+
+private:
+    typedef std::vector<std::pair<char*, size_t>> string_list;
+
+    struct thread_state {
+        char* next = nullptr;
+        char* end = nullptr;
+        size_t used = 0;
+        size_t allocated = 0;
+        std::vector<char*> chunks;
+        char* free_lists[num_classes] = {};
+        // Replacements by the running transaction
+        string_list retiring;
+        string_list fresh;
+    } __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    struct retired {
+        string_arena* arena;
+        int thread;
+        string_list strings;
+    };
+
+    static int size_class(size_t need) {
+        return need <= 16 ? 0 : 60 - __builtin_clzl(need - 1);
+    }
+
+    char* carve(thread_state& ts, size_t size) {
+        if (size > chunk_size / 4) {
+            // big strings get a chunk of their own
+            char* c = (char*) malloc(size);
+            ts.chunks.push_back(c);
+            ts.allocated += size;
+            return c;
+        }
+        if (size_t(ts.end - ts.next) < size) {
+            ts.next = (char*) malloc(chunk_size);
+            ts.end = ts.next + chunk_size;
+            ts.chunks.push_back(ts.next);
+            ts.allocated += chunk_size;
+        }
+        char* p = ts.next;
+        ts.next += size;
+        return p;
+    }
+
+    // Back on the free list of the thread that stored or retired it
+    static void release(thread_state& ts, char* p, size_t len) {
+        size_t need = len + 1;
+        int c = size_class(need);
+        ts.used -= need;
+        memcpy(p, &ts.free_lists[c], sizeof(char*));
+        ts.free_lists[c] = p;
+    }
+
+    void retire(retired* r) {
+        if (retire_)
+            retire_(free_retired, r);
+        else
+            Transaction::rcu_call(free_retired, r);
+    }
+
+    static void free_retired(void* x) {
+        auto r = static_cast<retired*>(x);
+        thread_state& ts = r->arena->threads_[r->thread];
+        for (auto& s : r->strings)
+            release(ts, s.first, s.second);
+        delete r;
+    }
+
+    bool reclaim_;
+    retire_hook retire_;
+    thread_state threads_[MAX_THREADS];
+};
+
+// Variable-length string of at most ML bytes, stored in 16 bytes: a length,
+// and either the string itself (up to 13 bytes, NUL-terminated) or a
+// pointer into a string_arena and the string's first 6 bytes. The prefix
+// settles most comparisons without chasing the pointer. The pointer is the
+// first, 8-byte-aligned word, so a reader racing a row install loads either
+// the old or the new pointer, never a mix. Copies are shallow, and the
+// characters cannot be modified in place; assign a new value instead.
+//
+// VARCHAR(n) columns use this when a var_string<n> would be bigger.
+template <size_t ML>
+class compact_string {
+public:
+    static constexpr size_t max_length = ML;
+    static constexpr size_t inline_capacity = 13;
+    static_assert(ML < 65536, "compact_string length must fit 16 bits.");
+
+    compact_string() {
+        memset(&u_, 0, sizeof(u_));
+    }
+
+    compact_string(const char* c_str) {
+        init(c_str, strlen(c_str), *string_arena::current());
+    }
+
+    compact_string(const std::string& str) {
+        init(str.data(), str.length(), *string_arena::current());
+    }
+
+    compact_string(const char* s, size_t len, string_arena& arena) {
+        init(s, len, arena);
+    }
+
+    compact_string(const compact_string&) = default;
+    compact_string& operator=(const compact_string&) = default;
+
+    // Replaces the value with bytes stored in `arena`, which must be the
+    // one holding the current value. Inside a transaction, assign only to
+    // the copy of a row it writes: the arena retires the old bytes if the
+    // transaction commits, and reuses the new ones if it aborts.
+    void assign(const char* s, size_t len, string_arena& arena) {
+        const char* old = out_of_line();
+        size_t old_len = length();
+        init(s, len, arena);
+        arena.replaced(old, old_len, out_of_line(), length());
+    }
+
+    // Prepends `cnt` bytes and truncates to ML, as fix_string::insert_left
+    // does; replaces the value like assign(). With track = false the old
+    // bytes are left alone and the new ones are never reclaimed, for
+    // replacements made outside the writing transaction.
+    void insert_left(const char* buf, size_t cnt, string_arena& arena, bool track = true) {
+        const char* old = out_of_line();
+        size_t old_len = length();
+        size_t len = std::min(cnt + old_len, ML);
+        cnt = std::min(cnt, len);
+        if (len <= inline_capacity) {
+            memmove(u_.in.s + cnt, u_.in.s, len - cnt);
+            memcpy(u_.in.s, buf, cnt);
+            memset(u_.in.s + len, 0, sizeof(u_.in.s) - len);
+            u_.in.len = len;
+        } else {
+            char* p = arena.allocate(len);
+            memcpy(p, buf, cnt);
+            memcpy(p + cnt, c_str(), len - cnt);
+            p[len] = '\0';
+            set_out_of_line(p, len);
+        }
+        if (track)
+            arena.replaced(old, old_len, out_of_line(), length());
+    }
+
+    size_t length() const {
+        return u_.in.len;
+    }
+
+    const char* c_str() const {
+        if (length() <= inline_capacity)
+            return u_.in.s;
+        return u_.out.ptr;
+    }
+
+    char operator[](size_t idx) const {
+        return c_str()[idx];
+    }
+
+    bool operator==(const compact_string& rhs) const {
+        size_t len = length();
+        if (len != rhs.length())
+            return false;
+        if (len <= inline_capacity)
+            return !memcmp(u_.in.s, rhs.u_.in.s, len);
+        return !memcmp(u_.out.prefix, rhs.u_.out.prefix, sizeof(u_.out.prefix))
+               && !memcmp(c_str(), rhs.c_str(), len);
+    }
+
+    bool operator==(const char* c_str) const {
+        return equals(c_str, strnlen(c_str, ML + 1));
+    }
+
+    bool operator==(const std::string& str) const {
+        return equals(str.data(), str.length());
+    }
+
+    explicit operator std::string() const {
+        return std::string(c_str(), length());
+    }
+
+    bool contains(const char* substr) const {
+        return strstr(c_str(), substr) != nullptr;
+    }
+
+private:
+    void init(const char* s, size_t len, string_arena& arena) {
+        len = std::min(len, ML);
+        if (len <= inline_capacity) {
+            u_.in.len = len;
+            memcpy(u_.in.s, s, len);
+            memset(u_.in.s + len, 0, sizeof(u_.in.s) - len);
+        } else {
+            set_out_of_line(arena.store(s, len), len);
+        }
+    }
+
+    void set_out_of_line(const char* p, size_t len) {
+        u_.out.len = len;
+        memcpy(u_.out.prefix, p, sizeof(u_.out.prefix));
+        u_.out.ptr = p;
+    }
+
+    const char* out_of_line() const {
+        return length() > inline_capacity ? u_.out.ptr : nullptr;
+    }
+
+    bool equals(const char* s, size_t len) const {
+        len = std::min(len, ML);
+        return len == length() && !memcmp(c_str(), s, len);
+    }
+
+    // Both layouts keep the length in the last two bytes
+    union {
+        struct {
+            char s[inline_capacity + 1];
+            uint16_t len;
+        } in;
+        struct {
+            const char* ptr;
+            char prefix[6];
+            uint16_t len;
+        } out;
+    } u_;
+};
+
+static_assert(sizeof(compact_string<255>) == 16, "compact_string should take 16 bytes.");
+static_assert(alignof(compact_string<255>) == 8, "compact_string pointers should be word-aligned.");
+
+// Append-only dictionary of strings of at most ML bytes, each with a dense
+// integer code. Decoding and lookups are lock-free; adding a string takes a
+// lock. Entries live in fixed chunks and the hash index is replaced when it
+// fills, so pointers readers hold stay valid until the dictionary dies.
+template <size_t ML>
+class string_dictionary {
+public:
+    static constexpr uint32_t chunk_bits = 10;
+    static constexpr uint32_t max_codes = 1u << 24;
+
+    explicit string_dictionary(uint32_t code_limit = max_codes)
+        : limit_(std::min(code_limit, max_codes)), size_(0),
+          chunks_(new std::atomic<entry*>[(limit_ >> chunk_bits) + 1]()) {
+        index_.store(make_index(64), std::memory_order_relaxed);
+    }
+    string_dictionary(const string_dictionary&) = delete;
+    string_dictionary& operator=(const string_dictionary&) = delete;
+
+    ~string_dictionary() {
+        for (uint32_t c = 0; c <= (limit_ >> chunk_bits); ++c)
+            delete[] chunks_[c].load(std::memory_order_relaxed);
+        for (auto i : retired_)
+            free(i);
+        free(index_.load(std::memory_order_relaxed));
+    }
+
+    uint32_t size() const {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    // NUL-terminated string for `code`
+    const char* decode(uint32_t code) const {
+        assert(code < size());
+        return at(code).s;
+    }
+    size_t length(uint32_t code) const {
+        return at(code).len;
+    }
+
+    // Code of `s`, or -1 if it is not in the dictionary
+    int64_t find(const char* s, size_t len) const {
+        len = std::min(len, ML);
+        return probe(index_.load(std::memory_order_acquire), s, len, hash(s, len));
+    }
+
+    // Code of `s`, adding it if needed
+    uint32_t encode(const char* s, size_t len) {
+        len = std::min(len, ML);
+        uint64_t h = hash(s, len);
+        int64_t code = probe(index_.load(std::memory_order_acquire), s, len, h);
+        if (code >= 0)
+            return code;
+        std::lock_guard<std::mutex> guard(lock_);
+        index* idx = index_.load(std::memory_order_relaxed);
+        code = probe(idx, s, len, h);
+        if (code >= 0)
+            return code;
+        uint32_t n = size_.load(std::memory_order_relaxed);
+        always_assert(n < limit_, "string dictionary full");
+        auto& chunk = chunks_[n >> chunk_bits];
+        if (!chunk.load(std::memory_order_relaxed))
+            chunk.store(new entry[1u << chunk_bits], std::memory_order_release);
+        entry& e = chunk.load(std::memory_order_relaxed)[n & ((1u << chunk_bits) - 1)];
+        memcpy(e.s, s, len);
+        e.s[len] = '\0';
+        e.len = len;
+        e.hash = h;
+        size_.store(n + 1, std::memory_order_release);
+        if (2 * (n + 1) > idx->mask) {
+            index* bigger = make_index(2 * (idx->mask + 1));
+            for (uint32_t c = 0; c <= n; ++c)
+                insert(bigger, c);
+            index_.store(bigger, std::memory_order_release);
+            // readers may still be probing the old index
+            retired_.push_back(idx);
+        } else {
+            insert(idx, n);
+        }
+        return n;
+    }
+
+private:
+    struct entry {
+        uint64_t hash;
+        uint16_t len;
+        char s[ML + 1];
+    };
+
+    // Open addressing; slots hold code + 1, or 0 when empty
+    struct index {
+        uint32_t mask;
+        std::atomic<uint32_t> slots[];
+    };
+
+    // FNV-1a; dictionary strings are short
+    static uint64_t hash(const char* s, size_t len) {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i != len; ++i)
+            h = (h ^ (unsigned char) s[i]) * 1099511628211ull;
+        return h;
+    }
+
+    static index* make_index(uint32_t nslots) {
+        index* idx = (index*) calloc(1, sizeof(index) + nslots * sizeof(std::atomic<uint32_t>));
+        idx->mask = nslots - 1;
+        return idx;
+    }
+
+    const entry& at(uint32_t code) const {
+        return chunks_[code >> chunk_bits].load(std::memory_order_acquire)[code & ((1u << chunk_bits) - 1)];
+    }
+
+    int64_t probe(const index* idx, const char* s, size_t len, uint64_t h) const {
+        for (uint32_t i = h & idx->mask; ; i = (i + 1) & idx->mask) {
+            uint32_t v = idx->slots[i].load(std::memory_order_acquire);
+            if (!v)
+                return -1;
+            const entry& e = at(v - 1);
+            if (e.hash == h && e.len == len && !memcmp(e.s, s, len))
+                return v - 1;
+        }
+    }
+
+    void insert(index* idx, uint32_t code) {
+        uint32_t i = at(code).hash & idx->mask;
+        while (idx->slots[i].load(std::memory_order_relaxed))
+            i = (i + 1) & idx->mask;
+        idx->slots[i].store(code + 1, std::memory_order_release);
+    }
+
+    const uint32_t limit_;
+    std::atomic<uint32_t> size_;
+    std::unique_ptr<std::atomic<entry*>[]> chunks_;
+    std::atomic<index*> index_;
+    std::mutex lock_;
+    std::vector<index*> retired_;
+};
+
+// Dictionary-encoded string of at most ML bytes, for columns with few
+// distinct values. Rows store only a Code (1 to 4 bytes); the dictionary is
+// shared by every column of the same ML and Code in table Tag, so copies
+// between a table's split and unsplit row types keep their meaning.
+// Comparisons compare codes; comparing with a plain string looks it up
+// first, and a string missing from the dictionary equals nothing.
+template <size_t ML, typename Code = uint8_t, typename Tag = void>
+class __attribute__((packed)) dict_string {
+public:
+    typedef Code code_type;
+    typedef string_dictionary<ML> dictionary_type;
+    static constexpr size_t max_length = ML;
+    static_assert(sizeof(Code) >= 1 && sizeof(Code) <= 4, "Dictionary codes take 1 to 4 bytes.");
+
+    // Code 0 is always the empty string
+    dict_string() : code_(0) {}
+
+    dict_string(const char* c_str)
+        : code_(encode(c_str, strlen(c_str))) {}
+
+    dict_string(const std::string& str)
+        : code_(encode(str.data(), str.length())) {}
+
+    dict_string(const dict_string&) = default;
+    dict_string& operator=(const dict_string&) = default;
+
+    static dictionary_type& dictionary() {
+        static dictionary_type dict(code_limit);
+        static bool init = (dict.encode("", 0), true);
+        (void) init;
+        return dict;
+    }
+
+    // Code of `s` for predicates, or nothing if no row can hold `s`
+    static int64_t find(const char* s) {
+        return dictionary().find(s, strlen(s));
+    }
+
+    Code code() const {
+        return code_;
+    }
+
+    bool operator==(const dict_string& rhs) const {
+        return code_ == rhs.code_;
+    }
+    bool operator!=(const dict_string& rhs) const {
+        return code_ != rhs.code_;
+    }
+
+    bool operator==(const char* c_str) const {
+        return dictionary().find(c_str, strlen(c_str)) == code_;
+    }
+
+    bool operator==(const std::string& str) const {
+        return dictionary().find(str.data(), str.length()) == code_;
+    }
+
+    char operator[](size_t idx) const {
+        return c_str()[idx];
+    }
+
+    const char* c_str() const {
+        return dictionary().decode(code_);
+    }
+
+    size_t length() const {
+        return dictionary().length(code_);
+    }
+
+    explicit operator std::string() const {
+        return std::string(c_str(), length());
+    }
+
+private:
+    static constexpr uint32_t code_limit = sizeof(Code) >= 4 ? string_dictionary<ML>::max_codes
+                                           : std::min<uint64_t>(uint64_t(1) << (8 * sizeof(Code)),
+                                                                string_dictionary<ML>::max_codes);
+
+    static Code encode(const char* s, size_t len) {
+        return dictionary().encode(s, len);
+    }
+
+    Code code_;
+};
+
+}; // namespace bench
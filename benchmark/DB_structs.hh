@@ -15,6 +15,7 @@
 #endif
 
 #include "str.hh"
+#include "DB_string.hh"
 
 namespace bench {
 
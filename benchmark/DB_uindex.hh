@@ -19,6 +19,7 @@ public:
     using typename C::version_type;
     using typename C::value_container_type;
     using typename C::comm_type;
+    using typename C::NamedColumn;
 
     using C::invalid_bit;
     using C::insert_bit;
@@ -44,7 +45,7 @@ public:
 
     // our hashtable is an array of linked lists.
     // an internal_elem is the node type for these linked lists
-    struct internal_elem {
+    struct internal_elem : public HugeArenaObject {
         internal_elem *next;
         key_type key;
         value_container_type row_container;
@@ -78,13 +79,15 @@ private:
         bucket_entry() : head(nullptr), version(0) {}
     };
 
-    typedef std::vector<bucket_entry> MapType;
+    typedef std::vector<bucket_entry, HugeArenaAllocator<bucket_entry>> MapType;
     // this is the hashtable itself, an array of bucket_entry's
     MapType map_;
     Hash hasher_;
     Pred pred_;
 
     uint64_t key_gen_;
+    // CCPolicy access site of this table, or -1
+    int policy_site_;
 
     // used to mark whether a key is a bucket (for bucket version checks)
     // or a pointer (which will always have the lower 3 bits as 0)
@@ -101,13 +104,33 @@ public:
     template <typename T>
     static constexpr auto extract_item_list
         = split_version_helpers<index_t>::template extract_item_list<T>;
+    typedef adaptive_split_layout<value_container_type::num_versions> split_layout_type;
 
     // Main constructor
     unordered_index(size_t size, Hash h = Hash(), Pred p = Pred()) :
-            map_(), hasher_(h), pred_(p), key_gen_(0) {
+            map_(), hasher_(h), pred_(p), key_gen_(0), policy_site_(-1) {
         map_.resize(size);
     }
 
+    void set_policy_site(int site) {
+        policy_site_ = site;
+    }
+
+    // Regroup the row version cells at runtime, see DB_split_layout.hh
+    void enable_adaptive_split() {
+        if (value_container_type::num_versions > 1)
+            split_layout_ = std::make_shared<split_layout_type>();
+    }
+    const split_layout_type* adaptive_split() const {
+        return split_layout_.get();
+    }
+
+    // Out-of-line bytes of this table's compact_string columns; load
+    // under a string_arena::scope on it, and update them through it
+    string_arena& strings() {
+        return *strings_;
+    }
+
     inline size_t hash(const key_type& k) const {
         return hasher_(k);
     }
@@ -207,7 +230,7 @@ public:
         auto e = reinterpret_cast<internal_elem*>(rid);
         TransProxy row_item = Sto::item(this, item_key_t::row_item_key(e));
 
-        auto cell_accesses = column_to_cell_accesses<value_container_type>(accesses);
+        auto cell_accesses = cell_accesses_of(accesses);
 
         std::array<TransItem*, value_container_type::num_versions> cell_items {};
         bool any_has_write;
@@ -231,7 +254,7 @@ public:
             }
         }
 
-        ok = access_all(cell_accesses, cell_items, e->row_container);
+        ok = access_all(cell_accesses, cell_items, e->row_container, policy_site_);
         if (!ok)
             return { false, false, 0, UniRecordAccessor<V>(nullptr) };
 
@@ -250,6 +273,24 @@ public:
         row_item.add_commute(comm);
     }
 
+    // Opt-in repair of this transaction's read of column `col` in row `rid`
+    // (see TransProxy::add_repair). Fragments run at commit, may read the
+    // row's current contents with nontrans_row(), and redo their writes by
+    // rewriting the row they passed to update_row().
+    void add_repair(uintptr_t rid, NamedColumn col, Transaction::repair_fn fn, void* arg) {
+        auto e = reinterpret_cast<internal_elem*>(rid);
+        typename split_layout_type::mask_type cells = 1u << value_container_type::map(static_cast<int>(col));
+        if (split_layout_)
+            cells = split_layout_->leaders(cells);
+        for (; cells; cells &= cells - 1) {
+            int cell = __builtin_ctz(cells);
+            Sto::item(this, item_key_t(e, cell)).add_repair(e->row_container.version_at(cell), fn, arg);
+        }
+    }
+    const value_type& nontrans_row(uintptr_t rid) const {
+        return reinterpret_cast<const internal_elem*>(rid)->row_container.row;
+    }
+
     ins_return_type
     insert_row(const key_type& k, value_type *vptr, bool overwrite = false) {
         bucket_entry& buck = map_[find_bucket_idx(k)];
@@ -383,11 +424,21 @@ public:
         assert(!is_bucket(item));
         auto key = item.key<item_key_t>();
         auto e = key.internal_elem_ptr();
+        bool locked;
         if (key.is_row_item()) {
-            return txn.try_lock(item, e->version());
+            locked = txn.try_lock(item, e->version());
         } else {
-            return txn.try_lock(item, e->row_container.version_at(key.cell_num()));
+            locked = txn.try_lock(item, e->row_container.version_at(key.cell_num()));
+        }
+        if constexpr (C::Commute) {
+            if (locked && !commute_escrow_check(item, txn, key, e)) {
+                TXP_INCREMENT(txp_commute_escrow_aborts);
+                // not yet marked as needing unlock by the commit protocol
+                unlock(item);
+                return false;
+            }
         }
+        return locked;
     }
 
     bool check(TransItem& item, Transaction& txn) override {
@@ -432,7 +483,7 @@ public:
                     if (has_row_update(item)) {
                         copy_row(e, vptr);
                     } else if (has_row_cell(item)) {
-                        e->row_container.install_cell(0, vptr);
+                        split_version_helpers<index_t>::install_cells(e->row_container, 0, vptr, split_layout_.get());
                     }
                 }
             }
@@ -446,7 +497,7 @@ public:
                     e->row_container.install_cell(comm);
                 } else {
                     auto vptr = row_item.template raw_write_value<value_type*>();
-                    e->row_container.install_cell(key.cell_num(), vptr);
+                    split_version_helpers<index_t>::install_cells(e->row_container, key.cell_num(), vptr, split_layout_.get());
                 }
             }
             txn.set_version_unlock(e->row_container.version_at(key.cell_num()), item);
@@ -475,12 +526,47 @@ public:
     }
 
 private:
+    // Set by enable_adaptive_split()
+    std::shared_ptr<split_layout_type> split_layout_;
+    std::shared_ptr<string_arena> strings_ = std::make_shared<string_arena>();
+
+    std::array<access_t, value_container_type::num_versions>
+    cell_accesses_of(std::initializer_list<column_access_t> accesses) {
+        if (split_layout_) {
+            return split_version_helpers<index_t>::template adaptive_column_to_cell_accesses<value_container_type>(
+                    *split_layout_, accesses);
+        }
+        return column_to_cell_accesses<value_container_type>(accesses);
+    }
+
+    // Escrow-style bounds check for commutative updates. Runs on the item
+    // through which install() will apply the commutator, once its version
+    // is locked, so the row value inspected cannot change before install.
+    bool commute_escrow_check(TransItem& item, Transaction& txn, const item_key_t& key, internal_elem* e) {
+        if (key.is_row_item()) {
+            if (!item.has_commute() || has_insert(item) || has_delete(item)
+                || !(has_row_update(item) || has_row_cell(item))) {
+                return true;
+            }
+            return commutators::escrow_check(item.write_value<comm_type>(), e->row_container.row);
+        } else {
+            // update_row() registered the row item carrying the commutator;
+            // look it up without adding to the tset, which is being iterated
+            auto row_item = txn.check_item(this, item_key_t::row_item_key(e));
+            if (!row_item || !row_item->has_commute() || has_row_update(row_item->item())) {
+                return true;
+            }
+            return commutators::escrow_check(row_item->template write_value<comm_type>(), e->row_container.row);
+        }
+    }
+
     static bool
-    access_all(std::array<access_t, value_container_type::num_versions>& cell_accesses, std::array<TransItem*, value_container_type::num_versions>& cell_items, value_container_type& row_container) {
+    access_all(std::array<access_t, value_container_type::num_versions>& cell_accesses, std::array<TransItem*, value_container_type::num_versions>& cell_items, value_container_type& row_container, int site) {
         for (size_t idx = 0; idx < cell_accesses.size(); ++idx) {
             auto& access = cell_accesses[idx];
             auto proxy = TransProxy(*Sto::transaction(), *cell_items[idx]);
             if (static_cast<uint8_t>(access) & static_cast<uint8_t>(access_t::read)) {
+                CCPolicy::apply<version_type>(proxy.item(), site);
                 if (!proxy.observe(row_container.version_at(idx)))
                     return false;
             }
@@ -625,7 +711,7 @@ public:
 #if 0
     // our hashtable is an array of linked lists.
     // an internal_elem is the node type for these linked lists
-    struct internal_elem {
+    struct internal_elem : public HugeArenaObject {
         typedef typename SplitParams<value_type>::layout_type split_layout_type;
 
         internal_elem* next;
@@ -675,13 +761,14 @@ private:
         bucket_entry() : head(nullptr), version(0) {}
     };
 
-    typedef std::vector<bucket_entry> MapType;
+    typedef std::vector<bucket_entry, HugeArenaAllocator<bucket_entry>> MapType;
     // this is the hashtable itself, an array of bucket_entry's
     MapType map_;
     Hash hasher_;
     Pred pred_;
 
     uint64_t key_gen_;
+    std::shared_ptr<string_arena> strings_ = std::make_shared<string_arena>(true, MvGarbage::call_after_collect);
 
     // used to mark whether a key is a bucket (for bucket version checks)
     // or a pointer (which will always have the lower 3 bits as 0)
@@ -705,6 +792,17 @@ public:
         map_.resize(size);
     }
 
+    // MVCC reads never lock, so there is no policy to apply
+    void set_policy_site(int) {}
+    void enable_adaptive_split() {}
+
+    // Out-of-line bytes of this table's compact_string columns; load
+    // under a string_arena::scope on it. Replaced bytes are reclaimed only
+    // once the old versions that share them have been collected.
+    string_arena& strings() {
+        return *strings_;
+    }
+
     inline size_t hash(const key_type& k) const {
         return hasher_(k);
     }
@@ -13,6 +13,11 @@ const char* tpcc_input_generator::last_names[] = {
         "BAR", "OUGHT", "ABLE", "PRI", "PRES",
         "ESE", "ANTI", "CALLY", "ATION", "EING"};
 
+const char* ch_dimensions::region_names[] = {
+        "AFRICA", "AMERICA", "ASIA", "EUROPE", "MIDDLE EAST"};
+
+const int ch_queries::ids[] = { 1, 5, 6, 12, 14 };
+
 }; // namespace tpcc
 
 const Clp_Option options[] = {
@@ -28,6 +33,22 @@ const Clp_Option options[] = {
         { "commute",      'x', opt_comm,  Clp_NoVal,     Clp_Negate | Clp_Optional },
         { "verbose",      'v', opt_verb,  Clp_NoVal,     Clp_Negate | Clp_Optional },
         { "mix",          'm', opt_mix,   Clp_ValInt,    Clp_Optional },
+        { "cc-policy",    'y', opt_ccpol, Clp_ValString, Clp_Optional },
+        { "fallback",     'f', opt_fback,  Clp_ValUnsigned, Clp_Optional },
+        { "serial",       's', opt_serial, Clp_ValUnsigned, Clp_Optional },
+        { "validate",     'e', opt_valid,  Clp_ValUnsigned, Clp_Optional },
+        { "priority",     'a', opt_prio,   Clp_ValString, Clp_Optional },
+        { "deadline",     'd', opt_dline,  Clp_ValDouble, Clp_Optional },
+        { "rts-batch",    'b', opt_rtsb,   Clp_ValUnsigned, Clp_Optional },
+        { "adaptive-split", 'j', opt_asplit, Clp_NoVal,   Clp_Negate | Clp_Optional },
+        { "numa",         'u', opt_numa,   Clp_ValString, Clp_Optional },
+        { "hugepages",    'h', opt_huge,   Clp_ValString, Clp_Optional },
+        { "analytic",     'k', opt_chthr,  Clp_ValInt,    Clp_Optional },
+        { "ch-queries",   'q', opt_chq,    Clp_ValString, Clp_Optional },
+        { "cold-versions", 'z', opt_cold,  Clp_ValUnsigned, Clp_Optional },
+        { "lock-policy",  'o', opt_lpol,   Clp_ValString, Clp_Optional },
+        { "early-release", 0,  opt_early,  Clp_NoVal,     Clp_Negate | Clp_Optional },
+        { "reader-bias",  0,   opt_rbias,  Clp_NoVal,     Clp_Negate | Clp_Optional },
 };
 
 const char* workload_mix_names[] = { "Full", "NO-only", "NO+P-only" };
@@ -67,7 +88,56 @@ void print_usage(const char *argv_0) {
        << "    Specify workload mix:" << std::endl
        << "    0. Full mix (default)" << std::endl
        << "    1. New-order only" << std::endl
-       << "    2. New-order plus Payment only" << std::endl;
+       << "    2. New-order plus Payment only" << std::endl
+       << "  --cc-policy=<FILE> (or -y<FILE>)" << std::endl
+       << "    Load a per-transaction-type, per-table concurrency control policy (not for tictoc)." << std::endl
+       << "  --fallback=<NUM> (or -f<NUM>)" << std::endl
+       << "    After NUM aborts, retry while locking the records that caused them at access time" << std::endl
+       << "    (default 0, off; not for tictoc)." << std::endl
+       << "  --serial=<NUM> (or -s<NUM>)" << std::endl
+       << "    After NUM aborts, retry under a global serial token (default 0, off)." << std::endl
+       << "  --validate=<NUM> (or -e<NUM>)" << std::endl
+       << "    Validate optimistic reads early, every NUM reads and between delivery districts (default 0, off)." << std::endl
+       << "  --priority[=<LIST>] (or -a[<LIST>])" << std::endl
+       << "    Run transaction types at priority classes 0-3 (higher wins conflicts), listed for" << std::endl
+       << "    new-order, payment, order-status, delivery and stock-level (default 1,1,1,0,1)," << std::endl
+       << "    and report latency per class. Classes decide lock conflicts for swiss and for 2pl/adaptive" << std::endl
+       << "    under wait-die/wound-wait; otherwise they only lengthen the spin on a held lock (blind writes" << std::endl
+       << "    under OCC, all 2pl locks under --lock-policy=spin) and shorten the abort backoff." << std::endl
+       << "  --deadline=<MS> (or -d<MS>)" << std::endl
+       << "    With --priority, give transactions above class 0 a deadline MS after they start. Deadlines" << std::endl
+       << "    order conflicts within a class where classes do, and skip the abort backoff once passed." << std::endl
+       << "  --rts-batch=<NUM> (or -b<NUM>)" << std::endl
+       << "    TicToc: extend the read timestamps of read-hot rows NUM past the commit timestamp (default 0, off)." << std::endl
+       << "  --adaptive-split (or -j)" << std::endl
+       << "    Regroup the version cells of split tables at runtime from their read/write co-access;" << std::endl
+       << "    tables start with the codegen split. Needs FINE_GRAINED=1 (default false)." << std::endl
+       << "  --numa=<MODE> (or -u<MODE>)" << std::endl
+       << "    Warehouse placement over NUMA nodes: legacy (default), local (each node loads and" << std::endl
+       << "    runs a contiguous block of warehouses) or interleave (pages spread over all nodes)." << std::endl
+       << "  --hugepages=<MODE> (or -h<MODE>)" << std::endl
+       << "    Place rows, hash index buckets and transaction sets on huge pages: off (default)," << std::endl
+       << "    thp (transparent huge pages) or hugetlb (the hugetlbfs pool, see mount_hugepages.sh;" << std::endl
+       << "    falls back to thp). Compare dTLB misses with --perf-counter. Masstree index nodes" << std::endl
+       << "    are not covered: they come from the process allocator, which maps 2MB pages only in" << std::endl
+       << "    the default rpmalloc build, whatever the mode (not with USE_JEMALLOC or USE_LIBCMALLOC)." << std::endl
+       << "  --analytic=<NUM> (or -k<NUM>)" << std::endl
+       << "    CH-benCHmark: run NUM analytic threads next to the TPC-C threads, each running" << std::endl
+       << "    CH queries back to back, and report query latency next to throughput (default 0)." << std::endl
+       << "    Without MVCC each query reads one district per transaction, not one snapshot." << std::endl
+       << "  --ch-queries=<LIST> (or -q<LIST>)" << std::endl
+       << "    The CH queries the analytic threads run, of 1,5,6,12,14 (default all)." << std::endl
+       << "  --cold-versions=<EPOCHS> (or -z<EPOCHS>)" << std::endl
+       << "    MVCC: compress rows in versions that old snapshots (e.g. analytic threads) keep" << std::endl
+       << "    alive for more than EPOCHS epochs, and report version memory (default 0, off)." << std::endl
+       << "  --lock-policy=<STRING> (or -o<STRING>)" << std::endl
+       << "    Deadlock prevention policy for 2pl and adaptive: spin (default), wait-die, or wound-wait." << std::endl
+       << "  --early-release" << std::endl
+       << "    2pl and adaptive: payment releases its warehouse and district YTD write locks right" << std::endl
+       << "    after updating them, before commit (default false)." << std::endl
+       << "  --reader-bias" << std::endl
+       << "    2pl and adaptive: take read locks in per-thread slots instead of the shared lock" << std::endl
+       << "    word; writers revoke the bias (default false)." << std::endl;
 
     std::cout << ss.str() << std::flush;
 }
@@ -100,6 +170,7 @@ int main(int argc, const char *const *argv) {
         0
         #endif
     << std::endl;
+    std::cout << "TICTOC_COMPRESSED: " << TICTOC_COMPRESSED << std::endl;
     std::cout << "MALLOC: " <<
         #ifdef MALLOC
         MALLOC
@@ -121,6 +192,7 @@ int main(int argc, const char *const *argv) {
     bool clp_stop = false;
     bool node_tracking = false;
     bool enable_commute = false;
+    bool reader_bias = false;
     while (!clp_stop && ((opt = Clp_Next(clp)) != Clp_Done)) {
         switch (opt) {
         case opt_dbid:
@@ -139,6 +211,9 @@ int main(int argc, const char *const *argv) {
         case opt_comm:
             enable_commute = !clp->negated;
             break;
+        case opt_rbias:
+            reader_bias = !clp->negated;
+            break;
         default:
             break;
         }
@@ -170,14 +245,17 @@ int main(int argc, const char *const *argv) {
             std::cerr << "Warning: No node tracking option for opaque versions." << std::endl;
         }
         break;
-    /*
     case db_params_id::TwoPL:
-        ret_code = tpcc_access<db_2pl_params>::execute(argc, argv);
-        break;
     case db_params_id::Adaptive:
-        ret_code = tpcc_access<db_adaptive_params>::execute(argc, argv);
+        if (node_tracking || enable_commute) {
+            std::cerr << "Warning: node tracking and commute options ignored." << std::endl;
+        }
+        if (dbid == db_params_id::TwoPL) {
+            ret_code = reader_bias ? tpcc_lb(argc, argv) : tpcc_l(argc, argv);
+        } else {
+            ret_code = reader_bias ? tpcc_ab(argc, argv) : tpcc_a(argc, argv);
+        }
         break;
-    */
     case db_params_id::Swiss:
         ret_code = tpcc_s(argc, argv);
         break;
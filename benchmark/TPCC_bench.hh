@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <random>
 #include <string>
 #include <thread>
@@ -23,6 +25,7 @@
 #include "DB_params.hh"
 #include "DB_profiler.hh"
 #include "PlatformFeatures.hh"
+#include "TRetireBox.hh"
 
 #if TABLE_FINE_GRAINED
 #include "tpcc_split_params_ts.hh"
@@ -39,7 +42,8 @@
 // @section: clp parser definitions
 enum {
     opt_dbid = 1, opt_nwhs, opt_nthrs, opt_time, opt_perf, opt_pfcnt, opt_gc,
-    opt_gr, opt_node, opt_comm, opt_verb, opt_mix
+    opt_gr, opt_node, opt_comm, opt_verb, opt_mix, opt_ccpol, opt_fback, opt_serial, opt_valid,
+    opt_prio, opt_dline, opt_rtsb, opt_asplit, opt_numa, opt_huge, opt_chthr, opt_chq, opt_cold, opt_lpol, opt_early, opt_rbias
 };
 
 extern const char* workload_mix_names[];
@@ -63,6 +67,11 @@ extern int tpcc_mcn(int, char const* const*);
 
 extern int tpcc_s(int, char const* const*);
 
+extern int tpcc_l(int, char const* const*);
+extern int tpcc_lb(int, char const* const*);
+extern int tpcc_a(int, char const* const*);
+extern int tpcc_ab(int, char const* const*);
+
 extern int tpcc_t(int, char const* const*);
 extern int tpcc_tc(int, char const* const*);
 extern int tpcc_tn(int, char const* const*);
@@ -72,6 +81,85 @@ namespace tpcc {
 
 using namespace db_params;
 using bench::db_profiler;
+using bench::latency_histogram;
+
+// Priority classes for mixed interactive and batch runs (--priority). Each
+// transaction type runs at its class's priority (see
+// ContentionManager::set_priority); the deadline, if any, applies to classes
+// above 0 and counts from the transaction's first attempt.
+struct tpcc_priorities {
+    static constexpr int max_classes = 4;
+
+    tpcc_priorities() : enabled(false), of_type(), deadline_ticks(0) {}
+
+    // Parses a comma-separated list of classes for new-order, payment,
+    // order-status, delivery and stock-level, in that order
+    bool parse(const char* s) {
+        of_type.fill(0);
+        for (int t = 1; t != int(of_type.size()) && s && *s; ++t) {
+            char* end;
+            unsigned long c = strtoul(s, &end, 10);
+            if (end == s || c >= max_classes || (*end && *end != ','))
+                return false;
+            of_type[t] = uint32_t(c);
+            s = *end ? end + 1 : end;
+        }
+        enabled = true;
+        return true;
+    }
+
+    bool enabled;
+    std::array<uint32_t, 6> of_type; // indexed by tpcc_runner::txn_type
+    uint64_t deadline_ticks;
+};
+
+// CH-benCHmark queries run by the analytic threads (--analytic), by index
+// into ids
+struct ch_queries {
+    static constexpr int num_queries = 5;
+    static const int ids[num_queries];
+
+    ch_queries() {
+        enabled.fill(true);
+    }
+
+    static int index_of(int id) {
+        for (int i = 0; i != num_queries; ++i)
+            if (ids[i] == id)
+                return i;
+        return -1;
+    }
+
+    // Parses a comma-separated list of query numbers
+    bool parse(const char* s) {
+        enabled.fill(false);
+        bool any = false;
+        while (s && *s) {
+            char* end;
+            int i = index_of(int(strtol(s, &end, 10)));
+            if (end == s || i < 0 || (*end && *end != ','))
+                return false;
+            enabled[i] = any = true;
+            s = *end ? end + 1 : end;
+        }
+        return any;
+    }
+
+    std::array<bool, num_queries> enabled;
+};
+
+// One analytic thread's statistics for one query
+struct ch_query_stats {
+    latency_histogram lat; // completed queries, including retries
+    uint64_t aborts = 0;
+    uint64_t unfinished = 0; // still retrying when the run ended
+
+    void merge(const ch_query_stats& other) {
+        lat.merge(other.lat);
+        aborts += other.aborts;
+        unfinished += other.unfinished;
+    }
+};
 
 class tpcc_input_generator {
 public:
@@ -150,6 +238,12 @@ class tpcc_access;
 #define TPCC_HASH_INDEX 1
 #endif
 
+// CCPolicy access sites, one per table
+enum class tpcc_site : int {
+    warehouse = 0, district, customer, order, orderline, stock,
+    customer_index, order_customer_index, neworder, item, history
+};
+
 template <typename DBParams>
 class tpcc_db {
 public:
@@ -181,10 +275,34 @@ public:
     typedef UIndex<item_key, item_value>                 it_table_type;
     typedef OIndex<history_key, history_value>           ht_table_type;
 
+    // Warehouse and district YTDs under early lock release (2PL only); see
+    // enable_early_release()
+    typedef TRetireBox<int64_t> ytd_box;
+
     explicit inline tpcc_db(int num_whs);
     explicit inline tpcc_db(const std::string& db_file_name) = delete;
     inline ~tpcc_db();
     void thread_init_all();
+    void enable_adaptive_split();
+    void print_adaptive_split() const;
+
+    // Moves w_ytd and d_ytd out of their rows into TRetireBoxes, which
+    // payment retires right after its update, so the hot warehouse and
+    // district records are write-locked only briefly. Call before
+    // prepopulating; the rows' YTD columns then go unused.
+    void enable_early_release() {
+        wh_ytd_.reset(new ytd_box[num_whs_]);
+        dt_ytd_.reset(new ytd_box[num_whs_ * NUM_DISTRICTS_PER_WAREHOUSE]);
+    }
+    bool early_release() const {
+        return static_cast<bool>(wh_ytd_);
+    }
+    ytd_box& warehouse_ytd(uint64_t w_id) {
+        return wh_ytd_[w_id - 1];
+    }
+    ytd_box& district_ytd(uint64_t w_id, uint64_t d_id) {
+        return dt_ytd_[(w_id - 1) * NUM_DISTRICTS_PER_WAREHOUSE + (d_id - 1)];
+    }
 
     int num_warehouses() const {
         return static_cast<int>(num_whs_);
@@ -228,6 +346,15 @@ public:
     tpcc_delivery_queue& delivery_queue() {
         return dlvy_queue_;
     }
+    const numa_router& numa() const {
+        return numa_;
+    }
+    ch_dimensions& ch_dims() {
+        return ch_dims_;
+    }
+    void set_numa_mode(numa_mode mode) {
+        numa_ = numa_router(num_warehouses(), mode);
+    }
 
 private:
     size_t num_whs_;
@@ -247,6 +374,11 @@ private:
 
     tpcc_oid_generator oid_gen_;
     tpcc_delivery_queue dlvy_queue_;
+    numa_router numa_;
+    ch_dimensions ch_dims_;
+
+    std::unique_ptr<ytd_box[]> wh_ytd_;
+    std::unique_ptr<ytd_box[]> dt_ytd_;
 
     friend class tpcc_access<DBParams>;
 };
@@ -313,6 +445,71 @@ private:
     friend class tpcc_access<DBParams>;
 };
 
+// Runs CH-benCHmark analytic queries over all warehouses. Under MVCC each
+// query is one read-only snapshot transaction. Otherwise it runs as one
+// validated transaction per district, each consistent on its own: a single
+// OCC transaction would track every scanned row and outgrow the commit's
+// write-set index at large warehouse counts. Aborted attempts are retried
+// until the end of the run.
+template <typename DBParams>
+class ch_runner {
+public:
+    // o_entry_d and ol_delivery_d are drawn from [date_begin, date_end]
+    // (see tpcc_input_generator::gen_date)
+    static constexpr uint32_t date_begin = 1505244122;
+    static constexpr uint32_t date_end = 1599938522;
+    static constexpr uint32_t date_2020 = 1577836800;
+    static constexpr uint32_t month = 30 * 86400;
+
+    ch_runner(tpcc_db<DBParams>& database, uint64_t stop_tsc)
+        : db(database), stop_tsc(stop_tsc), aborts(0), gave_up(false), results() {}
+
+    // Runs query ch_queries::ids[qi]; returns false if the run ended first
+    inline bool run_query(int qi, uint64_t& num_aborts);
+
+    inline void run_q1();
+    inline void run_q5();
+    inline void run_q6();
+    inline void run_q12();
+    inline void run_q14();
+
+    // A one-number summary of query qi's last result
+    double result(int qi) const {
+        return results[qi];
+    }
+
+private:
+    // Queries run in chunks of districts, numbered (w_id - 1) * districts
+    // per warehouse + (d_id - 1); one chunk per district unless MVCC
+    static constexpr bool per_district = !DBParams::MVCC;
+
+    uint64_t num_chunks() const {
+        return per_district ? num_districts() : 1;
+    }
+    uint64_t chunk_begin(uint64_t c) const {
+        return per_district ? c : 0;
+    }
+    uint64_t chunk_end(uint64_t c) const {
+        return per_district ? c + 1 : num_districts();
+    }
+    uint64_t num_districts() const {
+        return uint64_t(db.num_warehouses()) * NUM_DISTRICTS_PER_WAREHOUSE;
+    }
+
+    // TEND condition: whether to retry an aborted attempt
+    bool keep_retrying() {
+        ++aborts;
+        gave_up = read_tsc() >= stop_tsc;
+        return !gave_up;
+    }
+
+    tpcc_db<DBParams>& db;
+    uint64_t stop_tsc;
+    uint64_t aborts;
+    bool gave_up;
+    std::array<double, ch_queries::num_queries> results;
+};
+
 template <typename DBParams>
 class tpcc_prepopulator {
 public:
@@ -323,6 +520,7 @@ public:
 
     inline void fill_items(uint64_t iid_begin, uint64_t iid_xend);
     inline void fill_warehouses();
+    inline void fill_ch_dimensions();
     inline void expand_warehouse(uint64_t wid);
     inline void expand_districts(uint64_t wid);
     inline void expand_customers(uint64_t wid);
@@ -349,7 +547,8 @@ template <typename DBParams>
 tpcc_db<DBParams>::tpcc_db(int num_whs)
     : num_whs_(num_whs),
       tbl_whs_(256),
-      oid_gen_() {
+      oid_gen_(),
+      numa_(num_whs) {
     //constexpr size_t num_districts = NUM_DISTRICTS_PER_WAREHOUSE;
     //constexpr size_t num_customers = NUM_CUSTOMERS_PER_DISTRICT * NUM_DISTRICTS_PER_WAREHOUSE;
 
@@ -365,6 +564,20 @@ tpcc_db<DBParams>::tpcc_db(int num_whs)
         tbl_nos_.emplace_back(999983/*num_customers * 10 * 2*/);
         tbl_hts_.emplace_back(999983/*num_customers * 2*/);
     }
+
+    tbl_its_->set_policy_site(static_cast<int>(tpcc_site::item));
+    tbl_whs_.set_policy_site(static_cast<int>(tpcc_site::warehouse));
+    for (int i = 0; i < num_whs; ++i) {
+        tbl_dts_[i].set_policy_site(static_cast<int>(tpcc_site::district));
+        tbl_cus_[i].set_policy_site(static_cast<int>(tpcc_site::customer));
+        tbl_ods_[i].set_policy_site(static_cast<int>(tpcc_site::order));
+        tbl_ols_[i].set_policy_site(static_cast<int>(tpcc_site::orderline));
+        tbl_sts_[i].set_policy_site(static_cast<int>(tpcc_site::stock));
+        tbl_cni_[i].set_policy_site(static_cast<int>(tpcc_site::customer_index));
+        tbl_oci_[i].set_policy_site(static_cast<int>(tpcc_site::order_customer_index));
+        tbl_nos_[i].set_policy_site(static_cast<int>(tpcc_site::neworder));
+        tbl_hts_[i].set_policy_site(static_cast<int>(tpcc_site::history));
+    }
 }
 
 template <typename DBParams>
@@ -396,7 +609,47 @@ void tpcc_db<DBParams>::thread_init_all() {
         t.thread_init();
 }
 
+template <typename DBParams>
+void tpcc_db<DBParams>::enable_adaptive_split() {
+    tbl_whs_.enable_adaptive_split();
+    for (int i = 0; i < num_warehouses(); ++i) {
+        tbl_dts_[i].enable_adaptive_split();
+        tbl_cus_[i].enable_adaptive_split();
+        tbl_ods_[i].enable_adaptive_split();
+        tbl_ols_[i].enable_adaptive_split();
+        tbl_sts_[i].enable_adaptive_split();
+    }
+}
+
+// Layouts reached by the tables of warehouse 1
+template <typename DBParams>
+void tpcc_db<DBParams>::print_adaptive_split() const {
+    if constexpr (!DBParams::MVCC) {
+        auto print = [] (const char* name, const auto* layout) {
+            if (layout)
+                std::cout << "Adaptive split: " << name << " " << layout->describe()
+                          << " after " << layout->migrations() << " migrations" << std::endl;
+        };
+        print("warehouse", tbl_whs_.adaptive_split());
+        print("district", tbl_dts_[0].adaptive_split());
+        print("customer", tbl_cus_[0].adaptive_split());
+        print("order", tbl_ods_[0].adaptive_split());
+        print("orderline", tbl_ols_[0].adaptive_split());
+        print("stock", tbl_sts_[0].adaptive_split());
+    }
+}
+
 // @section: db prepopulation functions
+template<typename DBParams>
+void tpcc_prepopulator<DBParams>::fill_ch_dimensions() {
+    std::vector<uint8_t> nations;
+    for (int n = 0; n != 128; ++n)
+        if (ch_dimensions::is_nation(n))
+            nations.push_back(uint8_t(n));
+    for (auto& su_nationkey : db.ch_dims().su_nationkey)
+        su_nationkey = nations[ig.random(0, nations.size() - 1)];
+}
+
 template<typename DBParams>
 void tpcc_prepopulator<DBParams>::fill_items(uint64_t iid_begin, uint64_t iid_xend) {
     for (auto iid = iid_begin; iid < iid_xend; ++iid) {
@@ -431,6 +684,8 @@ void tpcc_prepopulator<DBParams>::fill_warehouses() {
         wv.w_zip = random_zip_code();
         wv.w_tax = ig.random(0, 2000);
         wv.w_ytd = 30000000;
+        if (db.early_release())
+            db.warehouse_ytd(wid).nontrans_write(wv.w_ytd);
 
         db.tbl_warehouses().nontrans_put(wk, wv);
     }
@@ -438,6 +693,7 @@ void tpcc_prepopulator<DBParams>::fill_warehouses() {
 
 template<typename DBParams>
 void tpcc_prepopulator<DBParams>::expand_warehouse(uint64_t wid) {
+    string_arena::scope stock_strings(db.tbl_stocks(wid).strings());
     for (uint64_t iid = 1; iid <= NUM_ITEMS; ++iid) {
         stock_key sk(wid, iid);
         stock_value sv;
@@ -448,17 +704,17 @@ void tpcc_prepopulator<DBParams>::expand_warehouse(uint64_t wid) {
         sv.s_ytd = 0;
         sv.s_order_cnt = 0;
         sv.s_remote_cnt = 0;
-        sv.s_data = random_a_string(26, 50);
+        std::string s_data = random_a_string(26, 50);
         if (ig.random(1, 100) <= 10) {
-            auto pos = ig.random(0, sv.s_data.length() - 8);
-            auto placed = sv.s_data.place("ORIGINAL", pos);
-            assert(placed);
-            (void)placed;
+            auto pos = ig.random(0, s_data.length() - 8);
+            s_data.replace(pos, 8, "ORIGINAL");
         }
+        sv.s_data = s_data;
 
         db.tbl_stocks(wid).nontrans_put(sk, sv);
     }
 
+    string_arena::scope district_strings(db.tbl_districts(wid).strings());
     for (uint64_t did = 1; did <= NUM_DISTRICTS_PER_WAREHOUSE; ++did) {
         district_key dk(wid, did);
         district_value dv;
@@ -472,6 +728,8 @@ void tpcc_prepopulator<DBParams>::expand_warehouse(uint64_t wid) {
         dv.d_tax = ig.random(0, 2000);
         dv.d_ytd = 3000000;
         //dv.d_next_o_id = 3001;
+        if (db.early_release())
+            db.district_ytd(wid, did).nontrans_write(dv.d_ytd);
 
         db.tbl_districts(wid).nontrans_put(dk, dv);
     }
@@ -480,6 +738,7 @@ void tpcc_prepopulator<DBParams>::expand_warehouse(uint64_t wid) {
 template<typename DBParams>
 void tpcc_prepopulator<DBParams>::expand_districts(uint64_t wid) {
     std::unordered_map<customer_idx_key, std::list<uint64_t>> cids_map;
+    string_arena::scope customer_strings(db.tbl_customers(wid).strings());
 
     for (uint64_t did = 1; did <= NUM_DISTRICTS_PER_WAREHOUSE; ++did) {
         for (uint64_t cid = 1; cid <= NUM_CUSTOMERS_PER_DISTRICT; ++cid) {
@@ -494,6 +753,7 @@ void tpcc_prepopulator<DBParams>::expand_districts(uint64_t wid) {
             cv.c_street_1 = random_a_string(10, 20);
             cv.c_street_2 = random_a_string(10, 20);
             cv.c_city = random_a_string(10, 20);
+            cv.c_state = random_state_name();
             cv.c_zip = random_zip_code();
             cv.c_phone = random_n_string(16, 16);
             cv.c_since = ig.gen_date();
@@ -542,6 +802,7 @@ void tpcc_prepopulator<DBParams>::expand_customers(uint64_t wid) {
         }
     }
 
+    string_arena::scope orderline_strings(db.tbl_orderlines(wid).strings());
     for (uint64_t did = 1; did <= NUM_DISTRICTS_PER_WAREHOUSE; ++did) {
         std::vector<uint64_t> cid_perm;
         for (uint64_t n = 1; n <= NUM_CUSTOMERS_PER_DISTRICT; ++n)
@@ -594,12 +855,13 @@ void tpcc_prepopulator<DBParams>::run() {
     int r;
 
     always_assert(worker_id >= 1, "prepopulator worker id range error");
-    // set affinity so that the warehouse is filled at the corresponding numa node
-    set_affinity(worker_id - 1);
+    // pin to the warehouse's numa node so that it is filled there
+    db.numa().bind_loader(worker_id);
 
     if (worker_id == 1) {
         fill_items(1, 100001);
         fill_warehouses();
+        fill_ch_dimensions();
     }
 
     // barrier
@@ -619,6 +881,7 @@ void tpcc_prepopulator<DBParams>::run() {
     always_assert(r == PTHREAD_BARRIER_SERIAL_THREAD || r == 0, "pthread_barrier_wait");
 
     expand_customers((uint64_t) worker_id);
+    db.numa().unbind_loader();
 }
 
 // @section: prepopulation string generators
@@ -695,18 +958,35 @@ public:
         always_assert(r == 0, "pthread_barrier_destroy failed");
     }
 
-    static void tpcc_runner_thread(tpcc_db<DBParams>& db, db_profiler& prof, int runner_id, uint64_t w_start,
-                                   uint64_t w_end, uint64_t w_own, double time_limit, int mix, uint64_t& txn_cnt) {
-        tpcc_runner<DBParams> runner(runner_id, db, w_start, w_end, w_own, mix);
+    typedef std::array<latency_histogram, tpcc_priorities::max_classes> class_latencies;
+
+    static void tpcc_runner_thread(tpcc_db<DBParams>& db, db_profiler& prof, int runner_id,
+                                   numa_router::route route, double time_limit, int mix,
+                                   const tpcc_priorities& prio, uint64_t& txn_cnt, class_latencies& lat) {
+        uint64_t w_start = route.part_begin, w_end = route.part_end;
+        tpcc_runner<DBParams> runner(runner_id, db, w_start, w_end, route.owned, mix);
         typedef typename tpcc_runner<DBParams>::txn_type txn_type;
 
+        // Runs one transaction at its type's priority class, recording its
+        // latency including retries
+        auto timed = [&] (txn_type t, auto&& body) {
+            uint32_t cls = prio.of_type[static_cast<int>(t)];
+            auto t0 = read_tsc();
+            uint64_t deadline = (cls && prio.deadline_ticks) ? t0 + prio.deadline_ticks : 0;
+            if (prio.enabled)
+                Sto::set_priority(cls, deadline);
+            body();
+            auto t1 = read_tsc();
+            lat[cls].record(t1 - t0, deadline && t1 > deadline);
+        };
+
         uint64_t local_cnt = 0;
 
         std::array<uint64_t, NUM_DISTRICTS_PER_WAREHOUSE> last_delivered;
         std::fill(last_delivered.begin(), last_delivered.end(), 0);
 
         ::TThread::set_id(runner_id);
-        set_affinity(runner_id);
+        numa_router::bind(runner_id, route);
         db.thread_init_all();
 
         uint64_t tsc_diff = (uint64_t)(time_limit * constants::processor_tsc_frequency * constants::billion);
@@ -721,8 +1001,11 @@ public:
                 bool stop = false;
 
                 if (num_to_run > 0) {
+                    CCPolicy::begin(static_cast<int>(txn_type::delivery));
                     for (num_run = 0; num_run < num_to_run; ++num_run) {
-                        runner.run_txn_delivery(own_w_id, last_delivered);
+                        timed(txn_type::delivery, [&] {
+                            runner.run_txn_delivery(own_w_id, last_delivered);
+                        });
                         if ((read_tsc() - start_t) >= tsc_diff) {
                             stop = true;
                             ++num_run;
@@ -742,15 +1025,16 @@ public:
                 break;
 
             txn_type t = runner.next_transaction();
+            CCPolicy::begin(static_cast<int>(t));
             switch (t) {
                 case txn_type::new_order:
-                    runner.run_txn_neworder();
+                    timed(t, [&] { runner.run_txn_neworder(); });
                     break;
                 case txn_type::payment:
-                    runner.run_txn_payment();
+                    timed(t, [&] { runner.run_txn_payment(); });
                     break;
                 case txn_type::order_status:
-                    runner.run_txn_orderstatus();
+                    timed(t, [&] { runner.run_txn_orderstatus(); });
                     break;
                 case txn_type::delivery: {
                     uint64_t q_w_id = runner.ig.random(w_start, w_end);
@@ -763,7 +1047,7 @@ public:
                     break;
                 }
                 case txn_type::stock_level:
-                    runner.run_txn_stocklevel();
+                    timed(t, [&] { runner.run_txn_stocklevel(); });
                     break;
                 default:
                     fprintf(stderr, "r:%d unknown txn type\n", runner_id);
@@ -777,54 +1061,65 @@ public:
         txn_cnt = local_cnt;
     }
 
-    static uint64_t run_benchmark(tpcc_db<DBParams>& db, db_profiler& prof, int num_runners,
-                                  double time_limit, int mix, const bool verbose) {
-        int q = db.num_warehouses() / num_runners;
-        int r = db.num_warehouses() % num_runners;
+    typedef std::array<ch_query_stats, ch_queries::num_queries> ch_stats;
 
-        std::vector<std::thread> runner_thrs;
-        std::vector<uint64_t> txn_cnts(size_t(num_runners), 0);
-
-        int nwh = db.num_warehouses();
-        auto calc_own_w_id = [nwh](int rid) {
-            return (rid >= nwh) ? 0 : (rid + 1);
-        };
+    // Cycles through the enabled CH queries until the end of the run,
+    // starting at a different one in each thread
+    static void ch_runner_thread(tpcc_db<DBParams>& db, db_profiler& prof, int thread_id,
+                                 int analytic_id, double time_limit, const ch_queries& queries,
+                                 ch_stats& stats, const bool verbose) {
+        ::TThread::set_id(thread_id);
+        db.thread_init_all();
 
-        if (q == 0) {
-            q = (num_runners + db.num_warehouses() - 1) / db.num_warehouses();
-            int qq = q;
-            int wid = 1;
-            for (int i = 0; i < num_runners; ++i) {
-                if ((qq--) == 0) {
-                    ++wid;
-                    qq += q;
-                }
-                if (verbose) {
-                    fprintf(stdout, "runner %d: [%d, %d], own: %d\n", i, wid, wid, calc_own_w_id(i));
-                }
-                runner_thrs.emplace_back(tpcc_runner_thread, std::ref(db), std::ref(prof),
-                                         i, wid, wid, calc_own_w_id(i), time_limit, mix, std::ref(txn_cnts[i]));
+        uint64_t tsc_diff = (uint64_t)(time_limit * constants::processor_tsc_frequency * constants::billion);
+        ch_runner<DBParams> runner(db, prof.start_timestamp() + tsc_diff);
+
+        for (int n = analytic_id; ; ++n) {
+            int qi = n % ch_queries::num_queries;
+            if (!queries.enabled[qi])
+                continue;
+            auto t0 = read_tsc();
+            if (!runner.run_query(qi, stats[qi].aborts)) {
+                ++stats[qi].unfinished;
+                break;
             }
-        } else {
-            int last_xend = 1;
+            auto t1 = read_tsc();
+            stats[qi].lat.record(t1 - t0);
+            if (verbose)
+                fprintf(stdout, "analytic %d: Q%d = %g in %g ms\n", analytic_id, ch_queries::ids[qi],
+                        runner.result(qi), db_profiler::ticks_to_secs(t1 - t0) * 1000);
+            if (t1 - prof.start_timestamp() >= tsc_diff)
+                break;
+        }
+    }
 
-            for (int i = 0; i < num_runners; ++i) {
-                int next_xend = last_xend + q;
-                if (r > 0) {
-                    ++next_xend;
-                    --r;
-                }
-                if (verbose) {
-                    fprintf(stdout, "runner %d: [%d, %d], own: %d\n", i, last_xend, next_xend - 1, calc_own_w_id(i));
-                }
-                runner_thrs.emplace_back(tpcc_runner_thread, std::ref(db), std::ref(prof),
-                                         i, last_xend, next_xend - 1, calc_own_w_id(i), time_limit, mix,
-                                         std::ref(txn_cnts[i]));
-                last_xend = next_xend;
+    static uint64_t run_benchmark(tpcc_db<DBParams>& db, db_profiler& prof, int num_runners,
+                                  double time_limit, int mix, const tpcc_priorities& prio,
+                                  class_latencies& lat, int num_analytic, const ch_queries& queries,
+                                  ch_stats& ch, const bool verbose) {
+        std::vector<std::thread> runner_thrs;
+        std::vector<uint64_t> txn_cnts(size_t(num_runners), 0);
+        std::vector<class_latencies> lats(static_cast<size_t>(num_runners));
+        std::vector<ch_stats> ch_thread_stats(static_cast<size_t>(num_analytic));
+
+        auto routes = db.numa().routes(num_runners);
+        always_assert(routes.size() == size_t(num_runners), "warehouse distribution error");
+        for (int i = 0; i < num_runners; ++i) {
+            auto& rt = routes[i];
+            if (verbose) {
+                fprintf(stdout, "runner %d: [%d, %d], own: %d", i, rt.part_begin, rt.part_end, rt.owned);
+                if (rt.cpu >= 0)
+                    fprintf(stdout, ", cpu: %d, node: %d", rt.cpu, db.numa().partition_node(rt.part_begin));
+                fprintf(stdout, "\n");
             }
-
-            always_assert(last_xend == db.num_warehouses() + 1, "warehouse distribution error");
+            runner_thrs.emplace_back(tpcc_runner_thread, std::ref(db), std::ref(prof), i, rt,
+                                     time_limit, mix, std::cref(prio), std::ref(txn_cnts[i]),
+                                     std::ref(lats[i]));
         }
+        // analytic threads take the thread ids after the runners'
+        for (int i = 0; i < num_analytic; ++i)
+            runner_thrs.emplace_back(ch_runner_thread, std::ref(db), std::ref(prof), num_runners + i, i,
+                                     time_limit, std::cref(queries), std::ref(ch_thread_stats[i]), verbose);
 
         for (auto &t : runner_thrs)
             t.join();
@@ -832,6 +1127,12 @@ public:
         uint64_t total_txn_cnt = 0;
         for (auto& cnt : txn_cnts)
             total_txn_cnt += cnt;
+        for (auto& l : lats)
+            for (int c = 0; c != tpcc_priorities::max_classes; ++c)
+                lat[c].merge(l[c]);
+        for (auto& st : ch_thread_stats)
+            for (int q = 0; q != ch_queries::num_queries; ++q)
+                ch[q].merge(st[q]);
         return total_txn_cnt;
     }
 
@@ -849,6 +1150,14 @@ public:
         bool enable_gc = false;
         unsigned gc_rate = Transaction::get_epoch_cycle();
         bool verbose = false;
+        tpcc_priorities prio;
+        double deadline_ms = 0;
+        bool adaptive_split = false;
+        bool early_release = false;
+        bool cc_policy = false;
+        numa_mode numa = numa_mode::legacy;
+        int num_analytic = 0;
+        ch_queries queries;
 
         Clp_Parser *clp = Clp_NewParser(argc, argv, noptions, options);
 
@@ -883,6 +1192,8 @@ public:
                     break;
                 case opt_comm:
                     break;
+                case opt_rbias:
+                    break;
                 case opt_verb:
                     verbose = !clp->negated;
                     break;
@@ -892,6 +1203,80 @@ public:
                         mix = 0;
                     }
                     break;
+                case opt_ccpol:
+                    if (!CCPolicy::load(clp->val.s)) {
+                        std::cerr << "Could not load concurrency control policy "
+                                  << clp->val.s << std::endl;
+                        ret = 1;
+                        clp_stop = true;
+                    }
+                    cc_policy = true;
+                    break;
+                case opt_fback:
+                    ContentionManager::fallback_aborts = clp->val.u;
+                    break;
+                case opt_early:
+                    early_release = !clp->negated;
+                    break;
+                case opt_lpol:
+                    ContentionManager::lock_policy = parse_lock_policy(clp->val.s);
+                    if (static_cast<int>(ContentionManager::lock_policy) < 0) {
+                        std::cerr << "Unsupported lock policy " << clp->val.s << std::endl;
+                        ret = 1;
+                        clp_stop = true;
+                    }
+                    break;
+                case opt_serial:
+                    ContentionManager::serial_aborts = clp->val.u;
+                    break;
+                case opt_valid:
+                    Transaction::validate_every = clp->val.u;
+                    break;
+                case opt_prio:
+                    if (!prio.parse(clp->have_val ? clp->val.s : "1,1,1,0,1")) {
+                        std::cerr << "Bad priority classes " << clp->val.s << std::endl;
+                        ret = 1;
+                        clp_stop = true;
+                    }
+                    break;
+                case opt_dline:
+                    deadline_ms = clp->val.d;
+                    break;
+                case opt_rtsb:
+                    TicTocTid::extend_batch = clp->val.u;
+                    break;
+                case opt_asplit:
+                    adaptive_split = !clp->negated;
+                    break;
+                case opt_huge: {
+                    HugeArena::mode m;
+                    if (!HugeArena::parse(clp->val.s, m) || !HugeArena::configure(m)) {
+                        std::cerr << "Bad huge page mode " << clp->val.s << std::endl;
+                        ret = 1;
+                        clp_stop = true;
+                    }
+                    break;
+                }
+                case opt_numa:
+                    if (!parse_numa_mode(clp->val.s, numa)) {
+                        std::cerr << "Unknown NUMA placement " << clp->val.s << std::endl;
+                        ret = 1;
+                        clp_stop = true;
+                    }
+                    break;
+                case opt_chthr:
+                    num_analytic = clp->val.i;
+                    break;
+                case opt_cold:
+                    MvCompressor::configure(clp->val.u);
+                    break;
+                case opt_chq:
+                    if (!queries.parse(clp->val.s)) {
+                        std::cerr << "Bad CH query list " << clp->val.s << std::endl;
+                        ret = 1;
+                        clp_stop = true;
+                    }
+                    break;
                 default:
                     ::print_usage(argv[0]);
                     ret = 1;
@@ -903,8 +1288,31 @@ public:
         Clp_DeleteParser(clp);
         if (ret != 0)
             return ret;
+        if (cc_policy && DBParams::TicToc) {
+            std::cerr << "--cc-policy does not apply to TicToc" << std::endl;
+            return 1;
+        }
+        if (ContentionManager::fallback_aborts && DBParams::TicToc) {
+            std::cerr << "--fallback does not apply to TicToc" << std::endl;
+            return 1;
+        }
+        if (early_release && !DBParams::TwoPhaseLock && !DBParams::Adaptive) {
+            std::cerr << "--early-release needs the 2pl or adaptive dbid" << std::endl;
+            return 1;
+        }
+        if (num_analytic < 0 || num_threads + num_analytic > MAX_THREADS) {
+            std::cerr << "At most " << MAX_THREADS << " runner and analytic threads" << std::endl;
+            return 1;
+        }
 
         std::cout << "Selected workload mix: " << std::string(workload_mix_names[mix]) << std::endl;
+        if (num_analytic) {
+            std::cout << "CH-benCHmark: " << num_analytic << " analytic threads running queries";
+            for (int q = 0; q != ch_queries::num_queries; ++q)
+                if (queries.enabled[q])
+                    std::cout << " Q" << ch_queries::ids[q];
+            std::cout << std::endl;
+        }
 
         auto profiler_mode = counter_mode ?
                              Profiler::perf_mode::counters : Profiler::perf_mode::record;
@@ -921,6 +1329,14 @@ public:
 
         db_profiler prof(spawn_perf);
         tpcc_db<DBParams> db(num_warehouses);
+        db.set_numa_mode(numa);
+        std::cout << "NUMA placement: " << numa_mode_name(numa) << std::endl;
+        if (adaptive_split)
+            db.enable_adaptive_split();
+        if (early_release) {
+            db.enable_early_release();
+            std::cout << "Early lock release: warehouse and district YTD" << std::endl;
+        }
 
         std::cout << "Prepopulating database..." << std::endl;
         prepopulate_db(db);
@@ -938,8 +1354,37 @@ public:
         std::cout << std::endl << std::flush;
 
         prof.start(profiler_mode);
-        auto num_trans = run_benchmark(db, prof, num_threads, time_limit, mix, verbose);
-        prof.finish(num_trans);
+        prio.deadline_ticks = db_profiler::secs_to_ticks(deadline_ms / 1000.0);
+        class_latencies lat;
+        ch_stats ch;
+        auto num_trans = run_benchmark(db, prof, num_threads, time_limit, mix, prio, lat,
+                                       num_analytic, queries, ch, verbose);
+        double elapsed_ms = prof.finish(num_trans);
+        if (num_analytic) {
+            uint64_t num_queries = 0;
+            for (int q = 0; q != ch_queries::num_queries; ++q) {
+                if (!queries.enabled[q])
+                    continue;
+                std::string name = "CH Q" + std::to_string(ch_queries::ids[q]);
+                ch[q].lat.print(name);
+                std::cout << name << ": " << ch[q].aborts << " aborted attempts, "
+                          << ch[q].unfinished << " unfinished" << std::endl;
+                num_queries += ch[q].lat.count();
+            }
+            std::cout << "CH-benCHmark: " << num_analytic << " analytic threads, "
+                      << (double) num_queries / (elapsed_ms / 1000.0) << " queries/sec, "
+                      << (double) num_trans / (elapsed_ms / 1000.0) << " OLTP txns/sec" << std::endl;
+        }
+        HugeArena::print_stats(std::cout);
+        if (MvCompressor::enabled())
+            MvCompressor::print_stats(std::cout);
+        if (adaptive_split)
+            db.print_adaptive_split();
+        if (prio.enabled) {
+            for (int c = tpcc_priorities::max_classes - 1; c >= 0; --c)
+                if (lat[c].count())
+                    lat[c].print("Latency (priority " + std::to_string(c) + ")");
+        }
 
         size_t remaining_deliveries = 0;
         for (int wh = 1; wh <= db.num_warehouses(); wh++) {
@@ -947,7 +1392,7 @@ public:
         }
         std::cout << "Remaining unresolved deliveries: " << remaining_deliveries << std::endl;
 
-        Transaction::rcu_release_all(advancer, num_threads);
+        Transaction::rcu_release_all(advancer, num_threads + num_analytic);
 
         return 0;
     }
@@ -32,6 +32,7 @@ using stock_value_frequpd = tpcc::stock_value_frequpd;
 using stock_value_infreq = tpcc::stock_value_infreq;
 
 using tpcc::c_data_info;
+using bench::string_arena;
 
 template <>
 class Commutator<warehouse_value> {
@@ -44,6 +45,11 @@ public:
         w.w_ytd += (uint64_t)delta_ytd;
     }
 
+    // Escrow bound: a negative payment cannot take w_ytd below zero
+    bool escrow_check(const warehouse_value &w) const {
+        return delta_ytd >= 0 || w.w_ytd >= (uint64_t)-delta_ytd;
+    }
+
 private:
     int64_t delta_ytd;
     friend Commutator<warehouse_value_frequpd>;
@@ -85,6 +91,11 @@ public:
         d.d_ytd += delta_ytd;
     }
 
+    // Escrow bound: a negative payment cannot take d_ytd below zero
+    bool escrow_check(const district_value &d) const {
+        return delta_ytd >= 0 || d.d_ytd + delta_ytd >= 0;
+    }
+
 private:
     int64_t delta_ytd;
     friend Commutator<district_value_frequpd>;
@@ -128,16 +139,21 @@ public:
 
     explicit Commutator(int64_t delta_balance, int64_t delta_ytd_payment)
             : delta_balance(delta_balance), delta_ytd_payment(delta_ytd_payment),
-              op(OpType::Payment), bad_credit(false), delta_data() {}
+              op(OpType::Payment), bad_credit(false), delta_data(), strings() {}
 
+    // `strings` is the customer table's arena, which holds c_data. MVCC
+    // tables apply the delta whenever a version is flattened, perhaps in a
+    // reader, so their (versioned) arenas don't track the replacement.
     explicit Commutator(int64_t delta_balance, int64_t delta_ytd_payment,
-            uint64_t c, uint64_t cd, uint64_t cw, uint64_t d, uint64_t w, int64_t hm)
+            uint64_t c, uint64_t cd, uint64_t cw, uint64_t d, uint64_t w, int64_t hm,
+            string_arena& strings)
         : delta_balance(delta_balance), delta_ytd_payment(delta_ytd_payment),
-          op(OpType::Payment), bad_credit(true), delta_data(c, cd, cw, d, w, hm) {}
+          op(OpType::Payment), bad_credit(true), delta_data(c, cd, cw, d, w, hm),
+          strings(&strings) {}
 
     explicit Commutator(int64_t delta_balance)
         : delta_balance(delta_balance), delta_ytd_payment(),
-          op(OpType::Delivery), bad_credit(), delta_data() {}
+          op(OpType::Delivery), bad_credit(), delta_data(), strings() {}
 
     void operate(customer_value &c) const {
         if (op == OpType::Payment) {
@@ -145,7 +161,7 @@ public:
             c.c_payment_cnt += 1;
             c.c_ytd_payment += delta_ytd_payment;
             if (bad_credit) {
-                c.c_data.insert_left(delta_data.buf(), c_data_info::len);
+                c.c_data.insert_left(delta_data.buf(), c_data_info::len, *strings, !strings->versioned());
             }
         } else if (op == OpType::Delivery) {
             c.c_balance += delta_balance;
@@ -159,6 +175,7 @@ private:
     OpType      op;
     bool        bad_credit;
     c_data_info delta_data;
+    string_arena* strings;
 
     friend Commutator<customer_value_infreq>;
     friend Commutator<customer_value_frequpd>;
@@ -190,7 +207,7 @@ public:
             c.c_payment_cnt += 1;
             c.c_ytd_payment += delta_ytd_payment;
             if (bad_credit) {
-                c.c_data.insert_left(delta_data.buf(), c_data_info::len);
+                c.c_data.insert_left(delta_data.buf(), c_data_info::len, *strings, !strings->versioned());
             }
         } else if (op == OpType::Delivery) {
             c.c_balance += delta_balance;
@@ -284,19 +301,30 @@ class Commutator<stock_value> {
 public:
     Commutator() = default;
 
+    // Stock never drops below this many units: orders that would take it
+    // lower restock by 91 first (TPC-C 2.4.2.2)
+    static constexpr int32_t min_quantity = 10;
+
     explicit Commutator(int32_t qty, bool remote) : update_qty(qty), is_remote(remote) {}
     void operate(stock_value& sv) const {
-        if ((sv.s_quantity - 10) >= update_qty)
-            sv.s_quantity -= update_qty;
-        else
-            sv.s_quantity += (91 - update_qty);
+        sv.s_quantity = next_quantity(sv.s_quantity);
         sv.s_ytd += update_qty;
         sv.s_order_cnt += 1;
         if (is_remote)
             sv.s_remote_cnt += 1;
     }
 
+    // No escrow bound: the restock rule keeps s_quantity at min_quantity or
+    // above for every order, so a check against the locked row never fails.
+
 private:
+    int32_t next_quantity(int32_t quantity) const {
+        if ((quantity - min_quantity) >= update_qty)
+            return quantity - update_qty;
+        else
+            return quantity + (91 - update_qty);
+    }
+
     int32_t update_qty;
     bool is_remote;
 
@@ -324,10 +352,7 @@ public:
     Commutator(Args&&... args) : Commutator<stock_value>(std::forward<Args>(args)...) {}
 
     void operate(stock_value_frequpd &sv) const {
-        if ((sv.s_quantity - 10) >= update_qty)
-            sv.s_quantity -= update_qty;
-        else
-            sv.s_quantity += (91 - update_qty);
+        sv.s_quantity = next_quantity(sv.s_quantity);
         sv.s_ytd += update_qty;
         sv.s_order_cnt += 1;
         if (is_remote)
@@ -7,10 +7,12 @@
 namespace ver_sel {
 
 template <typename VersImpl>
-class VerSel<tpcc::warehouse_value, VersImpl> : public VerSelBase<VerSel<tpcc::warehouse_value, VersImpl>, VersImpl> {
+class VerSel<tpcc::warehouse_value, VersImpl> : public VerSelBase<VerSel<tpcc::warehouse_value, VersImpl>, VersImpl>,
+        version_lead_pad<tpcc::warehouse_value, VersImpl, 2> {
 public:
     typedef VersImpl version_type;
     static constexpr size_t num_versions = 2;
+    static constexpr size_t container_align = cell_layout::line_size;
 
     explicit VerSel(type v) : vers_() {
         new (&vers_[0]) version_type(v);
@@ -57,10 +59,12 @@ private:
 };
 
 template <typename VersImpl>
-class VerSel<tpcc::district_value, VersImpl> : public VerSelBase<VerSel<tpcc::district_value, VersImpl>, VersImpl> {
+class VerSel<tpcc::district_value, VersImpl> : public VerSelBase<VerSel<tpcc::district_value, VersImpl>, VersImpl>,
+        version_lead_pad<tpcc::district_value, VersImpl, 2> {
 public:
     typedef VersImpl version_type;
     static constexpr size_t num_versions = 2;
+    static constexpr size_t container_align = cell_layout::line_size;
 
     explicit VerSel(type v) : vers_() {
         new (&vers_[0]) version_type(v);
@@ -107,10 +111,12 @@ private:
 };
 
 template <typename VersImpl>
-class VerSel<tpcc::customer_value, VersImpl> : public VerSelBase<VerSel<tpcc::customer_value, VersImpl>, VersImpl> {
+class VerSel<tpcc::customer_value, VersImpl> : public VerSelBase<VerSel<tpcc::customer_value, VersImpl>, VersImpl>,
+        version_lead_pad<tpcc::customer_value, VersImpl, 2> {
 public:
     typedef VersImpl version_type;
     static constexpr size_t num_versions = 2;
+    static constexpr size_t container_align = cell_layout::line_size;
 
     explicit VerSel(type v) : vers_() {
         new (&vers_[0]) version_type(v);
@@ -251,10 +257,12 @@ private:
 };
 
 template <typename VersImpl>
-class VerSel<tpcc::stock_value, VersImpl> : public VerSelBase<VerSel<tpcc::stock_value, VersImpl>, VersImpl> {
+class VerSel<tpcc::stock_value, VersImpl> : public VerSelBase<VerSel<tpcc::stock_value, VersImpl>, VersImpl>,
+        version_lead_pad<tpcc::stock_value, VersImpl, 2> {
 public:
     typedef VersImpl version_type;
     static constexpr size_t num_versions = 2;
+    static constexpr size_t container_align = cell_layout::line_size;
 
     explicit VerSel(type v) : vers_() { (void)v; }
     VerSel(type v, bool insert) : vers_() { (void)v; (void)insert; }
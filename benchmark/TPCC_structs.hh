@@ -2,9 +2,14 @@
 
 #include <string>
 #include <list>
+#include <array>
 #include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
 
 #include "DB_structs.hh"
+#include "VersionSelector.hh"
 #include "xxhash.h"
 #include "str.hh" // lcdf::Str
 
@@ -125,6 +130,15 @@ struct warehouse_value {
                                    w_tax,
                                    w_ytd };
 
+    // Hot cells first, next to the versions; see ver_sel::cell_layout
+    static constexpr size_t version_lead = ver_sel::cell_layout::default_version_lead;
+    struct hot_cells {
+        uint64_t   w_ytd;
+        char       end_;
+    };
+
+    uint64_t       w_ytd; // in 1/100
+    char           cold_pad_[ver_sel::cell_layout::cold_pad(version_lead, offsetof(hot_cells, end_))];
     var_string<10> w_name;
     var_string<20> w_street_1;
     var_string<20> w_street_2;
@@ -132,7 +146,6 @@ struct warehouse_value {
     fix_string<2>  w_state;
     fix_string<9>  w_zip;
     int64_t        w_tax; // in 1/10000
-    uint64_t       w_ytd; // in 1/100
 };
 
 // DISTRICT
@@ -159,9 +172,9 @@ struct district_key {
 
 struct district_value_infreq {
     var_string<10> d_name;
-    var_string<20> d_street_1;
-    var_string<20> d_street_2;
-    var_string<20> d_city;
+    compact_string<20> d_street_1;
+    compact_string<20> d_street_2;
+    compact_string<20> d_city;
     fix_string<2>  d_state;
     fix_string<9>  d_zip;
     int64_t        d_tax;
@@ -183,14 +196,22 @@ struct district_value {
                                    d_tax,
                                    d_ytd };
 
+    // Hot cells first, next to the versions; see ver_sel::cell_layout
+    static constexpr size_t version_lead = ver_sel::cell_layout::default_version_lead;
+    struct hot_cells {
+        int64_t    d_ytd;
+        char       end_;
+    };
+
+    int64_t        d_ytd;
+    char           cold_pad_[ver_sel::cell_layout::cold_pad(version_lead, offsetof(hot_cells, end_))];
     var_string<10> d_name;
-    var_string<20> d_street_1;
-    var_string<20> d_street_2;
-    var_string<20> d_city;
+    compact_string<20> d_street_1;
+    compact_string<20> d_street_2;
+    compact_string<20> d_city;
     fix_string<2>  d_state;
     fix_string<9>  d_zip;
     int64_t        d_tax;
-    int64_t        d_ytd;
     // we use the separate oid generator for better semantics in transactions
     //uint64_t       d_next_o_id;
 };
@@ -200,10 +221,11 @@ struct district_value {
 
 // customer name index hack <-- the true source of performance
 struct customer_idx_key {
-    customer_idx_key(uint64_t wid, uint64_t did, const var_string<16>& last) {
+    customer_idx_key(uint64_t wid, uint64_t did, const compact_string<16>& last) {
         c_w_id = bswap(wid);
         c_d_id = bswap(did);
-        memcpy(c_last, last.c_str(), sizeof(c_last));
+        memset(c_last, 0x00, sizeof(c_last));
+        memcpy(c_last, last.c_str(), last.length());
     }
 
     customer_idx_key(uint64_t wid, uint64_t did, const std::string& last) {
@@ -273,19 +295,31 @@ struct customer_key {
     uint64_t c_id;
 };
 
+// c_middle and c_credit take a handful of values; both customer row types
+// share one dictionary for them
+struct customer_value;
+typedef dict_string<2, uint8_t, customer_value> customer_dict_string;
+
+// c_credit of a customer with bad credit. Payment tests for it on every
+// call, so it is encoded once here and compared by code.
+inline const customer_dict_string& bad_credit() {
+    static const customer_dict_string bc("BC");
+    return bc;
+}
+
 // Split customer table
 struct customer_value_infreq {
-    var_string<16>  c_first;
-    fix_string<2>   c_middle;
-    var_string<16>  c_last;
-    var_string<20>  c_street_1;
-    var_string<20>  c_street_2;
-    var_string<20>  c_city;
+    compact_string<16> c_first;
+    customer_dict_string c_middle;
+    compact_string<16> c_last;
+    compact_string<20> c_street_1;
+    compact_string<20> c_street_2;
+    compact_string<20> c_city;
     fix_string<2>   c_state;
     fix_string<9>   c_zip;
     fix_string<16>  c_phone;
     uint32_t        c_since;
-    fix_string<2>   c_credit;
+    customer_dict_string c_credit;
     int64_t         c_credit_lim;
     int64_t         c_discount;
 };
@@ -295,7 +329,7 @@ struct customer_value_frequpd {
     int64_t         c_ytd_payment;
     uint16_t        c_payment_cnt;
     uint16_t        c_delivery_cnt;
-    fix_string<500> c_data;
+    compact_string<500> c_data;
 };
 
 // Unsplit customer table
@@ -319,24 +353,36 @@ struct customer_value {
                                    c_delivery_cnt,
                                    c_data };
 
-    var_string<16>  c_first;
-    fix_string<2>   c_middle;
-    var_string<16>  c_last;
-    var_string<20>  c_street_1;
-    var_string<20>  c_street_2;
-    var_string<20>  c_city;
+    // Hot cells first, next to the versions; see ver_sel::cell_layout
+    static constexpr size_t version_lead = ver_sel::cell_layout::default_version_lead;
+    struct hot_cells {
+        int64_t         c_balance;
+        int64_t         c_ytd_payment;
+        uint16_t        c_payment_cnt;
+        uint16_t        c_delivery_cnt;
+        compact_string<500> c_data;
+        char            end_;
+    };
+
+    int64_t         c_balance;
+    int64_t         c_ytd_payment;
+    uint16_t        c_payment_cnt;
+    uint16_t        c_delivery_cnt;
+    compact_string<500> c_data;
+    char            cold_pad_[ver_sel::cell_layout::cold_pad(version_lead, offsetof(hot_cells, end_))];
+    compact_string<16> c_first;
+    customer_dict_string c_middle;
+    compact_string<16> c_last;
+    compact_string<20> c_street_1;
+    compact_string<20> c_street_2;
+    compact_string<20> c_city;
     fix_string<2>   c_state;
     fix_string<9>   c_zip;
     fix_string<16>  c_phone;
     uint32_t        c_since;
-    fix_string<2>   c_credit;
+    customer_dict_string c_credit;
     int64_t         c_credit_lim;
     int64_t         c_discount;
-    int64_t         c_balance;
-    int64_t         c_ytd_payment;
-    uint16_t        c_payment_cnt;
-    uint16_t        c_delivery_cnt;
-    fix_string<500> c_data;
 };
 
 struct c_data_info {
@@ -539,7 +585,7 @@ struct orderline_value_infreq {
     uint64_t       ol_supply_w_id;
     uint32_t       ol_quantity;
     int32_t        ol_amount;
-    fix_string<24> ol_dist_info;
+    compact_string<24> ol_dist_info;
 };
 
 struct orderline_value_frequpd {
@@ -558,7 +604,7 @@ struct orderline_value {
     uint64_t       ol_supply_w_id;
     uint32_t       ol_quantity;
     int32_t        ol_amount;
-    fix_string<24> ol_dist_info;
+    compact_string<24> ol_dist_info;
     uint32_t       ol_delivery_d;
 };
 
@@ -625,8 +671,8 @@ struct stock_key {
 };
 
 struct stock_value_infreq {
-    std::array<fix_string<24>, NUM_DISTRICTS_PER_WAREHOUSE> s_dists;
-    var_string<50> s_data;
+    std::array<compact_string<24>, NUM_DISTRICTS_PER_WAREHOUSE> s_dists;
+    compact_string<50> s_data;
 };
 
 struct stock_value_frequpd {
@@ -644,12 +690,55 @@ struct stock_value {
                                    s_order_cnt,
                                    s_remote_cnt };
 
-    std::array<fix_string<24>, NUM_DISTRICTS_PER_WAREHOUSE> s_dists;
-    var_string<50> s_data;
+    // Hot cells first, next to the versions; see ver_sel::cell_layout
+    static constexpr size_t version_lead = ver_sel::cell_layout::default_version_lead;
+    struct hot_cells {
+        int32_t    s_quantity;
+        uint32_t   s_ytd;
+        uint32_t   s_order_cnt;
+        uint32_t   s_remote_cnt;
+        char       end_;
+    };
+
     int32_t        s_quantity;
     uint32_t       s_ytd;
     uint32_t       s_order_cnt;
     uint32_t       s_remote_cnt;
+    char           cold_pad_[ver_sel::cell_layout::cold_pad(version_lead, offsetof(hot_cells, end_))];
+    std::array<compact_string<24>, NUM_DISTRICTS_PER_WAREHOUSE> s_dists;
+    compact_string<50> s_data;
+};
+
+// CH-benCHmark SUPPLIER, NATION and REGION. They are never updated, so they
+// live outside the transactional tables.
+struct ch_dimensions {
+    static constexpr int num_suppliers = 10000;
+    static constexpr int num_regions = 5;
+    static const char* region_names[num_regions];
+
+    // NATION keys are the ASCII codes of digits and letters, matching
+    // customers by the first character of c_state; nation n is in region
+    // n % num_regions
+    static bool is_nation(int n) {
+        return n >= 0 && n < 128 && isalnum(n);
+    }
+    static int nation_region(int n) {
+        return n % num_regions;
+    }
+    static int region(const char* name) {
+        for (int r = 0; r != num_regions; ++r)
+            if (!strcmp(region_names[r], name))
+                return r;
+        return -1;
+    }
+
+    // The supplier of stock row (w, i)
+    static int supplier_of(uint64_t w, uint64_t i) {
+        return int((w * i) % num_suppliers);
+    }
+
+    // su_nationkey of each supplier
+    std::array<uint8_t, num_suppliers> su_nationkey;
 };
 
 }; // namespace tpcc
@@ -2,6 +2,8 @@
 
 #include "TPCC_bench.hh"
 #include <set>
+#include <tuple>
+#include <unordered_map>
 
 #ifndef TPCC_OBSERVE_C_BALANCE
 #define TPCC_OBSERVE_C_BALANCE 1
@@ -9,6 +11,30 @@
 
 namespace tpcc {
 
+// Repair fragment for payment's YTD updates: if the YTD cell changed under
+// us, recompute the new row's YTD from the row's current contents instead
+// of aborting. Allocated with Sto::tx_alloc so it lives until commit.
+template <typename Table, typename T, T Table::value_type::*Ytd>
+struct ytd_repair {
+    Table* table;
+    uintptr_t rid;
+    typename Table::value_type* new_row;
+    int64_t amount;
+
+    static bool run(void* arg) {
+        auto r = static_cast<ytd_repair*>(arg);
+        r->new_row->*Ytd = r->table->nontrans_row(r->rid).*Ytd + r->amount;
+        return true;
+    }
+
+    static void add(Table& table, uintptr_t rid, typename Table::NamedColumn col,
+                    typename Table::value_type* new_row, int64_t amount) {
+        auto r = Sto::tx_alloc<ytd_repair>();
+        *r = {&table, rid, new_row, amount};
+        table.add_repair(rid, col, &run, r);
+    }
+};
+
 template <typename DBParams>
 void tpcc_runner<DBParams>::run_txn_neworder() {
     typedef warehouse_value::NamedColumn wh_nc;
@@ -53,8 +79,8 @@ void tpcc_runner<DBParams>::run_txn_neworder() {
     }
 
     // holding outputs of the transaction
-    var_string<16> out_cus_last;
-    fix_string<2> out_cus_credit;
+    compact_string<16> out_cus_last;
+    customer_dict_string out_cus_credit;
     var_string<24> out_item_names[15];
     double out_total_amount = 0.0;
     char out_brand_generic[15];
@@ -214,7 +240,9 @@ void tpcc_runner<DBParams>::run_txn_neworder() {
         olv->ol_delivery_d = 0;
         olv->ol_quantity = qty;
         olv->ol_amount = ol_amount;
-        olv->ol_dist_info = s_dist;
+        // olv is raw scratch memory, so start from an empty string
+        olv->ol_dist_info = {};
+        olv->ol_dist_info.assign(s_dist.c_str(), s_dist.length(), db.tbl_orderlines(q_w_id).strings());
 
         std::tie(abort, result) = db.tbl_orderlines(q_w_id).insert_row(olk, olv, false);
         (void)result;
@@ -271,20 +299,24 @@ void tpcc_runner<DBParams>::run_txn_payment() {
 
     int64_t h_amount = ig.random(100, 500000);
     uint32_t h_date = ig.gen_date();
+    bool early_release = db.early_release();
+    // Stale YTD reads are repaired at commit rather than aborting; MVCC,
+    // TicToc and Swiss never take the OCC validation path that repairs.
+    constexpr bool repairable = !DBParams::MVCC && !DBParams::TicToc && !DBParams::Swiss;
 
     // holding outputs of the transaction
     var_string<10> out_w_name, out_d_name;
     var_string<20> out_w_street_1, out_w_street_2, out_w_city;
-    var_string<20> out_d_street_1, out_d_street_2, out_d_city;
+    compact_string<20> out_d_street_1, out_d_street_2, out_d_city;
     fix_string<2> out_w_state, out_d_state;
     fix_string<9> out_w_zip, out_d_zip;
-    var_string<16> out_c_first, out_c_last;
-    fix_string<2> out_c_middle;
-    var_string<20> out_c_street_1, out_c_street_2, out_c_city;
+    compact_string<16> out_c_first, out_c_last;
+    customer_dict_string out_c_middle;
+    compact_string<20> out_c_street_1, out_c_street_2, out_c_city;
     fix_string<2> out_c_state;
     fix_string<9> out_c_zip;
     fix_string<16> out_c_phone;
-    fix_string<2> out_c_credit;
+    customer_dict_string out_c_credit;
     uint32_t out_c_since;
     int64_t out_c_credit_lim;
     int64_t out_c_discount;
@@ -311,7 +343,7 @@ void tpcc_runner<DBParams>::run_txn_payment() {
          {wh_nc::w_city, access_t::read},
          {wh_nc::w_state, access_t::read},
          {wh_nc::w_zip, access_t::read},
-         {wh_nc::w_ytd, Commute ? access_t::write : access_t::update}}
+         {wh_nc::w_ytd, early_release ? access_t::none : Commute ? access_t::write : access_t::update}}
     );
     (void)result;
     CHK(success);
@@ -324,7 +356,11 @@ void tpcc_runner<DBParams>::run_txn_payment() {
     out_w_zip = value.w_zip();
 
     // update warehouse ytd
-    if constexpr (Commute) {
+    if (early_release) {
+        auto& ytd = db.warehouse_ytd(q_w_id);
+        CHK(ytd.write_nothrow(ytd.read() + h_amount));
+        ytd.retire();
+    } else if constexpr (Commute) {
         commutators::Commutator<warehouse_value> commutator(h_amount);
         db.tbl_warehouses().update_row(row, commutator);
     } else {
@@ -332,6 +368,11 @@ void tpcc_runner<DBParams>::run_txn_payment() {
         value.copy_into(new_wv);
         new_wv->w_ytd += h_amount;
         db.tbl_warehouses().update_row(row, new_wv);
+        if constexpr (repairable) {
+            ytd_repair<std::remove_reference_t<decltype(db.tbl_warehouses())>,
+                       decltype(warehouse_value::w_ytd), &warehouse_value::w_ytd>
+                ::add(db.tbl_warehouses(), row, wh_nc::w_ytd, new_wv, h_amount);
+        }
     }
     }
 
@@ -345,7 +386,7 @@ void tpcc_runner<DBParams>::run_txn_payment() {
          {dt_nc::d_city, access_t::read},
          {dt_nc::d_state, access_t::read},
          {dt_nc::d_zip, access_t::read},
-         {dt_nc::d_ytd, Commute ? access_t::write : access_t::update}}
+         {dt_nc::d_ytd, early_release ? access_t::none : Commute ? access_t::write : access_t::update}}
     );
     (void)result;
     CHK(success);
@@ -359,7 +400,11 @@ void tpcc_runner<DBParams>::run_txn_payment() {
 
     TXP_INCREMENT(txp_tpcc_pm_stage1);
 
-    if constexpr (Commute) {
+    if (early_release) {
+        auto& ytd = db.district_ytd(q_w_id, q_d_id);
+        CHK(ytd.write_nothrow(ytd.read() + h_amount));
+        ytd.retire();
+    } else if constexpr (Commute) {
         // update district ytd commutatively
         commutators::Commutator<district_value> commutator(h_amount);
         db.tbl_districts(q_w_id).update_row(row, commutator);
@@ -369,6 +414,11 @@ void tpcc_runner<DBParams>::run_txn_payment() {
         // update district ytd in-place
         new_dv->d_ytd += h_amount;
         db.tbl_districts(q_w_id).update_row(row, new_dv);
+        if constexpr (repairable) {
+            ytd_repair<std::remove_reference_t<decltype(db.tbl_districts(q_w_id))>,
+                       decltype(district_value::d_ytd), &district_value::d_ytd>
+                ::add(db.tbl_districts(q_w_id), row, dt_nc::d_ytd, new_dv, h_amount);
+        }
     }
 
     TXP_INCREMENT(txp_tpcc_pm_stage2);
@@ -403,7 +453,8 @@ void tpcc_runner<DBParams>::run_txn_payment() {
          {cu_nc::c_balance, access_t::update},
          {cu_nc::c_payment_cnt, Commute ? access_t::write : access_t::update},
          {cu_nc::c_ytd_payment, Commute ? access_t::write : access_t::update},
-         {cu_nc::c_credit, Commute ? access_t::write : access_t::update}}
+         {cu_nc::c_credit, Commute ? access_t::write : access_t::update},
+         {cu_nc::c_data, Commute ? access_t::write : access_t::update}}
     );
     (void)result;
     CHK(success);
@@ -417,9 +468,10 @@ void tpcc_runner<DBParams>::run_txn_payment() {
     out_c_balance = value.c_balance();
 
     if constexpr (Commute) {
-        if (value.c_credit() == "BC") {
+        if (value.c_credit() == bad_credit()) {
             commutators::Commutator<customer_value> commutator(-h_amount, h_amount, q_c_id, q_c_d_id, q_c_w_id,
-                                                                      q_d_id, q_w_id, h_amount);
+                                                                      q_d_id, q_w_id, h_amount,
+                                                                      db.tbl_customers(q_c_w_id).strings());
             db.tbl_customers(q_c_w_id).update_row(row, commutator);
         } else {
             commutators::Commutator<customer_value> commutator(-h_amount, h_amount);
@@ -431,9 +483,9 @@ void tpcc_runner<DBParams>::run_txn_payment() {
         new_cv->c_balance -= h_amount;
         new_cv->c_payment_cnt += 1;
         new_cv->c_ytd_payment += h_amount;
-        if (value.c_credit() == "BC") {
+        if (value.c_credit() == bad_credit()) {
             c_data_info info(q_c_id, q_c_d_id, q_c_w_id, q_d_id, q_w_id, h_amount);
-            new_cv->c_data.insert_left(info.buf(), c_data_info::len);
+            new_cv->c_data.insert_left(info.buf(), c_data_info::len, db.tbl_customers(q_c_w_id).strings());
         }
         db.tbl_customers(q_c_w_id).update_row(row, new_cv);
     }
@@ -491,8 +543,8 @@ void tpcc_runner<DBParams>::run_txn_orderstatus() {
     }
 
     // holding outputs of the transaction
-    var_string<16> out_c_first, out_c_last;
-    fix_string<2> out_c_middle;
+    compact_string<16> out_c_first, out_c_last;
+    customer_dict_string out_c_middle;
     int64_t out_c_balance;
     uint64_t out_o_carrier_id;
     uint32_t out_o_entry_date;
@@ -650,6 +702,9 @@ void tpcc_runner<DBParams>::run_txn_delivery(uint64_t q_w_id,
         if (order_id == 0)
             continue;
 
+        // each district's delivery is a long chain of reads and updates
+        CHK(Sto::validate_point());
+
         order_key ok(q_w_id, q_d_id, order_id);
         {
         auto [success, result] = db.tbl_neworders(q_w_id).delete_row(ok);
@@ -805,4 +860,406 @@ void tpcc_runner<DBParams>::run_txn_stocklevel(){
     TXP_ACCOUNT(txp_tpcc_st_aborts, starts - 1);
 }
 
+// @section: CH-benCHmark analytic queries
+template <typename DBParams>
+bool ch_runner<DBParams>::run_query(int qi, uint64_t& num_aborts) {
+    aborts = 0;
+    gave_up = false;
+    try {
+        switch (ch_queries::ids[qi]) {
+            case 1:
+                run_q1();
+                break;
+            case 5:
+                run_q5();
+                break;
+            case 6:
+                run_q6();
+                break;
+            case 12:
+                run_q12();
+                break;
+            case 14:
+                run_q14();
+                break;
+            default:
+                always_assert(false, "unknown CH query");
+        }
+    } catch (Transaction::Abort&) {
+        // TEND(false) rethrows when STO_USE_EXCEPTION
+        assert(gave_up);
+    }
+    num_aborts += aborts;
+    return !gave_up;
+}
+
+// Q1: quantity and amount of delivered order lines by ol_number
+template <typename DBParams>
+void ch_runner<DBParams>::run_q1() {
+    typedef orderline_value::NamedColumn ol_nc;
+    typedef typename tpcc_db<DBParams>::ol_table_type::accessor_t ol_accessor;
+
+    struct group {
+        uint64_t count;
+        uint64_t sum_quantity;
+        int64_t sum_amount;
+    };
+    std::array<group, 16> groups, part;
+
+    auto ol_scan_callback = [&part] (const orderline_key& key, const auto& scan_value) -> bool {
+        auto olv = (ol_accessor)(scan_value);
+        if (olv.ol_delivery_d() > date_begin) {
+            auto& g = part[bswap(key.ol_number)];
+            ++g.count;
+            g.sum_quantity += olv.ol_quantity();
+            g.sum_amount += olv.ol_amount();
+        }
+        return true;
+    };
+
+    groups.fill(group());
+    for (uint64_t c = 0; c != num_chunks(); ++c) {
+        TXN {
+        part.fill(group());
+        for (uint64_t wd = chunk_begin(c); wd != chunk_end(c); ++wd) {
+            uint64_t w_id = wd / NUM_DISTRICTS_PER_WAREHOUSE + 1, d_id = wd % NUM_DISTRICTS_PER_WAREHOUSE + 1;
+            orderline_key olk0(w_id, d_id, 0, 0);
+            orderline_key olk1(w_id, d_id + 1, 0, 0);
+            bool scan_success = db.tbl_orderlines(w_id)
+                    .template range_scan<decltype(ol_scan_callback), false/*reverse*/>(olk0, olk1, ol_scan_callback,
+                            {{ol_nc::ol_quantity, access_t::read},
+                             {ol_nc::ol_amount, access_t::read},
+                             {ol_nc::ol_delivery_d, access_t::read}}
+                    );
+            CHK(scan_success);
+        }
+        } TEND(keep_retrying());
+        if (gave_up)
+            return;
+        for (size_t n = 0; n != groups.size(); ++n) {
+            groups[n].count += part[n].count;
+            groups[n].sum_quantity += part[n].sum_quantity;
+            groups[n].sum_amount += part[n].sum_amount;
+        }
+    }
+
+    int64_t total = 0;
+    for (auto& g : groups)
+        total += g.sum_amount;
+    results[ch_queries::index_of(1)] = double(total);
+}
+
+// Q5: revenue by nation of the region's customers buying from suppliers of
+// their own nation
+template <typename DBParams>
+void ch_runner<DBParams>::run_q5() {
+    typedef order_value::NamedColumn od_nc;
+    typedef orderline_value::NamedColumn ol_nc;
+    typedef customer_value::NamedColumn cu_nc;
+    typedef stock_value::NamedColumn st_nc;
+    typedef typename tpcc_db<DBParams>::od_table_type::accessor_t od_accessor;
+    typedef typename tpcc_db<DBParams>::ol_table_type::accessor_t ol_accessor;
+
+    static const int region = ch_dimensions::region("EUROPE");
+    auto& su_nationkey = db.ch_dims().su_nationkey;
+
+    struct order_info {
+        uint64_t d_id;
+        uint64_t o_id;
+        uint64_t c_id;
+        int nation;
+    };
+    struct line_info {
+        uint64_t i_id;
+        int32_t amount;
+        int nation;
+    };
+    std::vector<order_info> orders;
+    std::vector<line_info> lines;
+    std::array<int64_t, 128> revenue, part;
+
+    auto od_scan_callback = [&orders] (const order_key& key, const auto& scan_value) -> bool {
+        auto odv = (od_accessor)(scan_value);
+        if (odv.o_entry_d() >= date_begin)
+            orders.push_back({bswap(key.o_d_id), bswap(key.o_id), odv.o_c_id(), -1});
+        return true;
+    };
+
+    // merge join with the orders, which come in the same key order
+    size_t next_order;
+    uint64_t ol_w_id;
+    auto ol_scan_callback = [&] (const orderline_key& key, const auto& scan_value) -> bool {
+        uint64_t d_id = bswap(key.ol_d_id), o_id = bswap(key.ol_o_id);
+        while (next_order != orders.size()
+               && std::tie(orders[next_order].d_id, orders[next_order].o_id) < std::tie(d_id, o_id))
+            ++next_order;
+        if (next_order == orders.size())
+            return false;
+        auto& od = orders[next_order];
+        if (od.d_id == d_id && od.o_id == o_id && od.nation >= 0) {
+            auto olv = (ol_accessor)(scan_value);
+            if (su_nationkey[ch_dimensions::supplier_of(ol_w_id, olv.ol_i_id())] == od.nation)
+                lines.push_back({olv.ol_i_id(), olv.ol_amount(), od.nation});
+        }
+        return true;
+    };
+
+    revenue.fill(0);
+    for (uint64_t c = 0; c != num_chunks(); ++c) {
+        TXN {
+        part.fill(0);
+        for (uint64_t wd = chunk_begin(c); wd != chunk_end(c); ++wd) {
+            uint64_t d_id = wd % NUM_DISTRICTS_PER_WAREHOUSE + 1;
+            ol_w_id = wd / NUM_DISTRICTS_PER_WAREHOUSE + 1;
+            orders.clear();
+            lines.clear();
+            order_key k0(ol_w_id, d_id, 0);
+            order_key k1(ol_w_id, d_id + 1, 0);
+            bool scan_success = db.tbl_orders(ol_w_id)
+                    .template range_scan<decltype(od_scan_callback), false/*reverse*/>(k0, k1, od_scan_callback,
+                            {{od_nc::o_c_id, access_t::read},
+                             {od_nc::o_entry_d, access_t::read}}
+                    );
+            CHK(scan_success);
+
+            for (auto& od : orders) {
+                customer_key ck(ol_w_id, od.d_id, od.c_id);
+                auto [success, result, row, value] = db.tbl_customers(ol_w_id).select_split_row(ck,
+                    {{cu_nc::c_state, access_t::read}});
+                (void)row;
+                CHK(success);
+                int nation = result ? value.c_state()[0] : -1;
+                if (ch_dimensions::is_nation(nation) && ch_dimensions::nation_region(nation) == region)
+                    od.nation = nation;
+            }
+
+            next_order = 0;
+            orderline_key olk0(ol_w_id, d_id, 0, 0);
+            orderline_key olk1(ol_w_id, d_id + 1, 0, 0);
+            scan_success = db.tbl_orderlines(ol_w_id)
+                    .template range_scan<decltype(ol_scan_callback), false/*reverse*/>(olk0, olk1, ol_scan_callback,
+                            {{ol_nc::ol_i_id, access_t::read},
+                             {ol_nc::ol_amount, access_t::read}}
+                    );
+            CHK(scan_success);
+
+            // the join with STOCK only needs the row to exist
+            for (auto& ol : lines) {
+                stock_key sk(ol_w_id, ol.i_id);
+                auto [success, result, row, value] = db.tbl_stocks(ol_w_id).select_split_row(sk,
+                    {{st_nc::s_quantity, access_t::read}});
+                (void)row; (void)value;
+                CHK(success);
+                if (result)
+                    part[ol.nation] += ol.amount;
+            }
+        }
+        } TEND(keep_retrying());
+        if (gave_up)
+            return;
+        for (size_t n = 0; n != revenue.size(); ++n)
+            revenue[n] += part[n];
+    }
+
+    int64_t total = 0;
+    for (auto r : revenue)
+        total += r;
+    results[ch_queries::index_of(5)] = double(total);
+}
+
+// Q6: revenue of order lines delivered within a date range
+template <typename DBParams>
+void ch_runner<DBParams>::run_q6() {
+    typedef orderline_value::NamedColumn ol_nc;
+    typedef typename tpcc_db<DBParams>::ol_table_type::accessor_t ol_accessor;
+
+    int64_t revenue = 0, part;
+
+    auto ol_scan_callback = [&part] (const orderline_key&, const auto& scan_value) -> bool {
+        auto olv = (ol_accessor)(scan_value);
+        uint32_t d = olv.ol_delivery_d();
+        uint32_t q = olv.ol_quantity();
+        if (d >= date_begin && d < date_end && q >= 1 && q <= 100000)
+            part += olv.ol_amount();
+        return true;
+    };
+
+    for (uint64_t c = 0; c != num_chunks(); ++c) {
+        TXN {
+        part = 0;
+        for (uint64_t wd = chunk_begin(c); wd != chunk_end(c); ++wd) {
+            uint64_t w_id = wd / NUM_DISTRICTS_PER_WAREHOUSE + 1, d_id = wd % NUM_DISTRICTS_PER_WAREHOUSE + 1;
+            orderline_key olk0(w_id, d_id, 0, 0);
+            orderline_key olk1(w_id, d_id + 1, 0, 0);
+            bool scan_success = db.tbl_orderlines(w_id)
+                    .template range_scan<decltype(ol_scan_callback), false/*reverse*/>(olk0, olk1, ol_scan_callback,
+                            {{ol_nc::ol_quantity, access_t::read},
+                             {ol_nc::ol_amount, access_t::read},
+                             {ol_nc::ol_delivery_d, access_t::read}}
+                    );
+            CHK(scan_success);
+        }
+        } TEND(keep_retrying());
+        if (gave_up)
+            return;
+        revenue += part;
+    }
+
+    results[ch_queries::index_of(6)] = double(revenue);
+}
+
+// Q12: lines delivered after their order's entry, by o_ol_cnt and by
+// whether the order went to a high-priority carrier (1 or 2)
+template <typename DBParams>
+void ch_runner<DBParams>::run_q12() {
+    typedef order_value::NamedColumn od_nc;
+    typedef orderline_value::NamedColumn ol_nc;
+    typedef typename tpcc_db<DBParams>::od_table_type::accessor_t od_accessor;
+    typedef typename tpcc_db<DBParams>::ol_table_type::accessor_t ol_accessor;
+
+    struct order_info {
+        uint64_t d_id;
+        uint64_t o_id;
+        uint32_t entry_d;
+        uint32_t ol_cnt;
+        bool high;
+    };
+    std::vector<order_info> orders;
+    std::array<uint64_t, 16> high_lines, low_lines, high_part, low_part;
+
+    auto od_scan_callback = [&orders] (const order_key& key, const auto& scan_value) -> bool {
+        auto odv = (od_accessor)(scan_value);
+        uint64_t carrier = odv.o_carrier_id();
+        orders.push_back({bswap(key.o_d_id), bswap(key.o_id), odv.o_entry_d(), odv.o_ol_cnt(),
+                          carrier == 1 || carrier == 2});
+        return true;
+    };
+
+    size_t next_order;
+    auto ol_scan_callback = [&] (const orderline_key& key, const auto& scan_value) -> bool {
+        uint64_t d_id = bswap(key.ol_d_id), o_id = bswap(key.ol_o_id);
+        while (next_order != orders.size()
+               && std::tie(orders[next_order].d_id, orders[next_order].o_id) < std::tie(d_id, o_id))
+            ++next_order;
+        if (next_order == orders.size())
+            return false;
+        auto& od = orders[next_order];
+        if (od.d_id == d_id && od.o_id == o_id) {
+            auto olv = (ol_accessor)(scan_value);
+            uint32_t d = olv.ol_delivery_d();
+            if (od.entry_d <= d && d < date_2020)
+                ++(od.high ? high_part : low_part)[std::min<uint32_t>(od.ol_cnt, 15)];
+        }
+        return true;
+    };
+
+    high_lines.fill(0);
+    low_lines.fill(0);
+    for (uint64_t c = 0; c != num_chunks(); ++c) {
+        TXN {
+        high_part.fill(0);
+        low_part.fill(0);
+        for (uint64_t wd = chunk_begin(c); wd != chunk_end(c); ++wd) {
+            uint64_t w_id = wd / NUM_DISTRICTS_PER_WAREHOUSE + 1, d_id = wd % NUM_DISTRICTS_PER_WAREHOUSE + 1;
+            orders.clear();
+            order_key k0(w_id, d_id, 0);
+            order_key k1(w_id, d_id + 1, 0);
+            bool scan_success = db.tbl_orders(w_id)
+                    .template range_scan<decltype(od_scan_callback), false/*reverse*/>(k0, k1, od_scan_callback,
+                            {{od_nc::o_entry_d, access_t::read},
+                             {od_nc::o_ol_cnt, access_t::read},
+                             {od_nc::o_carrier_id, access_t::read}}
+                    );
+            CHK(scan_success);
+
+            next_order = 0;
+            orderline_key olk0(w_id, d_id, 0, 0);
+            orderline_key olk1(w_id, d_id + 1, 0, 0);
+            scan_success = db.tbl_orderlines(w_id)
+                    .template range_scan<decltype(ol_scan_callback), false/*reverse*/>(olk0, olk1, ol_scan_callback,
+                            {{ol_nc::ol_delivery_d, access_t::read}}
+                    );
+            CHK(scan_success);
+        }
+        } TEND(keep_retrying());
+        if (gave_up)
+            return;
+        for (size_t n = 0; n != high_lines.size(); ++n) {
+            high_lines[n] += high_part[n];
+            low_lines[n] += low_part[n];
+        }
+    }
+
+    uint64_t high = 0;
+    for (auto n : high_lines)
+        high += n;
+    results[ch_queries::index_of(12)] = double(high);
+}
+
+// Q14: percentage of a month's delivered revenue from promotional items
+// (i_data starting with "PR")
+template <typename DBParams>
+void ch_runner<DBParams>::run_q14() {
+    typedef orderline_value::NamedColumn ol_nc;
+    typedef item_value::NamedColumn it_nc;
+    typedef typename tpcc_db<DBParams>::ol_table_type::accessor_t ol_accessor;
+
+    static constexpr uint32_t window_begin = date_begin + (date_end - date_begin) / 2;
+    static constexpr uint32_t window_end = window_begin + month;
+
+    std::vector<std::pair<uint64_t, int32_t>> lines;
+    std::unordered_map<uint64_t, bool> promo;
+    int64_t promo_revenue = 0, revenue = 0, promo_part, part;
+
+    auto ol_scan_callback = [&lines] (const orderline_key&, const auto& scan_value) -> bool {
+        auto olv = (ol_accessor)(scan_value);
+        uint32_t d = olv.ol_delivery_d();
+        if (d >= window_begin && d < window_end)
+            lines.emplace_back(olv.ol_i_id(), olv.ol_amount());
+        return true;
+    };
+
+    for (uint64_t c = 0; c != num_chunks(); ++c) {
+        TXN {
+        promo.clear();
+        promo_part = part = 0;
+        for (uint64_t wd = chunk_begin(c); wd != chunk_end(c); ++wd) {
+            uint64_t w_id = wd / NUM_DISTRICTS_PER_WAREHOUSE + 1, d_id = wd % NUM_DISTRICTS_PER_WAREHOUSE + 1;
+            lines.clear();
+            orderline_key olk0(w_id, d_id, 0, 0);
+            orderline_key olk1(w_id, d_id + 1, 0, 0);
+            bool scan_success = db.tbl_orderlines(w_id)
+                    .template range_scan<decltype(ol_scan_callback), false/*reverse*/>(olk0, olk1, ol_scan_callback,
+                            {{ol_nc::ol_i_id, access_t::read},
+                             {ol_nc::ol_amount, access_t::read},
+                             {ol_nc::ol_delivery_d, access_t::read}}
+                    );
+            CHK(scan_success);
+
+            for (auto& ol : lines) {
+                auto it = promo.find(ol.first);
+                if (it == promo.end()) {
+                    auto [success, result, row, value] = db.tbl_items().select_split_row(item_key(ol.first),
+                        {{it_nc::i_data, access_t::read}});
+                    (void)row;
+                    CHK(success);
+                    bool is_promo = result && value.i_data()[0] == 'P' && value.i_data()[1] == 'R';
+                    it = promo.emplace(ol.first, is_promo).first;
+                }
+                part += ol.second;
+                if (it->second)
+                    promo_part += ol.second;
+            }
+        }
+        } TEND(keep_retrying());
+        if (gave_up)
+            return;
+        revenue += part;
+        promo_revenue += promo_part;
+    }
+
+    results[ch_queries::index_of(14)] = 100.0 * double(promo_revenue) / double(1 + revenue);
+}
+// @endsection: CH-benCHmark analytic queries
+
 }; // namespace tpcc
@@ -18,7 +18,7 @@ using db_params::parse_dbid;
 
 // @section: clp parser definitions
 enum {
-    opt_dbid = 1, opt_nthrs, opt_time, opt_perf, opt_pfcnt
+    opt_dbid = 1, opt_nthrs, opt_time, opt_perf, opt_pfcnt, opt_lpol
 };
 
 static const Clp_Option options[] = {
@@ -26,7 +26,8 @@ static const Clp_Option options[] = {
         { "nthreads",     't', opt_nthrs, Clp_ValInt,    Clp_Optional },
         { "time",         'l', opt_time,  Clp_ValDouble, Clp_Optional },
         { "perf",         'p', opt_perf,  Clp_NoVal,     Clp_Optional },
-        { "perf-counter", 'c', opt_pfcnt, Clp_NoVal,     Clp_Negate| Clp_Optional }
+        { "perf-counter", 'c', opt_pfcnt, Clp_NoVal,     Clp_Negate| Clp_Optional },
+        { "lock-policy",  'k', opt_lpol,  Clp_ValString, Clp_Optional }
 };
 
 static inline void print_usage(const char *argv_0) {
@@ -42,7 +43,9 @@ static inline void print_usage(const char *argv_0) {
        << "  --perf (or -p)" << std::endl
        << "    Spawns perf profiler in record mode for the duration of the benchmark run." << std::endl
        << "  --perf-counter (or -c)" << std::endl
-       << "    Spawns perf profiler in counter mode for the duration of the benchmark run." << std::endl;
+       << "    Spawns perf profiler in counter mode for the duration of the benchmark run." << std::endl
+       << "  --lock-policy=<STRING> (or -k<STRING>)" << std::endl
+       << "    Deadlock prevention policy for 2pl: spin (default), wait-die, or wound-wait." << std::endl;
     std::cout << ss.str() << std::flush;
 }
 
@@ -149,6 +152,15 @@ int main(int argc, const char * const *argv) {
             case opt_pfcnt:
                 params.perf_counter_mode = !clp->negated;
                 break;
+            case opt_lpol:
+                ContentionManager::lock_policy = parse_lock_policy(clp->val.s);
+                if (static_cast<int>(ContentionManager::lock_policy) < 0) {
+                    std::cout << "Unsupported lock policy: " << std::string(clp->val.s) << std::endl;
+                    print_usage(argv[0]);
+                    ret_code = 1;
+                    clp_stop = true;
+                }
+                break;
             default:
                 print_usage(argv[0]);
                 ret_code = 1;
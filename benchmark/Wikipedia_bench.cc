@@ -16,6 +16,8 @@ using db_params::db_tictoc_node_params;
 using db_params::db_tictoc_commute_node_params;
 using db_params::db_mvcc_params;
 using db_params::db_mvcc_commute_params;
+using db_params::db_2pl_params;
+using db_params::db_adaptive_params;
 using db_params::parse_dbid;
 
 template <typename DBParams>
@@ -27,7 +29,7 @@ int* wikipedia::wikipedia_loader<DBParams>::page_last_rev_lens = nullptr;
 
 // @section: clp parser definitions
 enum {
-    opt_dbid = 1, opt_nthrs, opt_users, opt_pages, opt_time, opt_gc, opt_comm, opt_perf, opt_pfcnt
+    opt_dbid = 1, opt_nthrs, opt_users, opt_pages, opt_time, opt_gc, opt_comm, opt_perf, opt_pfcnt, opt_valid, opt_asplit, opt_cold, opt_ccpol
 };
 
 static const Clp_Option options[] = {
@@ -39,7 +41,11 @@ static const Clp_Option options[] = {
         { "garbage-collect", 'b', opt_gc, Clp_NoVal,     Clp_Negate | Clp_Optional },
         { "commute",      'x', opt_comm,  Clp_NoVal,     Clp_Negate | Clp_Optional },
         { "perf",         'p', opt_perf,  Clp_NoVal,     Clp_Optional },
-        { "perf-counter", 'c', opt_pfcnt, Clp_NoVal,     Clp_Negate | Clp_Optional }
+        { "perf-counter", 'c', opt_pfcnt, Clp_NoVal,     Clp_Negate | Clp_Optional },
+        { "validate",     'e', opt_valid, Clp_ValUnsigned, Clp_Optional },
+        { "adaptive-split", 'j', opt_asplit, Clp_NoVal,  Clp_Negate | Clp_Optional },
+        { "cold-versions", 'z', opt_cold,  Clp_ValUnsigned, Clp_Optional },
+        { "cc-policy",    'y', opt_ccpol, Clp_ValString, Clp_Optional }
 };
 
 static inline void print_usage(const char *argv_0) {
@@ -63,7 +69,17 @@ static inline void print_usage(const char *argv_0) {
        << "  --perf (or -p)" << std::endl
        << "    Spawns perf profiler in record mode for the duration of the benchmark run." << std::endl
        << "  --perf-counter (or -c)" << std::endl
-       << "    Spawns perf profiler in counter mode for the duration of the benchmark run." << std::endl;
+       << "    Spawns perf profiler in counter mode for the duration of the benchmark run." << std::endl
+       << "  --validate=<NUM> (or -e<NUM>)" << std::endl
+       << "    Validate optimistic reads early, every NUM reads (default 0, off)." << std::endl
+       << "  --adaptive-split (or -j)" << std::endl
+       << "    Regroup the version cells of the page and useracct tables at runtime from their" << std::endl
+       << "    read/write co-access; tables start with the codegen split. Needs FINE_GRAINED=1 (default false)." << std::endl
+       << "  --cold-versions=<EPOCHS> (or -z<EPOCHS>)" << std::endl
+       << "    MVCC: compress rows in versions that old snapshots keep alive for more than EPOCHS" << std::endl
+       << "    epochs, and report version memory. Needs --garbage-collect (default 0, off)." << std::endl
+       << "  --cc-policy=<FILE> (or -y<FILE>)" << std::endl
+       << "    Load a per-transaction-type, per-table concurrency control policy (not for tictoc)." << std::endl;
     std::cout << ss.str() << std::flush;
 }
 
@@ -77,12 +93,16 @@ struct cmd_params {
     bool enable_comm;
     bool spawn_perf;
     bool perf_counter_mode;
+    unsigned validate_every;
+    bool adaptive_split;
+    unsigned cold_age;
 
     explicit cmd_params()
         : db_id(db_params::db_params_id::Default),
           num_threads(1), scale_user(10), scale_page(10),
           time(10.0), enable_gc(false), enable_comm(false),
-          spawn_perf(false), perf_counter_mode(false) {}
+          spawn_perf(false), perf_counter_mode(false), validate_every(0),
+          adaptive_split(false), cold_age(0) {}
 };
 
 // @endsection: clp parser definitions
@@ -105,9 +125,15 @@ public:
         size_t num_pages = wikipedia::constants::pages * (size_t)p.scale_page;
         wikipedia::load_params lp = {num_users, num_pages};
         wikipedia::run_params rp(num_users, num_pages, p.time, wikipedia::workload_weightgram);
+        Transaction::validate_every = p.validate_every;
+        MvCompressor::configure(p.cold_age);
 
         // Create DB
         auto& db = *(new db_type());
+        if (p.adaptive_split) {
+            db.tbl_page().enable_adaptive_split();
+            db.tbl_useracct().enable_adaptive_split();
+        }
 
         // Load DB
         loader_type loader(db, lp);
@@ -147,6 +173,10 @@ public:
             total_commit_txns += c;
         }
         profiler.finish(total_commit_txns);
+        if (p.adaptive_split)
+            print_adaptive_split(db);
+        if (MvCompressor::enabled())
+            MvCompressor::print_stats(std::cout);
 
         Transaction::rcu_release_all(advancer, p.num_threads);
 
@@ -156,6 +186,20 @@ public:
         return 0;
     }
 
+    static void print_adaptive_split(db_type& db) {
+        if constexpr (!DBParams::MVCC) {
+            auto print = [] (const char* name, const auto* layout) {
+                if (layout)
+                    std::cout << "Adaptive split: " << name << " " << layout->describe()
+                              << " after " << layout->migrations() << " migrations" << std::endl;
+            };
+            print("page", db.tbl_page().adaptive_split());
+            print("useracct", db.tbl_useracct().adaptive_split());
+        } else {
+            (void)db;
+        }
+    }
+
     static void print_abort_histogram(std::vector<runner_type>& runners) {
         std::stringstream ss;
         std::vector<size_t> overall_histogram(wikipedia::workload_weightgram.size(), 0ul);
@@ -194,6 +238,7 @@ int main(int argc, const char * const *argv) {
     int ret_code = 0;
     int opt;
     bool clp_stop = false;
+    bool cc_policy = false;
     while (!clp_stop && ((opt = Clp_Next(clp)) != Clp_Done)) {
         switch (opt) {
         case opt_dbid:
@@ -230,6 +275,24 @@ int main(int argc, const char * const *argv) {
         case opt_pfcnt:
             params.perf_counter_mode = !clp->negated;
             break;
+        case opt_valid:
+            params.validate_every = clp->val.u;
+            break;
+        case opt_asplit:
+            params.adaptive_split = !clp->negated;
+            break;
+        case opt_cold:
+            params.cold_age = clp->val.u;
+            break;
+        case opt_ccpol:
+            if (!CCPolicy::load(clp->val.s)) {
+                std::cerr << "Could not load concurrency control policy "
+                          << clp->val.s << std::endl;
+                ret_code = 1;
+                clp_stop = true;
+            }
+            cc_policy = true;
+            break;
         default:
             print_usage(argv[0]);
             ret_code = 1;
@@ -241,6 +304,10 @@ int main(int argc, const char * const *argv) {
     Clp_DeleteParser(clp);
     if (ret_code != 0)
         return ret_code;
+    if (cc_policy && params.db_id == db_params_id::TicToc) {
+        std::cerr << "--cc-policy does not apply to TicToc" << std::endl;
+        return 1;
+    }
 
     auto cpu_freq = determine_cpu_freq();
     if (cpu_freq == 0.0)
@@ -259,16 +326,16 @@ int main(int argc, const char * const *argv) {
                     bench_access<db_tictoc_commute_node_params>::execute(params) :
                     bench_access<db_tictoc_node_params>::execute(params);
             break;
-#if 0
-        case db_params_id::Opaque:
-            ret_code = bench_access<db_opaque_params>::execute(params);
-            break;
         case db_params_id::TwoPL:
             ret_code = bench_access<db_2pl_params>::execute(params);
             break;
         case db_params_id::Adaptive:
             ret_code = bench_access<db_adaptive_params>::execute(params);
             break;
+#if 0
+        case db_params_id::Opaque:
+            ret_code = bench_access<db_opaque_params>::execute(params);
+            break;
         case db_params_id::Swiss:
             ret_code = bench_access<db_swiss_params>::execute(params);
             break;
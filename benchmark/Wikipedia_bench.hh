@@ -41,6 +41,12 @@ struct constants {
     static constexpr double revision_user_sigma = 1.0001;
 };
 
+// CCPolicy access sites, one per table or index
+enum class wikipedia_site : int {
+    logging = 0, page, page_index, recentchanges, revision, text,
+    useracct, useracct_index, watchlist, watchlist_index
+};
+
 template <typename DBParams>
 class wikipedia_db {
 public:
@@ -83,7 +89,18 @@ public:
         idx_user_(),
         //tbl_ug_(),
         tbl_wl_(),
-        idx_wl_() {}
+        idx_wl_() {
+        tbl_log_.set_policy_site(static_cast<int>(wikipedia_site::logging));
+        tbl_page_.set_policy_site(static_cast<int>(wikipedia_site::page));
+        idx_page_.set_policy_site(static_cast<int>(wikipedia_site::page_index));
+        tbl_rc_.set_policy_site(static_cast<int>(wikipedia_site::recentchanges));
+        tbl_rev_.set_policy_site(static_cast<int>(wikipedia_site::revision));
+        tbl_text_.set_policy_site(static_cast<int>(wikipedia_site::text));
+        tbl_user_.set_policy_site(static_cast<int>(wikipedia_site::useracct));
+        idx_user_.set_policy_site(static_cast<int>(wikipedia_site::useracct_index));
+        tbl_wl_.set_policy_site(static_cast<int>(wikipedia_site::watchlist));
+        idx_wl_.set_policy_site(static_cast<int>(wikipedia_site::watchlist_index));
+    }
 
     /*
     ipb_tbl_type& tbl_ipblocks() {
@@ -586,6 +603,7 @@ void wikipedia_runner<DBParams>::run() {
         auto page_ns = ig.generate_page_namespace(page_id);
         auto page_title = ig.generate_page_title(page_id);
         size_t retries = 0;
+        CCPolicy::begin(static_cast<int>(t_type));
         switch (t_type) {
             case TxnType::AddWatchList:
                 retries = run_txn_addWatchList(user_id, page_ns, page_title);
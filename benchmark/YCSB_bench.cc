@@ -1,11 +1,14 @@
 #include <sstream>
 #include <iostream>
 #include <thread>
+#include <memory>
 
 #include "YCSB_bench.hh"
 #include "YCSB_txns.hh"
 #include "PlatformFeatures.hh"
 #include "DB_profiler.hh"
+#include "DB_deterministic.hh"
+#include "barrier.hh" // pthread_barrier_t
 
 namespace ycsb {
 
@@ -14,7 +17,8 @@ using bench::db_profiler;
 
 enum {
     opt_dbid = 1, opt_nthrs, opt_mode, opt_time, opt_perf, opt_pfcnt, opt_gc,
-    opt_node, opt_comm
+    opt_node, opt_comm, opt_det, opt_huge, opt_hot, opt_split, opt_rbias,
+    opt_acache, opt_cpath, opt_pfetch
 };
 
 static const Clp_Option options[] = {
@@ -27,6 +31,14 @@ static const Clp_Option options[] = {
     { "gc",           'g', opt_gc,    Clp_NoVal,     Clp_Negate| Clp_Optional },
     { "node",         'n', opt_node,  Clp_NoVal,     Clp_Negate| Clp_Optional },
     { "commute",      'x', opt_comm,  Clp_NoVal,     Clp_Negate| Clp_Optional },
+    { "deterministic",'d', opt_det,   Clp_ValUnsigned, Clp_Optional },
+    { "hugepages",    'h', opt_huge,  Clp_ValString, Clp_Optional },
+    { "hot-keys",     'k', opt_hot,   Clp_ValUnsigned, Clp_Optional },
+    { "hot-split",    's', opt_split, Clp_NoVal,     Clp_Negate| Clp_Optional },
+    { "reader-bias",  0,   opt_rbias, Clp_NoVal,     Clp_Negate| Clp_Optional },
+    { "anticache",    0,   opt_acache, Clp_ValUnsigned, Clp_Optional },
+    { "cold-file",    0,   opt_cpath, Clp_ValString, Clp_Optional },
+    { "prefetch",     0,   opt_pfetch, Clp_NoVal,    Clp_Negate| Clp_Optional },
 };
 
 static inline void print_usage(const char *argv_0) {
@@ -50,7 +62,34 @@ static inline void print_usage(const char *argv_0) {
        << "  --node (or -n)" << std::endl
        << "    Enable node tracking (default false)." << std::endl
        << "  --commute (or -x)" << std::endl
-       << "    Enable commutative updates in MVCC (default false)." << std::endl;
+       << "    Enable commutative updates in MVCC (default false)." << std::endl
+       << "  --deterministic[=<NUM>] (or -d[<NUM>])" << std::endl
+       << "    Run transactions with the deterministic batched engine instead of the" << std::endl
+       << "    DB concurrency control, in epochs of NUM transactions per thread (default 100)." << std::endl
+       << "  --hugepages=<MODE> (or -h<MODE>)" << std::endl
+       << "    Place rows, hash index buckets and transaction sets on huge pages: off (default)," << std::endl
+       << "    thp (transparent huge pages) or hugetlb (the hugetlbfs pool, see mount_hugepages.sh;" << std::endl
+       << "    falls back to thp). Compare dTLB misses with --perf-counter. Masstree index nodes" << std::endl
+       << "    are not covered: they come from the process allocator, which maps 2MB pages only in" << std::endl
+       << "    the default rpmalloc build, whatever the mode (not with USE_JEMALLOC or USE_LIBCMALLOC)." << std::endl
+       << "  --hot-keys=<NUM> (or -k<NUM>)" << std::endl
+       << "    Turn writes to the NUM hottest keys into blind increments of a per-key counter" << std::endl
+       << "    (default 0, off; not supported with mvcc or --deterministic). Use with -mA." << std::endl
+       << "  --hot-split, --no-hot-split (or -s)" << std::endl
+       << "    Keep hot-key counters in phase-reconciled split boxes (default), or in plain" << std::endl
+       << "    boxes updated by read-modify-write for comparison." << std::endl
+       << "  --reader-bias" << std::endl
+       << "    2pl and adaptive: take read locks in per-thread slots instead of the shared lock" << std::endl
+       << "    word; writers revoke the bias (default false)." << std::endl
+       << "  --anticache[=<RATIO>]" << std::endl
+       << "    Keep rows in an anti-caching table with only 1/RATIO of them in memory (default 4)," << std::endl
+       << "    evicting the rest to the cold file. Not supported with mvcc, --deterministic or" << std::endl
+       << "    --hot-keys. Use with -mA or -mB." << std::endl
+       << "  --cold-file=<PATH>" << std::endl
+       << "    File that holds evicted rows (default /tmp/ycsb_cold)." << std::endl
+       << "  --prefetch, --no-prefetch" << std::endl
+       << "    On touching an evicted row, abort and let the prefetcher thread read it instead" << std::endl
+       << "    of reading it in the transaction (default false)." << std::endl;
     std::cout << ss.str() << std::flush;
 }
 
@@ -70,9 +109,32 @@ void ycsb_prepopulation_thread(int thread_id, ycsb_db<DBParams>& db, uint64_t ke
     }
 }
 
+// The anti-caching table's key set is built by one thread, which evicts as
+// it goes so the resident rows never exceed the budget.
+template <typename DBParams>
+void ycsb_anticache_prepopulation_thread(ycsb_db<DBParams>& db) {
+    static constexpr uint64_t evict_every = 4096;
+    set_affinity(0);
+    ::TThread::set_id(0);
+    ycsb_input_generator ig(0);
+    auto& table = db.cold_table();
+    for (uint64_t i = 0; i < ycsb_table_size; ++i) {
+        table.nontrans_put(uint32_t(i), ig.random_ycsb_value<ycsb_value>());
+        if ((i + 1) % evict_every == 0) {
+            table.evict(db.max_hot());
+            Transaction::quiesce();
+        }
+    }
+}
+
 template <typename DBParams>
 void ycsb_db<DBParams>::prepopulate() {
     static constexpr uint64_t nthreads = 32;
+    if (anticache()) {
+        std::thread loader(ycsb_anticache_prepopulation_thread<DBParams>, std::ref(*this));
+        loader.join();
+        return;
+    }
     uint64_t key_begin, key_end;
     uint64_t segment_size = ycsb_table_size / nthreads;
     key_begin = 0;
@@ -135,6 +197,88 @@ public:
         txn_result.collapse2_count = collapse_cnt[1];
     }
 
+    // Deterministic batched execution (see DB_deterministic.hh). Each epoch
+    // takes the next `epoch_size` transactions from every runner's workload,
+    // interleaved; one thread sequences the epoch while the others wait, then
+    // all threads execute it.
+    struct deterministic_state {
+        typedef bench::deterministic_engine<uint32_t> engine_type;
+
+        deterministic_state(std::vector<ycsb_runner<DBParams>>& runners, size_t epoch_size)
+            : runners(runners), epoch_size(epoch_size),
+              cursors(runners.size(), 0), batch(), engine(), stop(false) {
+            int r = pthread_barrier_init(&barrier, nullptr, runners.size());
+            always_assert(r == 0, "pthread_barrier_init");
+        }
+        ~deterministic_state() {
+            pthread_barrier_destroy(&barrier);
+        }
+
+        void sequence() {
+            batch.clear();
+            for (size_t i = 0; i != epoch_size; ++i) {
+                for (size_t r = 0; r != runners.size(); ++r) {
+                    auto& w = runners[r].workload;
+                    batch.push_back(&w[cursors[r]]);
+                    cursors[r] = (cursors[r] + 1) % w.size();
+                }
+            }
+            engine.begin_epoch(batch.size());
+            for (size_t t = 0; t != batch.size(); ++t) {
+                for (auto& op : batch[t]->ops)
+                    engine.declare(t, op.key, op.is_write);
+            }
+            engine.end_epoch();
+        }
+
+        bool wait() {
+            int r = pthread_barrier_wait(&barrier);
+            always_assert(r == PTHREAD_BARRIER_SERIAL_THREAD || r == 0, "pthread_barrier_wait");
+            return r == PTHREAD_BARRIER_SERIAL_THREAD;
+        }
+
+        std::vector<ycsb_runner<DBParams>>& runners;
+        size_t epoch_size;
+        std::vector<size_t> cursors;
+        std::vector<const ycsb_txn_t*> batch;
+        engine_type engine;
+        pthread_barrier_t barrier;
+        bool stop;
+    };
+
+    static void ycsb_deterministic_thread(ycsb_db<DBParams>& db, db_profiler& prof, ycsb_runner<DBParams>& runner, deterministic_state& ds, double time_limit, results& txn_result) {
+        uint64_t local_cnt = 0;
+        uint64_t collapse_cnt[2] = {0, 0};
+        db.table_thread_init();
+
+        ::TThread::set_id(runner.id());
+        set_affinity(runner.id());
+
+        uint64_t tsc_diff = (uint64_t)(time_limit * constants::processor_tsc_frequency * constants::billion);
+        auto start_t = prof.start_timestamp();
+
+        while (true) {
+            if (ds.wait()) {
+                ds.stop = (read_tsc() - start_t) >= tsc_diff;
+                if (!ds.stop)
+                    ds.sequence();
+            }
+            ds.wait();
+            if (ds.stop)
+                break;
+            local_cnt += ds.engine.execute([&] (uint32_t t) {
+                auto txn = ds.batch[t];
+                runner.run_txn_deterministic(*txn);
+                if (txn->collapse_type)
+                    ++collapse_cnt[txn->collapse_type - 1];
+            });
+        }
+
+        txn_result.count = local_cnt;
+        txn_result.collapse1_count = collapse_cnt[0];
+        txn_result.collapse2_count = collapse_cnt[1];
+    }
+
     static void workload_generation(std::vector<ycsb_runner<DBParams>>& runners, mode_id mode) {
         std::vector<std::thread> thrs;
         int tsize = 16;
@@ -155,16 +299,24 @@ public:
             t.join();
     }
 
-    static results run_benchmark(ycsb_db<DBParams>& db, db_profiler& prof, std::vector<ycsb_runner<DBParams>>& runners, double time_limit) {
+    static results run_benchmark(ycsb_db<DBParams>& db, db_profiler& prof, std::vector<ycsb_runner<DBParams>>& runners, double time_limit, size_t det_epoch) {
         int num_runners = runners.size();
         std::vector<std::thread> runner_thrs;
         std::vector<results> txn_cnts;
         txn_cnts.resize(num_runners);
+        std::unique_ptr<deterministic_state> ds;
+        if (det_epoch)
+            ds.reset(new deterministic_state(runners, det_epoch));
 
         for (int i = 0; i < num_runners; ++i) {
             txn_cnts.emplace_back();
-            runner_thrs.emplace_back(ycsb_runner_thread, std::ref(db), std::ref(prof),
-                                     std::ref(runners[i]), time_limit, std::ref(txn_cnts[i]));
+            if (ds) {
+                runner_thrs.emplace_back(ycsb_deterministic_thread, std::ref(db), std::ref(prof),
+                                         std::ref(runners[i]), std::ref(*ds), time_limit, std::ref(txn_cnts[i]));
+            } else {
+                runner_thrs.emplace_back(ycsb_runner_thread, std::ref(db), std::ref(prof),
+                                         std::ref(runners[i]), time_limit, std::ref(txn_cnts[i]));
+            }
         }
 
         for (auto &t : runner_thrs)
@@ -189,6 +341,12 @@ public:
         mode_id mode = mode_id::ReadOnly;
         double time_limit = 10.0;
         bool enable_gc = false;
+        size_t det_epoch = 0;
+        uint32_t hot_keys = 0;
+        bool hot_split = true;
+        uint32_t anticache_ratio = 0;
+        std::string cold_path = "/tmp/ycsb_cold";
+        bool prefetch = false;
 
         Clp_Parser *clp = Clp_NewParser(argc, argv, arraysize(options), options);
 
@@ -245,6 +403,35 @@ public:
                 break;
             case opt_comm:
                 break;
+            case opt_rbias:
+                break;
+            case opt_det:
+                det_epoch = clp->have_val ? clp->val.u : 100;
+                break;
+            case opt_huge: {
+                HugeArena::mode m;
+                if (!HugeArena::parse(clp->val.s, m) || !HugeArena::configure(m)) {
+                    std::cerr << "Bad huge page mode " << clp->val.s << std::endl;
+                    ret = 1;
+                    clp_stop = true;
+                }
+                break;
+            }
+            case opt_hot:
+                hot_keys = clp->val.u;
+                break;
+            case opt_split:
+                hot_split = !clp->negated;
+                break;
+            case opt_acache:
+                anticache_ratio = clp->have_val ? clp->val.u : 4;
+                break;
+            case opt_cpath:
+                cold_path = clp->val.s;
+                break;
+            case opt_pfetch:
+                prefetch = !clp->negated;
+                break;
             default:
                 print_usage(argv[0]);
                 ret = 1;
@@ -257,6 +444,20 @@ public:
         if (ret != 0)
             return ret;
 
+        if (hot_keys && (DBParams::MVCC || det_epoch)) {
+            std::cerr << "--hot-keys is not supported with MVCC or --deterministic" << std::endl;
+            return 1;
+        }
+        if (anticache_ratio && (DBParams::MVCC || det_epoch || hot_keys)) {
+            std::cerr << "--anticache is not supported with MVCC, --deterministic or --hot-keys" << std::endl;
+            return 1;
+        }
+        // the evictor and prefetcher take the two thread ids after the workers
+        if (anticache_ratio && num_threads + 2 > MAX_THREADS) {
+            std::cerr << "--anticache needs two thread ids beyond the workers" << std::endl;
+            return 1;
+        }
+
         auto profiler_mode = counter_mode ?
                              Profiler::perf_mode::counters : Profiler::perf_mode::record;
 
@@ -272,6 +473,22 @@ public:
 
         db_profiler prof(spawn_perf);
         ycsb_db<DBParams> db;
+        if (hot_keys) {
+            db.init_hot_keys(hot_keys, hot_split);
+            std::cout << "Hot keys: " << hot_keys << ", "
+                      << (hot_split ? "split" : "unsplit") << " counters" << std::endl;
+        }
+
+        std::thread advancer;
+        if (anticache_ratio) {
+            db.init_anticache(std::max<size_t>(ycsb_table_size / anticache_ratio, 1), cold_path, prefetch);
+            std::cout << "Anti-caching: " << db.max_hot() << " of " << ycsb_table_size
+                      << " rows in memory, " << (prefetch ? "prefetched" : "blocking") << " fetches" << std::endl;
+            // Evicted rows are freed through RCU, during loading too
+            enable_gc = true;
+            Transaction::set_epoch_cycle(1000);
+            advancer = std::thread(&Transaction::epoch_advancer, nullptr);
+        }
 
         std::cout << "Prepopulating database..." << std::endl;
         db.prepopulate();
@@ -282,29 +499,44 @@ public:
             runners.emplace_back(i, db, mode);
         }
 
-        std::thread advancer;
         std::cout << "Generating workload..." << std::endl;
         workload_generation(runners, mode);
         std::cout << "Done." << std::endl;
         std::cout << "Garbage collection: ";
         if (enable_gc) {
             std::cout << "enabled, running every 1 ms";
-            Transaction::set_epoch_cycle(1000);
-            advancer = std::thread(&Transaction::epoch_advancer, nullptr);
+            if (!advancer.joinable()) {
+                Transaction::set_epoch_cycle(1000);
+                advancer = std::thread(&Transaction::epoch_advancer, nullptr);
+            }
         } else {
             std::cout << "disabled";
         }
         std::cout << std::endl << std::flush;
 
+        if (anticache_ratio)
+            db.cold_table().start(db.max_hot(), num_threads, num_threads + 1);
+
         prof.start(profiler_mode);
-        auto result = run_benchmark(db, prof, runners, time_limit);
+        if (det_epoch) {
+            std::cout << "Deterministic execution: " << det_epoch
+                      << " transactions per thread per epoch" << std::endl;
+        }
+        auto result = run_benchmark(db, prof, runners, time_limit, det_epoch);
         auto elapsed_ms = prof.finish(result.count);
+        HugeArena::print_stats(std::cout);
+        if (hot_keys)
+            std::cout << "Hot key increments: " << db.hot_total() << std::endl;
+        if (anticache_ratio) {
+            db.cold_table().stop();
+            db.cold_table().print_stats(std::cout);
+        }
         if (result.collapse1_count || result.collapse2_count) {
             std::cout << "Collapse 1 throughput: " << (double)result.collapse1_count / (elapsed_ms / 1000) << " txns/sec" << std::endl;
             std::cout << "Collapse 2 throughput: " << (double)result.collapse2_count / (elapsed_ms / 1000) << " txns/sec" << std::endl;
         }
 
-        Transaction::rcu_release_all(advancer, num_threads);
+        Transaction::rcu_release_all(advancer, anticache_ratio ? num_threads + 2 : num_threads);
 
         return 0;
     }
@@ -329,6 +561,7 @@ int main(int argc, const char *const *argv) {
     bool clp_stop = false;
     bool node_tracking = false;
     bool enable_commute = false;
+    bool reader_bias = false;
     while (!clp_stop && ((opt = Clp_Next(clp)) != Clp_Done)) {
         switch (opt) {
         case opt_dbid:
@@ -347,6 +580,9 @@ int main(int argc, const char *const *argv) {
         case opt_comm:
             enable_commute = !clp->negated;
             break;
+        case opt_rbias:
+            reader_bias = !clp->negated;
+            break;
         default:
             break;
         }
@@ -374,15 +610,23 @@ int main(int argc, const char *const *argv) {
             ret_code = ycsb_access<db_default_params>::execute(argc, argv);
         }
         break;
-    /*
-    case db_params_id::Opaque:
-        ret_code = ycsb_access<db_opaque_params>::execute(argc, argv);
-        break;
     case db_params_id::TwoPL:
-        ret_code = ycsb_access<db_2pl_params>::execute(argc, argv);
+        if (reader_bias) {
+            ret_code = ycsb_access<db_2pl_rbias_params>::execute(argc, argv);
+        } else {
+            ret_code = ycsb_access<db_2pl_params>::execute(argc, argv);
+        }
         break;
     case db_params_id::Adaptive:
-        ret_code = ycsb_access<db_adaptive_params>::execute(argc, argv);
+        if (reader_bias) {
+            ret_code = ycsb_access<db_adaptive_rbias_params>::execute(argc, argv);
+        } else {
+            ret_code = ycsb_access<db_adaptive_params>::execute(argc, argv);
+        }
+        break;
+    /*
+    case db_params_id::Opaque:
+        ret_code = ycsb_access<db_opaque_params>::execute(argc, argv);
         break;
     case db_params_id::Swiss:
         ret_code = ycsb_access<db_swiss_params>::execute(argc, argv);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "compiler.hh"
@@ -14,6 +15,8 @@
 #endif
 #include "DB_index.hh"
 #include "DB_params.hh"
+#include "DB_anticache.hh"
+#include "TSplitBox.hh"
 
 #if TABLE_FINE_GRAINED
 #include "ycsb_split_params_ts.hh"
@@ -43,8 +46,11 @@ public:
         unordered_index<K, V, DBParams>>::type;
 
     typedef UIndex<ycsb_key, ycsb_value> ycsb_table_type;
+    typedef TSplitBox<int64_t> hot_split_counter;
+    typedef TBox<int64_t, TNonopaqueWrapped<int64_t>> hot_counter;
+    typedef bench::anticache_table<uint32_t, ycsb_value> cold_table_type;
 
-    explicit ycsb_db() : ycsb_table_(ycsb_table_size) {}
+    explicit ycsb_db() : ycsb_table_(ycsb_table_size), hot_keys_(0), hot_split_(false) {}
 
     ycsb_table_type& ycsb_table() {
         return ycsb_table_;
@@ -56,8 +62,66 @@ public:
 
     void prepopulate();
 
+    // Anti-caching mode: rows live in an anticache_table instead of the
+    // index, and at most `max_hot` of them stay in memory; the rest are
+    // evicted to `cold_path`.
+    void init_anticache(size_t max_hot, const std::string& cold_path, bool prefetch) {
+        // cold file slots are 8-byte aligned
+        size_t slot = (sizeof(ycsb_value) + 7) & ~size_t(7);
+        cold_table_.reset(new cold_table_type(cold_path, ycsb_table_size * slot,
+                                              prefetch ? cold_table_type::fetch_policy::abort_and_prefetch
+                                                       : cold_table_type::fetch_policy::block));
+        max_hot_ = max_hot;
+    }
+    bool anticache() const {
+        return bool(cold_table_);
+    }
+    cold_table_type& cold_table() {
+        return *cold_table_;
+    }
+    size_t max_hot() const {
+        return max_hot_;
+    }
+
+    // Hot-key mode: writes to the `n` hottest keys become blind increments
+    // of a per-key counter, kept in TSplitBoxes, or with `split` off in
+    // plain boxes updated by read-modify-write as the baseline.
+    void init_hot_keys(uint32_t n, bool split) {
+        hot_keys_ = n;
+        hot_split_ = split;
+        if (split)
+            hot_split_counters_.reset(new hot_split_counter[n]);
+        else
+            hot_counters_.reset(new hot_counter[n]);
+    }
+    bool is_hot(uint32_t key) const {
+        return key < hot_keys_;
+    }
+    void increment_hot(uint32_t key) {
+        if (hot_split_) {
+            hot_split_counters_[key].apply(1);
+        } else {
+            hot_counter& c = hot_counters_[key];
+            c = c.read() + 1;
+        }
+    }
+    // Not thread safe with respect to concurrent updates
+    int64_t hot_total() const {
+        int64_t total = 0;
+        for (uint32_t k = 0; k != hot_keys_; ++k)
+            total += hot_split_ ? hot_split_counters_[k].nontrans_read()
+                                : hot_counters_[k].nontrans_read();
+        return total;
+    }
+
 private:
     ycsb_table_type ycsb_table_;
+    uint32_t hot_keys_;
+    bool hot_split_;
+    std::unique_ptr<hot_split_counter[]> hot_split_counters_;
+    std::unique_ptr<hot_counter[]> hot_counters_;
+    std::unique_ptr<cold_table_type> cold_table_;
+    size_t max_hot_ = 0;
 };
 
 struct ycsb_op_t {
@@ -119,6 +183,8 @@ public:
     }
 
     inline void run_txn(const ycsb_txn_t& txn);
+    inline void run_txn_deterministic(const ycsb_txn_t& txn);
+    inline void run_txn_anticache(const ycsb_txn_t& txn);
 
     std::vector<ycsb_txn_t> workload;
 
@@ -84,6 +84,11 @@ void ycsb_runner<DBParams>::run_txn(const ycsb_txn_t& txn) {
 
     (void)output;
 
+    if (db.anticache()) {
+        run_txn_anticache(txn);
+        return;
+    }
+
     TRANSACTION {
         if (DBParams::MVCC && txn.rw_txn) {
             Sto::mvcc_rw_upgrade();
@@ -92,7 +97,9 @@ void ycsb_runner<DBParams>::run_txn(const ycsb_txn_t& txn) {
             bool col_parity = op.col_n % 2;
             auto col_group = col_parity ? nm::odd_columns : nm::even_columns;
             (void)col_group;
-            if (op.is_write) {
+            if (op.is_write && db.is_hot(op.key)) {
+                db.increment_hot(op.key);
+            } else if (op.is_write) {
                 ycsb_key key(op.key);
                 auto [success, result, row, value]
                     = db.ycsb_table().select_split_row(key,
@@ -149,4 +156,67 @@ void ycsb_runner<DBParams>::run_txn(const ycsb_txn_t& txn) {
     } RETRY(true);
 }
 
+// Anti-caching mode: rows are whole values in the anticache_table, so a write
+// copies the row and replaces one column.
+template <typename DBParams>
+void ycsb_runner<DBParams>::run_txn_anticache(const ycsb_txn_t& txn) {
+    col_type output;
+    (void)output;
+    auto& table = db.cold_table();
+
+    TRANSACTION {
+        for (auto& op : txn.ops) {
+            bool col_parity = op.col_n % 2;
+            auto [success, found, row] = table.select_row(op.key);
+            (void)found;
+            TXN_DO(success);
+            assert(found);
+            if (op.is_write) {
+                ycsb_value new_val = *row;
+                auto& cols = col_parity ? new_val.odd_columns : new_val.even_columns;
+                cols[op.col_n/2] = op.write_value;
+                table.update_row(op.key, new_val);
+            } else {
+                auto& cols = col_parity ? row->odd_columns : row->even_columns;
+                output = cols[op.col_n/2];
+            }
+        }
+    } RETRY(true);
+}
+
+// Executes `txn` under the deterministic engine, which has already ordered it
+// after every conflicting transaction, so keys are accessed directly.
+template <typename DBParams>
+void ycsb_runner<DBParams>::run_txn_deterministic(const ycsb_txn_t& txn) {
+    col_type output;
+    (void)output;
+
+    for (auto& op : txn.ops) {
+        bool col_parity = op.col_n % 2;
+        ycsb_key key(op.key);
+        if constexpr (DBParams::MVCC) {
+            ycsb_value value;
+            bool found = db.ycsb_table().nontrans_get(key, &value);
+            (void)found;
+            assert(found);
+            auto& cols = col_parity ? value.odd_columns : value.even_columns;
+            if (op.is_write) {
+                cols[op.col_n/2] = op.write_value;
+                db.ycsb_table().nontrans_put(key, value);
+            } else {
+                output = cols[op.col_n/2];
+            }
+        } else {
+            ycsb_value* value = db.ycsb_table().nontrans_get(key);
+            assert(value);
+            auto& cols = col_parity ? value->odd_columns : value->even_columns;
+            if (op.is_write) {
+                cols[op.col_n/2] = op.write_value;
+            } else {
+                output = cols[op.col_n/2];
+            }
+        }
+    }
+}
+
 };
@@ -0,0 +1,8 @@
+#include "TPCC_bench.hh"
+#include "TPCC_txns.hh"
+
+using namespace tpcc;
+
+int tpcc_a(int argc, char const* const* argv) {
+    return tpcc_access<db_adaptive_params>::execute(argc, argv);
+}
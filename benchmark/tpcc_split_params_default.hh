@@ -286,17 +286,17 @@ class RecordAccessor<A, tpcc::district_value> {
   }
 
   
-  const var_string<20>& d_street_1() const {
+  const compact_string<20>& d_street_1() const {
     return impl().d_street_1_impl();
   }
 
   
-  const var_string<20>& d_street_2() const {
+  const compact_string<20>& d_street_2() const {
     return impl().d_street_2_impl();
   }
 
   
-  const var_string<20>& d_city() const {
+  const compact_string<20>& d_city() const {
     return impl().d_city_impl();
   }
 
@@ -343,17 +343,17 @@ class UniRecordAccessor<tpcc::district_value> : public RecordAccessor<UniRecordA
   }
 
   
-  const var_string<20>& d_street_1_impl() const {
+  const compact_string<20>& d_street_1_impl() const {
     return vptr_->d_street_1;
   }
 
   
-  const var_string<20>& d_street_2_impl() const {
+  const compact_string<20>& d_street_2_impl() const {
     return vptr_->d_street_2;
   }
 
   
-  const var_string<20>& d_city_impl() const {
+  const compact_string<20>& d_city_impl() const {
     return vptr_->d_city;
   }
 
@@ -413,17 +413,17 @@ class SplitRecordAccessor<tpcc::district_value> : public RecordAccessor<SplitRec
   }
 
   
-  const var_string<20>& d_street_1_impl() const {
+  const compact_string<20>& d_street_1_impl() const {
     return vptr_0_->d_street_1;
   }
 
   
-  const var_string<20>& d_street_2_impl() const {
+  const compact_string<20>& d_street_2_impl() const {
     return vptr_0_->d_street_2;
   }
 
   
-  const var_string<20>& d_city_impl() const {
+  const compact_string<20>& d_city_impl() const {
     return vptr_0_->d_city;
   }
 
@@ -536,32 +536,32 @@ template <typename A>
 class RecordAccessor<A, tpcc::customer_value> {
  public:
   
-  const var_string<16>& c_first() const {
+  const compact_string<16>& c_first() const {
     return impl().c_first_impl();
   }
 
   
-  const fix_string<2>& c_middle() const {
+  const tpcc::customer_dict_string& c_middle() const {
     return impl().c_middle_impl();
   }
 
   
-  const var_string<16>& c_last() const {
+  const compact_string<16>& c_last() const {
     return impl().c_last_impl();
   }
 
   
-  const var_string<20>& c_street_1() const {
+  const compact_string<20>& c_street_1() const {
     return impl().c_street_1_impl();
   }
 
   
-  const var_string<20>& c_street_2() const {
+  const compact_string<20>& c_street_2() const {
     return impl().c_street_2_impl();
   }
 
   
-  const var_string<20>& c_city() const {
+  const compact_string<20>& c_city() const {
     return impl().c_city_impl();
   }
 
@@ -586,7 +586,7 @@ class RecordAccessor<A, tpcc::customer_value> {
   }
 
   
-  const fix_string<2>& c_credit() const {
+  const tpcc::customer_dict_string& c_credit() const {
     return impl().c_credit_impl();
   }
 
@@ -621,7 +621,7 @@ class RecordAccessor<A, tpcc::customer_value> {
   }
 
   
-  const fix_string<500>& c_data() const {
+  const compact_string<500>& c_data() const {
     return impl().c_data_impl();
   }
 
@@ -643,32 +643,32 @@ class UniRecordAccessor<tpcc::customer_value> : public RecordAccessor<UniRecordA
 
  private:
   
-  const var_string<16>& c_first_impl() const {
+  const compact_string<16>& c_first_impl() const {
     return vptr_->c_first;
   }
 
   
-  const fix_string<2>& c_middle_impl() const {
+  const tpcc::customer_dict_string& c_middle_impl() const {
     return vptr_->c_middle;
   }
 
   
-  const var_string<16>& c_last_impl() const {
+  const compact_string<16>& c_last_impl() const {
     return vptr_->c_last;
   }
 
   
-  const var_string<20>& c_street_1_impl() const {
+  const compact_string<20>& c_street_1_impl() const {
     return vptr_->c_street_1;
   }
 
   
-  const var_string<20>& c_street_2_impl() const {
+  const compact_string<20>& c_street_2_impl() const {
     return vptr_->c_street_2;
   }
 
   
-  const var_string<20>& c_city_impl() const {
+  const compact_string<20>& c_city_impl() const {
     return vptr_->c_city;
   }
 
@@ -693,7 +693,7 @@ class UniRecordAccessor<tpcc::customer_value> : public RecordAccessor<UniRecordA
   }
 
   
-  const fix_string<2>& c_credit_impl() const {
+  const tpcc::customer_dict_string& c_credit_impl() const {
     return vptr_->c_credit;
   }
 
@@ -728,7 +728,7 @@ class UniRecordAccessor<tpcc::customer_value> : public RecordAccessor<UniRecordA
   }
 
   
-  const fix_string<500>& c_data_impl() const {
+  const compact_string<500>& c_data_impl() const {
     return vptr_->c_data;
   }
 
@@ -773,32 +773,32 @@ class SplitRecordAccessor<tpcc::customer_value> : public RecordAccessor<SplitRec
 
  private:
   
-  const var_string<16>& c_first_impl() const {
+  const compact_string<16>& c_first_impl() const {
     return vptr_0_->c_first;
   }
 
   
-  const fix_string<2>& c_middle_impl() const {
+  const tpcc::customer_dict_string& c_middle_impl() const {
     return vptr_0_->c_middle;
   }
 
   
-  const var_string<16>& c_last_impl() const {
+  const compact_string<16>& c_last_impl() const {
     return vptr_0_->c_last;
   }
 
   
-  const var_string<20>& c_street_1_impl() const {
+  const compact_string<20>& c_street_1_impl() const {
     return vptr_0_->c_street_1;
   }
 
   
-  const var_string<20>& c_street_2_impl() const {
+  const compact_string<20>& c_street_2_impl() const {
     return vptr_0_->c_street_2;
   }
 
   
-  const var_string<20>& c_city_impl() const {
+  const compact_string<20>& c_city_impl() const {
     return vptr_0_->c_city;
   }
 
@@ -823,7 +823,7 @@ class SplitRecordAccessor<tpcc::customer_value> : public RecordAccessor<SplitRec
   }
 
   
-  const fix_string<2>& c_credit_impl() const {
+  const tpcc::customer_dict_string& c_credit_impl() const {
     return vptr_0_->c_credit;
   }
 
@@ -858,7 +858,7 @@ class SplitRecordAccessor<tpcc::customer_value> : public RecordAccessor<SplitRec
   }
 
   
-  const fix_string<500>& c_data_impl() const {
+  const compact_string<500>& c_data_impl() const {
     return vptr_0_->c_data;
   }
 
@@ -1370,7 +1370,7 @@ class RecordAccessor<A, tpcc::orderline_value> {
   }
 
   
-  const fix_string<24>& ol_dist_info() const {
+  const compact_string<24>& ol_dist_info() const {
     return impl().ol_dist_info_impl();
   }
 
@@ -1417,7 +1417,7 @@ class UniRecordAccessor<tpcc::orderline_value> : public RecordAccessor<UniRecord
   }
 
   
-  const fix_string<24>& ol_dist_info_impl() const {
+  const compact_string<24>& ol_dist_info_impl() const {
     return vptr_->ol_dist_info;
   }
 
@@ -1475,7 +1475,7 @@ class SplitRecordAccessor<tpcc::orderline_value> : public RecordAccessor<SplitRe
   }
 
   
-  const fix_string<24>& ol_dist_info_impl() const {
+  const compact_string<24>& ol_dist_info_impl() const {
     return vptr_0_->ol_dist_info;
   }
 
@@ -1706,12 +1706,12 @@ template <typename A>
 class RecordAccessor<A, tpcc::stock_value> {
  public:
   
-  const std::array<fix_string<24>, NUM_DISTRICTS_PER_WAREHOUSE>& s_dists() const {
+  const std::array<compact_string<24>, NUM_DISTRICTS_PER_WAREHOUSE>& s_dists() const {
     return impl().s_dists_impl();
   }
 
   
-  const var_string<50>& s_data() const {
+  const compact_string<50>& s_data() const {
     return impl().s_data_impl();
   }
 
@@ -1753,12 +1753,12 @@ class UniRecordAccessor<tpcc::stock_value> : public RecordAccessor<UniRecordAcce
 
  private:
   
-  const std::array<fix_string<24>, NUM_DISTRICTS_PER_WAREHOUSE>& s_dists_impl() const {
+  const std::array<compact_string<24>, NUM_DISTRICTS_PER_WAREHOUSE>& s_dists_impl() const {
     return vptr_->s_dists;
   }
 
   
-  const var_string<50>& s_data_impl() const {
+  const compact_string<50>& s_data_impl() const {
     return vptr_->s_data;
   }
 
@@ -1811,12 +1811,12 @@ class SplitRecordAccessor<tpcc::stock_value> : public RecordAccessor<SplitRecord
 
  private:
   
-  const std::array<fix_string<24>, NUM_DISTRICTS_PER_WAREHOUSE>& s_dists_impl() const {
+  const std::array<compact_string<24>, NUM_DISTRICTS_PER_WAREHOUSE>& s_dists_impl() const {
     return vptr_0_->s_dists;
   }
 
   
-  const var_string<50>& s_data_impl() const {
+  const compact_string<50>& s_data_impl() const {
     return vptr_0_->s_data;
   }
 
@@ -0,0 +1,44 @@
+#!/usr/bin/python3
+
+# Compares the deterministic batched engine (ycsb_bench --deterministic, see
+# benchmark/DB_deterministic.hh) against the optimistic concurrency control
+# schemes on YCSB. Prints one throughput row per thread count.
+
+import argparse,re,subprocess
+
+def measure(args, threads, flags):
+    cmd = [args.binary, '-m' + args.mode, '-t{}'.format(threads),
+           '-l{}'.format(args.time)] + flags
+    best = 0.0
+    for _ in range(args.trials):
+        out = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             universal_newlines=True).stdout
+        m = re.search(r'Throughput: ([0-9.e+]+) txns/sec', out)
+        if m is None:
+            raise RuntimeError('no throughput in output of {}:\n{}'.format(' '.join(cmd), out))
+        best = max(best, float(m.group(1)))
+    return best
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare deterministic execution with OCC, TicToc and MVCC on YCSB.')
+    parser.add_argument('--binary', default='./ycsb_bench')
+    parser.add_argument('--mode', default='A', help='YCSB variant; A is the high-skew mix')
+    parser.add_argument('--threads', default='1,2,4,8,16')
+    parser.add_argument('--time', type=float, default=5.0)
+    parser.add_argument('--trials', type=int, default=1)
+    parser.add_argument('--epoch', type=int, default=100,
+                        help='transactions per thread per deterministic epoch')
+    args = parser.parse_args()
+
+    configs = [('occ', ['-idefault']),
+               ('tictoc', ['-itictoc']),
+               ('mvcc', ['-imvcc']),
+               ('deterministic', ['-idefault', '--deterministic={}'.format(args.epoch)])]
+
+    print('threads ' + ' '.join('{:>14}'.format(name) for name, _ in configs))
+    for t in map(int, args.threads.split(',')):
+        row = [measure(args, t, flags) for _, flags in configs]
+        print('{:7d} '.format(t) + ' '.join('{:14.0f}'.format(x) for x in row))
+
+if __name__ == '__main__':
+    main()
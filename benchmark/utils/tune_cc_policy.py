@@ -0,0 +1,99 @@
+#!/usr/bin/python3
+
+# Offline search for a concurrency control policy (see sto-core/CCPolicy.hh)
+# for the TPC-C or Wikipedia driver. Coordinate descent over (transaction
+# type, table) actions: each round tries every action for every cell, keeping
+# a change if measured throughput improves. The best policy found is written
+# to --out and can be passed to the driver with --cc-policy.
+
+import argparse,re,subprocess,tempfile
+
+# Transaction type and site numbering of each driver: tpcc::txn_type and
+# tpcc::tpcc_site (TPCC_bench.hh), wikipedia::TxnType and
+# wikipedia::wikipedia_site (Wikipedia_bench.hh)
+benches = {
+    'tpcc': {
+        'binary': './tpcc_bench',
+        'txn_types': {'new_order': 1, 'payment': 2, 'order_status': 3, 'delivery': 4, 'stock_level': 5},
+        'sites': ['warehouse', 'district', 'customer', 'order', 'orderline', 'stock',
+                  'customer_index', 'order_customer_index', 'neworder', 'item', 'history'],
+        'scale': lambda args: ['-w{}'.format(args.warehouses)],
+    },
+    'wikipedia': {
+        'binary': './wiki_bench',
+        'txn_types': {'add_watchlist': 0, 'get_page_anon': 1, 'get_page_auth': 2,
+                      'remove_watchlist': 3, 'list_page_namespace': 4, 'update_page': 5},
+        'sites': ['logging', 'page', 'page_index', 'recentchanges', 'revision', 'text',
+                  'useracct', 'useracct_index', 'watchlist', 'watchlist_index'],
+        'scale': lambda args: [],
+    },
+}
+actions = ['none', 'opt', 'lock']
+
+def write_policy(path, policy):
+    with open(path, 'w') as f:
+        for (t, s), a in sorted(policy.items()):
+            if a != 'none':
+                f.write('{} {} {}\n'.format(t, s, a))
+
+def measure(args, policy):
+    with tempfile.NamedTemporaryFile('w', suffix='.policy') as f:
+        write_policy(f.name, policy)
+        cmd = [args.binary, '-i' + args.dbid, '-t{}'.format(args.threads),
+               '-l{}'.format(args.time), '--cc-policy=' + f.name] \
+              + benches[args.bench]['scale'](args) + args.extra
+        best = 0.0
+        for _ in range(args.trials):
+            out = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                 universal_newlines=True).stdout
+            m = re.search(r'Throughput: ([0-9.e+]+) txns/sec', out)
+            if m is None:
+                raise RuntimeError('no throughput in output of {}:\n{}'.format(' '.join(cmd), out))
+            best = max(best, float(m.group(1)))
+        return best
+
+def main():
+    parser = argparse.ArgumentParser(description='Tune a TPC-C or Wikipedia concurrency control policy.')
+    parser.add_argument('--bench', default='tpcc', choices=sorted(benches))
+    parser.add_argument('--binary', help='driver binary (default ./tpcc_bench or ./wiki_bench)')
+    # locked reads also apply to the OCC versions of the default dbid
+    parser.add_argument('--dbid', default='adaptive', choices=['default', '2pl', 'adaptive'])
+    parser.add_argument('--threads', type=int, default=4)
+    parser.add_argument('--warehouses', type=int, default=1, help='TPC-C only')
+    parser.add_argument('--time', type=float, default=5.0)
+    parser.add_argument('--trials', type=int, default=1)
+    parser.add_argument('--rounds', type=int, default=2)
+    parser.add_argument('--out', default='tpcc.policy')
+    parser.add_argument('extra', nargs='*', help='additional driver arguments')
+    args = parser.parse_args()
+    bench = benches[args.bench]
+    if args.binary is None:
+        args.binary = bench['binary']
+    sites = bench['sites']
+
+    policy = {(t, s): 'none' for t in bench['txn_types'].values() for s in range(len(sites))}
+    best = measure(args, policy)
+    print('baseline: {:.0f} txns/sec'.format(best))
+
+    for r in range(args.rounds):
+        changed = False
+        for cell in sorted(policy):
+            current = policy[cell]
+            for a in actions:
+                if a == current:
+                    continue
+                policy[cell] = a
+                xput = measure(args, policy)
+                if xput > best:
+                    best, current, changed = xput, a, True
+                    print('round {}: type {} {} -> {}: {:.0f} txns/sec'.format(
+                        r, cell[0], sites[cell[1]], a, best))
+            policy[cell] = current
+        if not changed:
+            break
+
+    write_policy(args.out, policy)
+    print('best: {:.0f} txns/sec, policy written to {}'.format(best, args.out))
+
+if __name__ == '__main__':
+    main()
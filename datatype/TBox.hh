@@ -63,6 +63,13 @@ public:
         return *this;
     }
 
+    // Repair instead of aborting if this box's read is stale at commit (see
+    // TransProxy::add_repair). `fn(arg)` reruns the dependent work; it should
+    // read the box with nontrans_read().
+    void add_repair(Transaction::repair_fn fn, void* arg) const {
+        Sto::item(this, 0).add_repair(vers_, fn, arg);
+    }
+
     const T& nontrans_read() const {
         return v_.access();
     }
@@ -171,4 +171,8 @@ public:
         auto rtid = Sto::read_tid();
         return box.v_.find(rtid);
     }
+    template <typename T>
+    static const MvObject<T>& object(const TMvBox<T> &box) {
+        return box.v_;
+    }
 };
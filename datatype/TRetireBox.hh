@@ -0,0 +1,214 @@
+#pragma once
+
+#include <thread>
+
+#include "Sto.hh"
+
+// A 2PL box for hot records whose write lock may be released before commit,
+// after Bamboo.
+//
+// Writes acquire the TLockVersion write lock as usual. Once a transaction is
+// done writing the record it may retire() it: the new value is published in
+// place, the version is stamped with the writer's tid and the retired bit,
+// and the write lock is released. Later readers and writers see the dirty
+// value and record a commit dependency under item key 1; at commit they wait
+// for the retiring writer to resolve, and abort if it aborted (its undo image
+// is restored, which changes the version). Dependency chains are one deep: a
+// record that is still retired cannot be retired again.
+//
+// EarlyRelease is the per-table switch; without it retire() is a no-op and the
+// box is plain 2PL.
+template <typename T, bool EarlyRelease = true>
+class TRetireBox : public TObject {
+public:
+    typedef TLockVersion<false> version_type;
+    typedef TransactionTid::type type;
+
+    static constexpr type retired_bit = TransactionTid::user_bit;
+    static constexpr TransItem::flags_type retired_flag = TransItem::user0_bit;
+
+    TRetireBox()
+        : v_(), undo_(), undo_vers_(0) {
+    }
+    template <typename... Args>
+    explicit TRetireBox(Args&&... args)
+        : v_(std::forward<Args>(args)...), undo_(), undo_vers_(0) {
+    }
+
+    std::pair<bool, T> read_nothrow() const {
+        auto item = Sto::item(this, 0);
+        if (item.has_write())
+            return {true, item.template write_value<T>()};
+        if (!item.observe(vers_))
+            return {false, T()};
+        // observe the retired bit before the value: an aborting retiree
+        // restores the value before clearing the bit
+        depend(vers_.value());
+        acquire_fence();
+        return {true, v_};
+    }
+
+    T read() const {
+        auto result = read_nothrow();
+        if (!result.first)
+            throw Transaction::Abort();
+        return result.second;
+    }
+
+    bool write_nothrow(const T& x) {
+        auto item = Sto::item(this, 0);
+        if (item.has_flag(retired_flag)) {
+            // retire() promises this was the last write
+            Sto::transaction()->mark_abort_because(&item.item(), "write after retire");
+            return false;
+        }
+        if (!item.acquire_write(vers_, x))
+            return false;
+        depend(vers_.value());
+        return true;
+    }
+
+    void write(const T& x) {
+        if (!write_nothrow(x))
+            throw Transaction::Abort();
+    }
+
+    operator T() const {
+        return read();
+    }
+    TRetireBox<T, EarlyRelease>& operator=(const T& x) {
+        write(x);
+        return *this;
+    }
+
+    // Release the write lock early, exposing this transaction's value to
+    // others. Call after the transaction's last write to the record.
+    // Returns true if the record was retired.
+    bool retire() {
+        if (!EarlyRelease)
+            return false;
+        auto item = Sto::item(this, 0);
+        if (!item.has_write() || item.has_flag(retired_flag) || !item.item().needs_unlock())
+            return false;
+        assert(vers_.is_locked());
+        type vv = vers_.value();
+        if (vv & retired_bit)
+            return false;
+        undo_ = v_;
+        undo_vers_ = vv & ~(increment_value - 1);
+        v_ = item.template write_value<T>();
+        type tid = vers_.cp_commit_tid(*Sto::transaction());
+        release_fence();
+        vers_.value() = (tid & ~(increment_value - 1)) | retired_bit;
+        item.add_flags(retired_flag);
+        TXP_INCREMENT(txp_lock_retires);
+        return true;
+    }
+
+    bool is_retired() const {
+        return (vers_.value() & retired_bit) != 0;
+    }
+
+    const T& nontrans_read() const {
+        return v_;
+    }
+    void nontrans_write(const T& x) {
+        v_ = x;
+    }
+
+    // transactional methods
+    bool lock(TransItem& item, Transaction& txn) override {
+        return txn.try_lock(item, vers_);
+    }
+    bool check(TransItem& item, Transaction& txn) override {
+        // our own retire() restamped the version; the lock was held from
+        // the read until then
+        if (item.has_flag(retired_flag))
+            return true;
+        return vers_.cp_check_version(txn, item);
+    }
+    bool check_predicate(TransItem& item, Transaction& txn, bool committing) override {
+        (void)txn;
+        type dep = item.predicate_value<type>();
+        if (committing) {
+            unsigned n = 0;
+            while (retired_as(vers_.value(), dep)) {
+                if (++n > (1 << STO_SPIN_BOUND_WAIT))
+                    return false;
+                std::this_thread::yield();
+            }
+        }
+        type vv = vers_.value();
+        if (!retired_as(vv, dep) && !TransactionTid::check_version(vv, dep)) {
+            TXP_INCREMENT(txp_lock_cascades);
+            return false;
+        }
+        return true;
+    }
+    void install(TransItem& item, Transaction& txn) override {
+        if (item.has_flag(retired_flag)) {
+            // the value is already in place; others may hold the lock now
+            resolve(vers_.value() & ~(increment_value - 1));
+            item.clear_needs_unlock();
+        } else {
+            v_ = item.template write_value<T>();
+            txn.set_version_unlock(vers_, item);
+        }
+    }
+    void unlock(TransItem& item) override {
+        if (item.has_flag(retired_flag)) {
+            v_ = undo_;
+            resolve(undo_vers_);
+        } else {
+            vers_.cp_unlock(item);
+        }
+    }
+    void print(std::ostream& w, const TransItem& item) const override {
+        w << "{TRetireBox<" << typeid(T).name() << "> " << (void*) this;
+        if (item.key<int>() == 1) {
+            w << " D" << item.predicate_value<type>();
+        } else {
+            if (item.has_read())
+                w << " R";
+            if (item.has_write())
+                w << " =" << item.template write_value<T>();
+        }
+        if (item.has_flag(retired_flag))
+            w << " retired";
+        w << "}";
+    }
+
+private:
+    static constexpr type increment_value = TransactionTid::increment_value;
+
+    mutable version_type vers_;
+    T v_;
+    T undo_;
+    type undo_vers_;
+
+    static bool retired_as(type vv, type dep) {
+        return (vv & retired_bit) && TransactionTid::check_version(vv, dep);
+    }
+
+    // Record a commit dependency on the current retiree, if any
+    void depend(type vv) const {
+        if (!(vv & retired_bit))
+            return;
+        auto dep = Sto::item(this, 1);
+        if (!dep.has_predicate())
+            dep.set_predicate(vv & ~(increment_value - 1));
+    }
+
+    // Replace the version's tid, dropping the retired bit, while keeping the
+    // lock state of whoever holds the record now
+    void resolve(type tid) {
+        while (true) {
+            type vv = vers_.value();
+            assert(vv & retired_bit);
+            type nv = tid | (vv & (increment_value - 1) & ~retired_bit);
+            if (::bool_cmpxchg<volatile type>(&vers_.value(), vv, nv))
+                break;
+            relax_fence();
+        }
+    }
+};
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <atomic>
+
+#include "Sto.hh"
+
+// Commutative operations supported while a TSplitBox is split. Each defines
+// apply(dst, x), which folds operand x into dst. Operands are applied to the
+// joined value in commit order, so last_writer is commutative as well.
+namespace split_op {
+
+template <typename T>
+struct add {
+    static void apply(T& dst, const T& x) {
+        dst += x;
+    }
+};
+
+template <typename T>
+struct max {
+    static void apply(T& dst, const T& x) {
+        if (dst < x)
+            dst = x;
+    }
+};
+
+template <typename T>
+struct last_writer {
+    static void apply(T& dst, const T& x) {
+        dst = x;
+    }
+};
+
+}  // namespace split_op
+
+// A box for hot records, after Doppel's phase reconciliation.
+//
+// In the joined phase it behaves like a TBox whose writes are blind
+// commutative updates. Once enough conflicts have been observed on it, the
+// next update splits it: each thread then installs its updates into a
+// private per-thread slice, and updating transactions no longer contend on
+// the record version. A read of a split box reconciles it, merging the slices
+// back into the joined value; split phases also end on their own after
+// split_epochs global epochs.
+//
+// Phase changes happen under the record version lock and bump a phase
+// generation, which every reader records under item key 1 and validates at
+// commit, so a read never serializes across a split phase.
+template <typename T, typename Op = split_op::add<T>, typename W = TNonopaqueWrapped<T>>
+class TSplitBox : public TObject {
+public:
+    typedef typename W::read_type read_type;
+    typedef typename W::version_type version_type;
+    typedef uint64_t gen_type;
+
+    static constexpr TransItem::flags_type split_bit = TransItem::user0_bit;
+    static constexpr unsigned split_threshold = 16;
+    static constexpr Transaction::epoch_type split_epochs = 2;
+
+    TSplitBox()
+        : phase_(joined), gen_(0), conflicts_(0), split_epoch_(0), slices_(nullptr) {
+    }
+    template <typename... Args>
+    explicit TSplitBox(Args&&... args)
+        : v_(std::forward<Args>(args)...),
+          phase_(joined), gen_(0), conflicts_(0), split_epoch_(0), slices_(nullptr) {
+    }
+    ~TSplitBox() {
+        delete[] slices_;
+    }
+
+    read_type read() const {
+        if (is_split())
+            const_cast<TSplitBox<T, Op, W>*>(this)->reconcile();
+        Sto::item(this, 1).add_read(gen_.load());
+        auto item = Sto::item(this, 0);
+        auto result = v_.read(item, vers_);
+        if (!result.first)
+            throw Transaction::Abort();
+        T value = result.second;
+        if (item.has_write())
+            Op::apply(value, item.template write_value<T>());
+        return value;
+    }
+
+    operator read_type() const {
+        return read();
+    }
+
+    void apply(const T& x) {
+        if (is_split()) {
+            auto since = split_epoch_.load(std::memory_order_acquire);
+            if (Transaction::global_epochs.global_epoch.load() - since >= split_epochs)
+                reconcile();
+        } else if (conflicts_.load(std::memory_order_relaxed) >= split_threshold) {
+            split();
+        }
+        auto item = Sto::item(this, 0);
+        if (item.has_write()) {
+            Op::apply(item.template write_value<T>(), x);
+        } else {
+            item.add_write(x);
+        }
+    }
+
+    bool is_split() const {
+        return phase_.load() == split_phase;
+    }
+
+    // Phase changes; apply() and read() trigger these on their own, but they
+    // may also be called directly to pin a known hot record. Never call them
+    // while holding commit-time locks.
+    void split() {
+        vers_.lock_exclusive();
+        if (phase_.load() == joined) {
+            if (!slices_)
+                slices_ = new slice_type[MAX_THREADS];
+            split_epoch_.store(Transaction::global_epochs.global_epoch.load(),
+                               std::memory_order_release);
+            ++gen_;
+            phase_.store(split_phase);
+            TXP_INCREMENT(txp_split_phases);
+        }
+        vers_.unlock_exclusive();
+    }
+
+    void reconcile() {
+        vers_.lock_exclusive();
+        if (phase_.load() == split_phase) {
+            // New commits now take the joined path; wait out any that
+            // already claimed a slice before merging.
+            phase_.store(joined);
+            slice_type* order[MAX_THREADS];
+            int n = 0;
+            for (int i = 0; i != MAX_THREADS; ++i) {
+                slice_type& s = slices_[i];
+                s.vers.lock_exclusive();
+                if (s.dirty) {
+                    int j = n++;
+                    for (; j > 0 && order[j - 1]->tid > s.tid; --j)
+                        order[j] = order[j - 1];
+                    order[j] = &s;
+                }
+            }
+            for (int i = 0; i != n; ++i) {
+                Op::apply(v_.access(), order[i]->value);
+                order[i]->dirty = false;
+            }
+            for (int i = 0; i != MAX_THREADS; ++i)
+                slices_[i].vers.unlock_exclusive();
+            ++gen_;
+            conflicts_.store(0, std::memory_order_relaxed);
+            TXP_INCREMENT(txp_split_reconciles);
+        }
+        vers_.unlock_exclusive();
+    }
+
+    // Not thread safe with respect to concurrent updates
+    T nontrans_read() const {
+        T value = v_.access();
+        if (slices_) {
+            const slice_type* order[MAX_THREADS];
+            int n = 0;
+            for (int i = 0; i != MAX_THREADS; ++i) {
+                const slice_type& s = slices_[i];
+                if (s.dirty) {
+                    int j = n++;
+                    for (; j > 0 && order[j - 1]->tid > s.tid; --j)
+                        order[j] = order[j - 1];
+                    order[j] = &s;
+                }
+            }
+            for (int i = 0; i != n; ++i)
+                Op::apply(value, order[i]->value);
+        }
+        return value;
+    }
+    void nontrans_write(const T& x) {
+        if (slices_) {
+            for (int i = 0; i != MAX_THREADS; ++i)
+                slices_[i].dirty = false;
+        }
+        phase_.store(joined);
+        v_.access() = x;
+    }
+
+    // transactional methods
+    bool lock(TransItem& item, Transaction& txn) override {
+        if (phase_.load() == split_phase) {
+            slice_type& s = slices_[TThread::id()];
+            if (!txn.try_lock(item, s.vers))
+                return false;
+            // reconcile() publishes the joined phase before taking the slice
+            // locks, so either it waits for this commit or we see it here
+            if (phase_.load() == split_phase) {
+                item.add_flags(split_bit);
+                return true;
+            }
+            s.vers.cp_unlock(item);
+        }
+        if (!txn.try_lock(item, vers_)) {
+            conflicts_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // phase changes need vers_, so this is stable until we unlock; a
+        // failed lock() is not unlocked by the commit protocol
+        if (phase_.load() != joined) {
+            vers_.cp_unlock(item);
+            return false;
+        }
+        return true;
+    }
+    bool check(TransItem& item, Transaction& txn) override {
+        bool ok;
+        if (item.key<int>() == 1)
+            ok = phase_.load() == joined && gen_.load() == item.read_value<gen_type>();
+        else
+            ok = vers_.cp_check_version(txn, item);
+        if (!ok)
+            conflicts_.fetch_add(1, std::memory_order_relaxed);
+        return ok;
+    }
+    void install(TransItem& item, Transaction& txn) override {
+        const T& x = item.template write_value<T>();
+        if (item.has_flag(split_bit)) {
+            slice_type& s = slices_[TThread::id()];
+            if (s.dirty) {
+                Op::apply(s.value, x);
+            } else {
+                s.value = x;
+                s.dirty = true;
+            }
+            s.tid = txn.commit_tid();
+            txn.set_version_unlock(s.vers, item);
+            TXP_INCREMENT(txp_split_updates);
+        } else {
+            Op::apply(v_.access(), x);
+            txn.set_version_unlock(vers_, item);
+        }
+    }
+    void unlock(TransItem& item) override {
+        if (item.has_flag(split_bit))
+            slices_[TThread::id()].vers.cp_unlock(item);
+        else
+            vers_.cp_unlock(item);
+    }
+    void print(std::ostream& w, const TransItem& item) const override {
+        w << "{TSplitBox<" << typeid(T).name() << "> " << (void*) this;
+        if (item.key<int>() == 1) {
+            w << " G";
+            if (item.has_read())
+                w << " R" << item.read_value<gen_type>();
+        } else {
+            if (item.has_read())
+                w << " R" << item.read_value<version_type>();
+            if (item.has_write())
+                w << " op" << item.write_value<T>();
+        }
+        if (item.has_flag(split_bit))
+            w << " split";
+        w << "}";
+    }
+
+private:
+    enum phase_type : int { joined = 0, split_phase };
+
+    struct alignas(64) slice_type {
+        version_type vers;
+        T value;
+        TransactionTid::type tid;
+        bool dirty;
+
+        slice_type()
+            : vers(), value(), tid(0), dirty(false) {
+        }
+    };
+
+    version_type vers_;
+    W v_;
+    std::atomic<int> phase_;
+    std::atomic<gen_type> gen_;
+    std::atomic<unsigned> conflicts_;
+    std::atomic<Transaction::epoch_type> split_epoch_;
+    slice_type* slices_;
+};
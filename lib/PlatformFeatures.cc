@@ -122,3 +122,127 @@ void set_affinity(int runner_id) {
     }
 #endif
 }
+
+bool parse_numa_mode(const std::string& s, numa_mode& mode) {
+    if (s == "legacy")
+        mode = numa_mode::legacy;
+    else if (s == "local")
+        mode = numa_mode::local;
+    else if (s == "interleave")
+        mode = numa_mode::interleave;
+    else
+        return false;
+    return true;
+}
+
+const char* numa_mode_name(numa_mode mode) {
+    switch (mode) {
+    case numa_mode::local:
+        return "local";
+    case numa_mode::interleave:
+        return "interleave";
+    default:
+        return "legacy";
+    }
+}
+
+int numa_router::partition_node(int part) const {
+    int nodes = std::max(topo_info.num_nodes, 1);
+    switch (mode_) {
+    case numa_mode::local:
+        // contiguous blocks, over at most one node per partition
+        nodes = std::min(nodes, nparts_);
+        return (part - 1) * nodes / nparts_;
+    case numa_mode::interleave:
+        return -1;
+    default:
+        return (part - 1) % nodes;
+    }
+}
+
+void numa_router::bind_loader(int part) const {
+    if (mode_ == numa_mode::legacy) {
+        set_affinity(part - 1);
+        return;
+    }
+    int node = partition_node(part);
+    if (node < 0) {
+        set_affinity(part - 1);
+        numa_set_interleave_mask(numa_all_nodes_ptr);
+    } else {
+        auto& cpus = topo_info.cpu_id_list[node];
+        route r = {cpus[(part - 1) % cpus.size()], part, part, 0};
+        bind(part - 1, r);
+        // the partition's rows and index nodes come from its node even if
+        // the allocator hands out memory another thread first touched
+        numa_set_preferred(node);
+    }
+}
+
+void numa_router::unbind_loader() const {
+    if (mode_ != numa_mode::legacy)
+        numa_set_localalloc();
+}
+
+void numa_router::assign(std::vector<route>& routes, int rbegin, int rend,
+                         int pbegin, int pend, const std::vector<int>* cpus) {
+    int nrunners = rend - rbegin, nparts = pend - pbegin + 1;
+    int q = nparts / nrunners, r = nparts % nrunners;
+    if (q == 0) {
+        // several runners per partition; the first one owns it
+        q = (nrunners + nparts - 1) / nparts;
+        for (int i = 0; i < nrunners; ++i) {
+            int part = pbegin + i / q;
+            int cpu = cpus ? (*cpus)[i % cpus->size()] : -1;
+            routes.push_back({cpu, part, part, i % q ? 0 : part});
+        }
+    } else {
+        int next = pbegin;
+        for (int i = 0; i < nrunners; ++i) {
+            int end = next + q - 1 + (i < r);
+            int cpu = cpus ? (*cpus)[i % cpus->size()] : -1;
+            routes.push_back({cpu, next, end, next});
+            next = end + 1;
+        }
+    }
+}
+
+std::vector<numa_router::route> numa_router::routes(int nrunners) const {
+    std::vector<route> routes;
+    int nodes = std::min(std::max(topo_info.num_nodes, 1), nparts_);
+    if (mode_ != numa_mode::local || nrunners < nodes) {
+        assign(routes, 0, nrunners, 1, nparts_, nullptr);
+        if (mode_ == numa_mode::legacy) {
+            // runner i owns warehouse i + 1, as it always has
+            for (int i = 0; i < nrunners; ++i)
+                routes[i].owned = i < nparts_ ? i + 1 : 0;
+        }
+        return routes;
+    }
+    // each node's runners serve that node's partitions
+    for (int n = 0; n < nodes; ++n) {
+        int rbegin = n * nrunners / nodes, rend = (n + 1) * nrunners / nodes;
+        int pbegin = n * nparts_ / nodes + 1, pend = (n + 1) * nparts_ / nodes;
+        assign(routes, rbegin, rend, pbegin, pend, &topo_info.cpu_id_list[n]);
+    }
+    return routes;
+}
+
+void numa_router::bind(int runner_id, const route& r) {
+    if (r.cpu < 0) {
+        set_affinity(runner_id);
+        return;
+    }
+#if defined(__APPLE__)
+    (void)runner_id;
+#else
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(r.cpu, &cpuset);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (rc != 0) {
+        std::cerr << "Error calling pthread_setaffinity_np: " << rc << "\n";
+        abort();
+    }
+#endif
+}
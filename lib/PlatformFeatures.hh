@@ -10,6 +10,8 @@
 #include <cctype>
 #include <cstring>
 
+#include <algorithm>
+
 #include <string>
 #include <iostream>
 #include <iomanip>
@@ -164,3 +166,51 @@ struct TopologyInfo {
 };
 
 extern TopologyInfo topo_info;
+
+// NUMA placement of a partitioned database (e.g. TPC-C warehouses 1..n).
+//   legacy:     partition p is loaded on node (p-1) % nodes, and runners are
+//               spread over nodes regardless of their partitions
+//   local:      partitions are split into contiguous blocks, one per node;
+//               each loader binds its allocations to its partition's node,
+//               and runners run on the node of the partitions they serve
+//   interleave: pages of every partition are interleaved over all nodes
+enum class numa_mode : int { legacy = 0, local, interleave };
+
+extern bool parse_numa_mode(const std::string& s, numa_mode& mode);
+extern const char* numa_mode_name(numa_mode mode);
+
+class numa_router {
+public:
+    // A runner thread's CPU and partitions
+    struct route {
+        int cpu;            // -1: set_affinity(runner id)
+        int part_begin;     // partitions served, inclusive
+        int part_end;
+        int owned;          // partition this runner owns, or 0
+    };
+
+    explicit numa_router(int nparts, numa_mode mode = numa_mode::legacy)
+        : nparts_(nparts), mode_(mode) {}
+
+    numa_mode mode() const {
+        return mode_;
+    }
+    // Node holding partition `part`, or -1 if interleaved
+    int partition_node(int part) const;
+
+    // Pin the calling thread and set its memory policy to load `part`
+    void bind_loader(int part) const;
+    // Undo bind_loader's memory policy
+    void unbind_loader() const;
+
+    std::vector<route> routes(int nrunners) const;
+    static void bind(int runner_id, const route& r);
+
+private:
+    int nparts_;
+    numa_mode mode_;
+
+    // Runners [rbegin, rend) serving partitions [pbegin, pend]
+    static void assign(std::vector<route>& routes, int rbegin, int rend,
+                       int pbegin, int pend, const std::vector<int>* cpus);
+};
@@ -9,6 +9,7 @@
 # setup_tpcc_gc: TPC-C, 1 and scaling warehouses, gc cycle of 1ms, 100ms, 10s (off)
 # setup_tpcc_mvcc: TPC-C, 1, 4, and scaling warehouses, MVCC only
 # setup_tpcc_occ: TPC-C, 1, 4, and scaling warehouses, OCC only
+# setup_tpcc_commute: TPC-C, tpcc_d vs tpcc_dc (commutators with escrow bounds)
 # setup_tpcc_opacity: TPC-C with opacity, 1, 4, and scaling warehouses
 # setup_tpcc_safe_flatten: TPC-C with safer flattening MVCC, 1, 4, and scaling warehouses
 # setup_tpcc_scaled: TPC-C, #warehouses = #threads
@@ -24,7 +25,9 @@
 # setup_tpcc_idx_cont: TPC-C index contention.
 # setup_wiki: Wikipedia
 # setup_ycsba: YCSB-A
+# setup_ycsba_hot: YCSB-A, OCC with hot-key increments, split vs unsplit counters
 # setup_ycsba_occ: YCSB-A, OCC only
+# setup_ycsb_anticache: YCSB-A/B, OCC over an anti-caching table 4x the memory budget
 # setup_ycsba_tictoc: YCSB-A, TicToc
 # setup_ycsba_mvcc: YCSB-A, OCC only
 # setup_ycsba_semopts: YCSB-A semantic optimizations comparison
@@ -514,6 +517,43 @@ setup_tpcc_occ() {
   }
 }
 
+setup_tpcc_commute() {
+  EXPERIMENT_NAME="TPC-C OCC vs commutative updates"
+
+  # -idefault runs tpcc_d, -idefault -x runs tpcc_dc. PROFILE_COUNTERS=2
+  # reports the commutative updates the escrow bounds aborted on stderr.
+  TPCC_OCC=(
+    "OCC (W1)"         "-idefault -g -w1"
+    "OCC + CU (W1)"    "-idefault -g -x -w1"
+    "OCC (W4)"         "-idefault -g -w4"
+    "OCC + CU (W4)"    "-idefault -g -x -w4"
+  )
+
+  TPCC_MVCC=(
+  )
+
+  TPCC_OCC_BINARIES=(
+  )
+  TPCC_MVCC_BINARIES=(
+  )
+  TPCC_BOTH_BINARIES=(
+    "tpcc_bench" "-commute" "NDEBUG=1 PROFILE_COUNTERS=2" ""
+  )
+
+  OCC_LABELS=("${TPCC_OCC[@]}")
+  MVCC_LABELS=()
+  OCC_BINARIES=("${TPCC_BOTH_BINARIES[@]}")
+  MVCC_BINARIES=()
+
+  call_runs() {
+    default_call_runs
+  }
+
+  update_cmd() {
+    :
+  }
+}
+
 setup_tpcc_opacity() {
   EXPERIMENT_NAME="TPC-C with Opacity"
 
@@ -1348,6 +1388,72 @@ setup_ycsba() {
   }
 }
 
+setup_ycsb_anticache() {
+  EXPERIMENT_NAME="YCSB-A/B, anti-caching, table 4x the memory budget"
+  TIMEOUT=120
+
+  # Three quarters of the rows live in the cold file; compare fetching in
+  # the transaction with aborting and prefetching.
+  YCSB_OCC=(
+    "OCC (A) anticache"             "-mA -idefault --anticache=4"
+    "OCC (A) anticache + prefetch"  "-mA -idefault --anticache=4 --prefetch"
+    "OCC (B) anticache"             "-mB -idefault --anticache=4"
+    "OCC (B) anticache + prefetch"  "-mB -idefault --anticache=4 --prefetch"
+  )
+
+  YCSB_MVCC=(
+  )
+
+  YCSB_OCC_BINARIES=(
+    "ycsb_bench" "-anticache" "NDEBUG=1" ""
+  )
+  YCSB_MVCC_BINARIES=(
+  )
+
+  OCC_LABELS=("${YCSB_OCC[@]}")
+  MVCC_LABELS=()
+  OCC_BINARIES=("${YCSB_OCC_BINARIES[@]}")
+  MVCC_BINARIES=()
+
+  call_runs() {
+    default_call_runs
+  }
+}
+
+setup_ycsba_hot() {
+  EXPERIMENT_NAME="YCSB-A, hot-key increments, split vs unsplit"
+  TIMEOUT=60
+
+  # Writes to the 16 hottest keys are counter increments. PROFILE_COUNTERS=2
+  # reports split phases, reconciles and slice updates on stderr.
+  YCSB_OCC=(
+    "OCC (A) hot"          "-mA -idefault -g -k16 --no-hot-split"
+    "OCC (A) hot + split"  "-mA -idefault -g -k16 --hot-split"
+  )
+
+  YCSB_MVCC=(
+  )
+
+  YCSB_OCC_BINARIES=(
+    "ycsb_bench" "-hot" "NDEBUG=1 PROFILE_COUNTERS=2" ""
+  )
+  YCSB_MVCC_BINARIES=(
+  )
+
+  OCC_LABELS=("${YCSB_OCC[@]}")
+  MVCC_LABELS=()
+  OCC_BINARIES=("${YCSB_OCC_BINARIES[@]}")
+  MVCC_BINARIES=()
+
+  call_runs() {
+    default_call_runs
+  }
+
+  update_cmd() {
+    ``  # noop
+  }
+}
+
 setup_ycsba_occ() {
   EXPERIMENT_NAME="YCSB-A, OCC only"
   TIMEOUT=60
@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <cstring>
+
+#include "CCPolicy.hh"
+
+__thread int CCPolicy::current_type;
+CCAction CCPolicy::table[max_txn_types][max_sites];
+
+static const char* const action_names[] = { "none", "opt", "lock" };
+
+void CCPolicy::clear() {
+    for (auto& row : table)
+        for (auto& a : row)
+            a = CCAction::none;
+}
+
+bool CCPolicy::load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f)
+        return false;
+
+    CCAction next[max_txn_types][max_sites] = {};
+    char line[256];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        if (char* c = strchr(line, '#'))
+            *c = '\0';
+        int txn_type, site;
+        char name[16];
+        int n = sscanf(line, "%d %d %15s", &txn_type, &site, name);
+        if (n <= 0)
+            continue;
+        ok = false;
+        if (n == 3 && valid(txn_type, site)) {
+            for (int i = 0; i != 3; ++i)
+                if (strcmp(name, action_names[i]) == 0) {
+                    next[txn_type][site] = static_cast<CCAction>(i);
+                    ok = true;
+                }
+        }
+        if (!ok)
+            fprintf(stderr, "%s: bad policy entry: %s", path, line);
+    }
+    fclose(f);
+
+    if (ok)
+        memcpy(table, next, sizeof(table));
+    return ok;
+}
+
+bool CCPolicy::save(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f)
+        return false;
+    for (int t = 0; t != max_txn_types; ++t)
+        for (int s = 0; s != max_sites; ++s)
+            if (table[t][s] != CCAction::none)
+                fprintf(f, "%d %d %s\n", t, s, action_names[static_cast<int>(table[t][s])]);
+    return fclose(f) == 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Transaction.hh"
+#include "TransItem.hh"
+
+// Runtime concurrency-control policy, after Polyjuice.
+//
+// A policy maps each (transaction type, access site) pair to an action that
+// is applied to an access's TransItem before its first observe. Transaction
+// types and sites are small integers chosen by the application; a benchmark
+// typically uses one site per table. Actions take effect on versions that
+// honor TransItem::cc_mode: TLockVersion (2pl and adaptive dbids), and, for
+// locked reads only, TVersion and TNonopaqueVersion (OCC dbids), which then
+// lock the record at access. Indexes call apply<V>(), which leaves items
+// observing any other version type alone: TicToc versions, for one, claim
+// the item's mode for their timestamps.
+//
+// apply() is also where starvation control takes effect: during a fallback
+// attempt (see ContentionManager::fallback_aborts), items that caused the
+// transaction's earlier aborts are read locked regardless of policy. That
+// too only reaches versions that honor cc_mode.
+enum class CCAction : uint8_t {
+    none = 0,   // let the version decide
+    optimistic, // read without locking, validate at commit
+    locked      // take a read lock
+};
+
+class CCPolicy {
+public:
+    static constexpr int max_txn_types = 16;
+    static constexpr int max_sites = 64;
+
+    static CCAction get(int txn_type, int site) {
+        if (!valid(txn_type, site))
+            return CCAction::none;
+        return table[txn_type][site];
+    }
+    static void set(int txn_type, int site, CCAction action) {
+        if (valid(txn_type, site))
+            table[txn_type][site] = action;
+    }
+    static void clear();
+
+    // Policy files hold one "<txn type> <site> <action>" entry per line,
+    // where action is one of "none", "opt" or "lock". '#' starts a comment.
+    // Returns false, leaving the policy unchanged, on a missing file or a
+    // malformed entry.
+    static bool load(const char* path);
+    static bool save(const char* path);
+
+    // Sets the calling thread's current transaction type
+    static void begin(int txn_type) {
+        current_type = txn_type;
+    }
+
+    static void apply(TransItem& item, int site) {
+        if (item.cc_mode() != CCMode::none)
+            return;
+        if (TThread::txn->fallback() && TThread::txn->is_hot(item)) {
+            item.cc_mode(CCMode::lock);
+            return;
+        }
+        if (site < 0)
+            return;
+        switch (get(current_type, site)) {
+        case CCAction::optimistic:
+            item.cc_mode(CCMode::opt);
+            break;
+        case CCAction::locked:
+            item.cc_mode(CCMode::lock);
+            break;
+        default:
+            break;
+        }
+    }
+    // apply() for an item about to observe a version of type V; a no-op
+    // unless V honors cc_mode
+    template <typename V>
+    static void apply(TransItem& item, int site) {
+        if (V::honors_cc_mode)
+            apply(item, site);
+    }
+
+private:
+    static bool valid(int txn_type, int site) {
+        return txn_type >= 0 && txn_type < max_txn_types
+            && site >= 0 && site < max_sites;
+    }
+
+    static __thread int current_type;
+    static CCAction table[max_txn_types][max_sites];
+};
@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include <limits>
+#include <type_traits>
+
 #include "MVCCTypes.hh"
 
 namespace commutators {
@@ -28,6 +31,10 @@ class Commutator<int64_t> {
 public:
     Commutator() = default;
     explicit Commutator(int64_t delta) : delta(delta) {}
+    // Escrow-style decrement: the committing transaction aborts if the result
+    // would drop below lower_bound
+    explicit Commutator(int64_t delta, int64_t lower_bound)
+        : delta(delta), lower_bound(lower_bound) {}
 
     virtual bool is_blind_write() const {
         return false;
@@ -37,8 +44,42 @@ public:
         v += delta;
     }
 
+    bool escrow_check(const int64_t& v) const {
+        return delta >= 0 || v >= lower_bound - delta;
+    }
+
 private:
     int64_t delta;
+    int64_t lower_bound = std::numeric_limits<int64_t>::min();
 };
 
+//////////////////////////////////////////////
+//
+// Escrow (bounds) checking
+//
+//////////////////////////////////////////////
+
+// A commutator may define `bool escrow_check(const T&) const`, which is
+// evaluated against the current value while the record is locked at commit
+// time; if it returns false the transaction aborts instead of installing the
+// update. Commutators without one are always applicable.
+template <typename C, typename T, typename = void>
+struct has_escrow_check : std::false_type {};
+
+template <typename C, typename T>
+struct has_escrow_check<C, T, std::void_t<
+        decltype(std::declval<const C&>().escrow_check(std::declval<const T&>()))>>
+    : std::true_type {};
+
+template <typename T>
+inline bool escrow_check(const Commutator<T>& comm, const T& value) {
+    if constexpr (has_escrow_check<Commutator<T>, T>::value) {
+        return comm.escrow_check(value);
+    } else {
+        (void)comm;
+        (void)value;
+        return true;
+    }
+}
+
 }
@@ -8,10 +8,12 @@
 #include "TicTocVersions.hh"
 
 class VersionDelegate {
+    template <typename VersImpl>
+    friend class BasicVersion;
     friend class TVersion;
     friend class TNonopaqueVersion;
     friend class TCommutativeVersion;
-    template <bool Adaptive>
+    template <bool Adaptive, bool ReaderBias>
     friend class TLockVersion;
     template <bool Opaque>
     friend class TSwissVersion;
@@ -149,10 +151,35 @@ inline bool BasicVersion<VersImpl>::acquire_write_impl(TransItem& item, Args&&..
     return true;
 }
 
+// Read-locks an item that was marked CCMode::lock (by a CC policy or by
+// starvation control) at its first read. The lock is exclusive and held until
+// the transaction ends; since the item needs unlocking, the commit protocol
+// neither relocks nor, unless it was also written, checks it. Returns false if
+// the lock could not be had within the spin bound; the caller then reads
+// optimistically.
+template <typename VersImpl>
+inline bool BasicVersion<VersImpl>::observe_read_locked(TransItem& item) {
+    int here = TThread::id();
+    unsigned n = 0;
+    while (!TransactionTid::try_lock(v_, here)) {
+        if (++n >= (1 << STO_SPIN_BOUND_WRITE))
+            return false;
+        relax_fence();
+    }
+    acquire_fence();
+    VersionDelegate::item_or_flags(item, TransItem::lock_bit | TransItem::read_bit);
+    VersionDelegate::item_access_rdata(item).v = Packer<VersImpl>::pack(t().buf_, VersImpl(v_));
+    TXP_INCREMENT(txp_fallback_locks);
+    return true;
+}
+
 // STO opaque optimistic concurrency control
 
 inline bool TVersion::observe_read_impl(TransItem &item, bool add_read){
     assert(!item.has_stash());
+    if (item.cc_mode() == CCMode::lock && add_read && !item.has_read()
+        && !item.needs_unlock() && observe_read_locked(item))
+        return t().check_opacity(item, value());
     TVersion version = *this;
     fence();
 
@@ -168,6 +195,7 @@ inline bool TVersion::observe_read_impl(TransItem &item, bool add_read){
         VersionDelegate::item_access_rdata(item).v = Packer<TVersion>::pack(t().buf_, std::move(version));
         //item().__or_flags(TransItem::read_bit);
         //item().rdata_ = Packer<TVersion>::pack(t()->buf_, std::move(version));
+        return t().count_read();
     }
 
     return true;
@@ -177,6 +205,11 @@ inline bool TVersion::observe_read_impl(TransItem &item, bool add_read){
 
 inline bool TNonopaqueVersion::observe_read_impl(TransItem& item, bool add_read) {
     assert(!item.has_stash());
+    if (item.cc_mode() == CCMode::lock && add_read && !item.has_read()
+        && !item.needs_unlock() && observe_read_locked(item)) {
+        VersionDelegate::txn_set_any_nonopaque(t(), true);
+        return true;
+    }
     TNonopaqueVersion version = *this;
     fence();
     if (version.is_locked()) {
@@ -191,6 +224,7 @@ inline bool TNonopaqueVersion::observe_read_impl(TransItem& item, bool add_read)
         //item().__or_flags(TransItem::read_bit);
         //item().rdata_ = Packer<TNonopaqueVersion>::pack(t()->buf_, std::move(version));
         //t()->any_nonopaque_ = true;
+        return t().count_read();
     }
     return true;
 }
@@ -198,8 +232,48 @@ inline bool TNonopaqueVersion::observe_read_impl(TransItem& item, bool add_read)
 
 // Adaptive Reader/Writer lock concurrency control
 
-template <bool Adaptive>
-inline bool TLockVersion<Adaptive>::try_upgrade_with_spin() {
+// Called by a new write-lock owner that cleared the reader bias: waits for
+// biased readers to drain. Like waiting on counted readers, this is bounded.
+template <bool Adaptive, bool ReaderBias>
+inline bool TLockVersion<Adaptive, ReaderBias>::revoke_bias() {
+    TXP_INCREMENT(txp_lock_bias_revokes);
+    int me = TThread::id();
+    uint64_t n = 0;
+    for (int i = 0; i != MAX_THREADS; ++i) {
+        if (i == me)
+            continue;
+        while (TLockReaders::slot(i, this) == this) {
+            if (++n >= (1 << STO_SPIN_BOUND_WRITE))
+                return false;
+            relax_fence();
+        }
+    }
+    return true;
+}
+
+// One step of waiting for a conflicting lock holder; returns false once the
+// caller should give up and abort. Readers are anonymous, so waiting on them
+// is always bounded; waiting on a writer follows ContentionManager::lock_policy.
+template <bool Adaptive, bool ReaderBias>
+inline bool TLockVersion<Adaptive, ReaderBias>::wait_for_lock(uint64_t& n) {
+    type vv = v_;
+    if (ContentionManager::lock_policy == LockPolicy::spin || !(vv & lock_bit)) {
+        ++n;
+        if (n >= ContentionManager::spin_bound(TThread::id()))
+            return false;
+        relax_fence();
+        return true;
+    }
+    if (!ContentionManager::should_wait(TThread::id(), vv & mask))
+        return false;
+    TXP_INCREMENT(txp_lock_waits);
+    // Waits are unbounded here; back off rather than hammer the lock word
+    ContentionManager::on_lock_wait(TThread::id(), n++);
+    return true;
+}
+
+template <bool Adaptive, bool ReaderBias>
+inline bool TLockVersion<Adaptive, ReaderBias>::try_upgrade_with_spin() {
     uint64_t n = 0;
     while (true) {
         if (try_upgrade() == LockResponse::locked)
@@ -211,40 +285,36 @@ inline bool TLockVersion<Adaptive>::try_upgrade_with_spin() {
     }
 }
 
-template <bool Adaptive>
-inline bool TLockVersion<Adaptive>::try_lock_write_with_spin() {
+template <bool Adaptive, bool ReaderBias>
+inline bool TLockVersion<Adaptive, ReaderBias>::try_lock_write_with_spin() {
     uint64_t n = 0;
     while (true) {
         auto r = try_lock_write();
         if (r == LockResponse::locked)
             return true;
-        else if (r == LockResponse::spin)
-            ++n;
-        else
+        else if (r != LockResponse::spin)
             return false;
-        if (n == (1 << STO_SPIN_BOUND_WRITE))
+        if (!wait_for_lock(n))
             return false;
-        relax_fence();
     }
 }
 
-template <bool Adaptive>
-inline std::pair<LockResponse, typename TLockVersion<Adaptive>::type>
-TLockVersion<Adaptive>::try_lock_read_with_spin() {
+template <bool Adaptive, bool ReaderBias>
+inline std::pair<LockResponse, typename TLockVersion<Adaptive, ReaderBias>::type>
+TLockVersion<Adaptive, ReaderBias>::try_lock_read_with_spin() {
     uint64_t n = 0;
     while (true) {
         auto r = try_lock_read();
         if (r.first != LockResponse::spin) {
             return r;
         }
-        ++n;
-        if (n == (1 << STO_SPIN_BOUND_WRITE))
+        if (!wait_for_lock(n))
             return {LockResponse::failed, type()};
     }
 }
 
-template <bool Adaptive>
-inline bool TLockVersion<Adaptive>::lock_for_write(TransItem& item) {
+template <bool Adaptive, bool ReaderBias>
+inline bool TLockVersion<Adaptive, ReaderBias>::lock_for_write(TransItem& item) {
     if (item.has_read() && item.needs_unlock()) {
         // already holding read lock; upgrade to write lock
         if (!try_upgrade_with_spin()) {
@@ -263,8 +333,8 @@ inline bool TLockVersion<Adaptive>::lock_for_write(TransItem& item) {
     // write lock is held on the corresponding TVersion
 }
 
-template <bool Adaptive>
-inline bool TLockVersion<Adaptive>::acquire_write_impl(TransItem& item) {
+template <bool Adaptive, bool ReaderBias>
+inline bool TLockVersion<Adaptive, ReaderBias>::acquire_write_impl(TransItem& item) {
     if (!item.has_write()) {
         if (!lock_for_write(item)) {
             TXP_INCREMENT(txp_lock_aborts);
@@ -276,19 +346,19 @@ inline bool TLockVersion<Adaptive>::acquire_write_impl(TransItem& item) {
     return true;
 }
 
-template <bool Adaptive> template <typename T>
-inline bool TLockVersion<Adaptive>::acquire_write_impl(TransItem& item, const T& wdata) {
+template <bool Adaptive, bool ReaderBias> template <typename T>
+inline bool TLockVersion<Adaptive, ReaderBias>::acquire_write_impl(TransItem& item, const T& wdata) {
     return acquire_write_impl<T, const T&>(item, wdata);
 }
 
-template <bool Adaptive> template <typename T>
-inline bool TLockVersion<Adaptive>::acquire_write_impl(TransItem& item, T&& wdata) {
+template <bool Adaptive, bool ReaderBias> template <typename T>
+inline bool TLockVersion<Adaptive, ReaderBias>::acquire_write_impl(TransItem& item, T&& wdata) {
     typedef typename std::decay<T>::type V;
     return acquire_write_impl<V, V&&>(item, std::move(wdata));
 }
 
-template <bool Adaptive> template <typename T, typename... Args>
-inline bool TLockVersion<Adaptive>::acquire_write_impl(TransItem& item, Args&&... args) {
+template <bool Adaptive, bool ReaderBias> template <typename T, typename... Args>
+inline bool TLockVersion<Adaptive, ReaderBias>::acquire_write_impl(TransItem& item, Args&&... args) {
     if (!item.has_write()) {
         if (!lock_for_write(item)) {
             TXP_INCREMENT(txp_lock_aborts);
@@ -304,8 +374,8 @@ inline bool TLockVersion<Adaptive>::acquire_write_impl(TransItem& item, Args&&..
     return true;
 }
 
-template <bool Adaptive>
-inline bool TLockVersion<Adaptive>::observe_read_impl(TransItem& item, bool add_read) {
+template <bool Adaptive, bool ReaderBias>
+inline bool TLockVersion<Adaptive, ReaderBias>::observe_read_impl(TransItem& item, bool add_read) {
     assert(!item.has_stash());
 
     TLockVersion occ_version;
@@ -333,6 +403,9 @@ inline bool TLockVersion<Adaptive>::observe_read_impl(TransItem& item, bool add_
         } else if (response.first == LockResponse::locked) {
             VersionDelegate::item_or_flags(item, TransItem::lock_bit);
             VersionDelegate::item_or_flags(item, TransItem::read_bit);
+            // Stable while the read lock is held; validated if the read is
+            // later upgraded, since upgraded items are checked at commit
+            VersionDelegate::item_access_rdata(item).v = Packer<TLockVersion>::pack(t().buf_, TLockVersion(BV::value()));
             // XXX hack to prevent the commit protocol from skipping unlocks
             VersionDelegate::txn_set_any_nonopaque(t(), true);
         } else {
@@ -583,7 +656,7 @@ inline bool TicTocCompressedVersion<Opaque, Extend>::acquire_write_impl(TransIte
 template <bool Opaque, bool Extend> template <typename T>
 inline bool TicTocCompressedVersion<Opaque, Extend>::acquire_write_impl(TransItem& item, T&& wdata) {
     typedef typename std::decay<T>::type V;
-    return acquire_write_impl<V, V&&>(item, wdata);
+    return acquire_write_impl<V, V&&>(item, std::move(wdata));
 }
 
 template <bool Opaque, bool Extend> template <typename T, typename... Args>
@@ -689,13 +762,13 @@ TCommutativeVersion::type TCommutativeVersion::cp_commit_tid_impl(Transaction &t
     always_assert(false, "not implemented");
 }
 
-template <bool Adaptive>
-typename TLockVersion<Adaptive>::type& TLockVersion<Adaptive>::cp_access_tid_impl(Transaction &txn) {
+template <bool Adaptive, bool ReaderBias>
+typename TLockVersion<Adaptive, ReaderBias>::type& TLockVersion<Adaptive, ReaderBias>::cp_access_tid_impl(Transaction &txn) {
     return VersionDelegate::standard_tid(txn);
 }
 
-template <bool Adaptive>
-typename TLockVersion<Adaptive>::type TLockVersion<Adaptive>::cp_commit_tid_impl(Transaction &txn) {
+template <bool Adaptive, bool ReaderBias>
+typename TLockVersion<Adaptive, ReaderBias>::type TLockVersion<Adaptive, ReaderBias>::cp_commit_tid_impl(Transaction &txn) {
     auto tid = cp_access_tid_impl(txn);
     if (tid != 0)
         return tid;
@@ -785,7 +858,7 @@ inline bool Transaction::try_lock(TransItem& item, VersionBase<VersImpl>& vers)
                 for (unsigned x = 1 << std::min(15U, n - 2); x; --x)
                     relax_fence();
 # else
-        if (item.has_read() || n == (1 << STO_SPIN_BOUND_WRITE)) {
+        if (item.has_read() || n == ContentionManager::spin_bound(threadid_)) {
 #  if STO_DEBUG_ABORTS
             abort_version_ = vers.value();
 #  endif
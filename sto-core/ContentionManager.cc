@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <random>
+#include <thread>
 
 #include "ContentionManager.hh"
 #include "Transaction.hh"
@@ -22,6 +24,19 @@ bool ContentionManager::should_abort(int this_id, int owner_id) {
         return true;
     }
 
+    int urgency = compare_priority(this_id, owner_id);
+    if (urgency > 0) {
+        if (cm_info[owner_id].aborted == 0) {
+            cm_info[owner_id].aborted = 1;
+            release_fence();
+            TXP_INCREMENT(txp_priority_wounds);
+        }
+        return false;
+    } else if (urgency < 0) {
+        TXP_INCREMENT(txp_priority_yields);
+        return true;
+    }
+
     // This transaction is still in the timid phase
     acquire_fence();
     if (cm_info[this_id].timestamp == MAX_TS) {
@@ -59,7 +74,7 @@ void ContentionManager::start(Transaction *tx) {
     TXP_INCREMENT(txp_cm_start);
     int threadid = tx->threadid();
     if (tx->is_restarted()) {
-        // Do not reset abort count
+        // Do not reset abort count or start timestamp
         cm_info[threadid].timestamp = MAX_TS;
         cm_info[threadid].aborted = 0;
         cm_info[threadid].write_set_size = 0;
@@ -72,6 +87,48 @@ void ContentionManager::start(Transaction *tx) {
     }
 }
 
+void ContentionManager::start_locking(int threadid, bool restarted) {
+    if (!restarted)
+        cm_info[threadid].start_ts = fetch_and_add(&ts, uint64_t(1));
+    cm_info[threadid].aborted = 0;
+    release_fence();
+}
+
+bool ContentionManager::should_wait(int this_id, int owner_id) {
+    acquire_fence();
+    // Wounded by an older transaction, or waiting on ourselves
+    if (cm_info[this_id].aborted == 1 || this_id == owner_id)
+        return false;
+
+    int urgency = compare_priority(this_id, owner_id);
+    bool older = urgency > 0
+        || (urgency == 0 && cm_info[this_id].start_ts < cm_info[owner_id].start_ts);
+    if (lock_policy == LockPolicy::wait_die) {
+        if (!older)
+            TXP_INCREMENT(txp_lock_dies);
+        return older;
+    }
+
+    assert(lock_policy == LockPolicy::wound_wait);
+    if (older && cm_info[owner_id].aborted == 0) {
+        //FIXME: like should_abort, this might wound a new transaction on that thread
+        cm_info[owner_id].aborted = 1;
+        release_fence();
+        TXP_INCREMENT(txp_lock_wounds);
+    }
+    return true;
+}
+
+void ContentionManager::on_lock_wait(int threadid, uint64_t n) {
+    if (n >= (1 << STO_SPIN_BOUND_WRITE)) {
+        std::this_thread::yield();
+        return;
+    }
+    uint64_t window = uint64_t(LOCK_WAIT_BASE_CYCLES) << std::min(n, uint64_t(LOCK_WAIT_MAX_SHIFT));
+    window >>= std::min(cm_info[threadid].priority, uint32_t(MAX_PRIORITY_SHIFT));
+    wait_cycles(rand_r(&(cm_info[threadid].seed)) % (window + 1));
+}
+
 void ContentionManager::on_rollback(int threadid) {
     TXP_INCREMENT(txp_cm_onrollback);
     if (cm_info[threadid].abort_count < SUCC_ABORTS_MAX) {
@@ -80,9 +137,47 @@ void ContentionManager::on_rollback(int threadid) {
     }
     //uint64_t cycles_to_wait = rand_r((unsigned int*)&cm_info[threadid].seed) % (cm_info[threadid].abort_count * WAIT_CYCLES_MULTIPLICATOR);
     uint64_t cycles_to_wait = rand_r(&(cm_info[threadid].seed)) % cm_info[threadid].abort_backoff;
+    cycles_to_wait >>= std::min(cm_info[threadid].priority, uint32_t(MAX_PRIORITY_SHIFT));
+    uint64_t deadline = cm_info[threadid].deadline;
+    if (deadline && read_tsc() >= deadline)
+        return;
     wait_cycles(cycles_to_wait);
 }
 
+uint64_t ContentionManager::spin_bound(int threadid) {
+    return uint64_t(1) << (STO_SPIN_BOUND_WRITE
+                           + std::min(cm_info[threadid].priority, uint32_t(MAX_PRIORITY_SHIFT)));
+}
+
+int ContentionManager::compare_priority(int a, int b) {
+    acquire_fence();
+    uint32_t pa = cm_info[a].priority, pb = cm_info[b].priority;
+    if (pa != pb)
+        return pa > pb ? 1 : -1;
+    uint64_t da = cm_info[a].deadline, db = cm_info[b].deadline;
+    if (da == db)
+        return 0;
+    // no deadline sorts last
+    if (da == 0 || (db != 0 && db < da))
+        return -1;
+    return 1;
+}
+
+void ContentionManager::acquire_serial_token() {
+    while (!bool_cmpxchg(&serial_token, uint64_t(0), uint64_t(1)))
+        relax_fence();
+    acquire_fence();
+}
+
+void ContentionManager::release_serial_token() {
+    release_fence();
+    serial_token = 0;
+}
+
 // Defines and initializes the static fields
 uint64_t ContentionManager::ts = 0;
+LockPolicy ContentionManager::lock_policy = LockPolicy::spin;
+unsigned ContentionManager::fallback_aborts = 0;
+unsigned ContentionManager::serial_aborts = 0;
+uint64_t ContentionManager::serial_token = 0;
 CMInfo ContentionManager::cm_info[MAX_THREADS];
@@ -3,17 +3,37 @@
 #include "Interface.hh"
 #include "timing.hh"
 #include <climits>
+#include <cstring>
 
 #define MAX_TS UINT_MAX
 #define TS_THRESHOLD 10
 #define SUCC_ABORTS_MAX 10
 #define WAIT_CYCLES_MULTIPLICATOR 10000
 #define INIT_BACKOFF_CYCLES 3072
+#define MAX_PRIORITY_SHIFT 8
+#define LOCK_WAIT_BASE_CYCLES 64
+#define LOCK_WAIT_MAX_SHIFT 8
 
 #define MAX_THREADS 128
 
 class Transaction;
 
+// Deadlock prevention policy for write locks held under TLockVersion (2PL).
+// `spin` is the original bounded-spin-then-abort behavior. `wait_die` and
+// `wound_wait` order conflicting transactions by start timestamp, which a
+// transaction keeps across restarts so that it eventually becomes the oldest.
+enum class LockPolicy : int { spin = 0, wait_die, wound_wait };
+
+inline LockPolicy parse_lock_policy(const char *s) {
+    if (s == nullptr || strcmp(s, "spin") == 0)
+        return LockPolicy::spin;
+    if (strcmp(s, "wait-die") == 0)
+        return LockPolicy::wait_die;
+    if (strcmp(s, "wound-wait") == 0)
+        return LockPolicy::wound_wait;
+    return static_cast<LockPolicy>(-1);
+}
+
 struct CMInfo {
     uint32_t aborted;
     uint32_t seed;
@@ -21,8 +41,10 @@ struct CMInfo {
     uint64_t write_set_size;
     uint64_t abort_count;
     uint64_t abort_backoff;
-    uint64_t version;
-    uint64_t padding[2];
+    uint64_t deadline;
+    uint64_t start_ts;
+    uint32_t priority;
+    uint32_t padding;
 
     CMInfo() = default;
 };
@@ -36,11 +58,61 @@ public:
 
     static void start(Transaction *tx); 
 
+    // Start of a transaction under a 2PL lock policy other than spin, with
+    // or without CONTENTION_REGULATION: the first attempt takes a start
+    // timestamp, which restarts keep, and every attempt clears the wound
+    // left by the previous one.
+    static void start_locking(int threadid, bool restarted);
+
     static void on_rollback(int threadid);
 
+    // Called while this_id waits for a write lock owned by owner_id. Returns
+    // false if this_id should abort instead of waiting any longer.
+    static bool should_wait(int this_id, int owner_id);
+
+    // Backs off between polls of a write lock that should_wait allowed
+    // threadid to wait for; n counts the polls so far. The randomized
+    // window doubles per poll, and past the spin bound the thread yields
+    // to give a descheduled owner a chance to run.
+    static void on_lock_wait(int threadid, uint64_t n);
+
+    // Starvation control. A transaction that has aborted fallback_aborts
+    // times in a row locks the items that caused its aborts when it next
+    // accesses them (see CCPolicy::apply); after serial_aborts it also runs
+    // under a global token, so at most one starving transaction runs at a
+    // time. 0 disables either mechanism.
+    static void acquire_serial_token();
+    static void release_serial_token();
+
+    // Priority scheduling. A thread's transactions carry a priority class
+    // (higher is more urgent, default 0) and an optional deadline, a
+    // read_tsc() value or 0 for none; both persist across transactions
+    // until changed. Conflicts go to the higher class, then to the earlier
+    // deadline, then to the usual timestamp order: should_abort wounds a
+    // less urgent lock owner and yields to a more urgent one, should_wait
+    // orders 2PL waiters the same way, spin_bound lets higher classes spin
+    // longer on a held lock where nothing orders the conflict, and
+    // on_rollback and on_lock_wait back off less for higher classes
+    // (on_rollback not at all past the deadline).
+    static void set_priority(int threadid, uint32_t priority, uint64_t deadline = 0) {
+        cm_info[threadid].priority = priority;
+        cm_info[threadid].deadline = deadline;
+    }
+    // Returns > 0 if a's transaction is more urgent than b's, < 0 if less,
+    // and 0 if neither.
+    static int compare_priority(int a, int b);
+    // Spins a transaction of threadid's class makes on a held lock before
+    // giving up and aborting: OCC commit-time locks of blind writes and 2PL
+    // locks under LockPolicy::spin. Higher classes spin longer.
+    static uint64_t spin_bound(int threadid);
+
 public:
     // Global timestamp
     static uint64_t ts;
+    static LockPolicy lock_policy;
+    static unsigned fallback_aborts;
+    static unsigned serial_aborts;
+    static uint64_t serial_token;
     static CMInfo cm_info[MAX_THREADS];
 };
 
@@ -9,8 +9,26 @@
 
 enum class LockResponse : int {locked, failed, optimistic, spin};
 
-template <bool Adaptive>
-class TLockVersion : public BasicVersion<TLockVersion<Adaptive>> {
+// Visible reader indicators for reader-biased TLockVersions, after BRAVO.
+// Each thread owns a row. A biased read lock publishes the version's address
+// in the reader's row instead of bumping the reader count in the version
+// word, so readers of a hot record don't share its cache line.
+struct TLockReaders {
+    static constexpr unsigned nslots = 64;
+
+    struct alignas(64) row_type {
+        const void* volatile slot[nslots];
+    };
+    static row_type rows[MAX_THREADS];
+
+    static const void* volatile& slot(int threadid, const void* vers) {
+        uintptr_t x = reinterpret_cast<uintptr_t>(vers);
+        return rows[threadid].slot[((x >> 3) ^ (x >> 9)) % nslots];
+    }
+};
+
+template <bool Adaptive, bool ReaderBias = false>
+class TLockVersion : public BasicVersion<TLockVersion<Adaptive, ReaderBias>> {
 public:
     typedef TransactionTid::type type;
     static constexpr type mask = TransactionTid::threadid_mask;
@@ -18,15 +36,23 @@ public:
     static constexpr type lock_bit = TransactionTid::lock_bit;
     static constexpr type opt_bit = TransactionTid::opt_bit;
     static constexpr type dirty_bit = TransactionTid::dirty_bit;
+    static constexpr bool honors_cc_mode = true;
+    // Set while readers may take the lock through TLockReaders. 2PL has no
+    // use for the nonopaque bit, so ReaderBias versions reuse it. Installs
+    // clear it; counted readers set it again at random (rbias_chance
+    // percent), so only read-dominated records stay biased.
+    static constexpr type rbias_bit = ReaderBias ? TransactionTid::nonopaque_bit : 0;
+    static constexpr int rbias_chance = 5;
 
-    using BV = BasicVersion<TLockVersion<Adaptive>>;
+    using BV = BasicVersion<TLockVersion<Adaptive, ReaderBias>>;
     using BV::v_;
 
-    TLockVersion() = default;
+    TLockVersion()
+            : BV(initialized_tid | rbias_bit) {}
     explicit TLockVersion(type v)
             : BV(v) {}
     TLockVersion(type v, bool insert)
-            : BV(v | (insert ? lock_bit : 0)) {}
+            : BV(v | (insert ? (lock_bit | TThread::id()) : rbias_bit)) {}
 
     bool cp_try_lock_impl(TransItem& item, int threadid) {
         (void)item;
@@ -43,7 +69,8 @@ public:
             release_fence();
         } else {
             assert(item.has_read());
-            unlock_read();
+            if (!unlock_read_biased())
+                unlock_read();
         }
     }
     bool cp_check_version_impl(Transaction& txn, TransItem& item) {
@@ -78,7 +105,11 @@ public:
 
 private:
     // read/writer/optimistic combined lock
+    // The low bits hold the reader count, or the owner's thread id while
+    // write-locked.
     std::pair<LockResponse, type> try_lock_read() {
+        if (try_lock_read_biased())
+            return std::make_pair(LockResponse::locked, type());
         while (true) {
             type vv = v_;
             bool write_locked = ((vv & lock_bit) != 0);
@@ -89,9 +120,12 @@ private:
             if (!rlock_avail) {
                 return std::make_pair(LockResponse::optimistic, vv);
             }
-            if (::bool_cmpxchg(&v_, vv, (vv & ~mask) | (rlock_cnt+1)))
+            if (::bool_cmpxchg(&v_, vv, (vv & ~mask) | (rlock_cnt+1))) {
+                if (ReaderBias && !(vv & rbias_bit)
+                    && TThread::gen[TThread::id()].chance(rbias_chance))
+                    __sync_fetch_and_or(&v_, rbias_bit);
                 return std::make_pair(LockResponse::locked, type());
-            else
+            } else
                 relax_fence();
         }
     }
@@ -103,9 +137,16 @@ private:
             bool read_locked = ((vv & mask) != 0);
             if (write_locked || read_locked)
                 return LockResponse::spin;
-            if (::bool_cmpxchg(&v_, vv, (vv | lock_bit)))
+            if (::bool_cmpxchg(&v_, vv, ((vv & ~rbias_bit) | lock_bit | TThread::id()))) {
+                if ((vv & rbias_bit) && !revoke_bias()) {
+                    // biased readers still hold the lock; back off, biased
+                    release_fence();
+                    v_ = vv;
+                    return LockResponse::spin;
+                }
+                clear_own_slot();
                 return LockResponse::locked;
-            else
+            } else
                 relax_fence();
         }
     }
@@ -115,13 +156,57 @@ private:
         type vv = v_;
         type rlock_cnt = vv & mask;
         assert(!TransactionTid::is_locked(vv));
+        if (ReaderBias && TLockReaders::slot(TThread::id(), this) == this) {
+            // read lock is held through TLockReaders
+            return try_lock_write();
+        }
         assert(rlock_cnt >= 1);
-        if ((rlock_cnt == 1) && ::bool_cmpxchg(&v_, vv, (vv - 1) | lock_bit))
+        if ((rlock_cnt == 1) && ::bool_cmpxchg(&v_, vv, ((vv & ~(mask | rbias_bit)) | lock_bit | TThread::id()))) {
+            if ((vv & rbias_bit) && !revoke_bias()) {
+                release_fence();
+                v_ = vv;
+                return LockResponse::spin;
+            }
             return LockResponse::locked;
-        else
+        } else
             return LockResponse::spin;
     }
 
+    // Reader-biased fast path: publish, then confirm the bias still holds.
+    // A writer clears the bias before scanning the rows, so one of the two
+    // sees the other.
+    bool try_lock_read_biased() {
+        if (!ReaderBias || !(v_ & rbias_bit))
+            return false;
+        auto& s = TLockReaders::slot(TThread::id(), this);
+        if (s != nullptr)
+            return false;
+        s = this;
+        fence();
+        if ((v_ & (rbias_bit | lock_bit)) == rbias_bit)
+            return true;
+        s = nullptr;
+        return false;
+    }
+    bool unlock_read_biased() {
+        if (!ReaderBias)
+            return false;
+        auto& s = TLockReaders::slot(TThread::id(), this);
+        if (s != this)
+            return false;
+        release_fence();
+        s = nullptr;
+        return true;
+    }
+    // An upgrading biased reader keeps its slot until it holds the lock
+    void clear_own_slot() {
+        if (ReaderBias) {
+            auto& s = TLockReaders::slot(TThread::id(), this);
+            if (s == this)
+                s = nullptr;
+        }
+    }
+
     void unlock_read() {
         if (!Adaptive) {
             type vv = __sync_fetch_and_add(&v_, -1);
@@ -148,9 +233,9 @@ private:
         assert(BV::is_locked());
         type new_v;
         if (!Adaptive) {
-            new_v = v_ & ~(lock_bit | dirty_bit | opt_bit);
+            new_v = v_ & ~(lock_bit | dirty_bit | opt_bit | mask);
         } else {
-            new_v = v_ & ~(lock_bit | dirty_bit);
+            new_v = v_ & ~(lock_bit | dirty_bit | mask);
             if (((new_v & opt_bit) != 0) && TThread::gen[TThread::id()].chance(50)) {
                 new_v &= ~opt_bit;
             }
@@ -159,6 +244,8 @@ private:
         release_fence();
     }
 
+    inline bool revoke_bias();
+    inline bool wait_for_lock(uint64_t& n);
     inline bool try_upgrade_with_spin();
     inline bool try_lock_write_with_spin();
     inline std::pair<LockResponse, type> try_lock_read_with_spin();
@@ -0,0 +1,284 @@
+#include "HugeArena.hh"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/mman.h>
+
+HugeArena::mode HugeArena::mode_ = HugeArena::mode::off;
+bool HugeArena::used_ = false;
+
+namespace {
+
+constexpr int nsmall = HugeArena::small_max / HugeArena::small_step;
+constexpr int large_shift = 13; // the smallest large class is 8KB
+constexpr int nlarge = 21 - large_shift + 1;
+constexpr size_t large_align = 4096;
+static_assert(size_t(1) << (large_shift + nlarge - 1) == HugeArena::page_size,
+              "large classes end at a huge page");
+
+struct free_node {
+    free_node* next;
+};
+
+// Per-thread free lists and slabs for small objects. A thread's cache is
+// reused by later threads once it exits.
+struct thread_cache {
+    free_node* free[nsmall];
+    char* slab_next[nsmall];
+    char* slab_end[nsmall];
+    char* chunk_next;
+    char* chunk_end;
+    thread_cache* next_idle;
+};
+
+std::mutex arena_lock;
+char* segment_next;
+char* segment_end;
+char* large_next;
+char* large_end;
+free_node* large_free[nlarge];
+thread_cache* idle_caches;
+std::atomic<bool> hugetlb_failed;
+std::atomic<size_t> hugetlb_mapped;
+std::atomic<size_t> thp_mapped;
+// objects bigger than a huge page, mapped on their own: whether on hugetlb
+std::unordered_map<void*, bool> big_maps;
+
+struct cache_holder {
+    thread_cache* c = nullptr;
+    ~cache_holder() {
+        if (c) {
+            std::lock_guard<std::mutex> guard(arena_lock);
+            c->next_idle = idle_caches;
+            idle_caches = c;
+        }
+    }
+};
+thread_local cache_holder local_cache;
+
+thread_cache* cache() {
+    thread_cache* c = local_cache.c;
+    if (!c) {
+        std::lock_guard<std::mutex> guard(arena_lock);
+        if ((c = idle_caches))
+            idle_caches = c->next_idle;
+        else
+            c = new thread_cache();
+        local_cache.c = c;
+    }
+    return c;
+}
+
+size_t round_up(size_t x, size_t a) {
+    return (x + a - 1) & ~(a - 1);
+}
+
+// Maps `size` bytes (a multiple of the huge page size), huge page aligned
+char* map_pages(size_t size, bool* hugetlb = nullptr) {
+    void* p;
+    if (HugeArena::current() == HugeArena::mode::hugetlb && !hugetlb_failed) {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            hugetlb_mapped += size;
+            if (hugetlb)
+                *hugetlb = true;
+            return static_cast<char*>(p);
+        }
+        if (!hugetlb_failed.exchange(true))
+            std::cerr << "HugeArena: no hugetlb pages (" << strerror(errno)
+                      << "), falling back to transparent huge pages" << std::endl;
+    }
+    // over-map so the region can be trimmed to a huge page boundary
+    p = mmap(nullptr, size + HugeArena::page_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        throw std::bad_alloc();
+    char* raw = static_cast<char*>(p);
+    char* base = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(raw), HugeArena::page_size));
+    if (base != raw)
+        munmap(raw, base - raw);
+    if (size_t tail = HugeArena::page_size - (base - raw))
+        munmap(base + size, tail);
+    madvise(base, size, MADV_HUGEPAGE);
+    thp_mapped += size;
+    if (hugetlb)
+        *hugetlb = false;
+    return base;
+}
+
+// Takes one huge page from the current segment; needs arena_lock
+char* take_page() {
+    if (segment_next == segment_end) {
+        segment_next = map_pages(HugeArena::segment_size);
+        segment_end = segment_next + HugeArena::segment_size;
+    }
+    char* p = segment_next;
+    segment_next += HugeArena::page_size;
+    return p;
+}
+
+void* small_allocate(size_t sz) {
+    int cls = sz / HugeArena::small_step - 1;
+    thread_cache* c = cache();
+    if (free_node* n = c->free[cls]) {
+        c->free[cls] = n->next;
+        return n;
+    }
+    if (size_t(c->slab_end[cls] - c->slab_next[cls]) < sz) {
+        // slabs start 64KB aligned, so objects are aligned to any power of
+        // two dividing their size
+        if (c->chunk_next == c->chunk_end) {
+            std::lock_guard<std::mutex> guard(arena_lock);
+            c->chunk_next = take_page();
+            c->chunk_end = c->chunk_next + HugeArena::page_size;
+        }
+        c->slab_next[cls] = c->chunk_next;
+        c->slab_end[cls] = c->chunk_next + HugeArena::slab_size;
+        c->chunk_next += HugeArena::slab_size;
+    }
+    void* p = c->slab_next[cls];
+    c->slab_next[cls] += sz;
+    return p;
+}
+
+void small_deallocate(void* p, size_t sz) {
+    int cls = sz / HugeArena::small_step - 1;
+    thread_cache* c = cache();
+    auto n = static_cast<free_node*>(p);
+    n->next = c->free[cls];
+    c->free[cls] = n;
+}
+
+int large_class(size_t sz) {
+    int shift = large_shift;
+    while ((size_t(1) << shift) < sz)
+        ++shift;
+    return shift - large_shift;
+}
+
+void* large_allocate(size_t sz) {
+    int cls = large_class(sz);
+    sz = size_t(1) << (cls + large_shift);
+    std::lock_guard<std::mutex> guard(arena_lock);
+    if (free_node* n = large_free[cls]) {
+        large_free[cls] = n->next;
+        return n;
+    }
+    if (size_t(large_end - large_next) < sz) {
+        large_next = take_page();
+        large_end = large_next + HugeArena::page_size;
+    }
+    void* p = large_next;
+    large_next += sz;
+    return p;
+}
+
+void large_deallocate(void* p, size_t sz) {
+    int cls = large_class(sz);
+    std::lock_guard<std::mutex> guard(arena_lock);
+    auto n = static_cast<free_node*>(p);
+    n->next = large_free[cls];
+    large_free[cls] = n;
+}
+
+} // namespace
+
+bool HugeArena::configure(mode m) {
+    if (m == mode_)
+        return true;
+    if (used_ || hugetlb_mapped || thp_mapped)
+        return false;
+    mode_ = m;
+
+    std::ifstream thp("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string setting;
+    if (m != mode::off && std::getline(thp, setting) && setting.find("[never]") != std::string::npos)
+        std::cerr << "HugeArena: transparent huge pages are disabled, "
+                  << "fallback mappings will use base pages" << std::endl;
+    return true;
+}
+
+bool HugeArena::parse(const char* s, mode& m) {
+    if (!strcmp(s, "off"))
+        m = mode::off;
+    else if (!strcmp(s, "thp"))
+        m = mode::thp;
+    else if (!strcmp(s, "hugetlb"))
+        m = mode::hugetlb;
+    else
+        return false;
+    return true;
+}
+
+const char* HugeArena::name(mode m) {
+    switch (m) {
+    case mode::thp:
+        return "thp";
+    case mode::hugetlb:
+        return "hugetlb";
+    default:
+        return "off";
+    }
+}
+
+void* HugeArena::arena_allocate(size_t sz, size_t align) {
+    if (align < small_step)
+        align = small_step;
+    sz = sz ? round_up(sz, align) : align;
+    if (sz <= small_max)
+        return small_allocate(sz);
+    assert(align <= large_align);
+    if (sz <= page_size)
+        return large_allocate(sz);
+    bool hugetlb;
+    char* p = map_pages(round_up(sz, page_size), &hugetlb);
+    std::lock_guard<std::mutex> guard(arena_lock);
+    big_maps[p] = hugetlb;
+    return p;
+}
+
+void HugeArena::arena_deallocate(void* p, size_t sz, size_t align) {
+    if (align < small_step)
+        align = small_step;
+    sz = sz ? round_up(sz, align) : align;
+    if (sz <= small_max)
+        small_deallocate(p, sz);
+    else if (sz <= page_size)
+        large_deallocate(p, sz);
+    else {
+        sz = round_up(sz, page_size);
+        bool hugetlb;
+        {
+            std::lock_guard<std::mutex> guard(arena_lock);
+            auto it = big_maps.find(p);
+            assert(it != big_maps.end());
+            hugetlb = it->second;
+            big_maps.erase(it);
+        }
+        munmap(p, sz);
+        (hugetlb ? hugetlb_mapped : thp_mapped) -= sz;
+    }
+}
+
+size_t HugeArena::hugetlb_bytes() {
+    return hugetlb_mapped;
+}
+
+size_t HugeArena::thp_bytes() {
+    return thp_mapped;
+}
+
+void HugeArena::print_stats(std::ostream& out) {
+    out << "Huge-page arena: " << name(mode_);
+    if (mode_ != mode::off)
+        out << ", " << (hugetlb_bytes() >> 20) << " MB on hugetlb pages, "
+            << (thp_bytes() >> 20) << " MB on transparent huge pages";
+    out << std::endl;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <new>
+
+// Huge-page backed memory for TLB-heavy data: database rows, hash index
+// buckets, Transaction objects (whose tset0_ and hash table are inline),
+// tset_ chunks and TransScratch zones.
+//
+// Memory comes from 2MB-aligned segments, mapped with MAP_HUGETLB from the
+// hugetlbfs pool (see mount_hugepages.sh) in hugetlb mode, and as
+// transparent huge pages (madvise(MADV_HUGEPAGE)) in thp mode. hugetlb mode
+// falls back to THP once the pool runs out. Objects up to small_max bytes
+// come from per-thread, per-size slabs; larger ones up to a huge page from
+// power-of-two free lists; anything bigger is mapped on its own. Freed
+// memory is reused but never unmapped, except for those big mappings.
+//
+// In off mode (the default) every call goes to the global operator new, and
+// index nodes allocated by Masstree are unaffected in every mode: they come
+// from the process allocator (see allocator_init()), which maps 2MB pages
+// only in the rpmalloc build (MALLOC=2), independent of the mode here.
+//
+// The mode is chosen once at startup, before the first allocation.
+class HugeArena {
+public:
+    enum class mode : int { off = 0, thp, hugetlb };
+
+    static constexpr size_t page_size = size_t(2) << 20;
+    static constexpr size_t segment_size = 16 * page_size;
+    static constexpr size_t small_step = 16;
+    static constexpr size_t small_max = 4096;
+    static constexpr size_t slab_size = 64 << 10;
+
+    // Returns false if memory was already allocated
+    static bool configure(mode m);
+    static mode current() {
+        return mode_;
+    }
+    static bool enabled() {
+        return mode_ != mode::off;
+    }
+    static bool parse(const char* s, mode& m);
+    static const char* name(mode m);
+
+    static inline void* allocate(size_t sz, size_t align = alignof(std::max_align_t));
+    // `sz` and `align` must match the allocation's
+    static inline void deallocate(void* p, size_t sz, size_t align = alignof(std::max_align_t));
+
+    static size_t hugetlb_bytes();
+    static size_t thp_bytes();
+    static void print_stats(std::ostream& out);
+
+private:
+    static mode mode_;
+    static bool used_;
+
+    static void* arena_allocate(size_t sz, size_t align);
+    static void arena_deallocate(void* p, size_t sz, size_t align);
+};
+
+// Base class routing a type's operator new and delete through HugeArena
+struct HugeArenaObject {
+    static void* operator new(size_t sz) {
+        return HugeArena::allocate(sz);
+    }
+    static void* operator new(size_t sz, std::align_val_t al) {
+        return HugeArena::allocate(sz, size_t(al));
+    }
+    static void operator delete(void* p, size_t sz) {
+        HugeArena::deallocate(p, sz);
+    }
+    static void operator delete(void* p, size_t sz, std::align_val_t al) {
+        HugeArena::deallocate(p, sz, size_t(al));
+    }
+    static void* operator new(size_t, void* p) noexcept {
+        return p;
+    }
+    static void operator delete(void*, void*) noexcept {
+    }
+};
+
+// Standard allocator over HugeArena, for containers
+template <typename T>
+struct HugeArenaAllocator {
+    typedef T value_type;
+
+    HugeArenaAllocator() noexcept = default;
+    template <typename U>
+    HugeArenaAllocator(const HugeArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(HugeArena::allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept {
+        HugeArena::deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const HugeArenaAllocator<U>&) const noexcept {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const HugeArenaAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+inline void* HugeArena::allocate(size_t sz, size_t align) {
+    if (mode_ != mode::off)
+        return arena_allocate(sz, align);
+    if (!used_)
+        used_ = true;
+    if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        return ::operator new(sz, std::align_val_t(align));
+    return ::operator new(sz);
+}
+
+inline void HugeArena::deallocate(void* p, size_t sz, size_t align) {
+    if (!p)
+        return;
+    if (mode_ != mode::off)
+        arena_deallocate(p, sz, align);
+    else if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        ::operator delete(p, std::align_val_t(align));
+    else
+        ::operator delete(p);
+}
@@ -0,0 +1,194 @@
+#include "MVCCCompress.hh"
+
+#include <algorithm>
+#include <cstring>
+
+size_t MvCompressor::min_size_ = MvCompressor::default_min_size;
+MvCompressor::counters MvCompressor::counters_[MAX_THREADS];
+
+namespace {
+
+constexpr int hash_bits = 12;
+constexpr size_t min_match = 4;
+// The last sequence starts at least this far from the end of the input,
+// and a match ends at least last_literals bytes before it
+constexpr size_t match_limit = 12;
+constexpr size_t last_literals = 5;
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+inline unsigned hash32(uint32_t x) {
+    return (x * 2654435761U) >> (32 - hash_bits);
+}
+
+// Space for a length of `n` continued past a nibble
+inline size_t length_bytes(size_t n) {
+    return n >= 15 ? (n - 15) / 255 + 1 : 0;
+}
+
+inline unsigned char* put_length(unsigned char* op, size_t n) {
+    for (n -= 15; n >= 255; n -= 255)
+        *op++ = 255;
+    *op++ = n;
+    return op;
+}
+
+inline bool get_length(const unsigned char*& ip, const unsigned char* iend, size_t& n) {
+    unsigned char b;
+    do {
+        if (ip == iend)
+            return false;
+        b = *ip++;
+        n += b;
+    } while (b == 255);
+    return true;
+}
+
+}
+
+size_t MvCodec::compress(const void* in, size_t size, unsigned char* out, size_t capacity) {
+    if (size > max_input)
+        return 0;
+    const unsigned char* src = static_cast<const unsigned char*>(in);
+    const unsigned char* end = src + size;
+    const unsigned char* ip = src;
+    const unsigned char* anchor = src;
+    unsigned char* op = out;
+    unsigned char* oend = out + capacity;
+    uint16_t table[1 << hash_bits] = {};
+
+    while (size > match_limit && ip < end - match_limit) {
+        uint32_t seq = read32(ip);
+        unsigned hv = hash32(seq);
+        const unsigned char* ref = src + table[hv];
+        table[hv] = ip - src;
+        if (ref >= ip || read32(ref) != seq) {
+            ++ip;
+            continue;
+        }
+        const unsigned char* mp = ip + min_match;
+        const unsigned char* rp = ref + min_match;
+        while (mp < end - last_literals && *mp == *rp)
+            ++mp, ++rp;
+
+        size_t nlit = ip - anchor;
+        size_t nmatch = mp - ip - min_match;
+        if (size_t(oend - op) < 1 + length_bytes(nlit) + nlit + 2 + length_bytes(nmatch))
+            return 0;
+        unsigned char* token = op++;
+        *token = (std::min(nlit, size_t(15)) << 4) | std::min(nmatch, size_t(15));
+        if (nlit >= 15)
+            op = put_length(op, nlit);
+        memcpy(op, anchor, nlit);
+        op += nlit;
+        size_t offset = ip - ref;
+        *op++ = offset & 255;
+        *op++ = offset >> 8;
+        if (nmatch >= 15)
+            op = put_length(op, nmatch);
+        ip = anchor = mp;
+    }
+
+    size_t nlit = end - anchor;
+    if (size_t(oend - op) < 1 + length_bytes(nlit) + nlit)
+        return 0;
+    *op++ = std::min(nlit, size_t(15)) << 4;
+    if (nlit >= 15)
+        op = put_length(op, nlit);
+    memcpy(op, anchor, nlit);
+    op += nlit;
+    return op - out;
+}
+
+bool MvCodec::decompress(const unsigned char* in, size_t csize, void* out, size_t size) {
+    const unsigned char* ip = in;
+    const unsigned char* iend = in + csize;
+    unsigned char* start = static_cast<unsigned char*>(out);
+    unsigned char* op = start;
+    unsigned char* oend = start + size;
+
+    while (ip != iend) {
+        unsigned token = *ip++;
+        size_t nlit = token >> 4;
+        if (nlit == 15 && !get_length(ip, iend, nlit))
+            return false;
+        if (nlit > size_t(iend - ip) || nlit > size_t(oend - op))
+            return false;
+        memcpy(op, ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t nmatch = token & 15;
+        if (nmatch == 15 && !get_length(ip, iend, nmatch))
+            return false;
+        nmatch += min_match;
+        if (offset == 0 || offset > size_t(op - start) || nmatch > size_t(oend - op))
+            return false;
+        // matches may overlap their own output
+        const unsigned char* rp = op - offset;
+        while (nmatch--)
+            *op++ = *rp++;
+    }
+    return op == oend;
+}
+
+void MvCompressor::configure(unsigned age_epochs, size_t min_size) {
+    Transaction::cold_age = age_epochs;
+    min_size_ = min_size;
+}
+
+size_t MvCompressor::versions() {
+    int64_t n = 0;
+    for (auto& c : counters_)
+        n += c.versions;
+    return n;
+}
+
+size_t MvCompressor::version_bytes() {
+    int64_t n = 0;
+    for (auto& c : counters_)
+        n += c.version_bytes;
+    return n;
+}
+
+size_t MvCompressor::compressed_versions() {
+    int64_t n = 0;
+    for (auto& c : counters_)
+        n += c.compressed;
+    return n;
+}
+
+size_t MvCompressor::compressed_bytes() {
+    int64_t n = 0;
+    for (auto& c : counters_)
+        n += c.compressed_bytes;
+    return n;
+}
+
+void MvCompressor::print_stats(std::ostream& out) {
+    int64_t saved = 0;
+    uint64_t total = 0, decompressed = 0;
+    for (auto& c : counters_) {
+        saved += c.saved_bytes;
+        total += c.total_compressed;
+        decompressed += c.decompressed;
+    }
+    out << "MVCC versions: " << versions() << " retained in "
+        << (version_bytes() >> 10) << " KB";
+    if (enabled())
+        out << ", " << compressed_versions() << " compressed into "
+            << (compressed_bytes() >> 10) << " KB (" << (saved >> 10)
+            << " KB saved); " << total << " compressed, "
+            << decompressed << " decompressed for old snapshots";
+    out << std::endl;
+}
@@ -0,0 +1,116 @@
+// Compression of cold MVCC versions
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+
+#include "Transaction.hh"
+
+// A byte-oriented LZ77 codec in the style of LZ4's block format: each
+// sequence is a token (literal length, match length - 4), the literals, and
+// a 2-byte little-endian match offset; lengths of 15 or more continue in
+// extra bytes. The last sequence holds only literals. Inputs are limited to
+// 64KB so offsets and the match table fit in 16 bits.
+class MvCodec {
+public:
+    static constexpr size_t max_input = 65535;
+
+    // Returns the compressed size, or 0 if the result would not fit in
+    // `capacity` bytes
+    static size_t compress(const void* in, size_t size, unsigned char* out, size_t capacity);
+    // Returns false unless `in` decodes to exactly `size` bytes
+    static bool decompress(const unsigned char* in, size_t csize, void* out, size_t size);
+};
+
+// Policy and statistics for compressing MVCC versions that stay in a
+// version chain long after being superseded, typically because old
+// snapshots hold back GC. When a version is installed, its committed
+// predecessor is registered with Transaction::cold_call; if RCU has not
+// freed it Transaction::cold_age epochs later, its value is compressed with
+// MvCodec and the MvHistory is replaced by an MvCompressedHistory. Reads at
+// old snapshots decompress into a transient copy (see MvObject::find).
+//
+// Only trivially copyable values of at least min_size() bytes compress.
+class MvCompressor {
+public:
+    static constexpr size_t default_min_size = 128;
+
+    // Compresses versions superseded for at least `age_epochs` epochs;
+    // 0 disables compression
+    static void configure(unsigned age_epochs, size_t min_size = default_min_size);
+    static bool enabled() {
+        return Transaction::cold_age != 0;
+    }
+    static size_t min_size() {
+        return min_size_;
+    }
+
+    template <typename T>
+    static bool applies() {
+        return std::is_trivially_copyable<T>::value
+            && sizeof(T) >= min_size_ && sizeof(T) <= MvCodec::max_input
+            && enabled();
+    }
+
+    // Heap-allocated versions (inlined versions are not counted). Versions
+    // are counted only while compression is enabled, so configure() before
+    // creating the objects whose versions are to be reported.
+    static void count_version(size_t bytes) {
+        if (!enabled())
+            return;
+        auto& c = counters_[TThread::id()];
+        ++c.versions;
+        c.version_bytes += bytes;
+    }
+    static void uncount_version(size_t bytes) {
+        if (!enabled())
+            return;
+        auto& c = counters_[TThread::id()];
+        --c.versions;
+        c.version_bytes -= bytes;
+    }
+    // A version node of `raw` bytes was replaced by one of `packed` bytes
+    static void count_compressed(size_t raw, size_t packed) {
+        auto& c = counters_[TThread::id()];
+        c.version_bytes -= raw - packed;
+        ++c.compressed;
+        c.compressed_bytes += packed;
+        c.saved_bytes += raw - packed;
+        ++c.total_compressed;
+    }
+    static void uncount_compressed(size_t raw, size_t packed) {
+        auto& c = counters_[TThread::id()];
+        --c.versions;
+        c.version_bytes -= packed;
+        --c.compressed;
+        c.compressed_bytes -= packed;
+        c.saved_bytes -= raw - packed;
+    }
+    static void count_decompressed() {
+        ++counters_[TThread::id()].decompressed;
+    }
+
+    // Versions and bytes held by version chains, of which compressed
+    static size_t versions();
+    static size_t version_bytes();
+    static size_t compressed_versions();
+    static size_t compressed_bytes();
+    static void print_stats(std::ostream& out);
+
+private:
+    struct __attribute__((aligned(64))) counters {
+        int64_t versions;
+        int64_t version_bytes;
+        int64_t compressed;
+        int64_t compressed_bytes;
+        int64_t saved_bytes;
+        uint64_t total_compressed;
+        uint64_t decompressed;
+    };
+
+    static size_t min_size_;
+    static counters counters_[MAX_THREADS];
+};
@@ -1,8 +1,20 @@
 #include <bitset>
+#include <cstring>
+#include <vector>
 
 #include "MVCCStructs.hh"
 
 std::ostream& operator<<(std::ostream& w, MvStatus s) {
+    if (s & (SWEPT | COMPRESSED)) {
+        w << MvStatus(s & ~(SWEPT | COMPRESSED));
+        if (s & SWEPT) {
+            w << "+SWEPT";
+        }
+        if (s & COMPRESSED) {
+            w << "+COMPRESSED";
+        }
+        return w;
+    }
     switch (s) {
     case UNUSED:                 return w << "UNUSED";
     case ABORTED:                return w << "ABORTED";
@@ -26,6 +38,32 @@ std::ostream& operator<<(std::ostream& w, MvStatus s) {
     }
 }
 
+MvCompressedHistory::MvCompressedHistory(const MvHistoryBase* h, size_t csize)
+    : MvHistoryBase(h->obj_, h->wtid_, MvStatus(h->status_.load() | COMPRESSED)),
+      csize_(csize) {
+    rtid_.store(h->rtid_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    prev_.store(h->prev_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+MvCompressedHistory* MvCompressedHistory::make(const MvHistoryBase* h, const void* value, size_t size) {
+    static thread_local std::vector<unsigned char> scratch;
+    size_t capacity = size - size / 8;
+    if (scratch.size() < capacity) {
+        scratch.resize(capacity);
+    }
+    size_t csize = MvCodec::compress(value, size, scratch.data(), capacity);
+    if (!csize) {
+        return nullptr;
+    }
+    void* x = ::operator new(sizeof(MvCompressedHistory) + csize, std::nothrow);
+    if (!x) {
+        return nullptr;
+    }
+    auto c = new(x) MvCompressedHistory(h, csize);
+    memcpy(c->data(), scratch.data(), csize);
+    return c;
+}
+
 void MvHistoryBase::print_prevs(size_t max) const {
     auto h = this;
     for (size_t i = 0;
@@ -6,6 +6,7 @@
 #include <stack>
 #include <thread>
 
+#include "MVCCCompress.hh"
 #include "MVCCTypes.hh"
 #include "Transaction.hh"
 #include "TRcu.hh"
@@ -33,10 +34,44 @@ enum MvStatus {
     LOCKED_COMMITTED_DELTA  = 0b0000'0001'1100,  // Converting from delta to flattened
     GARBAGE                 = 0b0000'0100'0000,
     GARBAGE2                = 0b0000'1000'0000,
+    SWEPT                   = 0b0001'0000'0000'0000,  // gc_committed_cb has run
+    COMPRESSED              = 0b0010'0000'0000'0000,  // An MvCompressedHistory
 };
 
 std::ostream& operator<<(std::ostream& w, MvStatus s);
 
+// Defers a callback until the versions a commit superseded have been freed,
+// so that data they share by pointer, like out-of-line strings, can be
+// freed from it. A commit's versions run gc_committed_cb an RCU period
+// after install, or from cold_version_cb no later than that, or one RCU
+// period later still if compress_prev puts it off; gc_committed_cb frees
+// the versions it supersedes an RCU period after it runs. Callbacks run in
+// order on the committing thread, so three RCU periods after the commit's
+// installs cover every path. Call from the committing thread after install.
+class MvGarbage {
+public:
+    static void call_after_collect(TRcuSet::callback_type function, void* argument) {
+        Transaction::rcu_call(stage_cb, new stage{function, argument, 2});
+    }
+
+private:
+    struct stage {
+        TRcuSet::callback_type function;
+        void* argument;
+        int periods_left;
+    };
+
+    static void stage_cb(void* x) {
+        auto s = static_cast<stage*>(x);
+        if (s->periods_left-- > 0) {
+            Transaction::rcu_call(stage_cb, s);
+            return;
+        }
+        s->function(s->argument);
+        delete s;
+    }
+};
+
 class MvHistoryBase {
 public:
     using tid_type = TransactionTid::type;
@@ -68,6 +103,37 @@ public:
     void* obj_;  // Parent object
 };
 
+// A committed version whose value MvCompressor compressed. It replaces the
+// MvHistory<T> in the version chain and carries the COMPRESSED flag; only
+// its MvHistoryBase fields may be used.
+class MvCompressedHistory : public MvHistoryBase {
+public:
+    // Returns nullptr unless the value shrinks by at least an eighth
+    static MvCompressedHistory* make(const MvHistoryBase* h, const void* value, size_t size);
+    static void free(MvCompressedHistory* c) {
+        c->~MvCompressedHistory();
+        ::operator delete(c);
+    }
+
+    bool decompress(void* value, size_t size) const {
+        return MvCodec::decompress(data(), csize_, value, size);
+    }
+    size_t bytes() const {
+        return sizeof(MvCompressedHistory) + csize_;
+    }
+
+private:
+    uint32_t csize_;
+
+    MvCompressedHistory(const MvHistoryBase* h, size_t csize);
+    const unsigned char* data() const {
+        return reinterpret_cast<const unsigned char*>(this + 1);
+    }
+    unsigned char* data() {
+        return reinterpret_cast<unsigned char*>(this + 1);
+    }
+};
+
 template <typename T>
 class MvHistory : protected MvHistoryBase {
 public:
@@ -183,6 +249,18 @@ public:
         status(COMMITTED | (s & ~PENDING));
     }
 
+    // Makes a committed version a plain, live one for nontransactional
+    // writes: sets the committed flag and clears the delta and deleted
+    // flags, keeping the GC bookkeeping flags (SWEPT, COMPRESSED, GARBAGE*)
+    // NOT THREADSAFE
+    inline void status_nontrans_commit() {
+        int s = status();
+        int ns = COMMITTED | (s & (SWEPT | COMPRESSED | GARBAGE | GARBAGE2));
+        if (ns != s) {
+            status(ns);
+        }
+    }
+
     // Sets the deleted flag; does nothing if the current status is ABORTED
     // NOT THREADSAFE
     inline void status_delete() {
@@ -249,7 +327,12 @@ public:
 private:
     static void gc_committed_cb(void* ptr) {
         history_type* h = static_cast<history_type*>(ptr);
-        h->assert_status((h->status() & COMMITTED_DELTA) == COMMITTED, "gc_committed_cb");
+        MvStatus hstatus = h->status();
+        h->assert_status((hstatus & COMMITTED_DELTA) == COMMITTED, "gc_committed_cb");
+        // No callback refers to h after this one, so compress_prev may
+        // replace it
+        while (!h->status_.compare_exchange_weak(hstatus, MvStatus(hstatus | SWEPT))) {
+        }
         // Here is how we ensure that `gc_committed_cb` never conflicts
         // with a flatten operation.
         // (1) When `gc_committed_cb` runs, `h->prev()`
@@ -292,6 +375,21 @@ private:
         h->object()->delete_history(h);
     }
 
+    // Returns an uncompressed copy of this compressed version, freed by RCU
+    // once the current transaction is done with it
+    history_type* decompressed_copy() const {
+        auto c = static_cast<const MvCompressedHistory*>(static_cast<const MvHistoryBase*>(this));
+        history_type* h = new history_type(object(), wtid_, static_cast<T*>(nullptr));
+        bool ok = c->decompress(&h->v_, sizeof(T));
+        always_assert(ok, "corrupt compressed version");
+        h->status(status() & ~COMPRESSED);
+        h->rtid_.store(rtid_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        h->prev_.store(prev_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        Transaction::rcu_delete(h);
+        MvCompressor::count_decompressed();
+        return h;
+    }
+
     // Initializes the flattening process
     inline void enflatten() {
         int s = status_.load(std::memory_order_relaxed);
@@ -311,6 +409,12 @@ private:
     void flatten(int old_status, bool fg) {
         assert(old_status == COMMITTED_DELTA);
 
+        uint64_t start_tsc = 0;
+        if (txp_count >= txp_mvcc_flat_cycles) {
+            start_tsc = read_tsc();
+        }
+        TXP_INCREMENT(txp_mvcc_flat_runs);
+
         // Current element is the one initiating the flattening here. It is not
         // included in the trace, but it is included in the committed trace.
         history_type* curr = this;
@@ -321,7 +425,7 @@ private:
             curr = curr->prev();
         }
 
-        TXP_INCREMENT(txp_mvcc_flat_versions);
+        TXP_ACCOUNT(txp_mvcc_flat_versions, trace.size());
         T value {curr->v_};
         tid_type safe_wtid = curr->wtid();
         curr->update_rtid(this->wtid());
@@ -359,6 +463,7 @@ private:
             v_ = value;
             TXP_INCREMENT(txp_mvcc_flat_commits);
             status(COMMITTED);
+            object()->cache_latest(this);
             enqueue_for_committed();
             if (fg) {
                 object()->flattenv_.store(0, std::memory_order_relaxed);
@@ -366,6 +471,9 @@ private:
         } else {
             TXP_INCREMENT(txp_mvcc_flat_spins);
         }
+        if (txp_count >= txp_mvcc_flat_cycles) {
+            TXP_ACCOUNT(txp_mvcc_flat_cycles, read_tsc() - start_tsc);
+        }
     }
 
     comm_type c_;
@@ -381,48 +489,63 @@ public:
     typedef const T& read_type;
     typedef TransactionTid::type tid_type;
 
-    // How many consecutive DELTA versions will be allowed before flattening
-    static constexpr int gc_flattening_length = 257;
+    // Bounds on how many consecutive DELTA versions will be allowed before
+    // flattening. Objects that are never read may grow chains up to the
+    // maximum; each sampled read halves the allowed length down to the
+    // minimum (see flattening_length).
+    static constexpr int gc_flattening_length_min = 16;
+    static constexpr int gc_flattening_length_max = 1024;
+    // One in this many reads of the object is counted towards its read
+    // ratio; must be a power of 2
+    static constexpr unsigned read_sample_rate = 16;
 
 #if MVCC_INLINING
-    MvObject() : h_(&ih_), ih_(this) {
+    MvObject() : h_(&ih_), latest_(&ih_), ih_(this) {
         if (std::is_trivial<T>::value) {
             ih_.v_ = T();
         }
         ih_.status(COMMITTED_DELETED);
     }
     explicit MvObject(const T& value)
-            : h_(&ih_), ih_(this, 0, value) {
+            : h_(&ih_), latest_(&ih_), ih_(this, 0, value) {
         ih_.status(COMMITTED);
     }
     explicit MvObject(T&& value)
-            : h_(&ih_), ih_(this, 0, std::move(value)) {
+            : h_(&ih_), latest_(&ih_), ih_(this, 0, std::move(value)) {
         ih_.status(COMMITTED);
     }
     template <typename... Args>
     explicit MvObject(Args&&... args)
-            : h_(&ih_), ih_(this, 0, T(std::forward<Args>(args)...)) {
+            : h_(&ih_), latest_(&ih_), ih_(this, 0, T(std::forward<Args>(args)...)) {
         ih_.status(COMMITTED);
     }
 #else
     MvObject() : h_(new history_type(this)) {
+        MvCompressor::count_version(sizeof(history_type));
         if (std::is_trivial<T>::value) {
             head()->v_ = T(); /* XXXX */
         }
         head()->status(COMMITTED_DELETED);
+        latest_.store(head(), std::memory_order_relaxed);
     }
     explicit MvObject(const T& value)
             : h_(new history_type(this, 0, value)) {
+        MvCompressor::count_version(sizeof(history_type));
         head()->status(COMMITTED);
+        latest_.store(head(), std::memory_order_relaxed);
     }
     explicit MvObject(T&& value)
             : h_(new history_type(this, 0, std::move(value))) {
+        MvCompressor::count_version(sizeof(history_type));
         head()->status(COMMITTED);
+        latest_.store(head(), std::memory_order_relaxed);
     }
     template <typename... Args>
     explicit MvObject(Args&&... args)
             : h_(new history_type(this, 0, T(std::forward<Args>(args)...))) {
+        MvCompressor::count_version(sizeof(history_type));
         head()->status(COMMITTED);
+        latest_.store(head(), std::memory_order_relaxed);
     }
 #endif
 
@@ -513,8 +636,9 @@ public:
         // rtid update
         hr->update_rtid(tid);
 
-        // Read version consistency check
-        for (history_type* h = head(); h != hr; h = h->prev()) {
+        // Read version consistency check; hr may be a copy of a compressed
+        // version (see find), so stop at its wtid
+        for (history_type* h = head(); h != hr && h->wtid() > hr->wtid(); h = h->prev()) {
             if (!h->status_is(ABORTED) && h->wtid() < tid) {
                 return false;
             }
@@ -527,18 +651,29 @@ public:
     void cp_install(history_type* h) {
         int s = h->status();
         h->assert_status((s & (PENDING | ABORTED)) == PENDING, "cp_install");
+        // Invalidate the latest-version cache before the new version becomes
+        // visible, so cached readers fall back to the chain walk meanwhile
+        bump_latest_wtid(h->wtid());
         h->status((s & ~PENDING) | COMMITTED);
         if (!(s & DELTA)) {
             cuctr_.store(0, std::memory_order_relaxed);
+            decay_reads();
             flattenv_.store(0, std::memory_order_relaxed);
-            h->enqueue_for_committed();
+            cache_latest(h);
+            if (!(s & DELETED) && MvCompressor::applies<T>()) {
+                Transaction::cold_call(cold_version_cb, h);
+            } else {
+                h->enqueue_for_committed();
+            }
         } else {
             int dc = cuctr_.load(std::memory_order_relaxed) + 1;
-            if (dc <= gc_flattening_length) {
+            if (dc <= flattening_length()) {
                 cuctr_.store(dc, std::memory_order_relaxed);
             } else if (flattenv_.load(std::memory_order_relaxed) == 0) {
                 cuctr_.store(0, std::memory_order_relaxed);
+                decay_reads();
                 flattenv_.store(h->wtid(), std::memory_order_relaxed);
+                TXP_INCREMENT(txp_mvcc_flat_scheduled);
                 Transaction::rcu_call(gc_flatten_cb, this);
             }
         }
@@ -552,7 +687,15 @@ public:
     void delete_history(history_type* h) {
         if (is_inlined(h)) {
             h->status_.store(UNUSED, std::memory_order_release);
+        } else if (h->status_is(COMPRESSED)) {
+            auto c = static_cast<MvCompressedHistory*>(static_cast<MvHistoryBase*>(h));
+            MvCompressor::uncount_compressed(sizeof(history_type), c->bytes());
+#if MVCC_GARBAGE_DEBUG
+            memset(static_cast<void*>(c), 0xFF, sizeof(MvHistoryBase));
+#endif
+            MvCompressedHistory::free(c);
         } else {
+            MvCompressor::uncount_version(sizeof(history_type));
 #if MVCC_GARBAGE_DEBUG
             memset(h, 0xFF, sizeof(MvHistoryBase));
 #endif
@@ -564,6 +707,7 @@ public:
     // pending versions, but if toggled off, will simply return first version,
     // regardless of status
     history_type* find(const tid_type tid, const bool wait=true) const {
+        sample_read();
         history_type* h = head();
 
         /* TODO: use something smarter than a linear scan */
@@ -588,6 +732,9 @@ public:
 
         assert(h);
 
+        if (h->status_is(COMPRESSED)) {
+            return h->decompressed_copy();
+        }
         return h;
     }
 
@@ -597,6 +744,12 @@ public:
 
     history_type* find_latest(const bool wait = true) const {
         history_type* h = head();
+        // Waiting readers must still observe pending versions above the
+        // cached one, so they can only use the cache when it is the head
+        history_type* hc = cached_latest();
+        if (hc && (!wait || hc == h)) {
+            return hc;
+        }
         while (true) {
             auto status = h->status();
             h->assert_status(status & (PENDING | ABORTED | COMMITTED), "find_latest");
@@ -634,14 +787,34 @@ public:
             return &ih_;
         }
 #endif
-        return new(std::nothrow) history_type(this, std::forward<Args>(args)...);
+        history_type* h = new(std::nothrow) history_type(this, std::forward<Args>(args)...);
+        if (h) {
+            MvCompressor::count_version(sizeof(history_type));
+        }
+        return h;
+    }
+
+    // Returns the latest committed, flattened version if the cache is
+    // current, or nullptr if a newer version has been installed since
+    history_type* cached_latest() const {
+        history_type* h = latest_.load(std::memory_order_acquire);
+        if (h
+                && (h->status() & (PENDING | ABORTED | COMMITTED_DELTA | LOCKED)) == COMMITTED
+                && h->wtid() >= latest_wtid_.load(std::memory_order_acquire)) {
+            TXP_INCREMENT(txp_mvcc_latest_hits);
+            return h;
+        }
+        TXP_INCREMENT(txp_mvcc_latest_misses);
+        return nullptr;
     }
 
     // Read-only
     const T& nontrans_access() const {
+        if (history_type* hc = cached_latest()) {
+            return hc->v_;
+        }
         history_type* h = head();
         history_type* next = nullptr;
-        /* TODO: head version caching */
         while (h) {
             if (h->status_is(COMMITTED)) {
                 if (h->status_is(DELTA)) {
@@ -657,15 +830,18 @@ public:
     }
     // Writable version
     T& nontrans_access() {
+        if (history_type* hc = cached_latest()) {
+            hc->status_nontrans_commit();
+            return hc->v_;
+        }
         history_type* h = head();
         history_type* next = nullptr;
-        /* TODO: head version caching */
         while (h) {
             if (h->status_is(COMMITTED)) {
                 if (h->status_is(DELTA)) {
                     h->enflatten();
                 }
-                h->status(COMMITTED);
+                h->status_nontrans_commit();
                 return h->v();
             }
             next = h;
@@ -675,7 +851,57 @@ public:
         throw InvalidState();
     }
 
+    // Adaptive flattening policy: the number of consecutive DELTA versions
+    // allowed before a background flatten is scheduled
+    int flattening_length() const {
+        int reads = rdctr_.load(std::memory_order_relaxed);
+        if (reads >= 31) {
+            return gc_flattening_length_min;
+        }
+        return std::max(gc_flattening_length_max >> reads, gc_flattening_length_min);
+    }
+
 protected:
+    // Counts one in every read_sample_rate reads (per thread) towards the
+    // object's read ratio, keeping the shared counter off the common path
+    void sample_read() const {
+        static_assert((read_sample_rate & (read_sample_rate - 1)) == 0,
+                      "read_sample_rate must be a power of 2");
+        if ((++read_sample_tick_ & (read_sample_rate - 1)) == 0) {
+            rdctr_.fetch_add(1, std::memory_order_relaxed);
+            TXP_INCREMENT(txp_mvcc_flat_read_samples);
+        }
+    }
+
+    // Ages the read ratio whenever the delta chain is cut, so objects that
+    // stop being read drift back towards long chains
+    void decay_reads() {
+        int reads = rdctr_.load(std::memory_order_relaxed);
+        if (reads) {
+            rdctr_.store(reads >> 1, std::memory_order_relaxed);
+        }
+    }
+
+    // Records h as the latest committed, flattened version unless the cache
+    // already holds a newer one
+    void cache_latest(history_type* h) {
+        history_type* hc = latest_.load(std::memory_order_acquire);
+        while ((!hc || hc->wtid() <= h->wtid())
+               && !latest_.compare_exchange_weak(hc, h,
+                                                 std::memory_order_release,
+                                                 std::memory_order_acquire)) {
+        }
+    }
+
+    void bump_latest_wtid(tid_type wtid) {
+        tid_type prev = latest_wtid_.load(std::memory_order_relaxed);
+        while (prev < wtid
+               && !latest_wtid_.compare_exchange_weak(prev, wtid,
+                                                      std::memory_order_release,
+                                                      std::memory_order_relaxed)) {
+        }
+    }
+
     static void gc_flatten_cb(void* ptr) {
         auto object = static_cast<MvObject<T>*>(ptr);
         auto flattenv = object->flattenv_.load(std::memory_order_relaxed);
@@ -696,13 +922,70 @@ protected:
         }
     }
 
+    // Stands in for gc_committed_cb on versions of compressible objects.
+    // If the version outlives cold_age epochs, the version it superseded
+    // is compressed for the old snapshots that still read it, and
+    // collected right away (it is freed once those snapshots end).
+    static void cold_version_cb(void* ptr) {
+        history_type* h = static_cast<history_type*>(ptr);
+        if (Transaction::cold_expiring()) {
+            history_type::gc_committed_cb(h);
+        } else {
+            h->object()->compress_prev(h);
+        }
+    }
+
+    void compress_prev(history_type* h) {
+        std::atomic<MvHistoryBase*>* link = &h->prev_;
+        history_type* p = h->prev();
+        while (p && p->status_is(ABORTED)) {
+            link = &p->prev_;
+            p = p->prev();
+        }
+        // Collecting early is only safe once no running transaction can
+        // insert below h, and with no delta in reach of a flatten
+        MvStatus ps = p ? p->status() : COMMITTED;
+        if (h->wtid() >= Transaction::cold_tid_bound()
+            || (ps & (PENDING | COMMITTED_DELTA | LOCKED)) != COMMITTED) {
+            Transaction::rcu_call(history_type::gc_committed_cb, h);
+            return;
+        }
+        // p must be done with its own gc_committed_cb (SWEPT), which holds
+        // it by pointer. Copies read from the compressed version do not
+        // keep its rtid, which no longer matters for the same reason.
+        if (p && !is_inlined(p)
+            && (ps & (DELETED | GARBAGE | SWEPT | COMPRESSED)) == SWEPT) {
+            if (MvCompressedHistory* c = MvCompressedHistory::make(p, &p->v_, sizeof(T))) {
+                MvHistoryBase* expected = p;
+                if (link->compare_exchange_strong(expected, c)) {
+                    MvCompressor::count_compressed(sizeof(history_type), c->bytes());
+                    // readers may still hold the original
+                    Transaction::rcu_delete(p);
+                } else {
+                    MvCompressedHistory::free(c);
+                }
+            }
+        }
+        history_type::gc_committed_cb(h);
+    }
+
     std::atomic<MvHistoryBase*> h_;
     std::atomic<int> cuctr_ = 0;  // For gc-time flattening
+    mutable std::atomic<int> rdctr_ = 0;  // Sampled reads, for adaptive flattening
     std::atomic<tid_type> flattenv_;
+    // Hot-version cache: the latest committed, non-delta version, valid only
+    // while no newer version has been installed (see cached_latest)
+    std::atomic<history_type*> latest_;
+    std::atomic<tid_type> latest_wtid_ = 0;
 
 #if MVCC_INLINING
     history_type ih_;  // Inlined version
 #endif
 
+    static __thread unsigned read_sample_tick_;
+
     friend class MvHistory<T>;
 };
+
+template <typename T>
+__thread unsigned MvObject<T>::read_sample_tick_;
@@ -5,6 +5,8 @@
 // Default STO/Silo OCC version (with opacity)
 class TVersion : public BasicVersion<TVersion> {
 public:
+    static constexpr bool honors_cc_mode = true;
+
     TVersion() = default;
     explicit TVersion(type v)
             : BasicVersion(v) {}
@@ -31,6 +33,8 @@ public:
 // STO/Silo OCC version without opacity
 class TNonopaqueVersion : public BasicVersion<TNonopaqueVersion> {
 public:
+    static constexpr bool honors_cc_mode = true;
+
     TNonopaqueVersion()
             : BasicVersion<TNonopaqueVersion>(TransactionTid::nonopaque_bit) {}
     explicit TNonopaqueVersion(type v)
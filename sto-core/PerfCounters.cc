@@ -0,0 +1,203 @@
+#include "PerfCounters.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+bool PerfCounters::enabled_ = true;
+std::atomic<unsigned> PerfCounters::available_mask_;
+std::atomic<unsigned> PerfCounters::rdpmc_threads_;
+std::atomic<unsigned> PerfCounters::read_threads_;
+std::atomic<int> PerfCounters::open_errno_;
+__thread PerfCounters::thread_state PerfCounters::state_;
+PerfCounters::thread_phases PerfCounters::phases_[MAX_THREADS];
+
+namespace {
+
+struct event_config {
+    uint32_t type;
+    uint64_t config;
+    const char* name;
+};
+
+const event_config events[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "LLC misses"},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB
+                         | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                         | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), "dTLB misses"}
+};
+
+}
+
+void PerfCounters::configure(bool on) {
+    enabled_ = on;
+}
+
+const char* PerfCounters::event_name(int e) {
+    return events[e].name;
+}
+
+bool PerfCounters::thread_init() {
+    thread_state& st = state_;
+    st.tried = true;
+    st.nopen = 0;
+    int leader = -1;
+    long page_size = sysconf(_SC_PAGESIZE);
+    bool mapped = true;
+
+    for (int e = 0; e != ev_count; ++e) {
+        st.fd[e] = -1;
+        st.slot[e] = -1;
+        st.page[e] = nullptr;
+
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[e].type;
+        attr.config = events[e].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        int fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fd < 0) {
+            // the first event to open leads the group
+            int expected = 0;
+            open_errno_.compare_exchange_strong(expected, errno);
+            continue;
+        }
+        if (leader < 0)
+            leader = fd;
+        st.fd[e] = fd;
+        st.slot[e] = st.nopen++;
+        available_mask_.fetch_or(1u << e);
+
+        void* p = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED || !static_cast<perf_event_mmap_page*>(p)->cap_user_rdpmc) {
+            if (p != MAP_FAILED)
+                munmap(p, page_size);
+            mapped = false;
+        } else
+            st.page[e] = p;
+    }
+
+    st.opened = st.nopen != 0;
+    st.rdpmc = st.opened && mapped;
+    if (st.rdpmc)
+        ++rdpmc_threads_;
+    else if (st.opened)
+        ++read_threads_;
+    return st.opened;
+}
+
+void PerfCounters::read_counters(sample& s) {
+    if (!state_.rdpmc || !read_mapped(s))
+        read_group(s);
+}
+
+// Reads each counter with rdpmc, following the perf_event_mmap_page
+// seqlock. Fails if an event is not on a counter right now (multiplexed,
+// or the thread is being migrated); the group read handles that.
+bool PerfCounters::read_mapped(sample& s) {
+    for (int e = 0; e != ev_count; ++e) {
+        auto pc = static_cast<volatile perf_event_mmap_page*>(state_.page[e]);
+        if (!pc) {
+            s.v[e] = 0;
+            continue;
+        }
+        uint32_t seq;
+        uint64_t count;
+        do {
+            seq = pc->lock;
+            fence();
+            uint32_t idx = pc->index;
+            if (!pc->cap_user_rdpmc || !idx)
+                return false;
+            unsigned shift = 64 - pc->pmc_width;
+            int64_t pmc = int64_t(read_pmc(idx - 1) << shift) >> shift;
+            count = pc->offset + pmc;
+            fence();
+        } while (pc->lock != seq);
+        s.v[e] = count;
+    }
+    return true;
+}
+
+void PerfCounters::read_group(sample& s) {
+    uint64_t buf[1 + ev_count];
+    int leader = -1;
+    for (int e = 0; e != ev_count && leader < 0; ++e)
+        leader = state_.fd[e];
+    ssize_t n = ::read(leader, buf, sizeof(buf));
+    bool ok = n >= ssize_t(sizeof(uint64_t)) && buf[0] == uint64_t(state_.nopen);
+    for (int e = 0; e != ev_count; ++e)
+        s.v[e] = ok && state_.slot[e] >= 0 ? buf[1 + state_.slot[e]] : 0;
+}
+
+std::string PerfCounters::status() {
+    std::stringstream ss;
+    if (!enabled_)
+        ss << "disabled";
+    else if (rdpmc_threads_ + read_threads_ == 0) {
+        ss << "unavailable";
+        if (int err = open_errno_.load())
+            ss << " (" << strerror(err) << ")";
+        ss << ", TSC only";
+    } else {
+        ss << (read_threads_ == 0 ? "rdpmc" : rdpmc_threads_ == 0 ? "read(2)" : "rdpmc and read(2)");
+        for (int e = 0; e != ev_count; ++e)
+            if (!available(e))
+                ss << ", no " << event_name(e);
+    }
+    return ss.str();
+}
+
+PerfCounters::totals PerfCounters::phase_totals(int phase) {
+    totals t {};
+    for (auto& tp : phases_) {
+        auto& p = tp.p[phase];
+        t.tsc += p.tsc;
+        for (int e = 0; e != ev_count; ++e)
+            t.v[e] += p.v[e];
+        t.scopes += p.scopes;
+    }
+    return t;
+}
+
+void PerfCounters::print_phases(std::ostream& out, const char* const names[], int nphases,
+                                double tsc_ghz) {
+    out << "$ Hardware counters by phase: " << status() << std::endl;
+    bool counted = rdpmc_threads_ + read_threads_ != 0;
+    for (int i = 0; i != nphases && i != max_phases; ++i) {
+        totals t = phase_totals(i);
+        if (!t.scopes)
+            continue;
+        out << "   " << names[i] << ": " << t.scopes << " scopes, "
+            << std::fixed << std::setprecision(3) << t.tsc / tsc_ghz / 1e6 << " ms";
+        if (counted) {
+            double kinstr = t.v[ev_instructions] / 1000.0;
+            if (available(ev_cycles) && available(ev_instructions) && t.v[ev_cycles])
+                out << ", IPC " << std::setprecision(2) << double(t.v[ev_instructions]) / t.v[ev_cycles];
+            for (int e : {ev_llc_misses, ev_dtlb_misses})
+                if (available(e)) {
+                    out << ", " << event_name(e) << ' ' << t.v[e];
+                    if (kinstr)
+                        out << " (" << std::setprecision(2) << t.v[e] / kinstr << "/kinstr)";
+                }
+        }
+        out << std::defaultfloat << std::endl;
+    }
+}
+
+void PerfCounters::reset() {
+    for (auto& tp : phases_)
+        for (auto& p : tp.p)
+            p = totals();
+}
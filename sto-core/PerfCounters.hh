@@ -0,0 +1,105 @@
+// In-process hardware performance counters for transaction phases
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "compiler.hh"
+#include "TThread.hh"
+
+// Each thread opens one perf_event_open group counting its own user-mode
+// cycles, instructions, LLC misses and dTLB load misses. A sample reads the
+// group with rdpmc when the kernel allows it (perf_event_mmap_page
+// cap_user_rdpmc) and with one group read(2) otherwise. If the group cannot
+// be opened at all (no PMU, perf_event_paranoid, seccomp...), samples carry
+// only the TSC.
+//
+// Phases are accumulated per thread: account(phase, start) adds the
+// difference between `start` and now to `phase`. Transaction does this for
+// its TimingCounters when built with STO_HW_COUNTERS (see TimeKeeper).
+class PerfCounters {
+public:
+    enum event { ev_cycles = 0, ev_instructions, ev_llc_misses, ev_dtlb_misses, ev_count };
+    static constexpr int max_phases = 8;
+
+    struct sample {
+        uint64_t tsc;
+        uint64_t v[ev_count];
+    };
+
+    // Counting is on by default; turn it off before threads start sampling
+    static void configure(bool on);
+    static bool enabled() {
+        return enabled_;
+    }
+
+    // Opens the calling thread's group on first use. Returns false if the
+    // thread counts nothing but the TSC.
+    static bool thread_init();
+    static void read(sample& s) {
+        s.tsc = read_tsc();
+        if (enabled_ && (state_.opened || (!state_.tried && thread_init())))
+            read_counters(s);
+        else
+            for (int e = 0; e != ev_count; ++e)
+                s.v[e] = 0;
+    }
+
+    static void account(int phase, const sample& start) {
+        sample now;
+        read(now);
+        auto& p = phases_[TThread::id()].p[phase];
+        p.tsc += now.tsc - start.tsc;
+        for (int e = 0; e != ev_count; ++e)
+            p.v[e] += now.v[e] - start.v[e];
+        ++p.scopes;
+    }
+
+    // Whether any thread counted `e`
+    static bool available(int e) {
+        return available_mask_ & (1u << e);
+    }
+    // How counters were read: "rdpmc", "read(2)", or why they were not
+    static std::string status();
+    static const char* event_name(int e);
+
+    struct totals {
+        uint64_t tsc;
+        uint64_t v[ev_count];
+        uint64_t scopes;
+    };
+    static totals phase_totals(int phase);
+    // One line per phase with scopes; `names[i]` names phase i
+    static void print_phases(std::ostream& out, const char* const names[], int nphases,
+                             double tsc_ghz);
+    static void reset();
+
+private:
+    struct thread_state {
+        bool tried;
+        bool opened;
+        bool rdpmc;
+        int nopen;
+        int fd[ev_count];
+        int slot[ev_count];     // position in the group read, or -1
+        void* page[ev_count];   // perf_event_mmap_page, or nullptr
+    };
+    struct __attribute__((aligned(64))) thread_phases {
+        totals p[max_phases];
+    };
+
+    static bool enabled_;
+    static std::atomic<unsigned> available_mask_;
+    static std::atomic<unsigned> rdpmc_threads_;
+    static std::atomic<unsigned> read_threads_;
+    static std::atomic<int> open_errno_;
+    static __thread thread_state state_;
+    static thread_phases phases_[MAX_THREADS];
+
+    static void read_counters(sample& s);
+    static bool read_mapped(sample& s);
+    static void read_group(sample& s);
+};
@@ -4,4 +4,5 @@
 #include "Transaction.hh"
 #include "TransItem.hh"
 #include "ConcurrencyControl.hh"
+#include "CCPolicy.hh"
 #include "TWrapped.hh"
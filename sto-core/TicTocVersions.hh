@@ -9,6 +9,22 @@ public:
 
     static constexpr type ts_shift = TransactionTid::mask_width + 5;
 
+    // Batched read timestamp extension. A validating read extends a row's
+    // rts to its commit ts; if the rts was already extended since the row's
+    // last write, the row is read-hot and the rts is extended extend_batch
+    // further, so that later readers need not CAS it again. Writers to the
+    // row then commit after the extended rts. 0 disables batching.
+    static type extend_batch;
+
+    // The rts a reader committing at commit_ts should extend a row to
+    static type extended_rts(type rts, type wts, type commit_ts) {
+        if (extend_batch && rts > wts) {
+            TXP_INCREMENT(txp_tictoc_rts_batched);
+            return commit_ts + extend_batch;
+        }
+        return commit_ts;
+    }
+
     static type timestamp(type ts) {
         return ts >> ts_shift;
     }
@@ -46,9 +62,12 @@ public:
                     || ((timestamp(t_rts) < commit_ts) && is_locked_elsewhere(t_rts)))
                     return false;
                 if (timestamp(t_rts) < commit_ts) {
-                    type v = commit_ts << ts_shift | (t_rts & (increment_value - 1));
+                    type ext = extended_rts(timestamp(t_rts), timestamp(t_wts), commit_ts);
+                    type v = ext << ts_shift | (t_rts & (increment_value - 1));
+                    TXP_INCREMENT(txp_tictoc_rts_cas);
                     if (bool_cmpxchg(&tuple_rts, t_rts, v))
                         return true;
+                    TXP_INCREMENT(txp_tictoc_rts_cas_failures);
                 } else {
                     return true;
                 }
@@ -94,10 +113,19 @@ public:
 
     // |-----WTS value-----|-delta-|--TTid bits--|
     //        44 bits       8 bits    12 bits
+    //
+    // rts is wts + delta. Extending the rts past the largest delta moves the
+    // wts forward instead (the paper's delta overflow rule), although no
+    // write happened in between, so a concurrent reader that observed the
+    // older wts then fails validation. No history of earlier (wts, rts)
+    // pairs is kept, so the paper's timestamp-history check, which would
+    // let such readers and readers of overwritten versions still commit,
+    // is not implemented.
 
     static constexpr type delta_shift = type(12);
     static constexpr type wts_shift = type(20);
-    static constexpr type delta_mask = type(0xff) << delta_shift;
+    static constexpr type delta_max = type(0xff);
+    static constexpr type delta_mask = delta_max << delta_shift;
 
     static type wts_value(type t) {
         return t >> wts_shift;
@@ -129,14 +157,18 @@ public:
                     ((rts_value(v) < commit_ts) && is_locked_elsewhere(t)))
                     return false;
                 if (rts_value(v) < commit_ts) {
-                    type vv = v;
-                    type delta = commit_ts - wts_value(v);
-                    type shift = delta - (delta & 0xff);
-                    vv += (shift << wts_shift);
-                    vv &= ~delta_mask;
-                    vv |= (delta & 0xff << delta_shift);
+                    type ext = TicTocTid::extended_rts(rts_value(v), wts_value(v), commit_ts);
+                    type wts = wts_value(v);
+                    if (ext - wts > delta_max) {
+                        wts = ext - delta_max;
+                        TXP_INCREMENT(txp_tictoc_wts_shifts);
+                    }
+                    type vv = (wts << wts_shift) | ((ext - wts) << delta_shift)
+                        | (v & (increment_value - 1));
+                    TXP_INCREMENT(txp_tictoc_rts_cas);
                     if (bool_cmpxchg(&t, v, vv))
                         return true;
+                    TXP_INCREMENT(txp_tictoc_rts_cas_failures);
                 } else {
                     return true;
                 }
@@ -293,11 +325,11 @@ public:
 
     TicTocCompressedVersion() : BV(1 << TicTocCompressedTid::wts_shift) {}
     explicit TicTocCompressedVersion(type v) {
-        v_ = (v / TransactionTid::increment_value) << TicTocCompressedTid::wts_shift;
+        v_ = compress(v);
     }
     explicit TicTocCompressedVersion(type v, bool insert) {
         (void)insert;
-        v_ = (v / TransactionTid::increment_value) << TicTocCompressedTid::wts_shift;
+        v_ = compress(v);
     }
 
     bool is_locked() const {
@@ -331,10 +363,10 @@ public:
     static inline type& cp_access_tid_impl(Transaction& txn);
     inline type cp_commit_tid_impl(Transaction& txn);
 
-    void cp_set_version_unlock(type new_ts) {
+    void cp_set_version_unlock_impl(type new_ts) {
         TicTocCompressedTid::set_timestamps_unlock(v_, new_ts, 0);
     }
-    void cp_set_version(type new_ts) {
+    void cp_set_version_impl(type new_ts) {
         TicTocCompressedTid::set_timestamps(v_, new_ts, 0);
     }
 
@@ -364,4 +396,12 @@ public:
 
 private:
     explicit TicTocCompressedVersion(const rdata_t& rd) : BV(reinterpret_cast<type>(rd.v)) {}
+
+    // Converts a TID to a wts, keeping its flag bits (but not its lock) as
+    // TicTocVersion does
+    static type compress(type v) {
+        constexpr type flags = (TransactionTid::increment_value - 1)
+            & ~(TransactionTid::lock_bit | TransactionTid::threadid_mask);
+        return ((v / TransactionTid::increment_value) << TicTocCompressedTid::wts_shift) | (v & flags);
+    }
 };
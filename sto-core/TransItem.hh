@@ -220,6 +220,14 @@ class TransItem {
         __rm_flags(lock_bit);
         return *this;
     }
+    // Has the owner's unlock() run when the transaction commits or aborts.
+    // For an item that is neither read nor written, this is a pure
+    // end-of-transaction hook: it is not checked, locked or installed, and
+    // leaves a read-only transaction read-only.
+    TransItem& add_needs_unlock() {
+        __or_flags(lock_bit);
+        return *this;
+    }
 
     CCMode cc_mode() const {
         return mode_;
@@ -352,6 +360,14 @@ class TransProxy {
     template <typename T>
     inline TransProxy& update_read(T old_rdata, T new_rdata);
 
+    // Opt-in transaction repair: if this item's read of `vers` fails the
+    // commit check, re-read `vers` and call `fn(arg)` to redo the work that
+    // depended on it instead of aborting. `fn` returns false to give up.
+    // A transaction holds a few registrations at most; past that, a stale
+    // read aborts as usual.
+    template <typename VersImpl>
+    inline TransProxy& add_repair(const VersionBase<VersImpl>& vers, bool (*fn)(void*), void* arg);
+
     inline TransProxy& set_predicate();
     template <typename T>
     inline TransProxy& set_predicate(T pdata);
@@ -539,6 +555,10 @@ private:
         return t_;
     }
 
+    // Snapshots `vers` into `item`'s read data before a repair
+    template <typename VersImpl>
+    static bool reread_version(Transaction& txn, TransItem& item, const void* vers);
+
     template <typename VersImpl>
     friend class VersionBase;
 
@@ -4,6 +4,8 @@
 #include <cstring>
 #include <cassert>
 
+#include "HugeArena.hh"
+
 class TransScratch {
 public:
     static constexpr size_t initial_zone_capacity = 4096; // 4KB
@@ -16,7 +18,7 @@ public:
     explicit TransScratch(size_t init_size)
             : tail_next_avail(0), tail_capacity(init_size),
               total_capacity(init_size) {
-        auto z = new char [sizeof(zone_hdr) + init_size];
+        auto z = allocate_zone(init_size);
         new (reinterpret_cast<zone_hdr *>(z)) zone_hdr(init_size);
         zone_head = zone_tail = reinterpret_cast<zone_hdr *>(z);
     }
@@ -40,6 +42,10 @@ private:
         zone_hdr *next;
     };
 
+    static char *allocate_zone(size_t zone_size) {
+        return static_cast<char *>(HugeArena::allocate(sizeof(zone_hdr) + zone_size));
+    }
+
 protected:
     size_t tail_next_avail;
     size_t tail_capacity;
@@ -57,7 +63,7 @@ T& TransScratch::allocate() {
         size_t new_capacity = (tail_capacity > 0) ? (tail_capacity * 2) : initial_zone_capacity;
         assert(new_capacity > sizeof(T));
 
-        auto z = new char [sizeof(zone_hdr) + new_capacity];
+        auto z = allocate_zone(new_capacity);
         auto new_zone = reinterpret_cast<zone_hdr *>(z);
         new (new_zone) zone_hdr(new_capacity);
 
@@ -108,7 +114,7 @@ void TransScratch::clear() {
     while (curr != nullptr) {
         auto next_zone = curr->next;
         capacity_check += curr->length;
-        delete[] curr;
+        HugeArena::deallocate(curr, sizeof(zone_hdr) + curr->length);
         curr = next_zone;
     }
     assert(capacity_check == total_capacity);
@@ -117,7 +123,7 @@ void TransScratch::clear() {
     if (total_capacity > max_scratch_restart_capacity)
         total_capacity = max_scratch_restart_capacity;
 
-    auto z = new char [sizeof(zone_hdr) + total_capacity];
+    auto z = allocate_zone(total_capacity);
     auto single_zone = reinterpret_cast<zone_hdr *>(z);
     new (single_zone) zone_hdr(total_capacity);
 
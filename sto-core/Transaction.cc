@@ -12,6 +12,7 @@ Transaction::testing_type Transaction::testing;
 threadinfo_t Transaction::tinfo[MAX_THREADS];
 __thread int TThread::the_id;
 PercentGen TThread::gen[MAX_THREADS];
+TLockReaders::row_type TLockReaders::rows[MAX_THREADS];
 
 Transaction::epoch_state __attribute__((aligned(128))) Transaction::global_epochs = {
     {2}, {1}, {0}, TransactionTid::increment_value, true
@@ -24,6 +25,11 @@ std::atomic<TransactionTid::type> __attribute__((aligned(128)))
     Transaction::_RTID(2 * TransactionTid::increment_value);
    // reserve TransactionTid::increment_value for prepopulated
 unsigned Transaction::us_per_epoch = 1000;  // Defaults to 1ms
+unsigned Transaction::validate_every = 0;
+unsigned Transaction::cold_age = 0;
+__thread bool Transaction::cold_expiring_;
+__thread TransactionTid::type Transaction::cold_tid_bound_;
+TicTocTid::type TicTocTid::extend_batch = 0;
 
 static void __attribute__((used)) check_static_assertions() {
     static_assert(sizeof(threadinfo_t) % 128 == 0, "threadinfo is 2-cache-line aligned");
@@ -39,6 +45,9 @@ void Transaction::initialize() {
 #endif
     commit_tid_ = 0;
     prev_commit_tid_ = 0;
+    fallback_ = serial_ = false;
+    nrestarts_ = nhot_ = nreads_ = 0;
+    abort_item_ = nullptr;
     for (unsigned i = 0; i != tset_initial_capacity / tset_chunk; ++i)
         tset_[i] = &tset0_[i * tset_chunk];
     for (unsigned i = tset_initial_capacity / tset_chunk; i != arraysize(tset_); ++i)
@@ -50,15 +59,22 @@ Transaction::~Transaction() {
         silent_abort();
     TransItem* live = tset0_;
     for (unsigned i = 0; i != arraysize(tset_); ++i, live += tset_chunk)
-        if (live != tset_[i])
-            delete[] tset_[i];
+        if (live != tset_[i] && tset_[i])
+            HugeArena::deallocate(tset_[i], sizeof(TransItem) * tset_chunk, alignof(TransItem));
 }
 
 void Transaction::refresh_tset_chunk() {
     assert(tset_size_ % tset_chunk == 0);
     assert(tset_size_ < tset_max_capacity);
-    if (!tset_[tset_size_ / tset_chunk])
-        tset_[tset_size_ / tset_chunk] = new TransItem[tset_chunk];
+    static_assert(std::is_trivially_destructible<TransItem>::value,
+                  "tset chunks are freed without destroying their items");
+    if (!tset_[tset_size_ / tset_chunk]) {
+        auto chunk = static_cast<TransItem*>(
+            HugeArena::allocate(sizeof(TransItem) * tset_chunk, alignof(TransItem)));
+        for (unsigned i = 0; i != tset_chunk; ++i)
+            new (&chunk[i]) TransItem;
+        tset_[tset_size_ / tset_chunk] = chunk;
+    }
     tset_next_ = tset_[tset_size_ / tset_chunk];
 }
 
@@ -121,6 +137,32 @@ void Transaction::epoch_advance_once() {
     }
 }
 
+// Like the minimum wtid, but ignoring transactions that have not written:
+// they will commit above the current _TID
+auto Transaction::min_commit_tid() -> tid_type {
+    tid_type min_tid = _TID.load(std::memory_order_relaxed);
+    for (auto& t : tinfo) {
+        fence();
+        tid_type ctid = t.commit_tid;
+        if (ctid != 0 && ctid < min_tid)
+            min_tid = ctid;
+    }
+    fence();
+    return min_tid;
+}
+
+void Transaction::clean_cold(threadinfo_t& thr, epoch_type active_epoch) {
+    // Callbacks before active_epoch are about to see their versions freed
+    cold_expiring_ = true;
+    thr.cold_set.clean_until(active_epoch);
+    cold_expiring_ = false;
+    epoch_type cold_epoch = global_epochs.global_epoch.load(std::memory_order_acquire) - cold_age;
+    if (signed_epoch_type(cold_epoch - active_epoch) > 0 && !thr.cold_set.empty()) {
+        cold_tid_bound_ = min_commit_tid();
+        thr.cold_set.clean_until(cold_epoch);
+    }
+}
+
 bool Transaction::preceding_duplicate_read(TransItem* needle) const {
     const TransItem* it = nullptr;
     for (unsigned tidx = 0; ; ++tidx) {
@@ -192,12 +234,141 @@ void Transaction::callCMstart() {
 #if CONTENTION_REGULATION
     ContentionManager::start(this);
 #endif
+    if (ContentionManager::lock_policy != LockPolicy::spin)
+        ContentionManager::start_locking(threadid_, restarted);
+}
+
+bool Transaction::validate() {
+    nreads_ = 0;
+    // Snapshot (MVCC) reads are validated against the commit tid, which
+    // doesn't exist yet
+    if (state_ != s_in_progress || read_tid_)
+        return true;
+
+    TXP_INCREMENT(txp_early_validations);
+    TransItem* it = nullptr;
+    for (unsigned tidx = 0; tidx != tset_size_; ++tidx) {
+        it = (tidx % tset_chunk ? it + 1 : tset_[tidx / tset_chunk]);
+        if (it->has_read()) {
+            // locked reads can't go stale; TicToc checks extend timestamps
+            if (it->needs_unlock() || it->cc_mode() == CCMode::tictoc)
+                continue;
+            if (!it->owner()->check(*it, *this)
+                && (!may_duplicate_items_ || !preceding_duplicate_read(it))) {
+                mark_abort_because(it, "early validation");
+                goto abort;
+            }
+        } else if (it->has_predicate()) {
+            if (!it->owner()->check_predicate(*it, *this, false)) {
+                mark_abort_because(it, "early validation check_predicate");
+                goto abort;
+            }
+        }
+    }
+    return true;
+
+abort:
+    TXP_INCREMENT(txp_early_aborts);
+    return false;
+}
+
+// Transaction repair: called at commit, with the write set locked, when
+// `item`'s read fails its check. Reruns the fragments registered on `item`
+// (TransProxy::add_repair) and rechecks it, a few times at most. Fragments
+// may rewrite items this transaction already locked; any other new access
+// fails the repair.
+bool Transaction::repair(TransItem* item) {
+    constexpr int max_attempts = 4;
+    for (int attempt = 0; attempt != max_attempts; ++attempt) {
+        unsigned size = tset_size_;
+        bool any = false;
+        for (unsigned i = 0; i != nrepairs_; ++i) {
+            repair_entry& r = repairs_[i];
+            if (r.item == item) {
+                any = true;
+                if (!r.reread(*this, *item, r.vers) || !r.fn(r.arg))
+                    goto fail;
+            }
+        }
+        if (!any)
+            return false;
+        if (tset_size_ != size)
+            goto fail;
+        TransItem* it = nullptr;
+        for (unsigned tidx = 0; tidx != tset_size_; ++tidx) {
+            it = (tidx % tset_chunk ? it + 1 : tset_[tidx / tset_chunk]);
+            if (it->has_write() && !it->needs_unlock())
+                goto fail;
+        }
+        if (item->owner()->check(*item, *this)) {
+            TXP_INCREMENT(txp_repairs);
+            return true;
+        }
+    }
+fail:
+    TXP_INCREMENT(txp_repair_failures);
+    return false;
+}
+
+void Transaction::start_fallback() {
+    unsigned k = ContentionManager::fallback_aborts;
+    if (k && nrestarts_ >= k) {
+        fallback_ = true;
+        TXP_INCREMENT(txp_fallback_runs);
+    }
+    k = ContentionManager::serial_aborts;
+    if (k && nrestarts_ >= k && !serial_) {
+        ContentionManager::acquire_serial_token();
+        serial_ = true;
+        TXP_INCREMENT(txp_serial_runs);
+    }
+}
+
+bool Transaction::is_hot(const TransItem& item) const {
+    unsigned n = std::min(nhot_, hot_capacity);
+    for (unsigned i = 0; i != n; ++i)
+        if (hot_[i].owner == item.owner() && hot_[i].key == item.key_)
+            return true;
+    return false;
+}
+
+void Transaction::remember_hot(const TransItem& item) {
+    if (!is_hot(item)) {
+        hot_[nhot_ % hot_capacity] = hot_item{item.owner(), item.key_};
+        ++nhot_;
+    }
+}
+
+static void account_retries(unsigned n) {
+    if (n == 0)
+        TXP_INCREMENT(txp_retries_0);
+    else if (n == 1)
+        TXP_INCREMENT(txp_retries_1);
+    else if (n < 4)
+        TXP_INCREMENT(txp_retries_2);
+    else if (n < 8)
+        TXP_INCREMENT(txp_retries_4);
+    else if (n < 16)
+        TXP_INCREMENT(txp_retries_8);
+    else if (n < 32)
+        TXP_INCREMENT(txp_retries_16);
+    else
+        TXP_INCREMENT(txp_retries_32);
 }
 
 void Transaction::stop(bool committed, unsigned* writeset, unsigned nwriteset) {
 #if STO_TSC_PROFILE
     TimeKeeper<tc_cleanup> tk;
 #endif
+    if (committed) {
+        account_retries(nrestarts_);
+        nrestarts_ = nhot_ = 0;
+    } else {
+        ++nrestarts_;
+        if (abort_item_ && ContentionManager::fallback_aborts)
+            remember_hot(*abort_item_);
+    }
+
     if (!committed) {
         TXP_INCREMENT(txp_total_aborts);
 #if STO_DEBUG_ABORTS
@@ -282,10 +453,16 @@ unlock_all:
     if (thr.trans_end_callback)
         thr.trans_end_callback();
     thr.wtid.store(0, std::memory_order_release);
+    thr.commit_tid.store(0, std::memory_order_release);
     // XXX should reset trans_end_callback after calling it...
     state_ = s_aborted + committed;
     restarted = true;
 
+    if (serial_) {
+        ContentionManager::release_serial_token();
+        serial_ = false;
+    }
+
 #if CONTENTION_REGULATION
     if (!committed) {
        ContentionManager::on_rollback(TThread::id());
@@ -300,6 +477,10 @@ unlock_all:
     if (!committed)
         TSC_ACCOUNT(tc_abort, endtime - start_tsc_);
 #endif
+#if STO_HW_COUNTERS
+    if (!committed)
+        PerfCounters::account(tc_abort, start_pcs_);
+#endif
 
     //COZ_PROGRESS;
 }
@@ -410,13 +591,17 @@ bool Transaction::try_commit() {
     fence();
 #endif
 
+    fence();
+    commit_epoch_ = global_epochs.global_epoch.load(std::memory_order_acquire);
+
     //phase2
     for (unsigned tidx = 0; tidx != tset_size_; ++tidx) {
         it = (tidx % tset_chunk ? it + 1 : tset_[tidx / tset_chunk]);
         if (it->has_read() && (it->locked_at_commit() || !it->needs_unlock())) {
             TXP_INCREMENT(txp_total_check_read);
             if (!it->owner()->check(*it, *this)
-                && (!may_duplicate_items_ || !preceding_duplicate_read(it))) {
+                && (!may_duplicate_items_ || !preceding_duplicate_read(it))
+                && (!nrepairs_ || !repair(it))) {
                 mark_abort_because(it, "commit check");
                 goto abort;
             }
@@ -464,6 +649,9 @@ abort:
 #if STO_TSC_PROFILE
     auto endtime = read_tsc();
     TSC_ACCOUNT(tc_commit_wasted, endtime - tk.init_tsc_val());
+#endif
+#if STO_HW_COUNTERS
+    PerfCounters::account(tc_commit_wasted, tk.init_pcs_val());
 #endif
     return false;
 }
@@ -549,6 +737,49 @@ void Transaction::print_stats() {
         fprintf(stderr, "$        Spinning runs: %llu\n", out.p(txp_mvcc_flat_spins));
         fprintf(stderr, "$     Avg spins/commit: %.3f\n", 1.0 * out.p(txp_mvcc_flat_spins) / out.p(txp_mvcc_flat_commits));
     }
+    if (txp_count >= txp_mvcc_flat_read_samples) {
+        fprintf(stderr, "$       Avg cycles/run: %.3f\n", 1.0 * out.p(txp_mvcc_flat_cycles) / out.p(txp_mvcc_flat_runs));
+        fprintf(stderr, "$  Scheduled (gc) runs: %llu\n", out.p(txp_mvcc_flat_scheduled));
+        fprintf(stderr, "$ Sampled object reads: %llu\n", out.p(txp_mvcc_flat_read_samples));
+    }
+    if (txp_count >= txp_commute_escrow_aborts)
+        fprintf(stderr, "$ %llu commutative updates aborted by escrow bounds\n", out.p(txp_commute_escrow_aborts));
+    if (txp_count >= txp_split_updates)
+        fprintf(stderr, "$ %llu split phases, %llu reconciliations, %llu split-phase updates\n",
+                out.p(txp_split_phases), out.p(txp_split_reconciles), out.p(txp_split_updates));
+    if (txp_count >= txp_lock_wounds)
+        fprintf(stderr, "$ 2PL lock policy: %llu wait spins, %llu dies, %llu wounds\n",
+                out.p(txp_lock_waits), out.p(txp_lock_dies), out.p(txp_lock_wounds));
+    if (txp_count >= txp_lock_cascades)
+        fprintf(stderr, "$ 2PL early release: %llu retired write locks, %llu cascading aborts\n",
+                out.p(txp_lock_retires), out.p(txp_lock_cascades));
+    if (txp_count >= txp_lock_bias_revokes)
+        fprintf(stderr, "$ 2PL reader bias: %llu revocations\n", out.p(txp_lock_bias_revokes));
+    if (txp_count >= txp_serial_runs) {
+        fprintf(stderr, "$ Retries before commit: 0: %llu, 1: %llu, 2-3: %llu, 4-7: %llu, 8-15: %llu, 16-31: %llu, 32+: %llu\n",
+                out.p(txp_retries_0), out.p(txp_retries_1), out.p(txp_retries_2), out.p(txp_retries_4),
+                out.p(txp_retries_8), out.p(txp_retries_16), out.p(txp_retries_32));
+        fprintf(stderr, "$ Starvation fallback: %llu attempts, %llu access-time locks, %llu serial attempts\n",
+                out.p(txp_fallback_runs), out.p(txp_fallback_locks), out.p(txp_serial_runs));
+    }
+    if (txp_count >= txp_early_aborts)
+        fprintf(stderr, "$ Early validation: %llu validations, %llu aborts\n",
+                out.p(txp_early_validations), out.p(txp_early_aborts));
+    if (txp_count >= txp_repair_failures)
+        fprintf(stderr, "$ Transaction repair: %llu repaired reads, %llu failed repairs\n",
+                out.p(txp_repairs), out.p(txp_repair_failures));
+    if (txp_count >= txp_priority_yields)
+        fprintf(stderr, "$ Priority scheduling: %llu wounds, %llu yields\n",
+                out.p(txp_priority_wounds), out.p(txp_priority_yields));
+    if (txp_count >= txp_tictoc_wts_shifts)
+        fprintf(stderr, "$ TicToc rts extension: %llu CAS attempts, %llu CAS failures, %llu batched, %llu compressed wts shifts\n",
+                out.p(txp_tictoc_rts_cas), out.p(txp_tictoc_rts_cas_failures),
+                out.p(txp_tictoc_rts_batched), out.p(txp_tictoc_wts_shifts));
+    if (txp_count >= txp_mvcc_latest_misses) {
+        fprintf(stderr, "$ MVCC latest-version cache: %llu hits, %llu misses (%.3f%% hit rate)\n",
+                out.p(txp_mvcc_latest_hits), out.p(txp_mvcc_latest_misses),
+                100.0 * (double) out.p(txp_mvcc_latest_hits) / (out.p(txp_mvcc_latest_hits) + out.p(txp_mvcc_latest_misses)));
+    }
     if (txp_count >= txp_tpcc_st_aborts) {
         fprintf(stderr, "$ TPCC txn profiles: commits(aborts), abort rate\n");
         fprintf(stderr, "$     New-Order: %llu(%llu), %.3f%%\n", out.p(txp_tpcc_no_commits), out.p(txp_tpcc_no_aborts),
@@ -595,6 +826,13 @@ void Transaction::print_stats() {
     ss << "   time_cleanup: " << out_tcs.to_realtime(tc_cleanup) << std::endl;
     ss << "   time_opacity: " << out_tcs.to_realtime(tc_opacity) << std::endl;
     ss << "   time_elapsed: " << out_tcs.to_realtime(tc_elapsed) << std::endl;
+#if STO_HW_COUNTERS
+    static const char* const tc_names[] = {"commit", "commit_wasted", "find_item", "abort",
+                                           "cleanup", "opacity", "elapsed"};
+    static_assert(arraysize(tc_names) == tc_count, "name every TimingCounter");
+    ss << std::endl;
+    PerfCounters::print_phases(ss, tc_names, tc_count, PROC_TSC_FREQ);
+#endif
 
     fprintf(stderr, "%s\n", ss.str().c_str());
 #endif
@@ -671,8 +909,12 @@ void Transaction::rcu_release_all(std::thread& epoch_advancer, int num_work_thre
         // XXX this would be safe to do in parallel too
         for (int i = 0; i < num_work_threads; ++i) {
             Transaction::tinfo[i].write_snapshot_epoch = wse;
+            cold_expiring_ = true;
+            Transaction::tinfo[i].cold_set.clean_until(ae);
+            cold_expiring_ = false;
             Transaction::tinfo[i].rcu_set.clean_until(ae);
-            more = more || !Transaction::tinfo[i].rcu_set.empty();
+            more = more || !Transaction::tinfo[i].rcu_set.empty()
+                || !Transaction::tinfo[i].cold_set.empty();
         }
         global_epochs.active_epoch.store(ae + 1);
         ++wse;
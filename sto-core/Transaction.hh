@@ -6,11 +6,14 @@
 #include "TRcu.hh"
 #include "ContentionManager.hh"
 #include "TransScratch.hh"
+#include "HugeArena.hh"
 #include "VersionBase.hh"
+#include "PerfCounters.hh"
 #include <algorithm>
 #include <functional>
 #include <memory>
 #include <type_traits>
+#include <vector>
 #include <unistd.h>
 #include <iostream>
 #include <sstream>
@@ -26,6 +29,13 @@
 #ifndef STO_TSC_PROFILE
 #define STO_TSC_PROFILE 0
 #endif
+// Hardware counters for the TimeKeeper phases (PerfCounters.hh)
+#ifndef STO_HW_COUNTERS
+#define STO_HW_COUNTERS 0
+#endif
+#if STO_HW_COUNTERS && !STO_TSC_PROFILE
+#error "STO_HW_COUNTERS requires STO_TSC_PROFILE"
+#endif
 
 #ifndef BILLION
 #define BILLION 1000000000.0
@@ -235,6 +245,41 @@ enum txp {
     txp_mvcc_flat_versions,
     txp_mvcc_flat_commits,
     txp_mvcc_flat_spins,
+    txp_mvcc_flat_cycles,
+    txp_mvcc_flat_scheduled,
+    txp_mvcc_flat_read_samples,
+    txp_mvcc_latest_hits,
+    txp_mvcc_latest_misses,
+    txp_commute_escrow_aborts,
+    txp_split_phases,
+    txp_split_reconciles,
+    txp_split_updates,
+    txp_lock_waits,
+    txp_lock_dies,
+    txp_lock_wounds,
+    txp_lock_retires,
+    txp_lock_cascades,
+    txp_lock_bias_revokes,
+    txp_retries_0,
+    txp_retries_1,
+    txp_retries_2,
+    txp_retries_4,
+    txp_retries_8,
+    txp_retries_16,
+    txp_retries_32,
+    txp_fallback_runs,
+    txp_fallback_locks,
+    txp_serial_runs,
+    txp_early_validations,
+    txp_early_aborts,
+    txp_repairs,
+    txp_repair_failures,
+    txp_priority_wounds,
+    txp_priority_yields,
+    txp_tictoc_rts_cas,
+    txp_tictoc_rts_cas_failures,
+    txp_tictoc_rts_batched,
+    txp_tictoc_wts_shifts,
     txp_tpcc_no_aborts,
     txp_tpcc_no_commits,
     txp_tpcc_no_stage1,
@@ -353,6 +398,7 @@ enum TimingCounters {
     tc_elapsed,
     tc_count
 };
+static_assert(tc_count <= PerfCounters::max_phases, "PerfCounters needs more phases");
 
 typedef uint64_t tc_counter_type;
 
@@ -402,7 +448,10 @@ struct __attribute__((aligned(128))) threadinfo_t {
     std::atomic<epoch_type> write_snapshot_epoch;
     std::atomic<epoch_type> epoch;
     std::atomic<tid_type> wtid;
+    std::atomic<tid_type> commit_tid;  // once write_tid() assigned one
     TRcuSet rcu_set;
+    // Callbacks waiting for their versions to grow old (see cold_call)
+    TRcuSet cold_set;
     // XXX(NH): these should be vectors so multiple data structures can register
     // callbacks for these
     std::function<void(void)> trans_start_callback;
@@ -418,6 +467,9 @@ class TimeKeeper {
 public:
     TimeKeeper() {
         init_tsc = read_tsc();
+#if STO_HW_COUNTERS
+        PerfCounters::read(init_pcs);
+#endif
     }
     ~TimeKeeper() {
         if (tmp_stats)
@@ -429,9 +481,17 @@ public:
     tc_counter_type init_tsc_val() const {
         return init_tsc;
     }
+#if STO_HW_COUNTERS
+    const PerfCounters::sample& init_pcs_val() const {
+        return init_pcs;
+    }
+#endif
 
 private:
     tc_counter_type init_tsc;
+#if STO_HW_COUNTERS
+    PerfCounters::sample init_pcs;
+#endif
 
     inline void sync_thread_counter();
     inline void sync_thread_counter_tmp();
@@ -476,7 +536,8 @@ private:
     mutable std::vector<AccessBucket> access_buckets_;
 };
 
-class Transaction {
+// Allocated from HugeArena: tset0_ and the hash table are inline
+class Transaction : public HugeArenaObject {
 public:
     typedef TransactionTid::type tid_type;
 
@@ -501,10 +562,27 @@ private:
     static std::atomic<tid_type> _TID;
     static std::atomic<tid_type> _RTID;
     static unsigned us_per_epoch;  // Defaults to 100ms
+    static __thread bool cold_expiring_;
+    static __thread tid_type cold_tid_bound_;
+
+    static tid_type min_commit_tid();
+    static void clean_cold(threadinfo_t& thr, epoch_type active_epoch);
 public:
+    // Early validation for OCC. With validate_every > 0, a transaction
+    // rechecks its read set in place after every validate_every optimistic
+    // reads and at Sto::validate_point(), so that a doomed transaction stops
+    // before doing more work. 0 (the default) validates only at commit.
+    static unsigned validate_every;
 
     static std::function<void(threadinfo_t::epoch_type)> epoch_advance_callback;
 
+    // Cold callbacks, for background work on old MVCC versions (see
+    // MvCompressor). A callback added with cold_call runs at one of this
+    // thread's transaction starts once cold_age epochs have passed, or
+    // sooner, with cold_expiring() true, when RCU callbacks added at the
+    // same time would run. 0 (the default) disables them.
+    static unsigned cold_age;
+
     static txp_counters txp_counters_combined() {
         txp_counters out;
         for (int i = 0; i != MAX_THREADS; ++i)
@@ -582,6 +660,28 @@ public:
         thr.rcu_set.add(thr.write_snapshot_epoch, function, argument);
     }
 
+    // Stops this thread's last transaction from holding back the epochs
+    // until its next one starts. Background threads that run transactions
+    // only now and then call it before going idle.
+    static void quiesce() {
+        auto& thr = this_thread();
+        thr.epoch.store(0, std::memory_order_release);
+        thr.write_snapshot_epoch.store(0, std::memory_order_release);
+    }
+
+    static void cold_call(TRcuSet::callback_type function, void* argument) {
+        auto& thr = this_thread();
+        thr.cold_set.add(thr.write_snapshot_epoch, function, argument);
+    }
+    static bool cold_expiring() {
+        return cold_expiring_;
+    }
+    // No running transaction commits at or below this tid; computed
+    // before cold callbacks run
+    static tid_type cold_tid_bound() {
+        return cold_tid_bound_;
+    }
+
     static void rcu_release_all(std::thread& epoch_advancer, int nworkth);
 
 #if STO_PROFILE_COUNTERS
@@ -658,17 +758,30 @@ private:
     // reset data so we can be reused for another transaction
     void start() {
         threadinfo_t& thr = this_thread();
+        if (!restarted)
+            nrestarts_ = nhot_ = 0;
+        nreads_ = 0;
+        nrepairs_ = 0;
+        fallback_ = false;
+        if (nrestarts_)
+            start_fallback();
         //if (isAborted_
         //   && tinfo[TThread::id()].p(txp_total_aborts) % 0x10000 == 0xFFFF)
            //print_stats();
 #if STO_TSC_PROFILE
         start_tsc_ = read_tsc();
+#endif
+#if STO_HW_COUNTERS
+        PerfCounters::read(start_pcs_);
 #endif
         special_txp = false;
         // New committed versions “happen” in write_snapshot_epoch
         thr.write_snapshot_epoch.store(global_epochs.global_epoch.load(std::memory_order_acquire), std::memory_order_release);
         thr.epoch.store(global_epochs.read_epoch.load(std::memory_order_acquire), std::memory_order_release);
-        thr.rcu_set.clean_until(global_epochs.active_epoch.load(std::memory_order_acquire));
+        epoch_type active_epoch = global_epochs.active_epoch.load(std::memory_order_acquire);
+        if (!thr.cold_set.empty())
+            clean_cold(thr, active_epoch);
+        thr.rcu_set.clean_until(active_epoch);
         thr.wtid.store(_TID.load(std::memory_order_relaxed), std::memory_order_release);
         if (thr.trans_start_callback)
             thr.trans_start_callback();
@@ -696,8 +809,8 @@ private:
         start_tid_ = read_tid_ = commit_tid_ = 0;
         tictoc_tid_ = 0;
         buf_.clear();
-#if STO_DEBUG_ABORTS
         abort_item_ = nullptr;
+#if STO_DEBUG_ABORTS
         abort_reason_ = nullptr;
         abort_version_ = 0;
 #endif
@@ -936,7 +1049,8 @@ public:
             abort_version_ = version;
     }
 #else
-    void mark_abort_because(TransItem*, const char*, TransactionTid::type = 0) const {
+    void mark_abort_because(TransItem* item, const char*, TransactionTid::type = 0) const {
+        abort_item_ = item;
     }
 #endif
 
@@ -971,6 +1085,11 @@ public:
         return state_ < s_aborted;
     }
 
+    // Locking, checking or installing; the transaction can add no items
+    bool committing() const {
+        return state_ == s_committing || state_ == s_committing_locked;
+    }
+
     template <typename T>
     T *tx_alloc(const T *src) {
         TXP_INCREMENT(txp_alloc_t);
@@ -1060,6 +1179,7 @@ public:
             threadinfo_t& thr = this_thread();
             commit_tid_ = _TID.fetch_add(TransactionTid::increment_value);
             thr.wtid.store(commit_tid_, std::memory_order_release);
+            thr.commit_tid.store(commit_tid_, std::memory_order_release);
         }
         return commit_tid_;
     }
@@ -1072,6 +1192,13 @@ public:
         return write_tid();
     }
 
+    // Global epoch read once the commit locks are held (as in Silo), so
+    // it orders conflicting commits the same way commit_tid() does
+    epoch_type commit_epoch() const {
+        assert(state_ == s_committing_locked || state_ == s_committing);
+        return commit_epoch_;
+    }
+
     inline tid_type compute_tictoc_commit_ts() const;
 
     template <typename VersImpl>
@@ -1186,7 +1313,44 @@ public:
         restarted = r;
     }
 
+    // Starvation control (see ContentionManager::fallback_aborts): true if
+    // this attempt should lock the items that caused earlier aborts when it
+    // accesses them
+    bool fallback() const {
+        return fallback_;
+    }
+    bool is_hot(const TransItem& item) const;
+
+    // Recheck the read set now; see validate_every
+    bool validate();
+    // Called by optimistic versions after each new read
+    bool count_read() {
+        if (validate_every && ++nreads_ >= validate_every)
+            return validate();
+        return true;
+    }
+
+    // Repair fragments (see TransProxy::add_repair) take their registered
+    // argument and return false to give up
+    typedef bool (*repair_fn)(void* arg);
+
 private:
+    static constexpr unsigned hot_capacity = 8;
+    static constexpr unsigned repair_capacity = 8;
+
+    struct hot_item {
+        TObject* owner;
+        void* key;
+    };
+
+    struct repair_entry {
+        TransItem* item;
+        const void* vers;
+        bool (*reread)(Transaction& txn, TransItem& item, const void* vers);
+        repair_fn fn;
+        void* arg;
+    };
+
     enum {
         s_in_progress = 0, s_opacity_check = 1, s_committing = 2,
         s_committing_locked = 3, s_aborted = 4, s_committed = 5
@@ -1203,6 +1367,14 @@ private:
     bool may_duplicate_items_;
     bool is_test_;
     bool restarted;
+    bool fallback_;
+    bool serial_;
+    unsigned nrestarts_;
+    unsigned nhot_;
+    unsigned nreads_;
+    hot_item hot_[hot_capacity];
+    unsigned nrepairs_;
+    repair_entry repairs_[repair_capacity];
     TransItem* tset_next_;
     unsigned tset_size_;
     mutable bool mvcc_rw_;  // manual MVCC read-write flag
@@ -1211,18 +1383,22 @@ private:
     mutable tid_type commit_tid_;
     mutable tid_type prev_commit_tid_;
     mutable tid_type tictoc_tid_; // commit tid reserved for TicToc
+    epoch_type commit_epoch_;
 public:
     mutable TransactionBuffer buf_;
     mutable TransScratch scratch_;
 private:
     mutable uint32_t lrng_state_;
-#if STO_DEBUG_ABORTS
     mutable TransItem* abort_item_;
+#if STO_DEBUG_ABORTS
     mutable const char* abort_reason_;
     mutable tid_type abort_version_;
 #endif
 #if STO_TSC_PROFILE
     mutable tc_counter_type start_tsc_;
+#endif
+#if STO_HW_COUNTERS
+    mutable PerfCounters::sample start_pcs_;
 #endif
     TransItem* tset_[tset_max_capacity / tset_chunk];
 #if CICADA_HASHTABLE
@@ -1236,6 +1412,9 @@ private:
 
     bool hard_check_opacity(TransItem* item, TransactionTid::type t);
     void stop(bool committed, unsigned* writes, unsigned nwrites);
+    void start_fallback();
+    void remember_hot(const TransItem& item);
+    bool repair(TransItem* item);
 
     friend class TransProxy;
     friend class TransItem;
@@ -1324,6 +1503,9 @@ inline void TimeKeeper<T, tmp_stats>::sync_thread_counter() {
         Transaction::tinfo[TThread::id()].tcs_.tcs_,
         read_tsc() - init_tsc
     );
+#if STO_HW_COUNTERS
+    PerfCounters::account(T, init_pcs);
+#endif
 }
 
 template <int T, bool tmp_stats>
@@ -1444,6 +1626,17 @@ public:
         return TThread::txn->read_tid();
     }
 
+    // An early validation point, e.g. before an expensive step
+    static bool validate_point() {
+        return !Transaction::validate_every || TThread::txn->validate();
+    }
+
+    // Priority class and deadline for this thread's transactions; see
+    // ContentionManager::set_priority
+    static void set_priority(uint32_t priority, uint64_t deadline = 0) {
+        ContentionManager::set_priority(TThread::id(), priority, deadline);
+    }
+
     static TransactionTid::type write_tid() {
         return TThread::txn->write_tid();
     }
@@ -1586,6 +1779,26 @@ inline TransProxy& TransProxy::update_read(T old_rdata, T new_rdata) {
     return *this;
 }
 
+template <typename VersImpl>
+inline TransProxy& TransProxy::add_repair(const VersionBase<VersImpl>& vers, bool (*fn)(void*), void* arg) {
+    Transaction* txn = t();
+    // past capacity, a stale read just aborts
+    if (txn->nrepairs_ != Transaction::repair_capacity)
+        txn->repairs_[txn->nrepairs_++] = {&item(), static_cast<const VersImpl*>(&vers),
+                                           &TransProxy::reread_version<VersImpl>, fn, arg};
+    return *this;
+}
+
+template <typename VersImpl>
+bool TransProxy::reread_version(Transaction& txn, TransItem& item, const void* vers) {
+    VersImpl snapshot = *static_cast<const VersImpl*>(vers);
+    fence();
+    if (TransactionTid::is_locked_elsewhere(snapshot.value(), txn.threadid()))
+        return false;
+    item.rdata_.v = Packer<VersImpl>::repack(txn.buf_, item.rdata_.v, snapshot);
+    return true;
+}
+
 
 inline TransProxy& TransProxy::set_predicate() {
     assert(!has_read());
@@ -236,6 +236,10 @@ class VersionBase {
 public:
     typedef TransactionTid::type type;
 
+    // Whether observing this version honors TransItem::cc_mode, so that
+    // CCPolicy may switch an item between optimistic and locked reads
+    static constexpr bool honors_cc_mode = false;
+
     VersionBase() : v_(initialized_tid) {}
     explicit VersionBase(type v) : v_(v) {}
 
@@ -396,6 +400,8 @@ public:
         return TransactionTid::unlocked(v_);
     }
 
+    inline bool observe_read_locked(TransItem& item);
+
     inline bool acquire_write_impl(TransItem& item);
     template <typename T>
     inline bool acquire_write_impl(TransItem& item, const T& wdata);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "MVCC.hh"
 #include "VersionBase.hh"
 
@@ -11,11 +13,47 @@ namespace ver_sel {
 
 typedef TransactionTid::type type;
 
+// Cache-line-aware cell layouts
+//
+// A container stores a row's version words right before the row. Rows
+// generated with hot cells (codegen `@hot`) declare a `version_lead`, put
+// their hot columns first and pad so their cold columns start a new cache
+// line, assuming the row itself starts `version_lead` bytes into a line.
+// The selector for such a row derives from version_lead_pad, which pads in
+// front of the version words so that they end exactly there, and sets
+// `container_align` to a cache line. A version check then reads the same
+// line as the hot columns it guards, and never pulls in cold columns.
+struct cell_layout {
+    static constexpr size_t line_size = CACHE_LINE_SIZE;
+    static constexpr size_t default_version_lead = 32;
+
+    // Padding after `hot_size` bytes of hot columns, in [1, line_size]
+    static constexpr size_t cold_pad(size_t version_lead, size_t hot_size) {
+        return line_size - (version_lead + hot_size) % line_size;
+    }
+    // Padding before `versions_size` bytes of versions, in [0, line_size)
+    static constexpr size_t lead_pad(size_t version_lead, size_t versions_size) {
+        return (version_lead + line_size - versions_size % line_size) % line_size;
+    }
+};
+
+template <typename RowType, typename VersImpl, size_t NumVersions,
+          size_t Size = cell_layout::lead_pad(RowType::version_lead, NumVersions * sizeof(VersImpl))>
+struct version_lead_pad {
+    char lead_pad_[Size];
+};
+
+template <typename RowType, typename VersImpl, size_t NumVersions>
+struct version_lead_pad<RowType, VersImpl, NumVersions, 0> {
+};
+
 // Version selector interface
 template <typename T, typename VersImpl>
 class VerSelBase {
 public:
     typedef VersImpl version_type;
+    // Selectors for rows with a cell layout use a cache line
+    static constexpr size_t container_align = alignof(VersImpl);
 
     constexpr static int map(int col_n) {
         return T::map_impl(col_n);
@@ -69,11 +107,18 @@ private:
     version_type vers_;
 };
 
+template <typename RowType, typename VersImpl>
+constexpr size_t container_align() {
+    return std::max({VerSel<RowType, VersImpl>::container_align,
+                     alignof(VerSel<RowType, VersImpl>), alignof(RowType)});
+}
+
 }  // namespace ver_sel
 
 // This is the actual "value type" to be put into the index
 template <typename RowType, typename VersImpl>
-class IndexValueContainer : ver_sel::VerSel<RowType, VersImpl> {
+class alignas(ver_sel::container_align<RowType, VersImpl>())
+IndexValueContainer : ver_sel::VerSel<RowType, VersImpl> {
 public:
     typedef TransactionTid::type type;
     using Selector = ver_sel::VerSel<RowType, VersImpl>;
@@ -126,6 +171,10 @@ struct example_row {
 // group:
 //   {d_ytd}, {d_payment_cnt, d_date, d_tax, d_next_oid}
 // @@@SelectorDefined
+//
+// Marking columns hot (`@hot: {d_ytd}` for the codegen) moves the cells
+// holding them to the front of the row and pads the remaining cells onto
+// the next cache line; see cell_layout.
 
 
 namespace ver_sel {
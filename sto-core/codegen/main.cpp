@@ -6,13 +6,29 @@
 #include <vector>
 #include <utility>
 #include <string>
+#include <algorithm>
 
 #include <map>
 #include <set>
 
 #include "driver.hpp"
 
-const std::string TName_str[] = {"int64_t", "int32_t", "float", "var_string", "fix_string"};
+const std::string TName_str[] = {"int64_t", "int32_t", "float", "var_string", "fix_string", "dict_string"};
+
+// VARCHAR columns that would take more than this in a var_string are
+// stored as a compact_string (DB_string.hh) instead
+const int compact_string_size = 16;
+
+// Namespace the row types are declared in (-n); empty for the global one
+std::string struct_namespace;
+
+// Spells a row type so that it resolves outside its own namespace, e.g.
+// from the ver_sel specializations or from a DICT column's dictionary tag
+std::string qualified_name(const std::string& struct_name) {
+    if (struct_namespace.empty())
+        return struct_name;
+    return struct_namespace + "::" + struct_name;
+}
 
 unsigned int integer_log2(uint64_t input) {
     if (input == 0 && input == 1)
@@ -23,12 +39,18 @@ unsigned int integer_log2(uint64_t input) {
     return log;
 }
 
-std::string cxx_type_name(const FieldType& t) {
+// DICT columns share a dictionary per row type `owner`
+std::string cxx_type_name(const FieldType& t, const std::string& owner) {
     std::stringstream ss;
-    ss << TName_str[t.tname];
-    assert(t.tname >= BigInt && t.tname <= Char);
+    assert(t.tname >= BigInt && t.tname <= Dict);
+    if (t.tname == VarChar && t.len + 1 > compact_string_size)
+        ss << "compact_string";
+    else
+        ss << TName_str[t.tname];
     if (t.tname == VarChar || t.tname == Char) {
         ss << '<' << t.len << '>';
+    } else if (t.tname == Dict) {
+        ss << '<' << t.len << ", uint" << 8 * t.code_bytes << "_t, " << qualified_name(owner) << '>';
     }
     return ss.str();
 }
@@ -74,7 +96,7 @@ void print_single(StructSpec &result) {
    auto &fields = result.fields;
    cout << "Number of fields: " << fields.size() << endl;
    for (size_t i = 0; i < fields.size(); ++i) {
-      cout << fields[i].name << " " << cxx_type_name(fields[i].t) << endl;
+      cout << fields[i].name << " " << cxx_type_name(fields[i].t, result.struct_name) << endl;
    }
 
    auto &groups = result.groups;
@@ -104,6 +126,10 @@ bool type_check_single(StructSpec &result) {
             return false;
         }
         field_name_set.insert(f.name);
+        if (f.t.tname == Dict && f.t.code_bytes != 1 && f.t.code_bytes != 2 && f.t.code_bytes != 4) {
+            std::cerr << "Error: Field \"" << f.name << "\" of struct " << struct_name << " needs 1, 2 or 4 byte dictionary codes" << std::endl;
+            return false;
+        }
     }
 
     assert(field_name_set.size() == fields.size());
@@ -129,6 +155,13 @@ bool type_check_single(StructSpec &result) {
     assert(group_fname_set.size() == field_name_set.size());
     assert(group_fname_set.size() == gfields);
 
+    for (auto& fn : result.hot) {
+        if (field_name_set.find(fn) == field_name_set.end()) {
+            std::cerr << "Error: Struct " << struct_name << " has a hot field \"" << fn << "\" referenced but undeclared" << std::endl;
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -141,6 +174,64 @@ bool type_check(std::vector<StructSpec> &result) {
    return true;
 }
 
+bool is_hot(const StructSpec& result, const std::string& fn) {
+    return std::find(result.hot.begin(), result.hot.end(), fn) != result.hot.end();
+}
+
+// Cells holding a hot field, in group order
+std::vector<size_t> hot_cells(const StructSpec& result) {
+    std::vector<size_t> cells;
+    for (size_t gidx = 0; gidx != result.groups.size(); ++gidx) {
+        auto& g = result.groups[gidx];
+        if (std::any_of(g.begin(), g.end(), [&] (const std::string& fn) { return is_hot(result, fn); }))
+            cells.push_back(gidx);
+    }
+    return cells;
+}
+
+const Field& find_field(const StructSpec& result, const std::string& fn) {
+    for (auto& f : result.fields)
+        if (f.name == fn)
+            return f;
+    abort();
+}
+
+// Declares the fields of a row with hot cells: hot cells come first, hot
+// fields leading within them, right after the container's version words
+// (see ver_sel::cell_layout); the cold cells start on the next cache line.
+void generate_cell_layout(StructSpec& result, std::stringstream& ss, const std::string& idt) {
+    auto hot = hot_cells(result);
+    std::vector<const Field*> hot_fields, cold_fields;
+    for (auto gidx : hot) {
+        auto& g = result.groups[gidx];
+        for (auto& fn : g)
+            if (is_hot(result, fn))
+                hot_fields.push_back(&find_field(result, fn));
+        for (auto& fn : g)
+            if (!is_hot(result, fn))
+                hot_fields.push_back(&find_field(result, fn));
+    }
+    for (size_t gidx = 0; gidx != result.groups.size(); ++gidx)
+        if (std::find(hot.begin(), hot.end(), gidx) == hot.end())
+            for (auto& fn : result.groups[gidx])
+                cold_fields.push_back(&find_field(result, fn));
+
+    ss << idt << "static constexpr size_t version_lead = ver_sel::cell_layout::default_version_lead;" << std::endl;
+    ss << idt << "struct hot_cells {" << std::endl;
+    for (auto f : hot_fields)
+        ss << idt << idt << cxx_type_name(f->t, result.struct_name) << ' ' << f->name << ';' << std::endl;
+    ss << idt << idt << "char end_;" << std::endl;
+    ss << idt << "};" << std::endl << std::endl;
+
+    for (auto f : hot_fields)
+        ss << idt << cxx_type_name(f->t, result.struct_name) << ' ' << f->name << ';' << std::endl;
+    if (!cold_fields.empty()) {
+        ss << idt << "char cold_pad_[ver_sel::cell_layout::cold_pad(version_lead, offsetof(hot_cells, end_))];" << std::endl;
+        for (auto f : cold_fields)
+            ss << idt << cxx_type_name(f->t, result.struct_name) << ' ' << f->name << ';' << std::endl;
+    }
+}
+
 void generate_code_single_struct(StructSpec &result) {
     std::stringstream ss;
     const std::string idt = "    ";
@@ -164,8 +255,12 @@ void generate_code_single_struct(StructSpec &result) {
     }
     ss << " };" << std::endl << std::endl;
 
-    for (auto& f : fields)
-        ss << idt << cxx_type_name(f.t) << ' ' << f.name << ';' << std::endl;
+    if (result.hot.empty()) {
+        for (auto& f : fields)
+            ss << idt << cxx_type_name(f.t, struct_name) << ' ' << f.name << ';' << std::endl;
+    } else {
+        generate_cell_layout(result, ss, idt);
+    }
     ss << "};" << std::endl;
 
     ss << std::endl;
@@ -176,16 +271,22 @@ void generate_code_single_struct(StructSpec &result) {
 void generate_code_single_versel(StructSpec &result) {
     std::stringstream ss;
     const std::string idt = "    ";
-    auto& struct_name = result.struct_name;
+    auto struct_name = qualified_name(result.struct_name);
     auto& groups = result.groups;
     auto gidx_width = integer_log2(groups.size());
 
     // Generate VerSel
     ss << "template <typename VersImpl>" << std::endl;
-    ss << "class VerSel<" << struct_name << ", VersImpl> : public VerSelBase<VerSel<" << struct_name << ", VersImpl>, VersImpl> {" << std::endl;
+    ss << "class VerSel<" << struct_name << ", VersImpl> : public VerSelBase<VerSel<" << struct_name << ", VersImpl>, VersImpl>";
+    if (!result.hot.empty())
+        ss << "," << std::endl << idt << idt << "version_lead_pad<" << struct_name << ", VersImpl, " << groups.size() << '>';
+    ss << " {" << std::endl;
     ss << "public:" << std::endl;
     ss << idt << "typedef VersImpl version_type;" << std::endl;
-    ss << idt << "static constexpr size_t num_versions = " << groups.size() << ';' << std::endl << std::endl;
+    ss << idt << "static constexpr size_t num_versions = " << groups.size() << ';' << std::endl;
+    if (!result.hot.empty())
+        ss << idt << "static constexpr size_t container_align = cell_layout::line_size;" << std::endl;
+    ss << std::endl;
 
     ss << idt << "explicit VerSel(type v) : vers_() { (void)v; }" << std::endl;
     ss << idt << "VerSel(type v, bool insert) : vers_() { (void)v; (void)insert; }" << std::endl << std::endl;
@@ -236,9 +337,17 @@ void generate_code(std::vector<StructSpec> &result) {
     std::cout << "// The following code is automatically generated by Hao & Yihe's parser/codegen"  << std::endl;
     std::cout << "// Please do not manually modify!" << std::endl << std::endl;
 
+    // Rows with hot cells refer to ver_sel::cell_layout
+    if (std::any_of(result.begin(), result.end(), [] (const StructSpec& spec) { return !spec.hot.empty(); }))
+        std::cout << "#include <cstddef>" << std::endl << "#include \"VersionSelector.hh\"" << std::endl << std::endl;
+
+    if (!struct_namespace.empty())
+        std::cout << "namespace " << struct_namespace << " {" << std::endl << std::endl;
     for (auto &spec : result) {
         generate_code_single_struct(spec);
     }
+    if (!struct_namespace.empty())
+        std::cout << "}; // namespace " << struct_namespace << std::endl;
 
     std::cout << std::endl << "namespace ver_sel {" << std::endl << std::endl;
     for (auto &spec : result) {
@@ -247,7 +356,14 @@ void generate_code(std::vector<StructSpec> &result) {
     std::cout << "}; // namespace ver_sel" << std::endl;
 }
 
-int main(const int argc, const char **argv) {
+int main(int argc, const char **argv) {
+    /** -n <namespace> declares the row types in that namespace **/
+    if( argc > 2 && std::strcmp( argv[ 1 ], "-n" ) == 0 ) {
+        struct_namespace = argv[ 2 ];
+        argv += 2;
+        argc -= 2;
+    }
+
     /** check for the right # of arguments **/
     std::vector<StructSpec> result;
     if( argc == 2 ) {
@@ -261,6 +377,7 @@ int main(const int argc, const char **argv) {
             std::cout << "use -o for pipe to std::cin\n";
             std::cout << "just give a filename to count from a file\n";
             std::cout << "use -h to get this menu\n";
+            std::cout << "precede either with -n <namespace> to declare the rows in a namespace\n";
             return( EXIT_SUCCESS );
         }
         /** example reading input from a file **/
@@ -23,11 +23,12 @@
   #include <string>
   #include <vector>
 
-  enum FieldTypeName { BigInt = 0, SmallInt, Float, VarChar, Char };
+  enum FieldTypeName { BigInt = 0, SmallInt, Float, VarChar, Char, Dict };
 
   struct FieldType {
 	FieldTypeName tname;
 	int len;
+	int code_bytes;  // Dict only
   };
 
   struct Field {
@@ -39,6 +40,7 @@
 	std::string struct_name;
 	std::vector<Field> fields;
 	std::vector<std::vector<std::string>> groups;
+	std::vector<std::string> hot;  // optional; see generate_cell_layout in main.cpp
   };
 }
 
@@ -61,8 +63,8 @@
 %define api.value.type variant
 %define parse.assert
 
-%token NAME FIELDS GROUPS LBRACE RBRACE COLON COMMA AT
-%token BIGINT SMALLINT FLOAT VARCHAR CHAR LPAREN RPAREN
+%token NAME FIELDS GROUPS HOT LBRACE RBRACE COLON COMMA AT
+%token BIGINT SMALLINT FLOAT VARCHAR CHAR DICT LPAREN RPAREN
 %token END 0 "end of file"
 %token <std::string> IDENTIFIER
 %token <int> NUMBER
@@ -76,6 +78,7 @@
 %type <std::vector<std::string>> group
 %type <std::vector<std::vector<std::string>>> group_list
 %type <std::vector<std::vector<std::string>>> group_spec
+%type <std::vector<std::string>> hot_spec
 %type <std::string> name_spec
 %type <StructSpec> spec
 %type <std::vector<StructSpec>> spec_list
@@ -101,8 +104,8 @@ spec_list
   ;
 
 spec
-  : AT AT AT name_spec field_spec group_spec AT AT AT 
-	{ $$ = { $4, $5, $6 }; }
+  : AT AT AT name_spec field_spec group_spec hot_spec AT AT AT
+	{ $$ = { $4, $5, $6, $7 }; }
   ;
 
 name_spec
@@ -120,6 +123,13 @@ group_spec
 	{ $$ = $4; }
   ;
 
+hot_spec
+  : %empty
+	{ $$ = std::vector<std::string>(); }
+  | HOT COLON LBRACE field_name_list RBRACE
+	{ $$ = $4; }
+  ;
+
 field_list
   : field
 	{ $$ = std::vector<Field>(1, $1); }
@@ -173,6 +183,10 @@ field_type
 	{ $$ = { VarChar, $3 }; }
   | CHAR LPAREN NUMBER RPAREN
 	{ $$ = { Char, $3 }; }
+  | DICT LPAREN NUMBER RPAREN
+	{ $$ = { Dict, $3, 1 }; }
+  | DICT LPAREN NUMBER COMMA NUMBER RPAREN
+	{ $$ = { Dict, $3, $5 }; }
   ;
 
 %% /* Spec Grammr */
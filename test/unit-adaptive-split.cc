@@ -0,0 +1,283 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <array>
+#include <vector>
+#include <thread>
+#include "Sto.hh"
+#include "DB_split_layout.hh"
+
+static constexpr int ncols = 4;
+typedef bench::adaptive_split_layout<ncols> layout_type;
+typedef layout_type::mask_type mask_type;
+typedef std::array<int, ncols> row_type;
+
+// A row with one version per column, grouped by an adaptive layout the way
+// the DB indexes group a container's cells: cell items are keyed by group
+// leader, and writes are buffered whole under the key `ncols`.
+class SplitRow : public TObject {
+public:
+    typedef TNonopaqueVersion version_type;
+
+    explicit SplitRow(std::initializer_list<mask_type> groups = {0b1111})
+        : layout(groups), cols_() {}
+
+    layout_type layout;
+
+    // Reads the columns in `read` and increments those in `incr`
+    bool access(mask_type read, mask_type incr, row_type& out) {
+        auto read_cells = layout.leaders(read | incr), write_cells = layout.leaders(incr);
+        layout.sample(read | incr, incr);
+        for (int c = 0; c != ncols; ++c) {
+            auto item = Sto::item(this, c);
+            if ((read_cells & (1u << c)) && !item.observe(vers_[c]))
+                return false;
+            if ((write_cells & (1u << c)) && !item.acquire_write(vers_[c]))
+                return false;
+        }
+        acquire_fence();
+        auto buf = Sto::item(this, ncols);
+        row_type row = buf.has_write() ? buf.template write_value<row_type>() : cols_;
+        out = row;
+        if (incr) {
+            for (int c = 0; c != ncols; ++c)
+                row[c] += (incr >> c) & 1;
+            buf.add_write(row);
+        }
+        return true;
+    }
+
+    const row_type& nontrans_read() const {
+        return cols_;
+    }
+
+    bool lock(TransItem& item, Transaction& txn) override {
+        int c = item.key<int>();
+        return c == ncols || txn.try_lock(item, vers_[c]);
+    }
+    bool check(TransItem& item, Transaction& txn) override {
+        return vers_[item.key<int>()].cp_check_version(txn, item);
+    }
+    void install(TransItem& item, Transaction& txn) override {
+        int c = item.key<int>();
+        if (c == ncols)
+            return;
+        auto& row = Sto::item(this, ncols).template write_value<row_type>();
+        for (auto m = layout.install_mask(c); m; m &= m - 1)
+            cols_[__builtin_ctz(m)] = row[__builtin_ctz(m)];
+        txn.set_version_unlock(vers_[c], item);
+    }
+    void unlock(TransItem& item) override {
+        int c = item.key<int>();
+        if (c != ncols)
+            vers_[c].cp_unlock(item);
+    }
+
+private:
+    version_type vers_[ncols];
+    row_type cols_;
+};
+
+static bool run(SplitRow& r, mask_type read, mask_type incr, row_type* out = nullptr) {
+    row_type v;
+    TRANSACTION {
+        TXN_DO(r.access(read, incr, v));
+    } RETRY(true);
+    if (out)
+        *out = v;
+    return true;
+}
+
+void testAdvisor() {
+    SplitRow r;
+    assert(r.layout.describe() == "{0,1,2,3}");
+    // too few samples
+    run(r, 0, 0b0011);
+    assert(!r.layout.advance());
+
+    // columns 0-1 and 2-3 are updated together, by different transactions
+    for (int i = 0; i != 2000; ++i)
+        run(r, 0, i % 2 ? 0b0011 : 0b1100);
+    assert(r.layout.advance());
+    assert(r.layout.phase() == 1 && r.layout.migrations() == 1);
+    assert(r.layout.describe() == "{0,1}{2,3}");
+    // nothing is pinned, so the migration completes at once
+    assert(r.layout.advance());
+    assert(r.layout.phase() == 2);
+    // splitting co-updated columns gains nothing
+    assert(!r.layout.advance());
+    assert(r.layout.describe() == "{0,1}{2,3}");
+
+    row_type v;
+    run(r, 0b1111, 0, &v);
+    assert(v == row_type({1001, 1001, 1000, 1000}));
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testMigration() {
+    SplitRow r;
+    for (int i = 0; i != 1200; ++i)
+        run(r, 0, i % 2 ? 0b0011 : 0b1100);
+
+    // a transaction pinned to layout 0 holds back the end of the migration
+    {
+        TestTransaction t1(1);
+        row_type v;
+        assert(r.access(0, 0b0001, v));
+        assert(r.layout.advance() && r.layout.phase() == 1);
+        assert(!r.layout.advance());
+
+        // under migration, writes lock the cells of both layouts, so this
+        // still conflicts with t1
+        TestTransaction t2(2);
+        assert(r.access(0, 0b0100, v));
+        assert(t2.try_commit());
+        t1.use();
+        assert(!t1.try_commit());
+    }
+    assert(r.layout.advance() && r.layout.phase() == 2);
+
+    // a stale read from before the split still conflicts after it
+    {
+        TestTransaction t1(1);
+        row_type v;
+        assert(r.access(0b0010, 0b1000, v));
+        TestTransaction t2(2);
+        assert(r.access(0, 0b0010, v));
+        assert(t2.try_commit());
+        t1.use();
+        assert(!t1.try_commit());
+    }
+
+    row_type v;
+    run(r, 0b1111, 0, &v);
+    assert(v == row_type({600, 601, 601, 600}));
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testSeeded() {
+    // one group per atom, the codegen'd split
+    SplitRow r({});
+    assert(r.layout.describe() == "{0}{1}{2}{3}");
+
+    // columns 0 and 1 are always accessed together, 2 and 3 apart
+    for (int i = 0; i != 2000; ++i)
+        run(r, 0, i % 3 == 0 ? 0b0011 : i % 3 == 1 ? 0b0100 : 0b1000);
+
+    // a read-only transaction pinned to layout 0
+    TestTransaction t1(1);
+    row_type v;
+    assert(r.access(0b0010, 0, v));
+    // the pin neither reads nor writes, so t1 stays read-only
+    auto pin = Sto::item(&r.layout, 0);
+    assert(!pin.has_read() && !pin.has_write());
+    assert(r.layout.advance() && r.layout.phase() == 1);
+    assert(r.layout.describe() == "{0,1}{2}{3}");
+    assert(!r.layout.advance());
+
+    // under migration, a write to column 1 locks cell 0, the merged
+    // group's leader, and cell 1, which readers of layout 0 observe
+    TestTransaction t2(2);
+    assert(r.access(0, 0b0010, v));
+    assert(t2.try_commit());
+    t1.use();
+    assert(!t1.try_commit());
+    // ending t1 unpinned it
+    assert(r.layout.advance() && r.layout.phase() == 2);
+
+    // after the migration, a write to column 1 locks only cell 0
+    {
+        TestTransaction t3(1);
+        assert(r.access(0b0001, 0, v));
+        TestTransaction t4(2);
+        assert(r.access(0, 0b0010, v));
+        assert(t4.try_commit());
+        t3.use();
+        assert(!t3.try_commit());
+    }
+
+    row_type w;
+    run(r, 0b1111, 0, &w);
+    assert(w == row_type({667, 669, 667, 666}));
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testDecay() {
+    SplitRow r({});
+    // columns 0 and 1 are updated together...
+    for (int i = 0; i != 2000; ++i)
+        run(r, 0, 0b0011);
+    assert(r.layout.advance() && r.layout.advance());
+    assert(r.layout.describe() == "{0,1}{2}{3}");
+
+    // ...until the workload changes. The old samples decay, so the advisor
+    // splits the group again.
+    for (int i = 0; i != 4000; ++i)
+        run(r, 0, i % 2 ? 0b0001 : 0b0010);
+    assert(r.layout.advance() && r.layout.advance());
+    assert(r.layout.describe() == "{0}{1}{2}{3}");
+    assert(r.layout.migrations() == 2);
+
+    // with no new samples, evaluations decay the histogram until there
+    // are too few samples to act on
+    for (int i = 0; i != 8; ++i)
+        assert(!r.layout.advance());
+    for (int i = 0; i != 200; ++i)
+        run(r, 0, 0b0011);
+    assert(!r.layout.advance());
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int txns_per_thread = 20000;
+
+void testConcurrent() {
+    for (int round = 0; round != 3; ++round) {
+        SplitRow r;
+        std::vector<std::thread> thrs;
+        std::array<std::array<int, 3>, num_threads> counts = {};
+        for (int i = 0; i < num_threads; ++i) {
+            thrs.emplace_back([&] (int id) {
+                TThread::set_id(id);
+                for (int n = 0; n < txns_per_thread; ++n) {
+                    int k = (n + id) % 10;
+                    if (k < 4)
+                        ++counts[id][0], run(r, 0, 0b0011);
+                    else if (k < 8)
+                        ++counts[id][1], run(r, 0, 0b1100);
+                    else if (k < 9)
+                        ++counts[id][2], run(r, 0, 0b0110);
+                    else {
+                        // every update keeps cols 0 + 2 == cols 1 + 3
+                        row_type v;
+                        run(r, 0b1111, 0, &v);
+                        assert(v[0] + v[2] == v[1] + v[3]);
+                    }
+                }
+            }, i);
+        }
+        for (auto& t : thrs)
+            t.join();
+
+        int a = 0, b = 0, c = 0;
+        for (auto& cnt : counts)
+            a += cnt[0], b += cnt[1], c += cnt[2];
+        assert(r.nontrans_read() == row_type({a, a + c, b + c, b}));
+        assert(r.layout.migrations() > 0);
+    }
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testAdvisor();
+    testMigration();
+    testSeeded();
+    testDecay();
+    testConcurrent();
+    return 0;
+}
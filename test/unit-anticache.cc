@@ -0,0 +1,177 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <array>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "Sto.hh"
+#include "DB_anticache.hh"
+#include "sampling.hh"
+
+struct row_type {
+    long count;
+    std::array<long, 31> payload;
+
+    row_type() : count(0), payload() {}
+    explicit row_type(long k) : count(0) {
+        payload.fill(k);
+    }
+};
+
+typedef bench::anticache_table<long, row_type> table_type;
+typedef table_type::fetch_policy fetch_policy;
+
+static std::string cold_path(const char* name) {
+    return std::string("/tmp/unit-anticache-") + name + "-" + std::to_string(getpid());
+}
+
+static void load(table_type& t, long n) {
+    for (long k = 0; k != n; ++k)
+        t.nontrans_put(k, row_type(k));
+}
+
+void testEvictFetch() {
+    table_type t(cold_path("evict"), 1 << 20);
+    load(t, 100);
+    assert(t.resident_rows() == 100);
+    assert(t.evict(10) == 90);
+    assert(t.resident_rows() == 10);
+
+    for (long k = 0; k != 100; ++k) {
+        TRANSACTION {
+            auto r = t.select_row(k);
+            TXN_DO(std::get<0>(r));
+            assert(std::get<1>(r) && std::get<2>(r)->payload[7] == k);
+        } RETRY(false);
+    }
+    assert(t.fetches() == 90 && t.cold_misses() == 90);
+    assert(t.resident_rows() == 100);
+
+    // fetched rows free their slots, which later evictions reuse
+    size_t file_bytes = t.cold_file_bytes();
+    for (int i = 0; i != 1000 && t.cold_bytes() != 0; ++i) {
+        // transaction starts run the RCU callbacks that free them
+        TransactionGuard guard;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(t.cold_bytes() == 0);
+    assert(t.evict(10) == 90);
+    assert(t.cold_file_bytes() == file_bytes);
+    for (long k = 0; k != 100; ++k) {
+        TRANSACTION {
+            TXN_DO(std::get<0>(t.select_row(k)));
+        } RETRY(false);
+    }
+
+    // an update of a cold row needs no fetch
+    t.evict(0);
+    {
+        TestTransaction t1(1);
+        row_type v(5);
+        v.count = 1;
+        assert(t.update_row(5, v));
+        assert(t1.try_commit());
+    }
+    assert(t.resident_rows() == 1 && t.fetches() == 180);
+
+    // a row evicted after a transaction observed it still validates
+    {
+        TestTransaction t1(1);
+        auto r = t.select_row(5);
+        assert(std::get<0>(r) && std::get<2>(r)->count == 1);
+        std::thread([&t] { TThread::set_id(10); t.evict(0); }).join();
+        assert(t.resident_rows() == 0);
+        assert(t1.try_commit());
+    }
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testAbortAndPrefetch() {
+    table_type t(cold_path("prefetch"), 1 << 20, fetch_policy::abort_and_prefetch);
+    load(t, 100);
+    t.evict(0);
+    t.start(100, 10, 11);
+
+    {
+        TestTransaction t1(1);
+        assert(!std::get<0>(t.select_row(42)));
+        t1.get_tx().silent_abort();
+        TestTransaction::hard_reset();
+    }
+    long v = -1;
+    TRANSACTION {
+        auto r = t.select_row(42);
+        TXN_DO(std::get<0>(r));
+        v = std::get<2>(r)->payload[0];
+    } RETRY(true);
+    assert(v == 42);
+    assert(t.fetches() == 1 && t.cold_misses() >= 1);
+    t.stop();
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int txns_per_thread = 20000;
+static constexpr long table_size = 8192;
+
+// Zipfian read-modify-writes over a table four times the memory budget
+void testZipfian(fetch_policy policy, const char* name) {
+    table_type t(cold_path(name), 256 << 20, policy);
+    load(t, table_size);
+    t.start(table_size / 4, 10, 11);
+
+    std::vector<std::thread> thrs;
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&t] (int id) {
+            TThread::set_id(id);
+            sampling::StoRandomDistribution<>::rng_type rng(id + 1);
+            sampling::StoZipfDistribution<> dist(rng, 0, table_size - 1, 0.99);
+            for (int n = 0; n < txns_per_thread; ++n) {
+                long k = dist.sample();
+                TRANSACTION {
+                    auto r = t.select_row(k);
+                    TXN_DO(std::get<0>(r));
+                    row_type v = *std::get<2>(r);
+                    assert(v.payload[3] == k);
+                    ++v.count;
+                    TXN_DO(t.update_row(k, v));
+                } RETRY(true);
+            }
+        }, i);
+    }
+    for (auto& th : thrs)
+        th.join();
+    t.stop();
+    t.print_stats(std::cout);
+    // the evictor may trail the workers a little
+    assert(t.evictions() > 0);
+    // and reuses the slots of fetched rows
+    assert(t.cold_file_bytes() < t.evictions() * sizeof(row_type));
+    t.evict(table_size / 4);
+    assert(t.resident_rows() <= table_size / 4);
+
+    long total = 0;
+    for (long k = 0; k != table_size; ++k) {
+        TRANSACTION {
+            auto r = t.select_row(k);
+            TXN_DO(std::get<0>(r));
+            total += std::get<2>(r)->count;
+        } RETRY(true);
+    }
+    assert(total == (long) num_threads * txns_per_thread);
+    printf("PASS: %s<%s>\n", __FUNCTION__, name);
+}
+
+int main() {
+    // evicted and overwritten rows are freed through RCU
+    std::thread advancer(&Transaction::epoch_advancer, nullptr);
+    testEvictFetch();
+    testAbortAndPrefetch();
+    testZipfian(fetch_policy::block, "block");
+    testZipfian(fetch_policy::abort_and_prefetch, "abort");
+    Transaction::rcu_release_all(advancer, 12);
+    return 0;
+}
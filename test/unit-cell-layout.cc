@@ -0,0 +1,145 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include "Sto.hh"
+#include "VersionSelector.hh"
+
+// A row as the codegen lays it out for
+//
+// @@@
+// @name: layout_row
+// @fields: {l_name(VARCHAR(40)), l_tax(BIGINT), l_ytd(BIGINT), l_payment_cnt(SMALLINT)}
+// @groups: {{l_ytd, l_payment_cnt}, {l_name, l_tax}}
+// @hot: {l_ytd}
+// @@@
+struct layout_row {
+
+    enum class NamedColumn : int { l_name = 0, l_tax, l_ytd, l_payment_cnt };
+
+    static constexpr size_t version_lead = ver_sel::cell_layout::default_version_lead;
+    struct hot_cells {
+        int64_t l_ytd;
+        int32_t l_payment_cnt;
+        char end_;
+    };
+
+    int64_t l_ytd;
+    int32_t l_payment_cnt;
+    char cold_pad_[ver_sel::cell_layout::cold_pad(version_lead, offsetof(hot_cells, end_))];
+    char l_name[41];
+    int64_t l_tax;
+};
+
+// The same columns without a cell layout
+struct plain_row {
+    enum class NamedColumn : int { l_name = 0, l_tax, l_ytd, l_payment_cnt };
+
+    char l_name[41];
+    int64_t l_tax;
+    int64_t l_ytd;
+    int32_t l_payment_cnt;
+};
+
+namespace ver_sel {
+
+template <typename VersImpl>
+class VerSel<layout_row, VersImpl> : public VerSelBase<VerSel<layout_row, VersImpl>, VersImpl>,
+                                     version_lead_pad<layout_row, VersImpl, 2> {
+public:
+    typedef VersImpl version_type;
+    static constexpr size_t num_versions = 2;
+    static constexpr size_t container_align = cell_layout::line_size;
+
+    explicit VerSel(type v) : vers_() {
+        new (&vers_[0]) version_type(v);
+    }
+    VerSel(type v, bool insert) : vers_() {
+        new (&vers_[0]) version_type(v, insert);
+    }
+
+    constexpr static int map_impl(int col_n) {
+        return col_n >= static_cast<int>(layout_row::NamedColumn::l_ytd) ? 0 : 1;
+    }
+
+    version_type& version_at_impl(int cell) {
+        return vers_[cell];
+    }
+
+    void install_by_cell_impl(layout_row *dst, const layout_row *src, int cell) {
+        switch (cell) {
+        case 0:
+            dst->l_ytd = src->l_ytd;
+            dst->l_payment_cnt = src->l_payment_cnt;
+            break;
+        case 1:
+            memcpy(dst->l_name, src->l_name, sizeof(dst->l_name));
+            dst->l_tax = src->l_tax;
+            break;
+        default:
+            always_assert(false, "cell id out of bound\n");
+            break;
+        }
+    }
+
+private:
+    version_type vers_[num_versions];
+};
+
+}  // namespace ver_sel
+
+static uintptr_t line_of(const void* p) {
+    return reinterpret_cast<uintptr_t>(p) / CACHE_LINE_SIZE;
+}
+
+template <typename V>
+void testLayout() {
+    typedef IndexValueContainer<layout_row, V> container_type;
+    static_assert(alignof(container_type) == CACHE_LINE_SIZE, "containers start a cache line");
+
+    layout_row r {};
+    r.l_ytd = 30000;
+    r.l_payment_cnt = 1;
+    r.l_tax = 7;
+    std::unique_ptr<container_type> c(new container_type(Sto::initialized_tid(), r));
+    assert(reinterpret_cast<uintptr_t>(c.get()) % CACHE_LINE_SIZE == 0);
+
+    // the hot cell's version and columns share one line; cold columns
+    // start the next one
+    auto& row = c->row;
+    assert(reinterpret_cast<uintptr_t>(&row) % CACHE_LINE_SIZE == layout_row::version_lead);
+    assert(line_of(&c->version_at(0)) == line_of(&row.l_ytd));
+    assert(line_of(&c->version_at(1)) == line_of(&row.l_ytd));
+    assert(line_of(&row.l_payment_cnt + 1) == line_of(&row.l_ytd));
+    assert(reinterpret_cast<uintptr_t>(&row.l_name) % CACHE_LINE_SIZE == 0);
+    assert(line_of(&row.l_name) == line_of(&row.l_ytd) + 1);
+
+    // cells still install independently
+    layout_row update = row;
+    update.l_ytd = 31000;
+    update.l_tax = 9;
+    c->install_cell(0, &update);
+    assert(row.l_ytd == 31000 && row.l_tax == 7);
+    c->install_cell(1, &update);
+    assert(row.l_tax == 9);
+    assert(c->row_version().value() == V(Sto::initialized_tid()).value());
+
+    printf("PASS: %s<%zu-byte versions>\n", __FUNCTION__, sizeof(V));
+}
+
+void testPlainLayout() {
+    // rows without hot cells keep the packed container
+    typedef IndexValueContainer<plain_row, TVersion> container_type;
+    static_assert(alignof(container_type) == alignof(int64_t), "no extra alignment");
+    static_assert(sizeof(container_type) == sizeof(TVersion) + sizeof(plain_row), "no padding");
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testLayout<TVersion>();
+    testLayout<TNonopaqueVersion>();
+    testLayout<TicTocVersion<>>();
+    testPlainLayout();
+    return 0;
+}
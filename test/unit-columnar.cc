@@ -0,0 +1,217 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <vector>
+#include "Sto.hh"
+#include "DB_columnar.hh"
+
+struct line_row {
+    long district;
+    long amount;
+};
+
+typedef bench::column_mirror<long, line_row> mirror_type;
+typedef mirror_type::aggregate aggregate;
+
+static mirror_type* make_mirror() {
+    return new mirror_type({
+        {"district", [] (const long&, const line_row& r) { return int64_t(r.district); }},
+        {"amount", [] (const long&, const line_row& r) { return int64_t(r.amount); }},
+        {"key", [] (const long& k, const line_row&) { return int64_t(k); }}
+    });
+}
+
+void testSnapshots() {
+    std::unique_ptr<mirror_type> m(make_mirror());
+    int amount = m->column_index("amount");
+    assert(amount == 1 && m->column_index("missing") == -1);
+
+    for (long k = 0; k != 10; ++k)
+        m->append(k, line_row{k % 2, 10 * k}, 0);
+    m->append(3, line_row{1, 1000}, 5);
+    m->remove(4, 7);
+    m->append(20, line_row{0, 7}, 9);
+
+    aggregate a = m->scan(0, amount);
+    assert(a.count == 10 && a.sum == 450 && a.min == 0 && a.max == 90);
+    // the update replaced key 3 at epoch 5
+    a = m->scan(5, amount);
+    assert(a.count == 10 && a.sum == 450 - 30 + 1000 && a.max == 1000);
+    // the delete ended key 4 at epoch 7
+    a = m->scan(8, amount);
+    assert(a.count == 9 && a.sum == 450 - 30 + 1000 - 40);
+    a = m->scan(9, amount);
+    assert(a.count == 10 && a.sum == 450 - 30 + 1000 - 40 + 7 && a.min == 0);
+    assert(m->images() == 12);
+
+    std::vector<aggregate> groups(2);
+    m->group_scan(9, 0, amount, groups);
+    assert(groups[0].count == 5 && groups[0].sum == 0 + 20 + 60 + 80 + 7);
+    assert(groups[1].count == 5 && groups[1].sum == 10 + 1000 + 50 + 70 + 90);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testZoneMaps() {
+    std::unique_ptr<mirror_type> m(make_mirror());
+    long n = 16 * mirror_type::chunk_rows;
+    for (long k = 0; k != n; ++k)
+        m->append(k, line_row{k % 10, k}, 1);
+    int key = m->column_index("key");
+
+    // keys are clustered, so a key range touches one chunk
+    uint64_t skipped = m->chunks_skipped();
+    aggregate a = m->scan(1, key, {{key, 5000, 5009}});
+    assert(a.count == 10 && a.sum == 50045 && a.min == 5000 && a.max == 5009);
+    assert(m->chunks_scanned() == 1 && m->chunks_skipped() == skipped + 15);
+
+    // a filter covering the zone map is free, one outside it skips
+    a = m->scan(1, key, {{0, 0, 9}});
+    assert(a.count == uint64_t(n));
+    a = m->scan(1, key, {{0, 10, 20}});
+    assert(a.count == 0);
+    m->print_stats(std::cout, "test");
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testVectorized() {
+    std::unique_ptr<mirror_type> m(make_mirror());
+    long n = 5 * mirror_type::chunk_rows + 3;
+    for (long k = 0; k != n; ++k)
+        m->append(k, line_row{k % 7, (k * 7919) % 1001 - 500}, k % 13);
+    for (long k = 0; k < n; k += 5)
+        m->append(k, line_row{k % 7, -k}, 6 + k % 5);
+    for (long k = 1; k < n; k += 9)
+        m->remove(k, 8);
+
+    for (uint64_t s : {0, 3, 6, 8, 12, 20}) {
+        aggregate sc[3], vec[3];
+        std::vector<aggregate> gsc(7), gvec(7);
+        for (int pass = 0; pass != 2; ++pass) {
+            mirror_type::set_vectorized(pass == 1);
+            aggregate* out = pass ? vec : sc;
+            out[0] = m->scan(s, 1);
+            out[1] = m->scan(s, 1, {{1, -100, 250}});
+            out[2] = m->scan(s, 2, {{0, 2, 4}, {1, 0, 1000}});
+            m->group_scan(s, 0, 1, pass ? gvec : gsc, {{2, 100, n - 100}});
+        }
+        for (int i = 0; i != 3; ++i)
+            assert(sc[i].count == vec[i].count && sc[i].sum == vec[i].sum
+                   && sc[i].min == vec[i].min && sc[i].max == vec[i].max);
+        for (int g = 0; g != 7; ++g)
+            assert(gsc[g].count == gvec[g].count && gsc[g].sum == gvec[g].sum);
+    }
+    mirror_type::set_vectorized(true);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static void set_read_epoch(uint64_t e) {
+    Transaction::global_epochs.read_epoch = e;
+}
+
+// Runs the RCU callbacks registered so far, freeing reclaimed chunks
+static void rcu_period() {
+    for (auto& t : Transaction::tinfo) {
+        t.write_snapshot_epoch = 0;
+        t.epoch = 0;
+    }
+    for (int i = 0; i != 4; ++i)
+        Transaction::global_epoch_advance_once();
+    for (auto& t : Transaction::tinfo) {
+        t.write_snapshot_epoch = Transaction::global_epochs.global_epoch.load();
+        t.rcu_set.clean_until(Transaction::global_epochs.active_epoch);
+    }
+}
+
+void testReclaim() {
+    std::unique_ptr<mirror_type> m(make_mirror());
+    long n = 4 * mirror_type::chunk_rows;
+    for (long k = 0; k != n; ++k)
+        m->append(k, line_row{0, 1}, 0);
+    for (long k = 0; k != n; ++k)
+        m->append(k, line_row{0, 2}, 2);
+    assert(m->chunks_in_use() == 8);
+
+    // a scan at snapshot 1 still sees the first images
+    set_read_epoch(2);
+    assert(m->pin() == 1);
+    set_read_epoch(4);
+    assert(m->reclaim() == 0 && m->chunks_in_use() == 8);
+    assert(m->scan(1, 1).sum == n);
+    m->unpin();
+    assert(m->reclaim() == 4 && m->chunks_in_use() == 4);
+    assert(m->scan(3, 1).sum == 2 * n && m->scan(3, 1).count == uint64_t(n));
+
+    // three quarters of these are replaced; the rest move to the tail,
+    // some already while the updates fill chunks
+    for (long k = 0; k != n; ++k)
+        m->append(k + n, line_row{0, 1}, 4);
+    for (long k = 0; k != n; ++k)
+        if (k % 4)
+            m->append(k + n, line_row{0, 3}, 5);
+    auto check = [&] (uint64_t s) {
+        aggregate a = m->scan(s, 1, {{2, n, 2 * n - 1}});
+        assert(a.count == uint64_t(n) && a.sum == (s == 4 ? n : n / 4 + 3 * (n - n / 4)));
+    };
+    check(4);
+    check(5);
+    set_read_epoch(6);
+    m->reclaim();
+    assert(m->images_moved() > 0);
+    check(5);
+    check(6);
+    // 2n live images, in 8 full chunks plus the tail at best
+    set_read_epoch(7);
+    m->reclaim();
+    m->reclaim();
+    assert(m->chunks_in_use() <= 10);
+    assert(m->scan(6, 1).count == 2 * uint64_t(n));
+    assert(m->scan(6, 1).sum == 2 * n + n / 4 + 3 * (n - n / 4));
+    m->print_stats(std::cout, "reclaim");
+    rcu_period();
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr long keys_per_thread = 4096;
+
+void testConcurrent() {
+    // writers update disjoint keys while a reader scans at a fixed snapshot
+    std::unique_ptr<mirror_type> m(make_mirror());
+    for (long k = 0; k != num_threads * keys_per_thread; ++k)
+        m->append(k, line_row{0, 1}, 0);
+
+    std::atomic<bool> done(false);
+    std::thread reader([&] {
+        while (!done)
+            assert(m->scan(0, 1).sum == num_threads * keys_per_thread);
+    });
+    std::vector<std::thread> thrs;
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&m] (int id) {
+            for (int round = 1; round != 5; ++round)
+                for (long k = id * keys_per_thread; k != (id + 1) * keys_per_thread; ++k)
+                    m->append(k, line_row{0, round + 1}, round);
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+    done = true;
+    reader.join();
+    assert(m->scan(4, 1).sum == 5 * num_threads * keys_per_thread);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testSnapshots();
+    testZoneMaps();
+    testVectorized();
+    testConcurrent();
+    testReclaim();
+    return 0;
+}
@@ -0,0 +1,280 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include "DB_structs.hh"
+#include "MVCCStructs.hh"
+
+using bench::var_string;
+using bench::fix_string;
+using bench::compact_string;
+using bench::string_arena;
+
+void testInline() {
+    string_arena arena;
+    compact_string<255> empty, s("short"), t(std::string("thirteen char"));
+    assert(empty.length() == 0 && empty == "");
+    assert(s.length() == 5 && s == "short" && !strcmp(s.c_str(), "short"));
+    assert(t.length() == 13 && t == std::string("thirteen char"));
+    assert(!(s == t) && !(s == "shorter") && !(s == "shor"));
+    assert(s[1] == 'h' && s.contains("or") && !s.contains("x"));
+    assert(std::string(s) == "short");
+
+    compact_string<255> u("short", 5, arena);
+    assert(u == s);
+    assert(arena.bytes_used() == 0);
+
+    // truncated to the declared length, like var_string
+    compact_string<4> v("abcdef");
+    assert(v.length() == 4 && v == "abcd" && v == "abcdxy");
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testOutOfLine() {
+    string_arena arena;
+    std::string text(200, 'x');
+    text[150] = 'y';
+    compact_string<255> s(text.data(), text.length(), arena);
+    assert(s.length() == 200 && s == text && std::string(s) == text);
+    assert(arena.bytes_used() == 201);
+
+    // copies share the arena bytes
+    compact_string<255> c = s;
+    assert(c.c_str() == s.c_str() && c == s);
+    assert(arena.bytes_used() == 201);
+
+    // same prefix, different tail
+    std::string text2 = text;
+    text2[150] = 'z';
+    compact_string<255> d(text2.data(), text2.length(), arena);
+    assert(!(d == s) && d.contains("z") && !s.contains("z"));
+
+    // implicit conversions store into the current arena
+    {
+        string_arena::scope scope(arena);
+        compact_string<255> e(text);
+        assert(e == s && e.c_str() != s.c_str());
+        assert(arena.bytes_used() == 3 * 201);
+    }
+    compact_string<255> f(text);
+    assert(arena.bytes_used() == 3 * 201);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int strings_per_thread = 20000;
+
+void testConcurrent() {
+    string_arena arena;
+    std::vector<std::vector<compact_string<64>>> out(num_threads);
+    std::vector<std::thread> thrs;
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&] (int id) {
+            TThread::set_id(id);
+            string_arena::scope scope(arena);
+            for (int n = 0; n < strings_per_thread; ++n)
+                out[id].emplace_back("thread " + std::to_string(id) + " string " + std::to_string(n));
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+
+    size_t bytes = 0;
+    for (int id = 0; id < num_threads; ++id)
+        for (int n = 0; n < strings_per_thread; ++n) {
+            std::string expect = "thread " + std::to_string(id) + " string " + std::to_string(n);
+            assert(out[id][n] == expect);
+            bytes += expect.length() + 1;
+        }
+    assert(arena.bytes_used() == bytes);
+    assert(arena.bytes_allocated() >= bytes);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+// Forces the RCU callbacks of finished transactions to run
+static void drain_rcu() {
+    for (auto& t : Transaction::tinfo) {
+        t.write_snapshot_epoch = 0;
+        t.epoch = 0;
+    }
+    for (int i = 0; i != 4; ++i)
+        Transaction::global_epoch_advance_once();
+    for (auto& t : Transaction::tinfo)
+        t.rcu_set.clean_until(Transaction::global_epochs.active_epoch);
+}
+
+// Runs the RCU callbacks of finished transactions once; callbacks they add
+// wait for the next call
+static void rcu_period() {
+    for (auto& t : Transaction::tinfo) {
+        t.write_snapshot_epoch = 0;
+        t.epoch = 0;
+    }
+    for (int i = 0; i != 4; ++i)
+        Transaction::global_epoch_advance_once();
+    for (auto& t : Transaction::tinfo) {
+        t.write_snapshot_epoch = Transaction::global_epochs.global_epoch.load();
+        t.rcu_set.clean_until(Transaction::global_epochs.active_epoch);
+    }
+}
+
+void testReclaim() {
+    string_arena arena;
+    std::string text(200, 'x'), text2(180, 'y');
+    compact_string<255> row(text.data(), text.length(), arena);
+    const char* old = row.c_str();
+
+    // committed: the old bytes are reused once no reader can hold them
+    {
+        TestTransaction t(0);
+        compact_string<255> copy = row;
+        copy.assign(text2.data(), text2.length(), arena);
+        assert(copy == text2 && row == text);
+        row = copy;
+        assert(t.try_commit());
+    }
+    assert(arena.bytes_used() == 201 + 181);
+    drain_rcu();
+    assert(arena.bytes_used() == 181);
+    compact_string<255> reuse(text.data(), text.length(), arena);
+    assert(reuse.c_str() == old && reuse == text);
+
+    // aborted: the new bytes are reused at once, the old ones stay
+    const char* kept = row.c_str();
+    const char* fresh;
+    {
+        TestTransaction t(0);
+        compact_string<255> copy = row;
+        copy.insert_left("abc", 3, arena);
+        assert(copy.length() == 183 && copy.contains("abcyyy"));
+        fresh = copy.c_str();
+        t.get_tx().silent_abort();
+        TestTransaction::hard_reset();
+    }
+    drain_rcu();
+    assert(row.c_str() == kept && row == text2);
+    assert(arena.bytes_used() == 181 + 201);
+    std::string text3(150, 'z');
+    compact_string<255> next(text3.data(), text3.length(), arena);
+    assert(next.c_str() == fresh);
+
+    // insert_left truncates like fix_string
+    compact_string<16> small("0123456789", 10, arena);
+    {
+        TestTransaction t(0);
+        compact_string<16> copy = small;
+        copy.insert_left("abcdefghij", 10, arena);
+        assert(copy.length() == 16 && copy == "abcdefghij012345");
+        small = copy;
+        assert(t.try_commit());
+    }
+
+    // outside transactions and in arenas that don't reclaim, nothing is freed
+    string_arena kept_arena(false);
+    compact_string<255> k(text.data(), text.length(), kept_arena);
+    {
+        TestTransaction t(0);
+        compact_string<255> copy = k;
+        copy.assign(text2.data(), text2.length(), kept_arena);
+        k = copy;
+        assert(t.try_commit());
+    }
+    k.assign(text.data(), text.length(), kept_arena);
+    drain_rcu();
+    assert(kept_arena.bytes_used() == 201 + 181 + 201);
+
+    // versioned arenas wait for the superseded versions to be collected
+    string_arena versioned(true, MvGarbage::call_after_collect);
+    compact_string<255> vrow(text.data(), text.length(), versioned);
+    {
+        TestTransaction t(0);
+        compact_string<255> copy = vrow;
+        copy.assign(text2.data(), text2.length(), versioned);
+        vrow = copy;
+        assert(t.try_commit());
+    }
+    for (int i = 0; i != 2; ++i) {
+        rcu_period();
+        assert(versioned.bytes_used() == 201 + 181);
+    }
+    rcu_period();
+    assert(versioned.bytes_used() == 181);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+// The VARCHAR columns of a TPC-C customer row as the codegen used to emit
+// them, and as it emits them now
+struct customer_var {
+    var_string<16> c_first;
+    fix_string<2> c_middle;
+    var_string<16> c_last;
+    var_string<20> c_street_1;
+    var_string<20> c_street_2;
+    var_string<20> c_city;
+    int64_t c_balance;
+};
+
+struct customer_compact {
+    compact_string<16> c_first;
+    fix_string<2> c_middle;
+    compact_string<16> c_last;
+    compact_string<20> c_street_1;
+    compact_string<20> c_street_2;
+    compact_string<20> c_city;
+    int64_t c_balance;
+};
+
+template <typename T>
+static double copy_ns(const T& row) {
+    constexpr int n = 1000000;
+    std::vector<T> dst(64);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i != n; ++i) {
+        dst[i % 64] = row;
+        asm volatile("" : : "r"(&dst[i % 64]) : "memory");
+    }
+    std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - start;
+    return d.count() / n;
+}
+
+template <typename T>
+static void fill(T& row) {
+    row.c_first = "Isabella";
+    row.c_middle = "OE";
+    row.c_last = "BARBARABLEOUGHT";
+    row.c_street_1 = "1234 Sesame Street";
+    row.c_street_2 = "Apartment 56";
+    row.c_city = "Cambridge";
+    row.c_balance = -10;
+}
+
+void reportCost() {
+    string_arena arena;
+    string_arena::scope scope(arena);
+    customer_var v;
+    customer_compact c;
+    fill(v);
+    fill(c);
+    assert(c.c_last == v.c_last.c_str() && c.c_street_2 == v.c_street_2.c_str());
+
+    printf("customer VARCHAR columns: var_string %zu bytes, %.1f ns/copy; "
+           "compact_string %zu bytes + %zu arena bytes, %.1f ns/copy\n",
+           sizeof(v), copy_ns(v), sizeof(c), arena.bytes_used(), copy_ns(c));
+    printf("VARCHAR(255): var_string %zu bytes, compact_string %zu bytes\n",
+           sizeof(var_string<255>), sizeof(compact_string<255>));
+}
+
+int main() {
+    testInline();
+    testOutOfLine();
+    testConcurrent();
+    testReclaim();
+    reportCost();
+    return 0;
+}
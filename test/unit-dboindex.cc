@@ -24,6 +24,30 @@ struct key_type {
     }
 };
 
+namespace commutators {
+
+template <>
+class Commutator<coarse_grained_row> {
+public:
+    Commutator() = default;
+
+    explicit Commutator(int64_t delta_aa) : delta_aa(delta_aa) {}
+
+    void operate(coarse_grained_row& row) const {
+        row.aa += delta_aa;
+    }
+
+    // aa is treated as a quantity that must never go negative
+    bool escrow_check(const coarse_grained_row& row) const {
+        return delta_aa >= 0 || row.aa >= static_cast<uint64_t>(-delta_aa);
+    }
+
+private:
+    int64_t delta_aa;
+};
+
+}  // namespace commutators
+
 // using example_row from VersionSelector.hh
 
 namespace bench {
@@ -306,6 +330,7 @@ using access_t = bench::access_t;
 using RowAccess = bench::RowAccess;
 
 using MVIndex = bench::mvcc_ordered_index<key_type, coarse_grained_row, db_params::db_mvcc_params>;
+using CommuteIndex = bench::ordered_index<key_type, coarse_grained_row, db_params::db_default_commute_params>;
 
 template <typename IndexType>
 void init_cindex(IndexType& ci) {
@@ -642,6 +667,77 @@ void test_mvcc_snapshot() {
     printf("pass %s\n", __FUNCTION__);
 }
 
+void test_commute_escrow() {
+    typedef CommuteIndex::NamedColumn nc;
+    typedef commutators::Commutator<coarse_grained_row> comm_type;
+    CommuteIndex ci;
+    ci.thread_init();
+
+    init_cindex(ci);
+
+    // Blind commutative updates are not validated against each other
+    {
+        TestTransaction t1(0);
+        {
+            auto [success, found, row, value] = ci.select_split_row(key_type(2), {{nc::aa, access_t::write}});
+            (void) value;
+            assert(success && found);
+            ci.update_row(row, comm_type(5));
+        }
+
+        TestTransaction t2(1);
+        {
+            auto [success, found, row, value] = ci.select_split_row(key_type(2), {{nc::aa, access_t::write}});
+            (void) value;
+            assert(success && found);
+            ci.update_row(row, comm_type(3));
+            assert(t2.try_commit());
+        }
+
+        t1.use();
+        assert(t1.try_commit());
+    }
+
+    {
+        TestTransaction t(0);
+        auto [success, found, row, value] = ci.select_split_row(key_type(2), {{nc::aa, access_t::read}});
+        (void) row;
+        assert(success && found);
+        assert(value.aa() == 10);
+        assert(t.try_commit());
+    }
+
+    // Escrow: a decrement that would take aa below zero aborts
+    {
+        TestTransaction t(0);
+        auto [success, found, row, value] = ci.select_split_row(key_type(1), {{nc::aa, access_t::write}});
+        (void) value;
+        assert(success && found);
+        ci.update_row(row, comm_type(-1));
+        assert(t.try_commit());
+    }
+
+    {
+        TestTransaction t(0);
+        auto [success, found, row, value] = ci.select_split_row(key_type(1), {{nc::aa, access_t::write}});
+        (void) value;
+        assert(success && found);
+        ci.update_row(row, comm_type(-1));
+        assert(!t.try_commit());
+    }
+
+    {
+        TestTransaction t(0);
+        auto [success, found, row, value] = ci.select_split_row(key_type(1), {{nc::aa, access_t::read}});
+        (void) row;
+        assert(success && found);
+        assert(value.aa() == 0);
+        assert(t.try_commit());
+    }
+
+    printf("pass %s\n", __FUNCTION__);
+}
+
 int main() {
     test_coarse_basic();
     test_coarse_read_my_split();
@@ -651,6 +747,7 @@ int main() {
     test_fine_conflict1();
     test_fine_conflict2();
     test_mvcc_snapshot();
+    test_commute_escrow();
     printf("All tests pass!\n");
 
     std::thread advancer;  // empty thread because we have no advancer thread
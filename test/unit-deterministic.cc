@@ -0,0 +1,99 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <random>
+#include <vector>
+#include <thread>
+#include "DB_deterministic.hh"
+
+typedef bench::deterministic_engine<int> engine_type;
+
+struct op {
+    int key;
+    bool is_write;
+};
+
+static constexpr int num_keys = 16;
+
+// Runs txn t: reads return the last writer of a key, writes install t
+static void run(const std::vector<op>& ops, int t, int* data, int* observed) {
+    for (size_t i = 0; i != ops.size(); ++i) {
+        if (ops[i].is_write)
+            data[ops[i].key] = t;
+        else
+            observed[i] = data[ops[i].key];
+    }
+}
+
+void testDependencies() {
+    engine_type e;
+    e.begin_epoch(4);
+    e.declare(0, 1, true);
+    e.declare(1, 1, false);
+    e.declare(2, 1, false);
+    e.declare(2, 2, false);
+    e.declare(3, 1, true);
+    e.declare(3, 2, true);
+    e.end_epoch();
+
+    std::vector<int> order;
+    size_t n = e.execute([&] (uint32_t t) { order.push_back(t); });
+    assert(n == 4);
+    assert(order == std::vector<int>({0, 1, 2, 3}));
+    // nothing left to claim
+    assert(e.execute([] (uint32_t) { assert(false); }) == 0);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int num_epochs = 50;
+static constexpr int epoch_size = 400;
+
+void testSerialEquivalence() {
+    std::mt19937 gen(17);
+    engine_type e;
+    int data[num_keys] = {}, serial[num_keys] = {};
+
+    for (int epoch = 0; epoch != num_epochs; ++epoch) {
+        std::vector<std::vector<op>> txns(epoch_size);
+        std::vector<std::vector<int>> observed(epoch_size), expected(epoch_size);
+        e.begin_epoch(epoch_size);
+        for (int t = 0; t != epoch_size; ++t) {
+            int nops = 1 + gen() % 4;
+            for (int i = 0; i != nops; ++i) {
+                // heavy skew onto the first keys
+                int key = (gen() % 2) ? gen() % 2 : gen() % num_keys;
+                txns[t].push_back({key, gen() % 3 == 0});
+                e.declare(t, key, txns[t].back().is_write);
+            }
+            observed[t].resize(nops);
+            expected[t].resize(nops);
+            run(txns[t], epoch * epoch_size + t, serial, expected[t].data());
+        }
+        e.end_epoch();
+
+        std::vector<std::thread> thrs;
+        for (int i = 0; i != num_threads; ++i) {
+            thrs.emplace_back([&] {
+                e.execute([&] (uint32_t t) {
+                    run(txns[t], epoch * epoch_size + t, data, observed[t].data());
+                });
+            });
+        }
+        for (auto& t : thrs)
+            t.join();
+
+        assert(observed == expected);
+        for (int k = 0; k != num_keys; ++k)
+            assert(data[k] == serial[k]);
+    }
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testDependencies();
+    testSerialEquivalence();
+    return 0;
+}
@@ -0,0 +1,97 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include "DB_structs.hh"
+
+using bench::dict_string;
+using bench::fix_string;
+using bench::string_dictionary;
+
+struct row_a;
+struct row_b;
+
+void testEncode() {
+    typedef dict_string<2, uint8_t, row_a> flag;
+    flag empty, bc("BC"), gc(std::string("GC")), bc2("BC");
+    assert(sizeof(flag) == 1);
+    assert(empty.code() == 0 && empty == "" && empty.length() == 0);
+    assert(bc.code() != gc.code() && bc.code() == bc2.code());
+    assert(bc == bc2 && bc != gc && bc == "BC" && !(bc == "GC"));
+    assert(!strcmp(gc.c_str(), "GC") && gc[1] == 'C' && std::string(gc) == "GC");
+
+    // truncated to the declared length
+    flag bcx("BCX");
+    assert(bcx == bc && bcx == "BCY");
+
+    // lookups don't add entries
+    assert(flag::find("ZZ") < 0 && !(bc == "ZZ"));
+    assert(flag::find("BC") == bc.code());
+    assert(flag::dictionary().size() == 3);
+
+    // each table type has its own dictionary
+    typedef dict_string<2, uint8_t, row_b> other_flag;
+    other_flag gc_b("GC");
+    assert(gc_b.code() == 1 && other_flag::dictionary().size() == 2);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testGrowth() {
+    // enough entries to replace the hash index several times
+    typedef dict_string<8, uint16_t, row_a> code;
+    std::vector<code> v;
+    for (int i = 0; i != 5000; ++i)
+        v.emplace_back(std::to_string(i));
+    for (int i = 0; i != 5000; ++i) {
+        assert(v[i] == std::to_string(i));
+        assert(code::find(std::to_string(i).c_str()) == v[i].code());
+    }
+    assert(code::dictionary().size() == 5001);
+
+    // codes are bounded by their width
+    string_dictionary<4> small(256);
+    for (int i = 0; i != 256; ++i)
+        assert(small.encode(std::to_string(i).c_str(), std::to_string(i).length()) == (uint32_t) i);
+    assert(small.find("255", 3) == 255 && small.find("256", 3) < 0);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+
+void testConcurrent() {
+    typedef dict_string<16, uint32_t, row_b> name;
+    std::vector<std::vector<name>> out(num_threads);
+    std::vector<std::thread> thrs;
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&] (int id) {
+            TThread::set_id(id);
+            // every thread encodes the same strings in a different order
+            for (int n = 0; n < 20000; ++n) {
+                int k = (n * (2 * id + 1)) % 20000;
+                out[id].emplace_back("name " + std::to_string(k));
+                assert(out[id].back() == "name " + std::to_string(k));
+            }
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+
+    assert(name::dictionary().size() == 20001);
+    for (int n = 0; n < 20000; ++n)
+        for (int id = 1; id < num_threads; ++id) {
+            int k = (n * (2 * id + 1)) % 20000;
+            assert(out[id][n].code() == out[0][k].code());
+        }
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testEncode();
+    testGrowth();
+    testConcurrent();
+    return 0;
+}
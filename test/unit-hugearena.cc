@@ -0,0 +1,153 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "Sto.hh"
+#include "TBox.hh"
+
+struct row : public HugeArenaObject {
+    long key;
+    char payload[100];
+
+    explicit row(long k) : key(k) {
+        memset(payload, int(k), sizeof(payload));
+    }
+};
+
+struct alignas(64) line_row : public HugeArenaObject {
+    long key;
+};
+
+static bool aligned(const void* p, size_t a) {
+    return reinterpret_cast<uintptr_t>(p) % a == 0;
+}
+
+void testConfigure() {
+    HugeArena::mode m;
+    assert(HugeArena::parse("hugetlb", m) && m == HugeArena::mode::hugetlb);
+    assert(HugeArena::parse("off", m) && m == HugeArena::mode::off);
+    assert(!HugeArena::parse("2mb", m));
+
+    // hugetlb falls back to THP where no pages are reserved
+    assert(HugeArena::configure(HugeArena::mode::hugetlb));
+    assert(HugeArena::current() == HugeArena::mode::hugetlb);
+    void* p = HugeArena::allocate(24);
+    assert(HugeArena::hugetlb_bytes() + HugeArena::thp_bytes() == HugeArena::segment_size);
+    // the mode is fixed once memory is handed out
+    assert(!HugeArena::configure(HugeArena::mode::off));
+    assert(HugeArena::configure(HugeArena::mode::hugetlb));
+    HugeArena::deallocate(p, 24);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testSizes() {
+    // small objects are reused per size
+    row* r = new row(7);
+    assert(aligned(r, 16) && r->payload[99] == 7);
+    delete r;
+    row* r2 = new row(8);
+    assert(r2 == r);
+    delete r2;
+
+    auto l = new line_row;
+    assert(aligned(l, 64));
+    delete l;
+
+    // large objects come from power-of-two lists
+    void* a = HugeArena::allocate(5000);
+    void* b = HugeArena::allocate(8192);
+    assert(aligned(a, 4096) && aligned(b, 4096) && a != b);
+    memset(a, 1, 5000);
+    memset(b, 2, 8192);
+    HugeArena::deallocate(a, 5000);
+    assert(HugeArena::allocate(6000) == a);
+    HugeArena::deallocate(a, 6000);
+    HugeArena::deallocate(b, 8192);
+
+    // bigger than a huge page: mapped on its own
+    size_t before = HugeArena::hugetlb_bytes() + HugeArena::thp_bytes();
+    size_t big = 3 * HugeArena::page_size + 1;
+    char* c = static_cast<char*>(HugeArena::allocate(big));
+    assert(aligned(c, HugeArena::page_size));
+    memset(c, 3, big);
+    assert(HugeArena::hugetlb_bytes() + HugeArena::thp_bytes() == before + 4 * HugeArena::page_size);
+    HugeArena::deallocate(c, big);
+    assert(HugeArena::hugetlb_bytes() + HugeArena::thp_bytes() == before);
+
+    std::vector<int, HugeArenaAllocator<int>> v;
+    for (int i = 0; i != 100000; ++i)
+        v.push_back(i);
+    assert(v[99999] == 99999);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int rows_per_thread = 100000;
+
+void testConcurrent() {
+    std::vector<std::vector<row*>> rows(num_threads);
+    std::vector<std::thread> thrs;
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&rows] (int id) {
+            for (long n = 0; n < rows_per_thread; ++n)
+                rows[id].push_back(new row(id * rows_per_thread + n));
+            // free half and reallocate them
+            for (long n = 0; n < rows_per_thread; n += 2)
+                delete rows[id][n];
+            for (long n = 0; n < rows_per_thread; n += 2)
+                rows[id][n] = new row(id * rows_per_thread + n);
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+
+    for (int id = 0; id < num_threads; ++id)
+        for (long n = 0; n < rows_per_thread; ++n) {
+            row* r = rows[id][n];
+            assert(r->key == id * rows_per_thread + n);
+            assert(r->payload[50] == char(r->key));
+        }
+    // freed on another thread than allocated them
+    for (auto& rs : rows)
+        for (auto r : rs)
+            delete r;
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testTransactions() {
+    // Transaction objects, tset chunks and scratch zones use the arena
+    TBox<int> boxes[2000];
+    std::vector<std::thread> thrs;
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&boxes] (int id) {
+            TThread::set_id(id);
+            for (int n = 0; n < 20; ++n) {
+                TRANSACTION_E {
+                    for (auto& b : boxes)
+                        b = b + 1;
+                } RETRY_E(true);
+            }
+            Sto::delete_transaction();
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+    for (auto& b : boxes)
+        assert(b.nontrans_read() == num_threads * 20);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testConfigure();
+    testSizes();
+    testConcurrent();
+    testTransactions();
+    HugeArena::print_stats(std::cout);
+    return 0;
+}
@@ -287,6 +287,7 @@ private:
     void InsertUnreadableTest();
     void DeleteReinsertTest();
     void UpdateTest();
+    void LatestVersionCacheTest();
 };
 
 template <bool Ordered>
@@ -316,6 +317,8 @@ void MVCCIndexTester<Ordered>::RunTests() {
     PostTest();
     DeleteReinsertTest();
     PostTest();
+    LatestVersionCacheTest();
+    PostTest();
     if constexpr (Ordered) {
         ScanTest();
         PostTest();
@@ -1199,6 +1202,90 @@ void MVCCIndexTester<Ordered>::DeleteReinsertTest() {
     printf("Test pass: DeleteReinsertTest\n");
 }
 
+// Concurrent commutative and full updates against nontransactional readers,
+// which are served from the latest-version cache whenever it is current
+template <bool Ordered>
+void MVCCIndexTester<Ordered>::LatestVersionCacheTest() {
+    static constexpr int num_updates = 2000;
+    index_type idx(index_init_size);
+    idx.thread_init();
+
+    key_type key{0, 1};
+    index_value val{0, 5, 6};
+    idx.nontrans_put(key, val);
+
+    std::atomic<bool> done(false);
+
+    auto commuter = [&](int thread_id) {
+        TThread::set_id(thread_id);
+        idx.thread_init();
+        for (int i = 0; i < num_updates; ++i) {
+            RWTRANSACTION {
+                auto[success, result, row, accessor]
+                    = idx.select_split_row(key,
+                                           {{nc::value_1, access_t::write},
+                                            {nc::value_2b, access_t::none}});
+                (void)accessor;
+                TXN_DO(success);
+                assert(result);
+                commutators::Commutator<index_value> comm(1);
+                idx.update_row(row, comm);
+            } RETRY(true);
+        }
+    };
+
+    auto updater = [&](int thread_id) {
+        TThread::set_id(thread_id);
+        idx.thread_init();
+        for (int i = 0; i < num_updates; ++i) {
+            RWTRANSACTION {
+                auto[success, result, row, accessor]
+                    = idx.select_split_row(key,
+                                           {{nc::value_1, access_t::update},
+                                            {nc::value_2a, access_t::read},
+                                            {nc::value_2b, access_t::read}});
+                TXN_DO(success);
+                assert(result);
+                index_value new_val{accessor.value_1() + 1,
+                                    accessor.value_2a(), accessor.value_2b()};
+                idx.update_row(row, &new_val);
+            } RETRY(true);
+        }
+    };
+
+    auto reader = [&](int thread_id) {
+        TThread::set_id(thread_id);
+        idx.thread_init();
+        int64_t last = 0;
+        while (!done.load()) {
+            index_value out;
+            bool found = idx.nontrans_get(key, &out);
+            assert(found);
+            assert(out.value_1 >= last);
+            assert(out.value_2a == 5);
+            assert(out.value_2b == 6);
+            last = out.value_1;
+        }
+    };
+
+    std::thread r(reader, 3);
+    std::thread w1(commuter, 1);
+    std::thread w2(updater, 2);
+    w1.join();
+    w2.join();
+    done.store(true);
+    r.join();
+
+    index_value out;
+    assert(idx.nontrans_get(key, &out));
+    assert(out.value_1 == 2 * num_updates);
+    assert(out.value_2a == 5);
+    assert(out.value_2b == 6);
+
+    TThread::set_id(0);
+    printf("Test pass: %s\n", __FUNCTION__);
+}
+
 int main() {
     {
         MVCCIndexTester<true> tester;
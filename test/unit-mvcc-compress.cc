@@ -0,0 +1,177 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Sto.hh"
+#include "TMvBox.hh"
+
+using namespace std::chrono_literals;
+
+// A wide row with text-like contents, in the spirit of Wikipedia text rows
+struct wide_row {
+    long id;
+    long revision;
+    char text[496];
+
+    wide_row() = default;
+    wide_row(long i, long r)
+        : id(i), revision(r) {
+        static const char words[] = "the quick brown fox jumps over the lazy dog ";
+        for (size_t n = 0; n != sizeof(text); ++n)
+            text[n] = words[(n + i + r) % (sizeof(words) - 1)];
+    }
+    bool is(long i, long r) const {
+        wide_row expected(i, r);
+        return memcmp(this, &expected, sizeof(*this)) == 0;
+    }
+};
+
+std::ostream& operator<<(std::ostream& w, const wide_row& r) {
+    return w << "wide_row{" << r.id << ", " << r.revision << "}";
+}
+
+static bool round_trip(const std::vector<unsigned char>& in, size_t capacity) {
+    std::vector<unsigned char> packed(capacity), out(in.size());
+    size_t csize = MvCodec::compress(in.data(), in.size(), packed.data(), capacity);
+    if (!csize)
+        return false;
+    assert(csize <= capacity);
+    assert(MvCodec::decompress(packed.data(), csize, out.data(), out.size()));
+    assert(out == in);
+    // truncated input never decodes
+    assert(!MvCodec::decompress(packed.data(), csize - 1, out.data(), out.size()));
+    return true;
+}
+
+void testCodec() {
+    std::vector<unsigned char> text(4000);
+    wide_row r(3, 4);
+    for (size_t n = 0; n != text.size(); ++n)
+        text[n] = r.text[n % sizeof(r.text)];
+    assert(round_trip(text, text.size() / 4));
+
+    // long runs need extended lengths
+    std::vector<unsigned char> zeros(60000, 0);
+    assert(round_trip(zeros, 1000));
+
+    std::mt19937 gen(7);
+    std::vector<unsigned char> noise(2000);
+    for (auto& c : noise)
+        c = gen();
+    assert(!round_trip(noise, noise.size() - 1));
+    assert(round_trip(noise, noise.size() + 64));
+
+    std::vector<unsigned char> tiny {1, 2, 3};
+    assert(round_trip(tiny, 8));
+    assert(!round_trip(text, 10));
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testDisabled() {
+    // nothing is counted while compression is off
+    assert(!MvCompressor::enabled());
+    std::vector<TMvBox<wide_row>> boxes(4);
+    assert(MvCompressor::versions() == 0 && MvCompressor::version_bytes() == 0);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_boxes = 64;
+static constexpr int num_revisions = 6;
+
+void testColdVersions() {
+    MvCompressor::configure(2);
+    assert(MvCompressor::applies<wide_row>() && !MvCompressor::applies<int>());
+
+    std::vector<TMvBox<wide_row>> boxes(num_boxes);
+    for (int i = 0; i != num_boxes; ++i)
+        boxes[i].nontrans_write(wide_row(i, 0));
+    TMvBox<int> ticks;
+    std::atomic<int> phase(0);
+
+    auto write_revision = [&] (int rev) {
+        for (int i = 0; i != num_boxes; ++i) {
+            RWTRANSACTION_E {
+                boxes[i] = wide_row(i, rev);
+            } RETRY_E(true);
+        }
+    };
+    // cold callbacks run as transactions start
+    auto tick = [&] {
+        RWTRANSACTION_E {
+            ticks = ticks + 1;
+        } RETRY_E(true);
+        std::this_thread::sleep_for(1ms);
+    };
+
+    std::thread writer([&] {
+        TThread::set_id(0);
+        write_revision(1);
+        phase = 1;
+        while (phase != 2)
+            tick();
+        for (int rev = 2; rev <= num_revisions; ++rev) {
+            write_revision(rev);
+            for (int n = 0; n != 5; ++n)
+                tick();
+        }
+        while (phase != 4)
+            tick();
+        for (int n = 0; n != 20; ++n)
+            tick();
+        Sto::delete_transaction();
+    });
+
+    // A long snapshot holds revision 1 while later revisions pile up
+    std::thread reader([&] {
+        TThread::set_id(1);
+        while (phase != 1)
+            std::this_thread::sleep_for(1ms);
+        TRANSACTION_E {
+            for (int i = 0; i != num_boxes; ++i)
+                assert(boxes[i].read().is(i, 1));
+            phase = 2;
+            while (phase != 3)
+                std::this_thread::sleep_for(1ms);
+            // revision 1 is compressed by now: read it back
+            for (int i = 0; i != num_boxes; ++i)
+                assert(boxes[i].read().is(i, 1));
+        } RETRY_E(false);
+        phase = 4;
+        Sto::delete_transaction();
+    });
+
+    while (phase != 2)
+        std::this_thread::sleep_for(1ms);
+    for (int n = 0; n != 2000 && MvCompressor::compressed_versions() < size_t(num_boxes); ++n)
+        std::this_thread::sleep_for(1ms);
+    assert(MvCompressor::compressed_versions() >= size_t(num_boxes));
+    assert(MvCompressor::compressed_bytes() < MvCompressor::compressed_versions() * sizeof(wide_row) / 2);
+    MvCompressor::print_stats(std::cout);
+    phase = 3;
+
+    reader.join();
+    writer.join();
+    for (int i = 0; i != num_boxes; ++i)
+        assert(boxes[i].nontrans_read().is(i, num_revisions));
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    std::thread advancer(&Transaction::epoch_advancer, nullptr);
+    testCodec();
+    testDisabled();
+    testColdVersions();
+    Transaction::rcu_release_all(advancer, 2);
+    // only the latest versions are left, none of them compressed
+    assert(MvCompressor::compressed_versions() == 0);
+    MvCompressor::print_stats(std::cout);
+    return 0;
+}
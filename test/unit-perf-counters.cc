@@ -0,0 +1,125 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <vector>
+#include "Sto.hh"
+#include "PerfCounters.hh"
+
+typedef PerfCounters::sample sample;
+
+static const char* const phase_names[] = {"walk", "spin", "threads"};
+
+// Touches `n` cache lines spread over a large buffer
+static uint64_t walk(std::vector<uint64_t>& buf, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0, pos = 0; i != n; ++i) {
+        pos = (pos + 4099 * 8) % buf.size();
+        sum += buf[pos]++;
+    }
+    return sum;
+}
+
+void testSamples() {
+    std::vector<uint64_t> buf(size_t(64) << 20 >> 3);
+    sample a, b;
+    PerfCounters::read(a);
+    volatile uint64_t sink = walk(buf, 1 << 20);
+    (void)sink;
+    PerfCounters::read(b);
+    assert(b.tsc > a.tsc);
+
+    std::cout << "counters: " << PerfCounters::status() << std::endl;
+    for (int e = 0; e != PerfCounters::ev_count; ++e) {
+        if (PerfCounters::available(e))
+            assert(b.v[e] >= a.v[e]);
+        else
+            assert(a.v[e] == 0 && b.v[e] == 0);
+    }
+    if (PerfCounters::available(PerfCounters::ev_instructions))
+        assert(b.v[PerfCounters::ev_instructions] - a.v[PerfCounters::ev_instructions] > (1 << 20));
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testPhases() {
+    std::vector<uint64_t> buf(size_t(16) << 20 >> 3);
+    for (int n = 0; n != 10; ++n) {
+        sample start;
+        PerfCounters::read(start);
+        volatile uint64_t sink = walk(buf, 1 << 16);
+        (void)sink;
+        PerfCounters::account(0, start);
+    }
+    for (int n = 0; n != 5; ++n) {
+        sample start;
+        PerfCounters::read(start);
+        for (volatile int i = 0; i != 100000; ++i)
+            /* spin */;
+        PerfCounters::account(1, start);
+    }
+
+    auto walked = PerfCounters::phase_totals(0);
+    auto spun = PerfCounters::phase_totals(1);
+    assert(walked.scopes == 10 && spun.scopes == 5);
+    assert(walked.tsc > 0 && spun.tsc > 0);
+    if (PerfCounters::available(PerfCounters::ev_instructions))
+        assert(spun.v[PerfCounters::ev_instructions] > 5 * 100000);
+    assert(PerfCounters::phase_totals(2).scopes == 0);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+
+void testThreads() {
+    // each thread opens its own group and accounts to its own slot
+    std::vector<std::thread> thrs;
+    for (int i = 0; i != num_threads; ++i)
+        thrs.emplace_back([] (int id) {
+            TThread::set_id(id);
+            for (int n = 0; n != 100; ++n) {
+                sample start;
+                PerfCounters::read(start);
+                for (volatile int j = 0; j != 1000; ++j)
+                    /* spin */;
+                PerfCounters::account(2, start);
+            }
+        }, i);
+    for (auto& t : thrs)
+        t.join();
+    assert(PerfCounters::phase_totals(2).scopes == num_threads * 100);
+    PerfCounters::print_phases(std::cout, phase_names, 3, PROC_TSC_FREQ);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testDisabled() {
+    PerfCounters::reset();
+    PerfCounters::configure(false);
+    std::thread t([] {
+        // only the TSC is read
+        sample a, b;
+        PerfCounters::read(a);
+        PerfCounters::read(b);
+        assert(b.tsc >= a.tsc);
+        for (int e = 0; e != PerfCounters::ev_count; ++e)
+            assert(a.v[e] == 0 && b.v[e] == 0);
+        PerfCounters::account(0, a);
+    });
+    t.join();
+    assert(PerfCounters::status() == "disabled");
+    assert(PerfCounters::phase_totals(0).scopes == 1);
+    assert(PerfCounters::phase_totals(1).scopes == 0);
+    PerfCounters::configure(true);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testSamples();
+    testPhases();
+    testThreads();
+    testDisabled();
+    return 0;
+}
@@ -0,0 +1,240 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include "Sto.hh"
+
+// A minimal OCC register whose reads go through CCPolicy::apply, like the
+// DB indexes' access sites
+class OccBox : public TObject {
+public:
+    typedef TNonopaqueVersion version_type;
+
+    std::pair<bool, long> read() const {
+        auto item = Sto::item(this, 0);
+        if (item.has_write())
+            return {true, item.template write_value<long>()};
+        CCPolicy::apply<version_type>(item.item(), -1);
+        if (!item.observe(vers_))
+            return {false, 0};
+        acquire_fence();
+        return {true, v_};
+    }
+    bool write(long x) {
+        Sto::item(this, 0).add_write(x);
+        return true;
+    }
+
+    bool locked() const {
+        return vers_.is_locked();
+    }
+    long nontrans_read() const {
+        return v_;
+    }
+
+    bool lock(TransItem& item, Transaction& txn) override {
+        return txn.try_lock(item, vers_);
+    }
+    bool check(TransItem& item, Transaction& txn) override {
+        return vers_.cp_check_version(txn, item);
+    }
+    void install(TransItem& item, Transaction& txn) override {
+        v_ = item.template write_value<long>();
+        txn.set_version_unlock(vers_, item);
+    }
+    void unlock(TransItem& item) override {
+        vers_.cp_unlock(item);
+    }
+
+private:
+    mutable version_type vers_;
+    long v_ = 0;
+};
+
+void testHotItemLockedOnRetry() {
+    ContentionManager::fallback_aborts = 1;
+    OccBox a, b;
+
+    {
+        TestTransaction t1(1);
+        auto r = a.read();
+        assert(r.first);
+        assert(b.read().first);
+
+        TestTransaction t2(2);
+        assert(a.write(5));
+        assert(t2.try_commit());
+
+        t1.use();
+        assert(!t1.try_commit());
+
+        // the retry locks `a`, which caused the abort, but not `b`
+        t1.use();
+        Sto::start_transaction();
+        assert(t1.get_tx().fallback());
+        // ...but only through versions that honor the item's mode
+        CCPolicy::apply<TicTocVersion<>>(Sto::item(&a, 0).item(), -1);
+        assert(Sto::item(&a, 0).item().cc_mode() == CCMode::none);
+        r = a.read();
+        assert(r.first && r.second == 5);
+        assert(a.locked());
+        assert(b.read().first);
+        assert(!b.locked());
+
+        TestTransaction t3(2);
+        assert(!a.read().first);
+        t3.get_tx().silent_abort();
+
+        t1.use();
+        assert(a.write(r.second + 1));
+        assert(t1.try_commit());
+    }
+
+    assert(!a.locked());
+    assert(a.nontrans_read() == 6);
+
+    // read-only fallback attempts release their locks too
+    {
+        TestTransaction t1(1);
+        assert(a.read().first);
+        TestTransaction t2(2);
+        assert(a.write(7));
+        assert(t2.try_commit());
+        t1.use();
+        assert(!t1.try_commit());
+
+        t1.use();
+        Sto::start_transaction();
+        assert(a.read().first);
+        assert(a.locked());
+        assert(t1.try_commit());
+    }
+
+    assert(!a.locked());
+    ContentionManager::fallback_aborts = 0;
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testSerialToken() {
+    ContentionManager::serial_aborts = 2;
+    OccBox a;
+
+    {
+        TestTransaction t(1);
+        for (int i = 0; i != 2; ++i) {
+            assert(ContentionManager::serial_token == 0);
+            t.get_tx().silent_abort();
+            Sto::start_transaction();
+        }
+        assert(ContentionManager::serial_token != 0);
+        assert(a.write(1));
+        assert(t.try_commit());
+        assert(ContentionManager::serial_token == 0);
+    }
+
+    // committing resets the abort count
+    {
+        TestTransaction t(1);
+        assert(a.read().first);
+        assert(t.try_commit());
+        t.use();
+        Sto::start_transaction();
+        assert(ContentionManager::serial_token == 0);
+        assert(t.try_commit());
+    }
+
+    ContentionManager::serial_aborts = 0;
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testPriority() {
+    auto& cm = ContentionManager::cm_info;
+    auto reset = [&] () {
+        for (int i : {1, 2})
+            cm[i].aborted = 0;
+    };
+
+    // a more urgent requester wounds the owner and waits
+    ContentionManager::set_priority(1, 1);
+    ContentionManager::set_priority(2, 0);
+    reset();
+    assert(!ContentionManager::should_abort(1, 2));
+    assert(cm[2].aborted == 1);
+    // a less urgent one yields, however old it is
+    reset();
+    cm[2].timestamp = 0;
+    cm[1].timestamp = MAX_TS - 1;
+    assert(ContentionManager::should_abort(2, 1));
+    assert(cm[1].aborted == 0);
+
+    // same class: the earlier deadline wins, and any deadline beats none
+    ContentionManager::set_priority(1, 0, 1000);
+    ContentionManager::set_priority(2, 0, 2000);
+    assert(ContentionManager::compare_priority(1, 2) > 0);
+    assert(ContentionManager::compare_priority(2, 1) < 0);
+    ContentionManager::set_priority(1, 0);
+    assert(ContentionManager::compare_priority(2, 1) > 0);
+    ContentionManager::set_priority(2, 0);
+    assert(ContentionManager::compare_priority(1, 2) == 0);
+
+    // 2PL wait-die orders by priority before start timestamp
+    ContentionManager::lock_policy = LockPolicy::wait_die;
+    ContentionManager::set_priority(2, 1);
+    cm[1].start_ts = 1;
+    cm[2].start_ts = 2;
+    reset();
+    assert(!ContentionManager::should_wait(1, 2));
+    assert(ContentionManager::should_wait(2, 1));
+    ContentionManager::lock_policy = LockPolicy::spin;
+    ContentionManager::set_priority(2, 0);
+    reset();
+
+    // where nothing orders the conflict, higher classes spin longer
+    ContentionManager::set_priority(1, 2);
+    assert(ContentionManager::spin_bound(1) == 4 * ContentionManager::spin_bound(2));
+    ContentionManager::set_priority(1, 0);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int txns_per_thread = 20000;
+
+void testConcurrentHot() {
+    ContentionManager::fallback_aborts = 2;
+    ContentionManager::serial_aborts = 8;
+    OccBox hot;
+    std::vector<std::thread> thrs;
+
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&hot] (int id) {
+            TThread::set_id(id);
+            for (int n = 0; n < txns_per_thread; ++n) {
+                TRANSACTION {
+                    auto r = hot.read();
+                    TXN_DO(r.first);
+                    TXN_DO(hot.write(r.second + 1));
+                } RETRY(true);
+            }
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+
+    assert(!hot.locked());
+    assert(hot.nontrans_read() == (long) num_threads * txns_per_thread);
+    ContentionManager::fallback_aborts = ContentionManager::serial_aborts = 0;
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testHotItemLockedOnRetry();
+    testSerialToken();
+    testPriority();
+    testConcurrentHot();
+    return 0;
+}
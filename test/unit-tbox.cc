@@ -161,6 +161,98 @@ void testNoOpacity1() {
     printf("PASS: %s\n", __FUNCTION__);
 }
 
+void testEarlyValidation() {
+    TBox<int, TNonopaqueWrapped<int> > f, g;
+    f.nontrans_write(3);
+    Transaction::validate_every = 1;
+
+    {
+        TestTransaction t1(1);
+        int x = f;
+        assert(x == 3);
+
+        TestTransaction t(2);
+        f = 2;
+        assert(t.try_commit());
+
+        // the next read notices that f changed
+        t1.use();
+        assert(!g.read_nothrow().first);
+        t1.get_tx().silent_abort();
+    }
+
+    {
+        TestTransaction t1(1);
+        int x = f;
+        assert(x == 2);
+        x = g;
+        assert(x == 0);
+        assert(Sto::validate_point());
+        assert(t1.try_commit());
+    }
+
+    Transaction::validate_every = 0;
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testRepair() {
+    struct boxes {
+        TBox<int> ctr, out, other;
+    } b;
+
+    auto fragment = [] (void* arg) {
+        auto& b = *static_cast<boxes*>(arg);
+        int v = b.ctr.nontrans_read();
+        b.ctr = v + 1;
+        b.out = v * 10;
+        return true;
+    };
+
+    {
+        TestTransaction t1(1);
+        int v = b.ctr;
+        b.ctr = v + 1;
+        b.out = v * 10;
+        b.ctr.add_repair(fragment, &b);
+
+        TestTransaction t2(2);
+        b.ctr = 5;
+        assert(t2.try_commit());
+
+        // the stale counter read is redone instead of aborting
+        t1.use();
+        assert(t1.try_commit());
+    }
+
+    assert(b.ctr.nontrans_read() == 6);
+    assert(b.out.nontrans_read() == 50);
+
+    // repairs may not touch items the transaction hasn't locked
+    {
+        TestTransaction t1(1);
+        int v = b.ctr;
+        b.ctr = v + 1;
+        b.ctr.add_repair([] (void* arg) {
+            auto& b = *static_cast<boxes*>(arg);
+            b.other = b.ctr.nontrans_read();
+            return true;
+        }, &b);
+
+        TestTransaction t2(2);
+        b.ctr = 7;
+        assert(t2.try_commit());
+
+        t1.use();
+        assert(!t1.try_commit());
+    }
+
+    assert(b.ctr.nontrans_read() == 7);
+    assert(b.other.nontrans_read() == 0);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
 #if 0
 void testStringWrapper() {
     TBox<std::string> f;
@@ -255,6 +347,8 @@ int main() {
     testConcurrentInt();
     testOpacity1();
     testNoOpacity1();
+    testEarlyValidation();
+    testRepair();
     //testStringWrapper();
 
     std::thread advancer;  // empty thread because we have no advancer thread
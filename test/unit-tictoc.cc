@@ -0,0 +1,196 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include "Sto.hh"
+
+// A TicToc register over either timestamp representation
+template <typename V>
+class TTBox : public TObject {
+public:
+    typedef V version_type;
+
+    std::pair<bool, long> read() const {
+        auto item = Sto::item(this, 0);
+        if (item.has_write())
+            return {true, item.template write_value<long>()};
+        if (!item.observe(vers_))
+            return {false, 0};
+        acquire_fence();
+        return {true, v_};
+    }
+    bool write(long x) {
+        return Sto::item(this, 0).acquire_write(vers_, x);
+    }
+
+    const version_type& version() const {
+        return vers_;
+    }
+    long nontrans_read() const {
+        return v_;
+    }
+
+    bool lock(TransItem& item, Transaction& txn) override {
+        return txn.try_lock(item, vers_);
+    }
+    bool check(TransItem& item, Transaction& txn) override {
+        return vers_.cp_check_version(txn, item);
+    }
+    void install(TransItem& item, Transaction& txn) override {
+        v_ = item.template write_value<long>();
+        txn.set_version_unlock(vers_, item);
+    }
+    void unlock(TransItem& item) override {
+        vers_.cp_unlock(item);
+    }
+
+private:
+    mutable version_type vers_;
+    long v_ = 0;
+};
+
+template <typename V>
+static void bump(TTBox<V>& box, int n, int threadid = 1) {
+    for (int i = 0; i != n; ++i) {
+        TestTransaction t(threadid);
+        auto r = box.read();
+        assert(r.first);
+        assert(box.write(r.second + 1));
+        assert(t.try_commit());
+    }
+}
+
+// Reads `cold` in a transaction whose commit ts is past `hot`'s rts
+template <typename V>
+static bool read_cold(TTBox<V>& cold, TTBox<V>& hot, int threadid = 1) {
+    TestTransaction t(threadid);
+    assert(cold.read().first);
+    auto r = hot.read();
+    assert(r.first);
+    assert(hot.write(r.second + 1));
+    return t.try_commit();
+}
+
+template <typename V>
+void testExtension(const char* name) {
+    TTBox<V> cold, hot;
+    bump(cold, 1);
+    auto wts = cold.version().write_timestamp();
+    assert(cold.version().read_timestamp() == wts);
+
+    bump(hot, 5);
+    assert(read_cold(cold, hot));
+    // extended to the reader's commit ts, which is also hot's new wts
+    assert(cold.version().write_timestamp() == wts);
+    assert(cold.version().read_timestamp() == hot.version().write_timestamp());
+
+    // once read-hot, extensions are batched
+    TicTocTid::extend_batch = 10;
+    bump(hot, 1);
+    assert(read_cold(cold, hot));
+    assert(cold.version().write_timestamp() == wts);
+    assert(cold.version().read_timestamp() == hot.version().write_timestamp() + 10);
+
+    // ... which later readers need not extend
+    auto rts = cold.version().read_timestamp();
+    bump(hot, 1);
+    assert(read_cold(cold, hot));
+    assert(cold.version().read_timestamp() == rts);
+
+    // writers commit after the extended rts
+    bump(cold, 1);
+    assert(cold.version().write_timestamp() == rts + 1);
+    TicTocTid::extend_batch = 0;
+
+    printf("PASS: %s<%s>\n", __FUNCTION__, name);
+}
+
+void testCompressedHistory() {
+    typedef TicTocCompressedVersion<> V;
+    TTBox<V> cold, hot;
+    bump(cold, 1);
+    auto wts = cold.version().write_timestamp();
+
+    // an extension past the largest delta moves the wts forward
+    bump(hot, TicTocCompressedTid::delta_max + 10);
+    assert(read_cold(cold, hot));
+    assert(cold.version().read_timestamp() == hot.version().write_timestamp());
+    assert(cold.version().write_timestamp() > wts);
+    assert(cold.version().read_timestamp() - cold.version().write_timestamp()
+           == TicTocCompressedTid::delta_max);
+
+    // a transaction that read the older wts then fails validation, though
+    // cold was never written
+    {
+        TestTransaction t1(1);
+        assert(cold.read().first);
+        wts = cold.version().write_timestamp();
+        bump(hot, TicTocCompressedTid::delta_max + 10, 2);
+        assert(read_cold(cold, hot, 2));
+        assert(cold.version().write_timestamp() > wts);
+        t1.use();
+        auto r = hot.read();
+        assert(r.first);
+        assert(hot.write(r.second + 1));
+        assert(!t1.try_commit());
+    }
+    assert(cold.nontrans_read() == 1);
+
+    // flags survive compression
+    V flagged(Sto::initialized_tid() | TransactionTid::user_bit);
+    assert(flagged.value() & TransactionTid::user_bit);
+    assert(!flagged.is_locked());
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int txns_per_thread = 10000;
+
+template <typename V>
+void testConcurrent(const char* name) {
+    TicTocTid::extend_batch = 4;
+    TTBox<V> boxes[4];
+    std::vector<std::thread> thrs;
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&boxes] (int id) {
+            TThread::set_id(id);
+            for (int n = 0; n < txns_per_thread; ++n) {
+                TRANSACTION {
+                    // everyone reads boxes 1-3; each thread writes box 0 or its own
+                    long sum = 0;
+                    for (int j = 1; j != 4; ++j) {
+                        auto r = boxes[j].read();
+                        TXN_DO(r.first);
+                        sum += r.second;
+                    }
+                    auto& w = boxes[n % 4 == 0 ? 0 : 1 + id % 3];
+                    auto r = w.read();
+                    TXN_DO(r.first);
+                    TXN_DO(w.write(r.second + 1));
+                    (void) sum;
+                } RETRY(true);
+            }
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+
+    long total = 0;
+    for (auto& b : boxes)
+        total += b.nontrans_read();
+    assert(total == (long) num_threads * txns_per_thread);
+    TicTocTid::extend_batch = 0;
+
+    printf("PASS: %s<%s>\n", __FUNCTION__, name);
+}
+
+int main() {
+    testExtension<TicTocVersion<>>("wide");
+    testExtension<TicTocCompressedVersion<>>("compressed");
+    testCompressedHistory();
+    testConcurrent<TicTocVersion<>>("wide");
+    testConcurrent<TicTocCompressedVersion<>>("compressed");
+    return 0;
+}
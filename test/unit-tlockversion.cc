@@ -0,0 +1,297 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include "Sto.hh"
+
+// A minimal 2PL register over TLockVersion
+template <bool ReaderBias>
+class LockBox : public TObject {
+public:
+    typedef TLockVersion<false, ReaderBias> version_type;
+
+    std::pair<bool, long> read() const {
+        auto item = Sto::item(this, 0);
+        if (item.has_write())
+            return {true, item.template write_value<long>()};
+        CCPolicy::apply(item.item(), site);
+        if (!item.observe(vers_))
+            return {false, 0};
+        acquire_fence();
+        return {true, v_};
+    }
+    bool write(long x) {
+        return Sto::item(this, 0).acquire_write(vers_, x);
+    }
+
+    TransactionTid::type version() const {
+        return vers_.value();
+    }
+    long nontrans_read() const {
+        return v_;
+    }
+
+    bool lock(TransItem& item, Transaction& txn) override {
+        return txn.try_lock(item, vers_);
+    }
+    bool check(TransItem& item, Transaction& txn) override {
+        return vers_.cp_check_version(txn, item);
+    }
+    void install(TransItem& item, Transaction& txn) override {
+        v_ = item.template write_value<long>();
+        txn.set_version_unlock(vers_, item);
+    }
+    void unlock(TransItem& item) override {
+        vers_.cp_unlock(item);
+    }
+
+    int site = -1;
+
+private:
+    mutable version_type vers_;
+    long v_ = 0;
+};
+
+void testBiasedReadsLeaveVersion() {
+    LockBox<true> b;
+    LockBox<false> c;
+    auto bv = b.version();
+    auto cv = c.version();
+    assert(bv & TransactionTid::nonopaque_bit);
+
+    {
+        TestTransaction t1(1);
+        assert(b.read().first);
+        assert(c.read().first);
+
+        TestTransaction t2(2);
+        assert(b.read().first);
+        assert(c.read().first);
+
+        // biased readers don't touch the version word
+        assert(b.version() == bv);
+        assert((c.version() & TransactionTid::threadid_mask) == 2);
+        assert(t2.try_commit());
+
+        t1.use();
+        assert(t1.try_commit());
+    }
+
+    assert(b.version() == bv);
+    assert(c.version() == cv);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testWriterRevokesBias() {
+    LockBox<true> b;
+
+    {
+        TestTransaction t1(1);
+        assert(b.read().first);
+
+        // the biased reader blocks the writer
+        TestTransaction t2(2);
+        assert(!b.write(1));
+        assert(b.version() & TransactionTid::nonopaque_bit);
+        t2.get_tx().silent_abort();
+
+        t1.use();
+        assert(t1.try_commit());
+    }
+
+    {
+        TestTransaction t(2);
+        assert(b.write(2));
+        assert(t.try_commit());
+    }
+
+    assert(b.nontrans_read() == 2);
+
+    // Biased readers may upgrade
+    LockBox<true> u;
+    {
+        TestTransaction t(1);
+        assert(u.read().first);
+        assert(u.write(3));
+        assert(TransactionTid::is_locked(u.version()));
+        assert(t.try_commit());
+    }
+
+    assert(u.nontrans_read() == 3);
+
+    {
+        TestTransaction t(2);
+        assert(u.write(4));
+        assert(t.try_commit());
+    }
+
+    assert(u.nontrans_read() == 4);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int txns_per_thread = 20000;
+
+void testConcurrentReadMostly() {
+    LockBox<true> b;
+    std::vector<std::thread> thrs;
+
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&b] (int id) {
+            TThread::set_id(id);
+            for (int n = 0; n < txns_per_thread; ++n) {
+                TRANSACTION {
+                    auto r = b.read();
+                    TXN_DO(r.first);
+                    if (n % 16 == 0)
+                        TXN_DO(b.write(r.second + 1));
+                } RETRY(true);
+            }
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+
+    assert(b.nontrans_read() == (long) num_threads * ((txns_per_thread + 15) / 16));
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testPolicyActions() {
+    LockBox<false> b;
+    b.site = 2;
+    auto bv = b.version();
+
+    const char* path = "/tmp/unit-tlockversion.policy";
+    FILE* f = fopen(path, "w");
+    assert(f);
+    fprintf(f, "# txn site action\n1 2 opt\n");
+    fclose(f);
+    assert(CCPolicy::load(path));
+    assert(CCPolicy::get(1, 2) == CCAction::optimistic);
+    assert(CCPolicy::get(0, 2) == CCAction::none);
+
+    {
+        // an optimistic read takes no read lock
+        CCPolicy::begin(1);
+        TestTransaction t(1);
+        assert(b.read().first);
+        assert(b.version() == bv);
+        assert(t.try_commit());
+    }
+
+    {
+        CCPolicy::begin(0);
+        TestTransaction t(1);
+        assert(b.read().first);
+        assert(b.version() != bv);
+        assert(t.try_commit());
+    }
+
+    assert(b.version() == bv);
+
+    // malformed files leave the policy alone
+    f = fopen(path, "w");
+    fprintf(f, "1 2 sometimes\n");
+    fclose(f);
+    assert(!CCPolicy::load(path));
+    assert(CCPolicy::get(1, 2) == CCAction::optimistic);
+    remove(path);
+    CCPolicy::clear();
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+// Policies leave items observing TicToc versions alone; those claim the
+// item's mode for their timestamps.
+void testPolicySkipsTicToc() {
+    LockBox<false> b;
+    CCPolicy::set(1, 2, CCAction::locked);
+    CCPolicy::begin(1);
+
+    {
+        TestTransaction t(1);
+        auto item = Sto::item(&b, 0);
+        CCPolicy::apply<TicTocVersion<>>(item.item(), 2);
+        assert(item.item().cc_mode() == CCMode::none);
+        CCPolicy::apply<TLockVersion<false>>(item.item(), 2);
+        assert(item.item().cc_mode() == CCMode::lock);
+        t.get_tx().silent_abort();
+    }
+
+    CCPolicy::begin(0);
+    CCPolicy::clear();
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+// Two transactions lock a and b in opposite orders. The older one (t1,
+// which started first) blocks on b, held by the younger t2; t2 then asks
+// for a. Wait-die makes t2 die on that request, wound-wait has t1 wound t2
+// while waiting, so t2 aborts at its next wait. Either way t1 commits.
+void testLockPolicy(LockPolicy policy) {
+    ContentionManager::lock_policy = policy;
+    LockBox<false> a, b;
+    std::atomic<int> phase(0);
+
+    TestTransaction t1(1);
+    TestTransaction t2(2);
+    assert(ContentionManager::cm_info[1].start_ts < ContentionManager::cm_info[2].start_ts);
+
+    t1.use();
+    assert(a.write(1));
+    t2.use();
+    assert(b.write(2));
+
+    std::thread older([&] {
+        t1.use();
+        phase = 1;
+        // waits for t2, the younger owner
+        assert(b.write(1));
+        assert(t1.try_commit());
+        phase = 2;
+    });
+
+    while (phase != 1)
+        std::this_thread::yield();
+    if (policy == LockPolicy::wound_wait) {
+        while (!ContentionManager::cm_info[2].aborted)
+            std::this_thread::yield();
+    }
+    assert(phase == 1);
+    t2.use();
+    assert(!a.write(2));
+    t2.get_tx().silent_abort();
+    older.join();
+
+    assert(phase == 2);
+    assert(a.nontrans_read() == 1 && b.nontrans_read() == 1);
+
+    // the restarted t2 keeps its timestamp, so it eventually wins
+    auto ts2 = ContentionManager::cm_info[2].start_ts;
+    t2.use();
+    Sto::start_transaction();
+    assert(ContentionManager::cm_info[2].start_ts == ts2);
+    assert(!ContentionManager::cm_info[2].aborted);
+    assert(a.write(2) && b.write(2));
+    assert(t2.try_commit());
+    assert(a.nontrans_read() == 2 && b.nontrans_read() == 2);
+
+    ContentionManager::lock_policy = LockPolicy::spin;
+    printf("PASS: %s(%s)\n", __FUNCTION__, policy == LockPolicy::wait_die ? "wait-die" : "wound-wait");
+}
+
+int main() {
+    testBiasedReadsLeaveVersion();
+    testWriterRevokesBias();
+    testConcurrentReadMostly();
+    testPolicyActions();
+    testPolicySkipsTicToc();
+    testLockPolicy(LockPolicy::wait_die);
+    testLockPolicy(LockPolicy::wound_wait);
+    return 0;
+}
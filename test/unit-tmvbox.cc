@@ -447,8 +447,109 @@ void testCommuteGC() {
     printf("PASS: %s\n", __FUNCTION__);
 }
 
+// Runs the RCU callbacks (including scheduled flattens) of all threads
+static void run_rcu_callbacks() {
+    for (auto& t : Transaction::tinfo) {
+        t.write_snapshot_epoch = 0;
+        t.epoch = 0;
+    }
+    for (int i = 0; i != 4; ++i)
+        Transaction::global_epoch_advance_once();
+    for (auto& t : Transaction::tinfo)
+        t.rcu_set.clean_until(Transaction::global_epochs.active_epoch);
+}
+
+// Number of DELTA versions above the newest flat version
+static int delta_run(TMvCommuteIntegerBox& box) {
+    TransactionGuard t;
+    Sto::mvcc_rw_upgrade();
+    int n = 0;
+    for (auto h = TMvBoxAccess::head(box); h && h->status_is(COMMITTED_DELTA); h = h->prev())
+        ++n;
+    return n;
+}
+
+static void commit_increments(TMvCommuteIntegerBox& box, int n) {
+    for (int i = 0; i != n; ++i) {
+        TransactionGuard t;
+        box.increment(1);
+    }
+}
+
+void testAdaptiveFlattening() {
+    typedef MvObject<int64_t> object_type;
+    // Runs first: the callbacks of earlier tests refer to their boxes, and
+    // these boxes outlive the test for the same reason
+
+    // a write-only object keeps long delta chains
+    static TMvCommuteIntegerBox wbox;
+    wbox.nontrans_write(0);
+    assert(TMvBoxAccess::object(wbox).flattening_length() == object_type::gc_flattening_length_max);
+    commit_increments(wbox, 4 * object_type::gc_flattening_length_min);
+    run_rcu_callbacks();
+    assert(delta_run(wbox) == 4 * object_type::gc_flattening_length_min);
+
+    // sampled reads shorten the allowed chain
+    static TMvCommuteIntegerBox box;
+    box.nontrans_write(0);
+    int reads = 0;
+    while (TMvBoxAccess::object(box).flattening_length() > 2 * object_type::gc_flattening_length_min) {
+        TransactionGuard t;
+        assert(static_cast<int64_t>(box) == 0);
+        ++reads;
+    }
+    assert(reads <= 6 * int(object_type::read_sample_rate));
+    int length = TMvBoxAccess::object(box).flattening_length();
+
+    // a chain up to the threshold stays unflattened...
+    commit_increments(box, length);
+    run_rcu_callbacks();
+    assert(delta_run(box) == length);
+
+    // ...and one more delta schedules a flatten of the chain
+    commit_increments(box, 1);
+    assert(delta_run(box) == length + 1);
+    run_rcu_callbacks();
+    assert(delta_run(box) == 0);
+    {
+        TransactionGuard t;
+        Sto::mvcc_rw_upgrade();
+        auto h = TMvBoxAccess::head(box);
+        assert(h->status_is(COMMITTED_DELTA, COMMITTED));
+        assert(h->v() == length + 1);
+    }
+    assert(box.nontrans_read() == length + 1);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testNontransKeepsGCFlags() {
+    TMvBox<int> box;
+    box.nontrans_write(0);
+
+    MvHistory<int> *h = nullptr;
+    {
+        TestTransaction t1(1);
+        box = 1;
+        assert(t1.try_commit());
+        TestTransaction t2(2);
+        h = TMvBoxAccess::head(box);
+        assert(t2.try_commit());
+    }
+    assert(h->status() == COMMITTED);
+
+    // as if gc_committed_cb had run on the latest version
+    h->status(MvStatus(h->status() | SWEPT));
+    box.nontrans_write(2);
+    assert(h->status() == (COMMITTED | SWEPT));
+    assert(box.nontrans_read() == 2);
+    assert(h->status() == (COMMITTED | SWEPT));
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
 
 int main() {
+    testAdaptiveFlattening();
     testSimpleInt();
     testSimpleString();
     testConcurrentInt();
@@ -458,6 +559,7 @@ int main() {
     testMvCommute1();
     testMvCommute2();
     testCommuteGC();
+    testNontransKeepsGCFlags();
 #if MVCC_INLINING
     testMvInline();
 #endif
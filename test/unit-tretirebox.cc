@@ -0,0 +1,149 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include "Sto.hh"
+#include "TRetireBox.hh"
+
+void testPlain2PL() {
+    TRetireBox<int, false> b;
+
+    {
+        TestTransaction t(1);
+        b = 3;
+        assert(!b.retire());
+        assert(!b.is_retired());
+        assert(t.try_commit());
+    }
+
+    assert(b.nontrans_read() == 3);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testDependentCommit() {
+    TRetireBox<int> b;
+
+    {
+        TestTransaction t1(1);
+        b = 1;
+        assert(b.retire());
+        assert(b.is_retired());
+        assert(b.nontrans_read() == 1);
+
+        // t2 sees the dirty value and may write over it
+        TestTransaction t2(2);
+        int v = b;
+        assert(v == 1);
+        b = v + 1;
+
+        t1.use();
+        assert(t1.try_commit());
+        assert(!b.is_retired());
+
+        t2.use();
+        assert(t2.try_commit());
+    }
+
+    assert(b.nontrans_read() == 2);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testCascadingAbort() {
+    TRetireBox<int> b;
+    TRetireBox<int> other;
+
+    {
+        TestTransaction t1(1);
+        b = 5;
+        assert(b.retire());
+
+        TestTransaction t2(2);
+        int v = b;
+        assert(v == 5);
+        other = v;
+
+        t1.use();
+        t1.get_tx().silent_abort();
+        assert(!b.is_retired());
+        assert(b.nontrans_read() == 0);
+
+        t2.use();
+        assert(!t2.try_commit());
+    }
+
+    assert(b.nontrans_read() == 0);
+    assert(other.nontrans_read() == 0);
+
+    // The record is usable again
+    {
+        TestTransaction t(1);
+        int v = b;
+        assert(v == 0);
+        b = 7;
+        assert(t.try_commit());
+    }
+
+    assert(b.nontrans_read() == 7);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testWriteAfterRetire() {
+    TRetireBox<int> b;
+
+    {
+        TestTransaction t(1);
+        b = 1;
+        assert(b.retire());
+        int v = b;
+        assert(v == 1);
+        assert(!b.write_nothrow(2));
+        t.get_tx().silent_abort();
+    }
+
+    assert(!b.is_retired());
+    assert(b.nontrans_read() == 0);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int updates_per_thread = 20000;
+
+void testConcurrentHot() {
+    TRetireBox<long> hot;
+    std::vector<std::thread> thrs;
+
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&hot] (int id) {
+            TThread::set_id(id);
+            for (int n = 0; n < updates_per_thread; ++n) {
+                TRANSACTION {
+                    auto r = hot.read_nothrow();
+                    TXN_DO(r.first);
+                    TXN_DO(hot.write_nothrow(r.second + 1));
+                    hot.retire();
+                } RETRY(true);
+            }
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+
+    assert(!hot.is_retired());
+    assert(hot.nontrans_read() == (long) num_threads * updates_per_thread);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testPlain2PL();
+    testDependentCommit();
+    testCascadingAbort();
+    testWriteAfterRetire();
+    testConcurrentHot();
+    return 0;
+}
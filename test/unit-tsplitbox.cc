@@ -0,0 +1,177 @@
+#undef NDEBUG
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thread>
+#include "Sto.hh"
+#include "TBox.hh"
+#include "TSplitBox.hh"
+
+void testJoined() {
+    TSplitBox<int> c;
+
+    {
+        TransactionGuard t;
+        c.apply(3);
+        c.apply(4);
+    }
+
+    {
+        TransactionGuard t;
+        int v = c;
+        assert(v == 7);
+        c.apply(1);
+        v = c;
+        assert(v == 8);
+    }
+
+    assert(!c.is_split());
+    assert(c.nontrans_read() == 8);
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testSplitUpdates() {
+    TSplitBox<int> c;
+    c.nontrans_write(10);
+    c.split();
+    assert(c.is_split());
+
+    {
+        TestTransaction t1(1);
+        c.apply(1);
+
+        TestTransaction t2(2);
+        c.apply(2);
+        assert(t2.try_commit());
+
+        t1.use();
+        assert(t1.try_commit());
+    }
+
+    assert(c.is_split());
+    assert(c.nontrans_read() == 13);
+
+    // A read reconciles the slices back into the record
+    {
+        TestTransaction t(1);
+        int v = c;
+        assert(v == 13);
+        assert(!c.is_split());
+        assert(t.try_commit());
+    }
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testSplitInvalidatesReaders() {
+    TSplitBox<int> c;
+    TBox<int> box;
+
+    {
+        TestTransaction t1(1);
+        int v = c;
+        assert(v == 0);
+        box = 1; /* avoid read-only txn */
+
+        c.split();
+
+        TestTransaction t2(2);
+        c.apply(5);
+        assert(t2.try_commit());
+
+        t1.use();
+        assert(!t1.try_commit());
+    }
+
+    // Readers that started after the reconciliation are fine
+    {
+        TestTransaction t1(1);
+        int v = c;
+        assert(v == 5);
+        box = 2;
+        assert(t1.try_commit());
+    }
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+void testMaxAndLastWriter() {
+    TSplitBox<int, split_op::max<int>> m;
+    TSplitBox<int, split_op::last_writer<int>> lw;
+    m.split();
+    lw.split();
+
+    {
+        TestTransaction t1(1);
+        m.apply(4);
+        lw.apply(4);
+
+        TestTransaction t2(2);
+        m.apply(9);
+        lw.apply(9);
+        assert(t2.try_commit());
+
+        TestTransaction t3(3);
+        m.apply(2);
+        assert(t3.try_commit());
+
+        // t1 commits last, so its put wins
+        t1.use();
+        assert(t1.try_commit());
+    }
+
+    {
+        TestTransaction t(1);
+        int v = m;
+        assert(v == 9);
+        v = lw;
+        assert(v == 4);
+        assert(t.try_commit());
+    }
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+static constexpr int num_threads = 4;
+static constexpr int updates_per_thread = 100000;
+
+void testConcurrentHot() {
+    TSplitBox<long> c;
+    std::vector<std::thread> thrs;
+
+    for (int i = 0; i < num_threads; ++i) {
+        thrs.emplace_back([&c] (int id) {
+            TThread::set_id(id);
+            for (int n = 0; n < updates_per_thread; ++n) {
+                TRANSACTION {
+                    c.apply(1);
+                    if (id == 0 && n % 1000 == 0) {
+                        long v = c;
+                        assert(v >= n);
+                    }
+                } RETRY(true);
+            }
+        }, i);
+    }
+    for (auto& t : thrs)
+        t.join();
+
+    {
+        TestTransaction t(0);
+        long v = c;
+        assert(v == (long) num_threads * updates_per_thread);
+        assert(t.try_commit());
+    }
+
+    printf("PASS: %s\n", __FUNCTION__);
+}
+
+int main() {
+    testJoined();
+    testSplitUpdates();
+    testSplitInvalidatesReaders();
+    testMaxAndLastWriter();
+    testConcurrentHot();
+    return 0;
+}